@@ -1,28 +1,113 @@
 
 //#include <SPI.h>
-#include "rotating_buffer.h"
+#include "ring_buffer.h"
 
 static const int TX_REQUEST_PIN = 14;
-static const unsigned TX_BUFFER_SIZE = 128; // MUST be less than 255!!!
-static const unsigned RX_BUFFER_SIZE = 128; // MUST be less than 255!!!
+// The SPI ISR drives TX_REQUEST_PIN (digital 14, A0) through its port register.
+#define TX_REQUEST_PORT PORTC
+#define TX_REQUEST_BIT  PC0
+
+// 1: The ISR writes the byte for the next transfer into SPDR first, from txNext,
+//    which was fetched from txBuffer during the previous interrupt.
+// 0: The ISR reads txBuffer before writing SPDR.
+// See README.md for the SPI clock either mode can sustain.
+#define SPI_BURST_MODE 1
+
+static const unsigned TX_BUFFER_SIZE = 128; // MUST be a power of 2, at most 128.
+static const unsigned RX_BUFFER_SIZE = 128; // MUST be a power of 2, at most 128.
 static const int DEBUG_LED = 17;
+// Longest "topic,data" message, plus its null terminator. MUST match the ESP32:
+// APP_MQTT_TOPIC_CAPACITY + 1 + APP_MQTT_DATA_CAPACITY + 1 in app_queues.h.
+static const unsigned MSG_BUFFER_SIZE = 64 + 1 + 96 + 1;
+
+// Pins driven by "irrigation/zone/on", zone 1 first.
+static const uint8_t ZONE_PINS[] = { 2, 3, 4, 5 };
+static const uint8_t ZONE_COUNT = sizeof(ZONE_PINS) / sizeof(ZONE_PINS[0]);
 
 unsigned long lastPing = 0;
 int spiRxStatus = 0;
 bool waitingForFirstSpiRx = true;
 bool ledState = 0;
-String strBuffer;
 
-// Needs to be interrupt safe.
-typedef buffer_type(char, TX_BUFFER_SIZE) TxBufferType;
-volatile static TxBufferType txBuffer;
+// The message being received. Messages are null terminated "topic,data" strings.
+static char msgBuffer[MSG_BUFFER_SIZE];
+static uint8_t msgLength = 0;
+static bool msgTooLong = false;
+static unsigned messageCount = 0;
+static unsigned droppedMessageCount = 0;
 
-// Needs to be interrupt safe.
-typedef buffer_type(char, RX_BUFFER_SIZE) RxBufferType;
-volatile static RxBufferType rxBuffer;
+// Written by loop(), read by the SPI ISR.
+static RingBuffer<char, TX_BUFFER_SIZE> txBuffer;
+
+// Written by the SPI ISR, read by loop().
+static RingBuffer<char, RX_BUFFER_SIZE> rxBuffer;
 
 static volatile unsigned rxBufferOverrunCount = 0;
 
+#if SPI_BURST_MODE
+// The next byte to transmit. Only valid when txIdle is false.
+static volatile char txNext = 0;
+// True once the ISR has found txBuffer empty. Cleared by startTx(). While it is
+// set, only startTx() reads txBuffer.
+static volatile bool txIdle = true;
+#endif
+
+
+//------------------------------------------------------------------------------
+// Topic handlers. data is the text after the first ',' (empty if none).
+//------------------------------------------------------------------------------
+static void onPing(const char *data) {
+  Serial.print("SPI slave: ");
+  Serial.println(data);
+}
+
+
+// data is the zone to turn on, 1 to ZONE_COUNT. Every other zone is turned off.
+// "0" turns every zone off.
+static void onZoneOn(const char *data) {
+  uint8_t zone = atoi(data);
+  for (uint8_t ndx = 0; ndx < ZONE_COUNT; ++ndx) {
+    digitalWrite(ZONE_PINS[ndx], (ndx + 1 == zone) ? HIGH : LOW);
+  }
+}
+
+
+struct TopicHandler {
+  const char *topic;  // In flash. Compared with strcmp_P().
+  void (*handler)(const char *data);
+};
+
+static const char TOPIC_PING[] PROGMEM = "ping";
+static const char TOPIC_ZONE_ON[] PROGMEM = "irrigation/zone/on";
+
+static const TopicHandler TOPIC_HANDLERS[] = {
+  { TOPIC_PING,     onPing },
+  { TOPIC_ZONE_ON,  onZoneOn },
+};
+static const uint8_t TOPIC_HANDLER_COUNT = sizeof(TOPIC_HANDLERS) / sizeof(TOPIC_HANDLERS[0]);
+
+
+// Splits msg into topic and data, in place, and calls the topic's handler.
+static void dispatchMessage(char *msg) {
+  char *data = strchr(msg, ',');
+  if (data) {
+    *data++ = '\0';
+  } else {
+    data = msg + strlen(msg);
+  }
+
+  for (uint8_t ndx = 0; ndx < TOPIC_HANDLER_COUNT; ++ndx) {
+    if (strcmp_P(msg, TOPIC_HANDLERS[ndx].topic) == 0) {
+      TOPIC_HANDLERS[ndx].handler(data);
+      ++messageCount;
+      return;
+    }
+  }
+  ++droppedMessageCount;
+  Serial.print("Unknown topic: ");
+  Serial.println(msg);
+}
+
 
 void setup (void) {
   Serial.begin(115200/2);   // divide by 2 because we are running a 5v 16mhz Arduino Pro Mini at 3.3v 8mhz
@@ -32,8 +117,10 @@ void setup (void) {
   lastPing = millis();
   pinMode(DEBUG_LED, OUTPUT);
 
-  buffer_init(txBuffer, TX_BUFFER_SIZE);
-  buffer_init(rxBuffer, RX_BUFFER_SIZE);
+  for (uint8_t ndx = 0; ndx < ZONE_COUNT; ++ndx) {
+    pinMode(ZONE_PINS[ndx], OUTPUT);
+    digitalWrite(ZONE_PINS[ndx], LOW);
+  }
 
   pinMode(TX_REQUEST_PIN, OUTPUT);
   digitalWrite(TX_REQUEST_PIN, LOW);
@@ -78,28 +165,70 @@ void setup (void) {
 
 
 // SPI interrupt routine
+// SPDR must be written before the next transfer starts, so everything else
+// comes after it. No function calls, so the prologue only saves what the body uses.
 ISR (SPI_STC_vect) {
   char rxChar = SPDR;  // read from SPI Data Register
 
-  if (is_buffer_full(rxBuffer)) {
+#if SPI_BURST_MODE
+  // Transmit back to the SPI Master.
+  SPDR = txNext;
+
+  if (!rxBuffer.push(rxChar)) {
     //TODO: FAIL!
     ++rxBufferOverrunCount;
     spiRxStatus = -1;
-  } else {
-    // Echo the received character to the Serial Tx.
-    buffer_write(rxBuffer, rxChar);
-    //spiRxStatus = rxChar;
   }
 
+  // Fetch the byte for the following transfer. Once idle, txBuffer is left
+  // to startTx(), even if loop() has already written to it.
+  if (!txIdle) {
+    char txChar;
+    if (txBuffer.pop(txChar)) {
+      txNext = txChar;
+    } else {
+      // The last byte is on its way out.
+      txNext = 0;
+      txIdle = true;
+      TX_REQUEST_PORT &= ~_BV(TX_REQUEST_BIT);
+    }
+  }
+#else
   // Transmit back to the SPI Master.
-  if (is_buffer_empty(txBuffer)) {
-    SPDR = 0;
-  } else {
-    buffer_read(txBuffer, SPDR);
-    if (is_buffer_empty(txBuffer)) {
-      digitalWrite(TX_REQUEST_PIN, LOW);
+  char txChar;
+  if (txBuffer.pop(txChar)) {
+    SPDR = txChar;
+    if (txBuffer.isEmpty()) {
+      TX_REQUEST_PORT &= ~_BV(TX_REQUEST_BIT);
     }
+  } else {
+    SPDR = 0;
   }
+
+  if (!rxBuffer.push(rxChar)) {
+    //TODO: FAIL!
+    ++rxBufferOverrunCount;
+    spiRxStatus = -1;
+  }
+#endif
+}
+
+
+// Call after writing to txBuffer. Raises TX_REQUEST_PIN so the master starts clocking.
+static void startTx(void) {
+  uint8_t sreg = SREG;
+  cli();
+#if SPI_BURST_MODE
+  // The ISR stopped fetching when txBuffer ran dry, so hand it the first byte.
+  // While txIdle is set the ISR does not read txBuffer, and interrupts are off.
+  char txChar;
+  if (txIdle && txBuffer.pop(txChar)) {
+    txNext = txChar;
+    txIdle = false;
+  }
+#endif
+  TX_REQUEST_PORT |= _BV(TX_REQUEST_BIT);
+  SREG = sreg;
 }
 
 
@@ -108,33 +237,72 @@ static void ping(void) {
   
   if (thisPing >= lastPing + 4*1000) {
     lastPing = thisPing;
-    
+
     ledState = !ledState;
     digitalWrite(DEBUG_LED, ledState);
 
+    if (messageCount > 0 || droppedMessageCount > 0) {
+      // Over the last 4 seconds.
+      Serial.print("msgs/s:");
+      Serial.print(messageCount / 4.0);
+      Serial.print(" dropped:");
+      Serial.println(droppedMessageCount);
+      messageCount = 0;
+      droppedMessageCount = 0;
+    }
+
     // JUST TESTING...
-    //buffer_safe_write(rxBuffer, '.');
-    //buffer_safe_write(rxBuffer, '\0');
-    //
-    //unsigned dataSize = 0;
-    //buffer_data_size(rxBuffer, dataSize);
     //Serial.print("ping - buffer=");
-    //Serial.println(dataSize);
+    //Serial.println(rxBuffer.size());
   }
 }
 
 
 static void subscribe(void) {
   const char *msg = "Hello SPI.";
-  for (int ndx = 0; ndx <= strlen(msg); ++ndx) { // Include null terminator.
-    buffer_safe_write(txBuffer, msg[ndx]);
-  }
-  digitalWrite(TX_REQUEST_PIN, HIGH);
+  txBuffer.write(msg, strlen(msg) + 1); // Include null terminator.
+  startTx();
   Serial.print("SPI subscribe: ");
   Serial.println(msg);
 }
 
 
+// Consumes every character received so far and dispatches each complete message.
+static void processRxBuffer(void) {
+  uint8_t contiguous;
+  const char *span;
+
+  while (span = rxBuffer.readSpan(contiguous), contiguous > 0) {
+    for (uint8_t ndx = 0; ndx < contiguous; ++ndx) {
+      char ch = span[ndx];
+      if (ch != '\0') {
+        if (msgLength < MSG_BUFFER_SIZE - 1) {
+          msgBuffer[msgLength++] = ch;
+        } else {
+          msgTooLong = true;
+        }
+      } else if (msgTooLong) {
+        // End-of-string, but the message did not fit.
+        ++droppedMessageCount;
+        msgTooLong = false;
+        msgLength = 0;
+      } else if (msgLength > 0) {
+        // End-of-string. Empty strings are padding and are skipped.
+        msgBuffer[msgLength] = '\0';
+        dispatchMessage(msgBuffer);
+        msgLength = 0;
+      }
+    }
+    rxBuffer.consume(contiguous);
+
+    if (waitingForFirstSpiRx) {
+      waitingForFirstSpiRx = false;
+      subscribe();
+    }
+  }
+}
+
+
 // main loop - wait for flag set in interrupt routine
 void loop (void) {
   ping();
@@ -146,30 +314,5 @@ void loop (void) {
     spiRxStatus = 0;
   }
 
-  if (is_buffer_empty(rxBuffer)) {
-    // Nothing to do yet.
-  } else {
-    char tmpCh;
-    buffer_read(rxBuffer, tmpCh);
-
-    if (tmpCh != 0) {
-      //Serial.print(strBuffer);
-      //Serial.print('-');
-      //Serial.println(tmpCh);
-      strBuffer += tmpCh; // Append the char just received.
-    }
-
-    if (tmpCh == 0) {
-      // End-of-string.
-      if (strBuffer.length() > 0) {
-        Serial.println(strBuffer);
-        strBuffer = "";
-      }
-    }
-
-    if (waitingForFirstSpiRx) {
-      waitingForFirstSpiRx = false;
-      subscribe();
-    }
-  }
+  processRxBuffer();
 }
@@ -0,0 +1,221 @@
+/**
+ * <p>File: ring_buffer.h</p>
+ * <p>Create Date: 2026-10-19</p>
+ * <p>Description: Single-producer / single-consumer ring buffer template.
+ *    Replaces the rotating_buffer.h macros.</p>
+ * @author Warren Taylor
+ */
+#ifndef RING_BUFFER_H_
+#define RING_BUFFER_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVR__)
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#endif
+
+
+/******************************************************************************
+  One side (e.g. an ISR) only ever writes and the other (e.g. loop()) only
+  ever reads. Used that way no operation needs interrupts disabled:
+
+    - The writer fills a slot and only then publishes the new write index.
+    - The reader copies a slot out and only then publishes the new read index.
+
+  The indexes run freely and wrap naturally, so the number of elements in use
+  is always (writeIndex - readIndex) and a full buffer is never mistaken for
+  an empty one. Capacity must therefore be a power of 2 that is less than the
+  range of IndexType (i.e. at most 128 with uint8_t, 32768 with uint16_t).
+
+  On AVR a uint8_t index is read and written in a single instruction. A wider
+  index is read with interrupts briefly disabled.
+
+  E X A M P L E
+ ---------------
+    static RingBuffer<char, 128> rxBuffer;
+
+    ISR (SPI_STC_vect) {
+      if (!rxBuffer.push(SPDR)) {
+        ++rxBufferOverrunCount;
+      }
+    }
+
+    void loop (void) {
+      char ch;
+      while (rxBuffer.pop(ch)) {
+        ...
+      }
+    }
+******************************************************************************/
+template<typename T, unsigned Capacity, typename IndexType = uint8_t>
+class RingBuffer {
+public:
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity MUST be a power of 2.");
+    static_assert(static_cast<IndexType>(-1) > 0, "IndexType MUST be unsigned.");
+    static_assert(Capacity - 1 <= static_cast<IndexType>(static_cast<IndexType>(-1) >> 1),
+                  "Capacity MUST be less than the range of IndexType.");
+
+    RingBuffer() : readIndex(0), writeIndex(0) { }
+
+    // NOT safe while either side is active.
+    void clear() {
+        readIndex = 0;
+        writeIndex = 0;
+    }
+
+    static IndexType capacity() { return static_cast<IndexType>(Capacity); }
+
+    // Either side. The answer can only get smaller (size) or larger (space)
+    // by the time the caller acts on it when asked by the other side.
+    IndexType size() const  { return static_cast<IndexType>(load(writeIndex) - load(readIndex)); }
+    IndexType space() const { return static_cast<IndexType>(Capacity - size()); }
+    bool isEmpty() const    { return load(writeIndex) == load(readIndex); }
+    bool isFull() const     { return size() == Capacity; }
+
+
+    //-------------------------------------------------------------------------
+    // Producer side.
+    //-------------------------------------------------------------------------
+    // Returns false, without writing, if the buffer is full.
+    bool push(const T &value) {
+        IndexType write = writeIndex;
+        if (static_cast<IndexType>(write - load(readIndex)) == Capacity) {
+            return false;
+        }
+        data[write & MASK] = value;
+        publish(writeIndex, static_cast<IndexType>(write + 1));
+        return true;
+    }
+
+    // Copies as much of src as fits. Returns the number of elements written.
+    IndexType write(const T *src, IndexType count) {
+        IndexType contiguous;
+        IndexType written = 0;
+        // At most two spans: up to the end of the array and then from its start.
+        while (written < count) {
+            T *span = writeSpan(contiguous);
+            if (contiguous == 0) {
+                break;
+            }
+            IndexType chunk = (count - written < contiguous) ? static_cast<IndexType>(count - written) : contiguous;
+            memcpy(span, src + written, chunk * sizeof(T));
+            commitWrite(chunk);
+            written += chunk;
+        }
+        return written;
+    }
+
+    // The free slots that can be filled in place, up to the end of the array.
+    // Fill up to contiguous elements and then call commitWrite().
+    T * writeSpan(IndexType &contiguous) {
+        IndexType write = writeIndex;
+        IndexType free = static_cast<IndexType>(Capacity - static_cast<IndexType>(write - load(readIndex)));
+        IndexType toEnd = static_cast<IndexType>(Capacity - (write & MASK));
+        contiguous = (free < toEnd) ? free : toEnd;
+        return &data[write & MASK];
+    }
+
+    void commitWrite(IndexType count) {
+        publish(writeIndex, static_cast<IndexType>(writeIndex + count));
+    }
+
+
+    //-------------------------------------------------------------------------
+    // Consumer side.
+    //-------------------------------------------------------------------------
+    // Returns false, without touching value, if the buffer is empty.
+    bool pop(T &value) {
+        IndexType read = readIndex;
+        if (load(writeIndex) == read) {
+            return false;
+        }
+        value = data[read & MASK];
+        publish(readIndex, static_cast<IndexType>(read + 1));
+        return true;
+    }
+
+    // Only valid when !isEmpty(). Does NOT remove the element.
+    const T & peek() const {
+        return data[readIndex & MASK];
+    }
+
+    // Copies out up to count elements. Returns the number of elements read.
+    IndexType read(T *dst, IndexType count) {
+        IndexType contiguous;
+        IndexType copied = 0;
+        while (copied < count) {
+            const T *span = readSpan(contiguous);
+            if (contiguous == 0) {
+                break;
+            }
+            IndexType chunk = (count - copied < contiguous) ? static_cast<IndexType>(count - copied) : contiguous;
+            memcpy(dst + copied, span, chunk * sizeof(T));
+            consume(chunk);
+            copied += chunk;
+        }
+        return copied;
+    }
+
+    // The elements that can be read in place, up to the end of the array.
+    // Use up to contiguous elements and then call consume().
+    const T * readSpan(IndexType &contiguous) const {
+        IndexType read = readIndex;
+        IndexType used = static_cast<IndexType>(load(writeIndex) - read);
+        IndexType toEnd = static_cast<IndexType>(Capacity - (read & MASK));
+        contiguous = (used < toEnd) ? used : toEnd;
+        return &data[read & MASK];
+    }
+
+    void consume(IndexType count) {
+        publish(readIndex, static_cast<IndexType>(readIndex + count));
+    }
+
+private:
+    static const IndexType MASK = static_cast<IndexType>(Capacity - 1);
+
+    T data[Capacity];
+    volatile IndexType readIndex;   // Only written by the consumer.
+    volatile IndexType writeIndex;  // Only written by the producer.
+
+    // Reads an index written by the other side. Everything it published
+    // before the index is visible after this returns.
+    static IndexType load(const volatile IndexType &index) {
+#if defined(__AVR__)
+        IndexType value;
+        if (sizeof(IndexType) == 1) {
+            value = index;
+        } else {
+            uint8_t sreg = SREG;
+            cli();
+            value = index;
+            SREG = sreg;
+        }
+        __asm__ __volatile__ ("" ::: "memory");
+        return value;
+#else
+        return __atomic_load_n(&index, __ATOMIC_ACQUIRE);
+#endif
+    }
+
+    // Publishes a new index. Every slot written or read before it is done first.
+    static void publish(volatile IndexType &index, IndexType value) {
+#if defined(__AVR__)
+        __asm__ __volatile__ ("" ::: "memory");
+        if (sizeof(IndexType) == 1) {
+            index = value;
+        } else {
+            uint8_t sreg = SREG;
+            cli();
+            index = value;
+            SREG = sreg;
+        }
+#else
+        __atomic_store_n(&index, value, __ATOMIC_RELEASE);
+#endif
+    }
+};
+
+
+#endif // RING_BUFFER_H_
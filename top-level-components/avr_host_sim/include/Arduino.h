@@ -0,0 +1,74 @@
+/*  Arduino.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    Host stand-in for the parts of the Arduino core used by
+    arduino_spi_master.ino. Digital pins are the Pro Mini's (ATmega328P):
+    0-7 are PORTD, 8-13 are PORTB and 14-19 (A0-A5) are PORTC, so
+    digitalWrite() and direct port writes see the same state.
+*/
+#ifndef _SIM_ARDUINO_H_
+#define _SIM_ARDUINO_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "avr/io.h"
+#include "avr/interrupt.h"
+#include "sim_avr.h"
+
+#define HIGH 1
+#define LOW  0
+#define INPUT  0
+#define OUTPUT 1
+
+#define BIN 2
+#define DEC 10
+#define HEX 16
+
+#define SS   10
+#define MOSI 11
+#define MISO 12
+#define SCK  13
+
+#define PROGMEM
+#define strcmp_P strcmp
+
+extern void pinMode(uint8_t pin, uint8_t mode);
+extern void digitalWrite(uint8_t pin, uint8_t value);
+extern int digitalRead(uint8_t pin);
+extern unsigned long millis(void);
+
+
+class String {
+public:
+    String(const char *text = "");
+    String(unsigned value, int base);
+    const char * c_str() const { return text; }
+private:
+    char text[40];
+};
+
+
+class SimSerial {
+public:
+    void begin(unsigned long baud);
+    void print(const char *text);
+    void print(const String &text);
+    void print(char ch);
+    void print(int value);
+    void print(unsigned value);
+    void print(long value);
+    void print(unsigned long value);
+    void print(double value);
+    void println(void);
+    template<typename T> void println(const T &value) { print(value); println(); }
+
+    // The output is thrown away unless enabled.
+    bool isEcho = false;
+};
+
+extern SimSerial Serial;
+
+
+#endif // _SIM_ARDUINO_H_
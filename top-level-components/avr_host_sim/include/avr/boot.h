@@ -0,0 +1,27 @@
+/*  avr/boot.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    Host stand-in for avr-libc's <avr/boot.h>. The flash is an array in
+    sim_avr.c. An erase or a write sets SPMEN and RWWSB, and SPMEN clears
+    again once simulated time has moved on by SIM_SPM_NS. SPM_READY_vect is
+    called when SPMEN is clear while SPMIE and interrupts are enabled.
+*/
+#ifndef _SIM_AVR_BOOT_H_
+#define _SIM_AVR_BOOT_H_
+
+#include "avr/io.h"
+#include "sim_avr.h"
+
+#define boot_page_erase(address)        sim_spm(SIM_SPM_ERASE, (uint16_t)(address), 0)
+#define boot_page_fill(address, data)   sim_spm(SIM_SPM_FILL, (uint16_t)(address), (uint16_t)(data))
+#define boot_page_write(address)        sim_spm(SIM_SPM_WRITE, (uint16_t)(address), 0)
+#define boot_rww_enable()               sim_spm(SIM_SPM_RWW_ENABLE, 0, 0)
+
+#define boot_spm_busy()                 (SPMCSR & _BV(SPMEN))
+#define boot_rww_busy()                 (SPMCSR & _BV(RWWSB))
+#define boot_spm_busy_wait()            sim_spm_busy_wait()
+#define boot_spm_interrupt_enable()     (SPMCSR |= _BV(SPMIE))
+#define boot_spm_interrupt_disable()    (SPMCSR &= (uint8_t)~_BV(SPMIE))
+
+#endif // _SIM_AVR_BOOT_H_
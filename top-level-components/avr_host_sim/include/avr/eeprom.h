@@ -0,0 +1,19 @@
+/*  avr/eeprom.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    Host stand-in for avr-libc's <avr/eeprom.h>. The EEPROM is an array in
+    sim_avr.c, erased (0xFF) at start. Writes complete at once.
+*/
+#ifndef _SIM_AVR_EEPROM_H_
+#define _SIM_AVR_EEPROM_H_
+
+#include <stdint.h>
+#include "sim_avr.h"
+
+#define eeprom_read_byte(address)           sim_eeprom_read((uint16_t)(uintptr_t)(address))
+#define eeprom_write_byte(address, value)   sim_eeprom_write((uint16_t)(uintptr_t)(address), (value))
+#define eeprom_update_byte(address, value)  sim_eeprom_write((uint16_t)(uintptr_t)(address), (value))
+#define eeprom_busy_wait()                  ((void)0)
+
+#endif // _SIM_AVR_EEPROM_H_
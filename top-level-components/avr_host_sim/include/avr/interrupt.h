@@ -0,0 +1,22 @@
+/*  avr/interrupt.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    Host stand-in for avr-libc's <avr/interrupt.h>. An ISR is an ordinary
+    function that the virtual master in sim_avr.c calls.
+*/
+#ifndef _SIM_AVR_INTERRUPT_H_
+#define _SIM_AVR_INTERRUPT_H_
+
+#include "avr/io.h"
+
+#ifdef __cplusplus
+#define ISR(vector) extern "C" void vector(void)
+#else
+#define ISR(vector) void vector(void)
+#endif
+
+#define sei() (SREG |= _BV(SREG_I))
+#define cli() (SREG &= (uint8_t)~_BV(SREG_I))
+
+#endif // _SIM_AVR_INTERRUPT_H_
@@ -0,0 +1,131 @@
+/*  avr/io.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    Host stand-in for avr-libc's <avr/io.h>. The ATmega168/328P I/O registers
+    the firmware uses are plain variables, defined in sim_avr.c. The memory
+    sizes are the ATmega168's.
+
+    SPDR works like the hardware for a slave: the virtual master leaves the
+    received byte in it and shifts out whatever the firmware left in it.
+*/
+#ifndef _SIM_AVR_IO_H_
+#define _SIM_AVR_IO_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern volatile uint8_t PINB, DDRB, PORTB;
+extern volatile uint8_t PINC, DDRC, PORTC;
+extern volatile uint8_t PIND, DDRD, PORTD;
+extern volatile uint8_t SPCR, SPSR, SPDR;
+extern volatile uint8_t TCCR0A, TCCR0B, OCR0A, OCR0B;
+extern volatile uint8_t TCCR2A, TCCR2B, OCR2A, OCR2B;
+extern volatile uint8_t PCICR, PCMSK0, PCMSK1, PCMSK2;
+extern volatile uint8_t SREG;
+extern volatile uint8_t SPMCSR, MCUCR, MCUSR;
+
+#ifdef __cplusplus
+}
+#endif
+
+#define _BV(bit) (1 << (bit))
+
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PB6 6
+#define PB7 7
+#define PC0 0
+#define PC1 1
+#define PC2 2
+#define PC3 3
+#define PC4 4
+#define PC5 5
+#define PC6 6
+#define PD0 0
+#define PD1 1
+#define PD2 2
+#define PD3 3
+#define PD4 4
+#define PD5 5
+#define PD6 6
+#define PD7 7
+
+// SPCR
+#define SPR0 0
+#define SPR1 1
+#define CPHA 2
+#define CPOL 3
+#define MSTR 4
+#define DORD 5
+#define SPE  6
+#define SPIE 7
+// SPSR
+#define SPI2X 0
+#define WCOL  6
+#define SPIF  7
+
+// TCCR0A/B, TCCR2A/B
+#define WGM00  0
+#define WGM01  1
+#define COM0B0 4
+#define COM0B1 5
+#define COM0A0 6
+#define COM0A1 7
+#define CS00   0
+#define CS01   1
+#define CS02   2
+#define WGM20  0
+#define WGM21  1
+#define COM2B0 4
+#define COM2B1 5
+#define COM2A0 6
+#define COM2A1 7
+#define CS20   0
+#define CS21   1
+#define CS22   2
+
+// PCICR, PCMSK0
+#define PCIE0  0
+#define PCIE1  1
+#define PCIE2  2
+#define PCINT0 0
+#define PCINT1 1
+#define PCINT2 2
+#define PCINT3 3
+#define PCINT4 4
+#define PCINT5 5
+
+// SREG
+#define SREG_I 7
+
+// SPMCSR
+#define SPMEN  0
+#define PGERS  1
+#define PGWRT  2
+#define BLBSET 3
+#define RWWSRE 4
+#define RWWSB  6
+#define SPMIE  7
+// MCUCR
+#define IVCE   0
+#define IVSEL  1
+// MCUSR
+#define PORF   0
+#define EXTRF  1
+#define BORF   2
+#define WDRF   3
+
+#define SPM_PAGESIZE 128
+#define FLASHEND     0x3FFF
+#define E2END        0x1FF
+
+#endif // _SIM_AVR_IO_H_
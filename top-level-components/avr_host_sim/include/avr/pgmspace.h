@@ -0,0 +1,17 @@
+/*  avr/pgmspace.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    Host stand-in for avr-libc's <avr/pgmspace.h>, for reading the simulated
+    flash by address. Reading the application section while RWWSB is set
+    returns 0xFF and counts as misuse, see sim_spm_get_misuse().
+*/
+#ifndef _SIM_AVR_PGMSPACE_H_
+#define _SIM_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include "sim_avr.h"
+
+#define pgm_read_byte(address) sim_flash_read((uint16_t)(uintptr_t)(address))
+
+#endif // _SIM_AVR_PGMSPACE_H_
@@ -0,0 +1,18 @@
+/*  avr/sleep.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    Host stand-in for avr-libc's <avr/sleep.h>. The firmware's first
+    sleep_mode() hands control to the scenario in sim_idle().
+*/
+#ifndef _SIM_AVR_SLEEP_H_
+#define _SIM_AVR_SLEEP_H_
+
+#include "sim_avr.h"
+
+#define SLEEP_MODE_IDLE 0
+
+#define set_sleep_mode(mode) ((void)(mode))
+#define sleep_mode() sim_idle()
+
+#endif // _SIM_AVR_SLEEP_H_
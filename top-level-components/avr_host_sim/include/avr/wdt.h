@@ -0,0 +1,20 @@
+/*  avr/wdt.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    Host stand-in for avr-libc's <avr/wdt.h>. The firmware only enables the
+    watchdog to reset the AVR, so wdt_enable() is the reset: it calls the
+    scenario's sim_reset().
+*/
+#ifndef _SIM_AVR_WDT_H_
+#define _SIM_AVR_WDT_H_
+
+#include "sim_avr.h"
+
+#define WDTO_15MS 0
+
+#define wdt_enable(timeout) ((void)(timeout), sim_reset())
+#define wdt_disable()       ((void)0)
+#define wdt_reset()         ((void)0)
+
+#endif // _SIM_AVR_WDT_H_
@@ -0,0 +1,101 @@
+/*  sim_arduino.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include "Arduino.h"
+#include <cstdio>
+
+
+SimSerial Serial;
+
+
+static void pinToPort(uint8_t pin, volatile uint8_t *&port, volatile uint8_t *&ddr, volatile uint8_t *&pinReg, uint8_t &bit) {
+    if (pin < 8) {
+        port = &PORTD; ddr = &DDRD; pinReg = &PIND; bit = pin;
+    } else if (pin < 14) {
+        port = &PORTB; ddr = &DDRB; pinReg = &PINB; bit = pin - 8;
+    } else {
+        port = &PORTC; ddr = &DDRC; pinReg = &PINC; bit = pin - 14;
+    }
+}
+
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    volatile uint8_t *port, *ddr, *pinReg;
+    uint8_t bit;
+    pinToPort(pin, port, ddr, pinReg, bit);
+    if (mode == OUTPUT) {
+        *ddr |= _BV(bit);
+    } else {
+        *ddr &= ~_BV(bit);
+    }
+}
+
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    volatile uint8_t *port, *ddr, *pinReg;
+    uint8_t bit;
+    pinToPort(pin, port, ddr, pinReg, bit);
+    if (value) {
+        *port |= _BV(bit);
+    } else {
+        *port &= ~_BV(bit);
+    }
+}
+
+
+int digitalRead(uint8_t pin) {
+    volatile uint8_t *port, *ddr, *pinReg;
+    uint8_t bit;
+    pinToPort(pin, port, ddr, pinReg, bit);
+    // An output pin reads back what it drives.
+    uint8_t value = (*ddr & _BV(bit)) ? *port : *pinReg;
+    return (value & _BV(bit)) ? HIGH : LOW;
+}
+
+
+unsigned long millis(void) {
+    return static_cast<unsigned long>(sim_now_ns() / 1000000ULL);
+}
+
+
+String::String(const char *source) {
+    std::snprintf(text, sizeof(text), "%s", source);
+}
+
+
+String::String(unsigned value, int base) {
+    if (base == BIN) {
+        char *ptr = text;
+        bool isLeading = true;
+        for (int bit = 15; bit >= 0; --bit) {
+            bool isSet = (value >> bit) & 1;
+            if (isSet || !isLeading || bit == 0) {
+                *ptr++ = isSet ? '1' : '0';
+                isLeading = false;
+            }
+        }
+        *ptr = '\0';
+    } else {
+        std::snprintf(text, sizeof(text), base == HEX ? "%x" : "%u", value);
+    }
+}
+
+
+void SimSerial::begin(unsigned long baud) { (void)baud; }
+void SimSerial::print(const char *text)     { if (isEcho) std::printf("%s", text); }
+void SimSerial::print(const String &text)   { print(text.c_str()); }
+void SimSerial::print(char ch)              { if (isEcho) std::printf("%c", ch); }
+void SimSerial::print(int value)            { if (isEcho) std::printf("%d", value); }
+void SimSerial::print(unsigned value)       { if (isEcho) std::printf("%u", value); }
+void SimSerial::print(long value)           { if (isEcho) std::printf("%ld", value); }
+void SimSerial::print(unsigned long value)  { if (isEcho) std::printf("%lu", value); }
+void SimSerial::print(double value)         { if (isEcho) std::printf("%.2f", value); }
+void SimSerial::println(void)               { if (isEcho) std::printf("\n"); }
@@ -0,0 +1,245 @@
+/*  sim_arduino_spi_master.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Runs arduino_spi_master.ino against the simulated registers. The sketch is
+// included, rather than linked, so its static state can be checked.
+#include "Arduino.h"
+#include "arduino_spi_master.ino"
+
+#include <cstdio>
+#include <cstring>
+
+
+static const unsigned BENCHMARK_MESSAGES = 2000;
+// Bytes the master clocks between two passes of loop().
+static const unsigned BYTES_PER_LOOP = 16;
+// The longest "topic,data" the ESP32 forwards, from app_queues.h:
+// APP_MQTT_TOPIC_CAPACITY + 1 + APP_MQTT_DATA_CAPACITY.
+static const unsigned LONGEST_ESP32_MESSAGE = 64 + 1 + 96;
+
+
+static void sendMessage(const char *msg) {
+    // Include the null terminator.
+    sim_spi_transfer_buffer(reinterpret_cast<const uint8_t *>(msg), nullptr, strlen(msg) + 1);
+}
+
+
+// Longer than rxBuffer, so loop() runs between every BYTES_PER_LOOP bytes.
+static void sendLongMessage(const char *msg) {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(msg);
+    size_t length = strlen(msg) + 1;
+    for (size_t offset = 0; offset < length; offset += BYTES_PER_LOOP) {
+        size_t count = (length - offset < BYTES_PER_LOOP) ? length - offset : BYTES_PER_LOOP;
+        sim_spi_transfer_buffer(bytes + offset, nullptr, count);
+        loop();
+    }
+}
+
+
+static bool isTxRequested(void) {
+    return (PORTC & _BV(TX_REQUEST_BIT)) != 0;
+}
+
+
+static void testRingBuffer(void) {
+    RingBuffer<uint8_t, 8> buffer;
+    uint8_t value = 0;
+
+    SIM_CHECK(buffer.isEmpty());
+    for (uint8_t ndx = 0; ndx < 8; ++ndx) {
+        SIM_CHECK(buffer.push(ndx));
+    }
+    SIM_CHECK(buffer.isFull());
+    SIM_CHECK(!buffer.push(99));
+
+    // Wrap around, then read back across the end of the array in two spans.
+    for (uint8_t ndx = 0; ndx < 5; ++ndx) {
+        buffer.pop(value);
+    }
+    const uint8_t more[] = { 8, 9, 10, 11, 12, 13 };
+    SIM_CHECK(buffer.write(more, sizeof(more)) == 5);
+    SIM_CHECK(buffer.size() == 8);
+
+    uint8_t contiguous;
+    const uint8_t *span = buffer.readSpan(contiguous);
+    SIM_CHECK(contiguous == 3 && span[0] == 5);
+
+    uint8_t out[8];
+    SIM_CHECK(buffer.read(out, sizeof(out)) == 8);
+    for (uint8_t ndx = 0; ndx < 8; ++ndx) {
+        SIM_CHECK(out[ndx] == 5 + ndx);
+    }
+    SIM_CHECK(buffer.isEmpty());
+}
+
+
+// Clocks until TX_REQUEST drops, and checks that the slave sent expected.
+static void checkReply(const char *expected) {
+    char reply[64];
+    unsigned length = 0;
+    for (unsigned count = 0; isTxRequested() && count < 100; ++count) {
+        reply[length] = static_cast<char>(sim_spi_transfer(0));
+        if (reply[length] != '\0' || length > 0) {
+            ++length;
+        }
+    }
+    // The last byte is still in SPDR when TX_REQUEST drops.
+    reply[length++] = static_cast<char>(sim_spi_transfer(0));
+    SIM_CHECK(!isTxRequested());
+    SIM_CHECK(length == strlen(expected) + 1 && std::memcmp(reply, expected, length) == 0);
+}
+
+
+static void testFirstMessageAndReply(void) {
+    sendMessage("ping,ready");
+    loop();
+    SIM_CHECK(!waitingForFirstSpiRx);
+    SIM_CHECK(isTxRequested());
+    checkReply("Hello SPI.");
+}
+
+
+// The master clocks a byte after loop() has written to txBuffer but before
+// it calls startTx(). The idle ISR must leave the first byte for startTx().
+static void testInterruptBeforeStartTx(void) {
+    const char *msg = "late start";
+    txBuffer.write(msg, strlen(msg) + 1);
+    SIM_CHECK(sim_spi_transfer(0) == 0);
+    startTx();
+    checkReply(msg);
+}
+
+
+static void testDispatch(void) {
+    sendMessage("irrigation/zone/on,2");
+    loop();
+    SIM_CHECK(digitalRead(ZONE_PINS[0]) == LOW);
+    SIM_CHECK(digitalRead(ZONE_PINS[1]) == HIGH);
+    SIM_CHECK(digitalRead(ZONE_PINS[2]) == LOW);
+
+    // Several messages in one pass of loop().
+    sendMessage("irrigation/zone/on,4");
+    sendMessage("irrigation/zone/on,3");
+    loop();
+    SIM_CHECK(digitalRead(ZONE_PINS[1]) == LOW);
+    SIM_CHECK(digitalRead(ZONE_PINS[2]) == HIGH);
+    SIM_CHECK(digitalRead(ZONE_PINS[3]) == LOW);
+
+    sendMessage("irrigation/zone/on,0");
+    loop();
+    SIM_CHECK(digitalRead(ZONE_PINS[2]) == LOW);
+
+    unsigned dropped = droppedMessageCount;
+    sendMessage("no/such/topic,1");
+    loop();
+    SIM_CHECK(droppedMessageCount == dropped + 1);
+
+    char tooLong[MSG_BUFFER_SIZE + 8];
+    std::memset(tooLong, 'x', sizeof(tooLong) - 1);
+    tooLong[sizeof(tooLong) - 1] = '\0';
+    sendLongMessage(tooLong);
+    SIM_CHECK(droppedMessageCount == dropped + 2);
+
+    // The longest message the ESP32 forwards fits.
+    char longest[LONGEST_ESP32_MESSAGE + 1];
+    std::memset(longest, ' ', sizeof(longest) - 1);
+    longest[sizeof(longest) - 1] = '\0';
+    std::memcpy(longest, "irrigation/zone/on,4", strlen("irrigation/zone/on,4"));
+    sendLongMessage(longest);
+    SIM_CHECK(droppedMessageCount == dropped + 2);
+    SIM_CHECK(digitalRead(ZONE_PINS[3]) == HIGH);
+    SIM_CHECK(rxBufferOverrunCount == 0);
+
+    // The message after a dropped one is intact.
+    sendMessage("irrigation/zone/on,1");
+    loop();
+    SIM_CHECK(digitalRead(ZONE_PINS[0]) == HIGH);
+}
+
+
+static void benchmark(void) {
+    const char *msg = "irrigation/zone/on,1";
+    const unsigned msgBytes = strlen(msg) + 1;
+
+    lastPing = millis();
+    messageCount = 0;
+    rxBufferOverrunCount = 0;
+    sim_spi_reset_stats();
+
+    uint64_t hostStart = sim_host_ns();
+    unsigned untilLoop = BYTES_PER_LOOP;
+    for (unsigned count = 0; count < BENCHMARK_MESSAGES; ++count) {
+        for (unsigned ndx = 0; ndx < msgBytes; ++ndx) {
+            sim_spi_transfer(static_cast<uint8_t>(msg[ndx]));
+            if (--untilLoop == 0) {
+                loop();
+                untilLoop = BYTES_PER_LOOP;
+            }
+        }
+    }
+    loop();
+    uint64_t hostNs = sim_host_ns() - hostStart;
+
+    const sim_spi_stats_t *stats = sim_spi_get_stats();
+    SIM_CHECK(messageCount == BENCHMARK_MESSAGES);
+    SIM_CHECK(rxBufferOverrunCount == 0);
+
+    std::printf("Dispatched %u messages, %u bytes.\n", messageCount, stats->bytes);
+    std::printf("  simulated link: %.0f bytes/s, %.0f msgs/s\n",
+        stats->bytes * 1e9 / stats->elapsedNs, messageCount * 1e9 / stats->elapsedNs);
+    std::printf("  host: %.1f Mbytes/s through the ISR and parser\n", stats->bytes * 1e3 / hostNs);
+}
+
+
+// Collisions and overruns per timing, from the ISR cycle estimates.
+static void timingTable(void) {
+    static const uint32_t SCK_HZ[] = { 250000, 500000, 1000000, 2000000 };
+    static const uint32_t GAP_NS[] = { 0, 4000, 8000 };
+
+    std::printf("%10s %8s %12s %12s %10s\n", "SCK", "gap(ns)", "bytes/s", "collisions", "overruns");
+    for (uint32_t sckHz : SCK_HZ) {
+        for (uint32_t gapNs : GAP_NS) {
+            sim_spi_timing_t timing = SIM_SPI_TIMING_DEFAULT;
+            timing.sckHz = sckHz;
+            timing.gapNs = gapNs;
+            sim_spi_set_timing(&timing);
+            sim_spi_reset_stats();
+
+            for (unsigned count = 0; count < 100; ++count) {
+                sendMessage("irrigation/zone/on,0");
+                loop();
+            }
+            const sim_spi_stats_t *stats = sim_spi_get_stats();
+            std::printf("%10u %8u %12.0f %12u %10u\n", sckHz, gapNs,
+                stats->bytes * 1e9 / stats->elapsedNs, stats->collisions, stats->overruns);
+        }
+    }
+
+    sim_spi_timing_t timing = SIM_SPI_TIMING_DEFAULT;
+    sim_spi_set_timing(&timing);
+}
+
+
+int main(int argc, char *argv[]) {
+    Serial.isEcho = (argc > 1 && std::strcmp(argv[1], "-v") == 0);
+
+    setup();
+    sim_spi_select(true);
+
+    testRingBuffer();
+    testFirstMessageAndReply();
+    testInterruptBeforeStartTx();
+    testDispatch();
+    benchmark();
+    timingTable();
+
+    return sim_finish();
+}
@@ -0,0 +1,245 @@
+/*  sim_avr.c
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include "sim_avr.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "avr/io.h"
+
+
+volatile uint8_t PINB, DDRB, PORTB;
+volatile uint8_t PINC, DDRC, PORTC;
+volatile uint8_t PIND, DDRD, PORTD;
+volatile uint8_t SPCR, SPSR, SPDR;
+volatile uint8_t TCCR0A, TCCR0B, OCR0A, OCR0B;
+volatile uint8_t TCCR2A, TCCR2B, OCR2A, OCR2B;
+volatile uint8_t PCICR, PCMSK0, PCMSK1, PCMSK2;
+volatile uint8_t SREG;
+volatile uint8_t SPMCSR, MCUCR, MCUSR;
+
+// Provided by the firmware. Weak, as not every firmware uses every vector.
+extern void SPI_STC_vect(void) __attribute__((weak));
+extern void PCINT0_vect(void) __attribute__((weak));
+extern void SPM_READY_vect(void) __attribute__((weak));
+
+
+static sim_spi_timing_t timing = SIM_SPI_TIMING_DEFAULT;
+static sim_spi_stats_t stats;
+static uint64_t nowNs;
+static unsigned checkCount;
+static unsigned failedCount;
+
+static uint8_t flash[FLASHEND + 1] = { [0 ... FLASHEND] = 0xFF };
+static uint16_t spmPageBuffer[SPM_PAGESIZE / 2] = { [0 ... SPM_PAGESIZE / 2 - 1] = 0xFFFF };
+static uint64_t spmDoneNs;
+static unsigned spmMisuse;
+static uint8_t eeprom[E2END + 1] = { [0 ... E2END] = 0xFF };
+
+
+void sim_spi_set_timing(const sim_spi_timing_t *newTiming) {
+    timing = *newTiming;
+}
+
+
+const sim_spi_stats_t * sim_spi_get_stats(void) {
+    return &stats;
+}
+
+
+void sim_spi_reset_stats(void) {
+    stats.bytes = 0;
+    stats.collisions = 0;
+    stats.overruns = 0;
+    stats.elapsedNs = 0;
+}
+
+
+uint8_t sim_spi_transfer(uint8_t mosi) {
+    uint64_t shiftNs = 8ULL * 1000000000ULL / timing.sckHz;
+    uint64_t isrNs = (uint64_t)timing.isrCycles * 1000000000ULL / timing.cpuHz;
+    uint64_t spdrWriteNs = (uint64_t)timing.spdrWriteCycles * 1000000000ULL / timing.cpuHz;
+
+    // The shift register swaps the two bytes.
+    uint8_t miso = SPDR;
+    SPDR = mosi;
+    sim_advance_ns(shiftNs);
+
+    ++stats.bytes;
+    stats.elapsedNs += shiftNs + timing.gapNs;
+    if (spdrWriteNs > timing.gapNs) {
+        ++stats.collisions;
+    }
+    if (isrNs > shiftNs + timing.gapNs) {
+        ++stats.overruns;
+    }
+
+    if ((SPCR & _BV(SPE)) && (SPCR & _BV(SPIE)) && SPI_STC_vect) {
+        SPI_STC_vect();
+    } else {
+        SPSR |= _BV(SPIF);
+    }
+    sim_advance_ns(timing.gapNs);
+    return miso;
+}
+
+
+void sim_spi_transfer_buffer(const uint8_t *mosi, uint8_t *miso, size_t length) {
+    size_t index;
+    for (index = 0; index < length; ++index) {
+        uint8_t rx = sim_spi_transfer(mosi ? mosi[index] : 0);
+        if (miso) {
+            miso[index] = rx;
+        }
+    }
+}
+
+
+void sim_spi_select(int isSelected) {
+    // SS is active low.
+    if (isSelected) {
+        PINB &= (uint8_t)~_BV(PB2);
+    } else {
+        PINB |= _BV(PB2);
+    }
+    if ((PCICR & _BV(PCIE0)) && (PCMSK0 & _BV(PCINT2)) && PCINT0_vect) {
+        PCINT0_vect();
+    }
+}
+
+
+uint64_t sim_now_ns(void) {
+    return nowNs;
+}
+
+
+// Raises SPM_READY_vect, level triggered like the AVR's, at most a few
+// times in a row so a firmware that leaves it raised can't hang the host.
+static void spm_ready_interrupt(void) {
+    unsigned count;
+    for (count = 0; count < 4; ++count) {
+        if (!(SPMCSR & _BV(SPMIE)) || (SPMCSR & _BV(SPMEN)) || !(SREG & _BV(SREG_I)) || !SPM_READY_vect) {
+            return;
+        }
+        SPM_READY_vect();
+    }
+}
+
+
+void sim_advance_ns(uint64_t ns) {
+    uint64_t endNs = nowNs + ns;
+
+    // Step to each SPM completion on the way, so the firmware can start the
+    // next operation at the right time.
+    spm_ready_interrupt();
+    while ((SPMCSR & _BV(SPMEN)) && spmDoneNs <= endNs) {
+        nowNs = spmDoneNs;
+        SPMCSR &= (uint8_t)~_BV(SPMEN);
+        spm_ready_interrupt();
+    }
+    nowNs = endNs;
+}
+
+
+uint64_t sim_host_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+
+void sim_spm(sim_spm_operation_t operation, uint16_t address, uint16_t data) {
+    uint16_t pageStart = address & (uint16_t)~(SPM_PAGESIZE - 1);
+    unsigned index;
+
+    if ((SPMCSR & _BV(SPMEN)) || address > FLASHEND) {
+        ++spmMisuse;
+        return;
+    }
+    switch (operation) {
+        case SIM_SPM_ERASE:
+            memset(&flash[pageStart], 0xFF, SPM_PAGESIZE);
+            break;
+        case SIM_SPM_FILL:
+            spmPageBuffer[(address % SPM_PAGESIZE) / 2] = data;
+            return;
+        case SIM_SPM_WRITE:
+            // Programming only clears bits.
+            for (index = 0; index < SPM_PAGESIZE / 2; ++index) {
+                flash[pageStart + 2 * index] &= spmPageBuffer[index] & 0xFF;
+                flash[pageStart + 2 * index + 1] &= spmPageBuffer[index] >> 8;
+                spmPageBuffer[index] = 0xFFFF;
+            }
+            break;
+        case SIM_SPM_RWW_ENABLE:
+            SPMCSR &= (uint8_t)~_BV(RWWSB);
+            return;
+    }
+    SPMCSR |= _BV(SPMEN) | _BV(RWWSB);
+    spmDoneNs = nowNs + SIM_SPM_NS;
+}
+
+
+void sim_spm_busy_wait(void) {
+    if (SPMCSR & _BV(SPMEN)) {
+        sim_advance_ns(spmDoneNs - nowNs);
+    }
+}
+
+
+unsigned sim_spm_get_misuse(void) {
+    return spmMisuse;
+}
+
+
+uint8_t sim_flash_read(uint16_t address) {
+    if (address > FLASHEND) {
+        return 0xFF;
+    }
+    // The 2K boot section can always be read.
+    if ((SPMCSR & _BV(RWWSB)) && address < FLASHEND + 1 - 2048) {
+        ++spmMisuse;
+        return 0xFF;
+    }
+    return flash[address];
+}
+
+
+void sim_flash_load(uint16_t address, const uint8_t *data, size_t length) {
+    memcpy(&flash[address], data, length);
+}
+
+
+uint8_t sim_eeprom_read(uint16_t address) {
+    return address <= E2END ? eeprom[address] : 0xFF;
+}
+
+
+void sim_eeprom_write(uint16_t address, uint8_t value) {
+    if (address <= E2END) {
+        eeprom[address] = value;
+    }
+}
+
+
+void sim_check(int isOk, const char *text, const char *file, int line) {
+    ++checkCount;
+    if (!isOk) {
+        ++failedCount;
+        printf("FAILED %s:%d: %s\n", file, line, text);
+    }
+}
+
+
+int sim_finish(void) {
+    printf("%u check(s), %u failed.\n", checkCount, failedCount);
+    return failedCount ? 1 : 0;
+}
@@ -0,0 +1,121 @@
+/*  sim_avr.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+#ifndef _SIM_AVR_H_
+#define _SIM_AVR_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//------------------------------------------------------------------------------
+// Virtual SPI master.
+//
+// Time is simulated. Each byte costs 8 SCK periods plus the gap the master
+// leaves between bytes. The SPI ISR cannot be timed on the host, so its cost
+// comes from the cycle estimates in sim_spi_timing_t. These are checked
+// against every byte:
+//   - a collision is counted when SPDR would be written after the next byte
+//     has started (the AVR sets WCOL and the reply byte is lost),
+//   - an overrun is counted when the whole ISR takes longer than a byte.
+//------------------------------------------------------------------------------
+typedef struct {
+    uint32_t cpuHz;             // AVR clock.
+    uint32_t sckHz;             // SPI clock driven by the master.
+    uint32_t gapNs;             // Idle time between bytes.
+    uint32_t isrCycles;         // Interrupt to reti, including response and prologue.
+    uint32_t spdrWriteCycles;   // Interrupt to the ISR's SPDR write.
+} sim_spi_timing_t;
+
+typedef struct {
+    uint32_t bytes;
+    uint32_t collisions;
+    uint32_t overruns;
+    uint64_t elapsedNs;         // Simulated.
+} sim_spi_stats_t;
+
+// Defaults match the estimates in arduino_spi_master/README.md.
+#define SIM_SPI_TIMING_DEFAULT { 8000000, 500000, 4000, 100, 30 }
+
+extern void sim_spi_set_timing(const sim_spi_timing_t *timing);
+extern const sim_spi_stats_t * sim_spi_get_stats(void);
+extern void sim_spi_reset_stats(void);
+
+// Clocks one byte: mosi goes in, the byte the firmware left in SPDR comes out.
+// Calls SPI_STC_vect when SPIE is set.
+extern uint8_t sim_spi_transfer(uint8_t mosi);
+extern void sim_spi_transfer_buffer(const uint8_t *mosi, uint8_t *miso, size_t length);
+
+// Drives SS (PB2) and calls PCINT0_vect when it is enabled.
+extern void sim_spi_select(int isSelected);
+
+// Simulated time, advanced by SPI transfers and sim_advance_ns().
+extern uint64_t sim_now_ns(void);
+extern void sim_advance_ns(uint64_t ns);
+
+// Host wall clock, for benchmarking the firmware code itself.
+extern uint64_t sim_host_ns(void);
+
+
+//------------------------------------------------------------------------------
+// Flash self-programming and EEPROM, for avr/boot.h, avr/pgmspace.h and
+// avr/eeprom.h.
+//
+// An erase or a write takes SIM_SPM_NS of simulated time (tWD_FLASH). The
+// flash is only written where it was erased first, as on the AVR. Starting
+// an operation while SPMEN is set, or reading the application section
+// before boot_rww_enable(), counts as misuse.
+//------------------------------------------------------------------------------
+#define SIM_SPM_NS 4500000ULL
+
+typedef enum {
+    SIM_SPM_ERASE,
+    SIM_SPM_FILL,
+    SIM_SPM_WRITE,
+    SIM_SPM_RWW_ENABLE
+} sim_spm_operation_t;
+
+extern void sim_spm(sim_spm_operation_t operation, uint16_t address, uint16_t data);
+extern void sim_spm_busy_wait(void);
+extern unsigned sim_spm_get_misuse(void);
+extern uint8_t sim_flash_read(uint16_t address);
+// Loads the flash directly, as an ISP programmer would.
+extern void sim_flash_load(uint16_t address, const uint8_t *data, size_t length);
+
+extern uint8_t sim_eeprom_read(uint16_t address);
+extern void sim_eeprom_write(uint16_t address, uint8_t value);
+
+
+//------------------------------------------------------------------------------
+// Scenario entry point, provided by each driver.
+// Called from the firmware's first sleep_mode(). Never returns.
+//------------------------------------------------------------------------------
+extern void sim_idle(void);
+
+// Called by wdt_enable(), which the firmware only uses to reset the AVR.
+// Only needed by scenarios whose firmware does that. Never returns.
+extern void sim_reset(void);
+
+// Prints the result, and exits with 1 if any check failed.
+#define SIM_CHECK(condition) sim_check((condition), #condition, __FILE__, __LINE__)
+extern void sim_check(int isOk, const char *text, const char *file, int line);
+extern int sim_finish(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // _SIM_AVR_H_
@@ -0,0 +1,328 @@
+/*  sim_avr_bootloader.c
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Runs avr_spi_master/spi_bootloader.c, unchanged, against the simulated
+// registers and flash. The EEPROM starts erased, so its main() stays in the
+// bootloader and the scenario runs from its first sleep_mode().
+//
+// The bootloader can't be started again in the same process, so each test
+// runs in a child forked from that point.
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "avr/io.h"
+#include "avr/eeprom.h"
+#include "sim_avr.h"
+#include "spi_bootloader.h"
+
+
+#define IMAGE_LENGTH        (BOOT_SECTION_START - 60)
+#define PAGE_GAP_NS         400000ULL   // After a page frame, for its CRC check.
+#define POLL_NS             1000000ULL  // While every page buffer is full.
+#define MAX_POLLS           100000
+
+static uint8_t image[BOOT_SECTION_START];
+static jmp_buf resetJump;
+static int resetCount;
+static unsigned resendCount;
+
+
+// Bit at a time, unlike the bootloader's, so one checks the other.
+static uint16_t crc16(const uint8_t *data, size_t length) {
+    uint16_t crc = 0;
+    size_t index;
+    int bit;
+    for (index = 0; index < length; ++index) {
+        crc ^= (uint16_t)data[index] << 8;
+        for (bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+
+static uint32_t crc32(const uint8_t *data, size_t length) {
+    uint32_t crc = 0xFFFFFFFFu;
+    size_t index;
+    int bit;
+    for (index = 0; index < length; ++index) {
+        crc ^= data[index];
+        for (bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320u : 0);
+        }
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+
+static void send_frame(const uint8_t *mosi, uint8_t *miso, size_t length) {
+    sim_spi_select(1);
+    sim_spi_transfer_buffer(mosi, miso, length);
+    sim_spi_select(0);
+}
+
+
+static void read_status(uint8_t *status) {
+    uint8_t frame[1 + BOOT_STATUS_LENGTH] = { BOOT_COMMAND_STATUS };
+    uint8_t reply[sizeof(frame)];
+    send_frame(frame, reply, sizeof(frame));
+    memcpy(status, reply + 1, BOOT_STATUS_LENGTH);
+}
+
+
+static uint16_t next_address(const uint8_t *status) {
+    return status[BOOT_STATUS_NEXT_LO] | (status[BOOT_STATUS_NEXT_HI] << 8);
+}
+
+
+// Pages past the end of the image are padded with 0xFF, as erased flash.
+static void send_page(uint16_t address, const uint8_t *data, uint32_t length, int isCorrupt) {
+    uint8_t frame[BOOT_PAGE_FRAME_LENGTH];
+    uint16_t crc;
+    uint32_t index;
+
+    frame[0] = BOOT_COMMAND_PAGE;
+    frame[1] = address & 0xFF;
+    frame[2] = address >> 8;
+    for (index = 0; index < BOOT_PAGE_SIZE; ++index) {
+        frame[3 + index] = (address + index < length) ? data[address + index] : 0xFF;
+    }
+    crc = crc16(frame + 1, 2 + BOOT_PAGE_SIZE);
+    frame[3 + BOOT_PAGE_SIZE] = crc & 0xFF;
+    frame[4 + BOOT_PAGE_SIZE] = crc >> 8;
+    if (isCorrupt) {
+        frame[3 + BOOT_PAGE_SIZE / 2] ^= 0x10;
+    }
+    send_frame(frame, NULL, sizeof(frame));
+    sim_advance_ns(PAGE_GAP_NS);
+}
+
+
+static void send_finish(uint32_t length, uint32_t crc) {
+    uint8_t frame[BOOT_FINISH_FRAME_LENGTH] = {
+        BOOT_COMMAND_FINISH,
+        length & 0xFF, (length >> 8) & 0xFF, (length >> 16) & 0xFF, length >> 24,
+        crc & 0xFF, (crc >> 8) & 0xFF, (crc >> 16) & 0xFF, crc >> 24
+    };
+    send_frame(frame, NULL, sizeof(frame));
+}
+
+
+// The master's side, as app_avr_ota.cpp does it: send while there is a free
+// page buffer, and go back to nextAddress when a page was rejected.
+// Corrupts the first copy of corruptAddress. Returns 0 if it gave up.
+static int send_image(const uint8_t *data, uint32_t length, uint16_t corruptAddress) {
+    uint32_t end = (length + BOOT_PAGE_SIZE - 1) & ~(uint32_t)(BOOT_PAGE_SIZE - 1);
+    uint8_t status[BOOT_STATUS_LENGTH];
+    uint32_t sent = 0;
+    int isCorruptSent = 0;
+    unsigned polls;
+
+    for (polls = 0; polls < MAX_POLLS; ++polls) {
+        read_status(status);
+        if (next_address(status) >= end) {
+            return 1;
+        }
+        if (next_address(status) < sent) {
+            ++resendCount;
+            sent = next_address(status);
+        }
+        if (status[BOOT_STATUS_FREE_BUFFERS] > 0 && sent < end) {
+            int isCorrupt = !isCorruptSent && sent == corruptAddress;
+            send_page(sent, data, length, isCorrupt);
+            isCorruptSent |= isCorrupt;
+            sent += BOOT_PAGE_SIZE;
+        } else {
+            sim_advance_ns(POLL_NS);
+        }
+    }
+    return 0;
+}
+
+
+static void wait_for_free_buffers(void) {
+    uint8_t status[BOOT_STATUS_LENGTH];
+    unsigned polls;
+    for (polls = 0; polls < MAX_POLLS; ++polls) {
+        read_status(status);
+        if (status[BOOT_STATUS_FREE_BUFFERS] == 2) {
+            break;
+        }
+        sim_advance_ns(POLL_NS);
+    }
+}
+
+
+static uint8_t wait_while_verifying(void) {
+    uint8_t status[BOOT_STATUS_LENGTH];
+    unsigned polls;
+    for (polls = 0; polls < MAX_POLLS; ++polls) {
+        read_status(status);
+        if (status[BOOT_STATUS_STATE] != BOOT_STATE_VERIFYING) {
+            break;
+        }
+        sim_advance_ns(POLL_NS);
+    }
+    return status[BOOT_STATUS_STATE];
+}
+
+
+static void test_status(void) {
+    uint8_t status[BOOT_STATUS_LENGTH];
+    read_status(status);
+    SIM_CHECK(status[BOOT_STATUS_SIGNATURE] == BOOT_SIGNATURE);
+    SIM_CHECK(status[BOOT_STATUS_STATE] == BOOT_STATE_RECEIVING);
+    SIM_CHECK(next_address(status) == 0);
+    SIM_CHECK(status[BOOT_STATUS_FREE_BUFFERS] == 2);
+    // The vectors moved to the boot section.
+    SIM_CHECK(MCUCR & _BV(IVSEL));
+}
+
+
+static void test_rejected_pages(void) {
+    const uint8_t truncated[] = { BOOT_COMMAND_PAGE, 0x00, 0x00, 0x55 };
+    const uint8_t unknown[] = { 0x42 };
+    uint8_t status[BOOT_STATUS_LENGTH];
+
+    send_page(BOOT_PAGE_SIZE, image, sizeof(image), 0);
+    read_status(status);
+    SIM_CHECK(status[BOOT_STATUS_ERROR] == BOOT_ERROR_ADDRESS && next_address(status) == 0);
+
+    send_page(0, image, sizeof(image), 1);
+    read_status(status);
+    SIM_CHECK(status[BOOT_STATUS_ERROR] == BOOT_ERROR_PAGE_CRC && next_address(status) == 0);
+
+    send_frame(truncated, NULL, sizeof(truncated));
+    read_status(status);
+    SIM_CHECK(status[BOOT_STATUS_ERROR] == BOOT_ERROR_FRAME && next_address(status) == 0);
+
+    send_frame(unknown, NULL, sizeof(unknown));
+    read_status(status);
+    SIM_CHECK(status[BOOT_STATUS_ERROR] == BOOT_ERROR_FRAME);
+
+    // Two buffers: the third page waits for the first to be written.
+    send_page(0, image, sizeof(image), 0);
+    send_page(BOOT_PAGE_SIZE, image, sizeof(image), 0);
+    send_page(2 * BOOT_PAGE_SIZE, image, sizeof(image), 0);
+    read_status(status);
+    SIM_CHECK(status[BOOT_STATUS_ERROR] == BOOT_ERROR_BUSY);
+    SIM_CHECK(next_address(status) == 2 * BOOT_PAGE_SIZE && status[BOOT_STATUS_FREE_BUFFERS] == 0);
+
+    // Finish before the image is complete.
+    send_finish(3 * BOOT_PAGE_SIZE, 0);
+    read_status(status);
+    SIM_CHECK(status[BOOT_STATUS_ERROR] == BOOT_ERROR_LENGTH && status[BOOT_STATUS_STATE] == BOOT_STATE_RECEIVING);
+    SIM_CHECK(sim_spm_get_misuse() == 0);
+}
+
+
+static void test_image(void) {
+    const uint8_t run[] = { BOOT_COMMAND_RUN };
+    unsigned pages = (IMAGE_LENGTH + BOOT_PAGE_SIZE - 1) / BOOT_PAGE_SIZE;
+    uint64_t startNs = sim_now_ns();
+    uint64_t elapsedNs, flashNs, linkNs;
+    uint32_t address;
+    int isFlashSame = 1;
+
+    SIM_CHECK(send_image(image, IMAGE_LENGTH, 5 * BOOT_PAGE_SIZE));
+    SIM_CHECK(resendCount == 1);
+    send_finish(IMAGE_LENGTH, crc32(image, IMAGE_LENGTH));
+    SIM_CHECK(wait_while_verifying() == BOOT_STATE_DONE);
+    elapsedNs = sim_now_ns() - startNs;
+
+    for (address = 0; address < IMAGE_LENGTH; ++address) {
+        isFlashSame &= sim_flash_read(address) == image[address];
+    }
+    SIM_CHECK(isFlashSame);
+    SIM_CHECK(eeprom_read_byte(BOOT_APP_VALID_ADDRESS) == BOOT_APP_VALID);
+    SIM_CHECK(sim_spm_get_misuse() == 0);
+
+    if (setjmp(resetJump) == 0) {
+        send_frame(run, NULL, sizeof(run));
+    }
+    SIM_CHECK(resetCount == 1);
+
+    // Erase plus write is 2 x SIM_SPM_NS per page. The link time is what
+    // the master spent clocking pages and polling. The read-back check is
+    // not timed.
+    flashNs = pages * 2 * SIM_SPM_NS;
+    linkNs = sim_spi_get_stats()->elapsedNs;
+    printf("Programmed %u bytes (%u pages, %u resent) in %.0f ms simulated.\n",
+        IMAGE_LENGTH, pages, resendCount, elapsedNs / 1e6);
+    printf("  flash alone: %.0f ms, SPI link busy: %.0f ms\n", flashNs / 1e6, linkNs / 1e6);
+    // Pipelined: close to the flash time, not flash plus link.
+    SIM_CHECK(elapsedNs < flashNs + flashNs / 10);
+}
+
+
+static void test_boot_section_protected(void) {
+    uint8_t status[BOOT_STATUS_LENGTH];
+
+    SIM_CHECK(send_image(image, BOOT_SECTION_START, 0xFFFF));
+    wait_for_free_buffers();
+    send_page(BOOT_SECTION_START, image, sizeof(image), 0);
+    read_status(status);
+    SIM_CHECK(status[BOOT_STATUS_ERROR] == BOOT_ERROR_ADDRESS && next_address(status) == BOOT_SECTION_START);
+}
+
+
+static void test_image_crc_mismatch(void) {
+    const uint32_t length = 4 * BOOT_PAGE_SIZE;
+
+    SIM_CHECK(send_image(image, length, 0xFFFF));
+    send_finish(length, crc32(image, length) ^ 1);
+    SIM_CHECK(wait_while_verifying() == BOOT_STATE_FAILED);
+    SIM_CHECK(eeprom_read_byte(BOOT_APP_VALID_ADDRESS) != BOOT_APP_VALID);
+}
+
+
+// RUN: back to the test.
+void sim_reset(void) {
+    ++resetCount;
+    longjmp(resetJump, 1);
+}
+
+
+static void run_test(const char *name, void (*test)(void)) {
+    pid_t pid;
+    int status = 0;
+
+    printf("%s: ", name);
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0) {
+        test();
+        exit(sim_finish());
+    }
+    waitpid(pid, &status, 0);
+    SIM_CHECK(pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+
+void sim_idle(void) {
+    uint32_t address;
+    srand(1);
+    for (address = 0; address < sizeof(image); ++address) {
+        image[address] = rand() & 0xFF;
+    }
+
+    run_test("status", test_status);
+    run_test("rejected pages", test_rejected_pages);
+    run_test("image", test_image);
+    run_test("image CRC mismatch", test_image_crc_mismatch);
+    run_test("boot section protected", test_boot_section_protected);
+
+    exit(sim_finish());
+}
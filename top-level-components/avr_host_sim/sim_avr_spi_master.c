@@ -0,0 +1,165 @@
+/*  sim_avr_spi_master.c
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Runs avr_spi_master/spi_master.c, unchanged, against the simulated
+// registers. Its main() does the setup and the scenario runs from its first
+// sleep_mode().
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "avr/io.h"
+#include "avr/eeprom.h"
+#include "sim_avr.h"
+#include "spi_bootloader.h"
+
+
+#define BENCHMARK_FRAMES 10000
+
+// Register addresses, as in spi_master.c.
+#define REG_READ        0x80
+#define REG_PORTB       0x00
+#define REG_PORTC       0x01
+#define REG_PORTD       0x02
+#define REG_DDRB        0x03
+#define REG_PWM_ENABLE  0x09
+#define REG_PINB        0x0A
+#define REG_BOOT        0x0D
+#define REG_BOOT_ENTER  0xB0
+
+static jmp_buf resetJump;
+static int resetCount;
+
+
+static void send_frame(const uint8_t *mosi, uint8_t *miso, size_t length) {
+    sim_spi_select(1);
+    sim_spi_transfer_buffer(mosi, miso, length);
+    sim_spi_select(0);
+}
+
+
+static void test_batched_write(void) {
+    const uint8_t frame[] = { REG_PORTB, 3, 0x01, 0x02, 0x03 };
+
+    sim_spi_select(1);
+    sim_spi_transfer_buffer(frame, NULL, sizeof(frame));
+    // Nothing changes until SS goes high.
+    SIM_CHECK(PORTC != 0x02);
+    sim_spi_select(0);
+
+    SIM_CHECK(PORTB == 0x01 && PORTC == 0x02 && PORTD == 0x03);
+}
+
+
+static void test_spi_pins_masked(void) {
+    uint8_t ddrb = DDRB;
+    const uint8_t frame[] = { REG_DDRB, 1, 0x00 };
+    send_frame(frame, NULL, sizeof(frame));
+    // MISO stays an output.
+    SIM_CHECK((DDRB & _BV(PB4)) && (DDRB & 0x3C) == (ddrb & 0x3C));
+}
+
+
+static void test_read(void) {
+    const uint8_t frame[] = { REG_READ | REG_PINB, 3, 0, 0, 0 };
+    uint8_t reply[sizeof(frame)];
+
+    PINB = 0x04 | 0x41;     // SS high, as sent after the previous frame.
+    PINC = 0x15;
+    PIND = 0xA5;
+    send_frame(frame, reply, sizeof(frame));
+    // PB2 (SS) is low while the frame is clocked.
+    SIM_CHECK(reply[2] == 0x41 && reply[3] == 0x15 && reply[4] == 0xA5);
+}
+
+
+static void test_pwm_enable(void) {
+    const uint8_t frame[] = { REG_PWM_ENABLE, 1, 0x03 };
+    send_frame(frame, NULL, sizeof(frame));
+    SIM_CHECK((TCCR0A & (_BV(COM0A1) | _BV(COM0B1))) == (_BV(COM0A1) | _BV(COM0B1)));
+    SIM_CHECK(!(TCCR2A & _BV(COM2B1)));
+}
+
+
+static void test_bad_frames(void) {
+    // The second record is outside the map, so the first is dropped too.
+    const uint8_t badFrame[] = { REG_PORTC, 1, 0x99, REG_PINB, 1, 0x00 };
+    send_frame(badFrame, NULL, sizeof(badFrame));
+    SIM_CHECK(PORTC == 0x02);
+
+    // Cut short.
+    const uint8_t shortFrame[] = { REG_PORTC, 2, 0x77 };
+    send_frame(shortFrame, NULL, sizeof(shortFrame));
+    SIM_CHECK(PORTC == 0x02);
+}
+
+
+static void test_boot_enter(void) {
+    const uint8_t wrongValue[] = { REG_BOOT, 1, 0x00 };
+    const uint8_t enter[] = { REG_PORTC, 1, 0x44, REG_BOOT, 1, REG_BOOT_ENTER };
+    const uint8_t tooLong[] = { REG_BOOT, 2, REG_BOOT_ENTER, 0x00 };
+    const uint8_t badRecord[] = { REG_PINB, 1, 0x00 };
+
+    sim_eeprom_write((uint16_t)(uintptr_t)BOOT_APP_VALID_ADDRESS, BOOT_APP_VALID);
+    send_frame(wrongValue, NULL, sizeof(wrongValue));
+    send_frame(tooLong, NULL, sizeof(tooLong));
+    SIM_CHECK(resetCount == 0);
+
+    if (setjmp(resetJump) == 0) {
+        send_frame(enter, NULL, sizeof(enter));
+    }
+    // The rest of the frame is written first, and the bootloader stays after the reset.
+    SIM_CHECK(resetCount == 1);
+    SIM_CHECK(PORTC == 0x44);
+    SIM_CHECK(eeprom_read_byte(BOOT_APP_VALID_ADDRESS) != BOOT_APP_VALID);
+
+    // The reset cut the pin change ISR short, but unlike the AVR's our RAM
+    // survives it. A bad frame clears what was left staged.
+    send_frame(badRecord, NULL, sizeof(badRecord));
+}
+
+
+static void benchmark(void) {
+    const uint8_t frame[] = { REG_PORTB, 3, 0x00, 0x00, 0x00 };
+    const sim_spi_stats_t *stats;
+    uint64_t hostStart;
+    unsigned count;
+
+    sim_spi_reset_stats();
+    hostStart = sim_host_ns();
+    for (count = 0; count < BENCHMARK_FRAMES; ++count) {
+        send_frame(frame, NULL, sizeof(frame));
+    }
+    stats = sim_spi_get_stats();
+
+    printf("Applied %u frames of 3 ports (24 pins), %u bytes.\n", BENCHMARK_FRAMES, stats->bytes);
+    printf("  simulated link: %.0f frames/s\n", BENCHMARK_FRAMES * 1e9 / stats->elapsedNs);
+    printf("  host: %.1f Mbytes/s through the ISR\n", stats->bytes * 1e3 / (sim_host_ns() - hostStart));
+}
+
+
+// REG_BOOT: back to the test.
+void sim_reset(void) {
+    ++resetCount;
+    longjmp(resetJump, 1);
+}
+
+
+void sim_idle(void) {
+    test_batched_write();
+    test_spi_pins_masked();
+    test_read();
+    test_pwm_enable();
+    test_bad_frames();
+    test_boot_enter();
+    benchmark();
+
+    exit(sim_finish());
+}
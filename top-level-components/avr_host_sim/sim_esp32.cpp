@@ -0,0 +1,70 @@
+/*  sim_esp32.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Built against the ESP32 host stubs, not the AVR ones; see sim_esp32.h.
+#include <cstdio>
+#include <cstring>
+
+#include "esp_log.h"
+#include "host_spi_master.h"
+#include "mqtt_client.h"
+#include "nvs_flash.h"
+
+#include "app_actuator_state.h"
+#include "app_mqtt.h"
+#include "app_queues.h"
+#include "app_spi.h"
+#include "sim_esp32.h"
+
+
+void sim_esp32_start(void) {
+    esp_log_level_set("*", ESP_LOG_WARN);
+    nvs_flash_init();
+    app_queues_init();
+    app_actuator_state_init();
+    app_spi_init();
+}
+
+
+bool sim_esp32_mqtt_data(const char *topic, const char *data) {
+    static int msgId = 0;
+    char topicCopy[64];
+    char dataCopy[64];
+    std::snprintf(topicCopy, sizeof(topicCopy), "%s", topic);
+    std::snprintf(dataCopy, sizeof(dataCopy), "%s", data);
+
+    esp_mqtt_event_t event = {};
+    event.event_id = MQTT_EVENT_DATA;
+    event.user_context = get_static_app_mqtt();
+    event.topic = topicCopy;
+    event.topic_len = static_cast<int>(std::strlen(topicCopy));
+    event.data = dataCopy;
+    event.data_len = static_cast<int>(std::strlen(dataCopy));
+    event.total_data_len = event.data_len;
+    // The duplicate filter keeps 16 bit ids, and 0 means QoS 0.
+    event.msg_id = (msgId++ % 65535) + 1;
+    return app_mqtt_event_handler(&event) == ESP_OK;
+}
+
+
+size_t sim_esp32_spi_transfer(const uint8_t *mosi, uint8_t *miso) {
+    return host_spi_master_transfer(mosi, miso, SIM_ESP32_TRANSACTION_LENGTH, 1);
+}
+
+
+bool sim_esp32_receive_upstream(char *msg, size_t size) {
+    AppSPIQueueNode node;
+    if (node.queueReceive(spiReceivedQueue, 0) != ESP_OK) {
+        return false;
+    }
+    std::snprintf(msg, size, "%s", node.getData().c_str());
+    return true;
+}
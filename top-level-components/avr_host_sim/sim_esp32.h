@@ -0,0 +1,54 @@
+/*  sim_esp32.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+#ifndef _SIM_ESP32_H_
+#define _SIM_ESP32_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//------------------------------------------------------------------------------
+// The ESP32 side of the link: the host build of secure_esp32_mqtt_client
+// (../secure_esp32_mqtt_client/host). Kept behind this header so its includes
+// don't meet the simulated AVR registers.
+//------------------------------------------------------------------------------
+// AppSPI's default transaction length.
+#define SIM_ESP32_TRANSACTION_LENGTH 32
+
+// The parts of app_main()'s boot sequence the link needs: NVS, the queues,
+// actuator state and AppSPI. The MQTT client and the publisher are not started.
+extern void sim_esp32_start(void);
+
+// Hands the broker's MQTT_EVENT_DATA to app_mqtt_event_handler(). Returns
+// false if it was not routed.
+extern bool sim_esp32_mqtt_data(const char *topic, const char *data);
+
+// Clocks the oldest transaction AppSPI has queued, as the SPI master. Both
+// buffers are SIM_ESP32_TRANSACTION_LENGTH bytes. Returns the number of bytes
+// clocked, 0 if AppSPI had nothing queued within a tick.
+extern size_t sim_esp32_spi_transfer(const uint8_t *mosi, uint8_t *miso);
+
+// Copies the oldest message AppSPI reassembled from spiReceivedQueue, where
+// the publisher would read it. Returns false if there is none.
+extern bool sim_esp32_receive_upstream(char *msg, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // _SIM_ESP32_H_
@@ -0,0 +1,174 @@
+/*  sim_esp32_link.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Runs arduino_spi_master.ino against the host build of AppSPI. Both are SPI
+// slaves, so the virtual master relays between them, with a FIFO each way:
+//   - It clocks AppSPI whenever AppSPI has a transaction queued, sending the
+//     sketch's bytes that are waiting.
+//   - It clocks the sketch while it has AppSPI's bytes for it, or while the
+//     sketch raises TX_REQUEST. Runs of padding from the sketch are dropped.
+// AppSPI only queues a transaction when it has something to send, so the
+// sketch's messages wait in the relay until the next downstream message.
+#include "Arduino.h"
+#include "arduino_spi_master.ino"
+#include "sim_esp32.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+
+
+static const unsigned BENCHMARK_MESSAGES = 1000;
+// Messages routed by the ESP32 and not yet dispatched by the sketch.
+static const unsigned BENCHMARK_WINDOW = 4;
+// Gives up on a check after this many transactions without the expected result.
+static const unsigned MAX_TRANSACTIONS = 200;
+
+static std::deque<uint8_t> toSketch;
+static std::deque<uint8_t> toEsp32;
+static uint8_t lastToEsp32 = 0;
+
+
+static bool isTxRequested(void) {
+    return (PORTC & _BV(TX_REQUEST_BIT)) != 0;
+}
+
+
+// Clocks one byte through the sketch.
+static void clockSketch(uint8_t mosi) {
+    uint8_t miso = sim_spi_transfer(mosi);
+    if (miso != 0 || lastToEsp32 != 0) {
+        toEsp32.push_back(miso);
+        lastToEsp32 = miso;
+    }
+}
+
+
+// Clocks one AppSPI transaction, if one is queued within a tick, and then up
+// to a transaction's worth of bytes through the sketch. Runs loop() once.
+static void relayTransaction(void) {
+    uint8_t mosi[SIM_ESP32_TRANSACTION_LENGTH] = {};
+    uint8_t miso[SIM_ESP32_TRANSACTION_LENGTH];
+    size_t waiting = std::min(toEsp32.size(), sizeof(mosi));
+    std::copy(toEsp32.begin(), toEsp32.begin() + waiting, mosi);
+    size_t clocked = sim_esp32_spi_transfer(mosi, miso);
+    if (clocked > 0) {
+        toEsp32.erase(toEsp32.begin(), toEsp32.begin() + std::min(waiting, clocked));
+        toSketch.insert(toSketch.end(), miso, miso + clocked);
+    }
+
+    for (size_t count = 0; count < SIM_ESP32_TRANSACTION_LENGTH; ++count) {
+        if (!toSketch.empty()) {
+            clockSketch(toSketch.front());
+            toSketch.pop_front();
+        } else if (isTxRequested()) {
+            clockSketch(0);
+        } else {
+            break;
+        }
+    }
+    // In burst mode the last byte is still in SPDR when TX_REQUEST drops.
+    if (lastToEsp32 != 0 && !isTxRequested()) {
+        clockSketch(0);
+    }
+    loop();
+}
+
+
+// Relays until isDone() or MAX_TRANSACTIONS. Returns isDone(), which is
+// called once after each transaction.
+template<typename Predicate>
+static bool relayUntil(Predicate isDone) {
+    for (unsigned count = 0; count < MAX_TRANSACTIONS; ++count) {
+        if (isDone()) {
+            return true;
+        }
+        relayTransaction();
+    }
+    return false;
+}
+
+
+// AppSPI sends "ping,ready" first, and the sketch answers it with "Hello SPI.".
+static void testLinkUp(void) {
+    SIM_CHECK(relayUntil([] { return !waitingForFirstSpiRx; }));
+    SIM_CHECK(relayUntil([] { return !isTxRequested(); }));
+    SIM_CHECK(toEsp32.size() == sizeof("Hello SPI."));
+}
+
+
+// An MQTT message for the sketch, from the broker's event to the zone pins.
+// Its transaction also carries the sketch's answer to the ping.
+static void testZoneOn(void) {
+    SIM_CHECK(sim_esp32_mqtt_data("irrigation/zone/on", "3"));
+    SIM_CHECK(relayUntil([] { return digitalRead(ZONE_PINS[2]) == HIGH; }));
+    SIM_CHECK(digitalRead(ZONE_PINS[0]) == LOW && digitalRead(ZONE_PINS[1]) == LOW && digitalRead(ZONE_PINS[3]) == LOW);
+
+    char msg[64] = "";
+    SIM_CHECK(relayUntil([&msg] { return sim_esp32_receive_upstream(msg, sizeof(msg)); }));
+    SIM_CHECK(std::strcmp(msg, "Hello SPI.") == 0);
+
+    SIM_CHECK(sim_esp32_mqtt_data("irrigation/zone/on", "0"));
+    SIM_CHECK(relayUntil([] { return digitalRead(ZONE_PINS[2]) == LOW; }));
+}
+
+
+static void benchmark(void) {
+    unsigned startCount = messageCount;
+    unsigned sent = 0;
+    rxBufferOverrunCount = 0;
+    sim_spi_reset_stats();
+
+    uint64_t hostStart = sim_host_ns();
+    unsigned idle = 0;
+    while (messageCount - startCount < BENCHMARK_MESSAGES && idle < MAX_TRANSACTIONS) {
+        while (sent < BENCHMARK_MESSAGES && sent - (messageCount - startCount) < BENCHMARK_WINDOW) {
+            char data[4];
+            std::snprintf(data, sizeof(data), "%u", sent % (ZONE_COUNT + 1));
+            if (!sim_esp32_mqtt_data("irrigation/zone/on", data)) {
+                break;
+            }
+            ++sent;
+        }
+        unsigned before = messageCount;
+        relayTransaction();
+        idle = (messageCount == before) ? idle + 1 : 0;
+    }
+    uint64_t hostNs = sim_host_ns() - hostStart;
+
+    const sim_spi_stats_t *stats = sim_spi_get_stats();
+    unsigned received = messageCount - startCount;
+    SIM_CHECK(received == BENCHMARK_MESSAGES);
+    SIM_CHECK(rxBufferOverrunCount == 0);
+
+    std::printf("Routed %u messages from app_mqtt_event_handler() to the sketch, %u bytes clocked.\n",
+        received, stats->bytes);
+    std::printf("  simulated link: %.0f bytes/s, %.0f msgs/s, %u collisions, %u overruns\n",
+        stats->bytes * 1e9 / stats->elapsedNs, received * 1e9 / stats->elapsedNs,
+        stats->collisions, stats->overruns);
+    std::printf("  host: %.0f msgs/s through AppSPI, the relay and the sketch\n", received * 1e9 / hostNs);
+}
+
+
+int main(int argc, char *argv[]) {
+    Serial.isEcho = (argc > 1 && std::strcmp(argv[1], "-v") == 0);
+
+    sim_esp32_start();
+    setup();
+    sim_spi_select(true);
+
+    testLinkUp();
+    testZoneOn();
+    benchmark();
+
+    return sim_finish();
+}
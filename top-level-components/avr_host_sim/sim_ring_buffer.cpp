@@ -0,0 +1,182 @@
+/*  sim_ring_buffer.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Runs RingBuffer from arduino_spi_master with the producer and the consumer
+// on two host threads, as the SPI ISR and loop() share it on the AVR. Each
+// side mixes single, bulk and in place access. The consumer checks that it
+// sees every value once, in order, and never more than Capacity in use.
+// On a host the indexes are acquire/release atomics, so this also exercises
+// the ordering the AVR build gets from its compiler barriers.
+#include "ring_buffer.h"
+#include "sim_avr.h"
+
+#include <cstdio>
+#include <thread>
+
+
+static const uint32_t VALUE_COUNT = 1000000;
+
+
+// A small generator, so each side picks its operations in its own order.
+static uint32_t nextRandom(uint32_t &state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 16;
+}
+
+
+template<typename Buffer, typename IndexType>
+static void producer(Buffer &buffer, uint32_t count) {
+    uint32_t state = 1;
+    uint32_t next = 0;
+    uint32_t values[Buffer::CAPACITY];
+    while (next < count) {
+        uint32_t remaining = count - next;
+        // Full: let the consumer run, in case the two share a CPU.
+        if (buffer.isFull()) {
+            std::this_thread::yield();
+            continue;
+        }
+        switch (nextRandom(state) % 3) {
+        case 0:
+            if (buffer.push(next)) {
+                ++next;
+            }
+            break;
+        case 1: {
+            IndexType wanted = static_cast<IndexType>(1 + nextRandom(state) % Buffer::CAPACITY);
+            if (wanted > remaining) {
+                wanted = static_cast<IndexType>(remaining);
+            }
+            for (IndexType ndx = 0; ndx < wanted; ++ndx) {
+                values[ndx] = next + ndx;
+            }
+            next += buffer.write(values, wanted);
+            break;
+        }
+        default: {
+            IndexType contiguous;
+            uint32_t *span = buffer.writeSpan(contiguous);
+            if (contiguous > remaining) {
+                contiguous = static_cast<IndexType>(remaining);
+            }
+            for (IndexType ndx = 0; ndx < contiguous; ++ndx) {
+                span[ndx] = next++;
+            }
+            buffer.commitWrite(contiguous);
+            break;
+        }
+        }
+    }
+}
+
+
+struct ConsumerResult {
+    uint32_t received;
+    uint32_t outOfOrder;
+    uint32_t overfull;
+};
+
+
+template<typename Buffer, typename IndexType>
+static void consumer(Buffer &buffer, uint32_t count, ConsumerResult &result) {
+    uint32_t state = 2;
+    uint32_t expected = 0;
+    uint32_t values[Buffer::CAPACITY];
+    result = ConsumerResult();
+
+    auto check = [&](uint32_t value) {
+        if (value != expected) {
+            ++result.outOfOrder;
+        }
+        expected = value + 1;
+        ++result.received;
+    };
+
+    while (result.received < count) {
+        IndexType size = buffer.size();
+        if (size > Buffer::CAPACITY) {
+            ++result.overfull;
+        }
+        if (size == 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        switch (nextRandom(state) % 3) {
+        case 0: {
+            // Not empty, so only the producer can change anything, and not this slot.
+            uint32_t peeked = buffer.peek();
+            uint32_t value = 0;
+            if (!buffer.pop(value) || value != peeked) {
+                ++result.outOfOrder;
+            }
+            check(value);
+            break;
+        }
+        case 1: {
+            IndexType wanted = static_cast<IndexType>(1 + nextRandom(state) % Buffer::CAPACITY);
+            IndexType got = buffer.read(values, wanted);
+            for (IndexType ndx = 0; ndx < got; ++ndx) {
+                check(values[ndx]);
+            }
+            break;
+        }
+        default: {
+            IndexType contiguous;
+            const uint32_t *span = buffer.readSpan(contiguous);
+            for (IndexType ndx = 0; ndx < contiguous; ++ndx) {
+                check(span[ndx]);
+            }
+            buffer.consume(contiguous);
+            break;
+        }
+        }
+    }
+}
+
+
+template<unsigned Capacity, typename IndexType>
+struct TestBuffer : public RingBuffer<uint32_t, Capacity, IndexType> {
+    static const unsigned CAPACITY = Capacity;
+};
+
+
+template<unsigned Capacity, typename IndexType>
+static void testTwoThreads(const char *name) {
+    typedef TestBuffer<Capacity, IndexType> Buffer;
+    static Buffer buffer;
+    ConsumerResult result;
+
+    uint64_t hostStart = sim_host_ns();
+    std::thread consumerThread(consumer<Buffer, IndexType>, std::ref(buffer), VALUE_COUNT, std::ref(result));
+    producer<Buffer, IndexType>(buffer, VALUE_COUNT);
+    consumerThread.join();
+    uint64_t hostNs = sim_host_ns() - hostStart;
+
+    SIM_CHECK(result.received == VALUE_COUNT);
+    SIM_CHECK(result.outOfOrder == 0);
+    SIM_CHECK(result.overfull == 0);
+    SIM_CHECK(buffer.isEmpty());
+    std::printf("  %-28s %u values, %u out of order, %.1f M values/s\n",
+        name, result.received, result.outOfOrder, result.received * 1e3 / hostNs);
+}
+
+
+int main(void) {
+    if (std::thread::hardware_concurrency() < 2) {
+        std::printf("Only one host CPU: the two sides take turns instead of racing.\n");
+    }
+    std::printf("RingBuffer, producer and consumer on two threads:\n");
+    testTwoThreads<8, uint8_t>("<uint32_t, 8>");
+    testTwoThreads<128, uint8_t>("<uint32_t, 128>");
+    testTwoThreads<1024, uint16_t>("<uint32_t, 1024, uint16_t>");
+
+    return sim_finish();
+}
@@ -0,0 +1,443 @@
+// F_CPU tells util/delay.h our clock frequency
+#ifndef F_CPU
+#define F_CPU 8000000UL // 8MHz
+#endif
+
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/boot.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include <stdint.h>
+
+#include "spi_bootloader.h"
+
+
+/*  SPI bootloader. Linked into the boot section (see the Makefile) and
+    started on every reset (BOOTRST). It jumps to the application when the
+    EEPROM says the application is valid. Otherwise it takes a new image
+    over SPI, see spi_bootloader.h for the protocol.
+
+    Like spi_master.c, everything happens in the ISRs:
+    - SPI_STC_vect receives a frame into a free page buffer,
+    - PCINT0_vect checks it when SS goes high and queues it,
+    - SPM_READY_vect erases and writes the queued pages, one after the
+      other, and finally checks the whole image.
+    The boot section keeps running while the application section is erased
+    or written, so the next page is clocked in during the 9ms that takes.
+*/
+#define PAGE_BUFFER_COUNT   2   // A power of 2.
+#define PAGE_RAW_LENGTH     (BOOT_PAGE_FRAME_LENGTH - 1)
+#define PAGE_DATA_OFFSET    2
+#define PAGE_CRC_OFFSET     (PAGE_DATA_OFFSET + BOOT_PAGE_SIZE)
+
+#if BOOT_PAGE_SIZE != SPM_PAGESIZE
+#error "BOOT_PAGE_SIZE does not match this AVR."
+#endif
+
+
+typedef enum {
+    FRAME_COMMAND,
+    FRAME_PAGE,
+    FRAME_FINISH,
+    FRAME_STATUS,
+    FRAME_END,          // The command is complete, any further byte is an error.
+    FRAME_ERROR         // Ignore everything until SS goes high.
+} frame_state_t;
+
+typedef enum {
+    PROGRAM_IDLE,
+    PROGRAM_ERASING,
+    PROGRAM_WRITING,
+    PROGRAM_VERIFYING
+} program_step_t;
+
+// A page frame as received, without the command byte:
+//   [address lo] [address hi] [data 0] ... [data 127] [crc lo] [crc hi]
+typedef struct {
+    uint8_t raw[PAGE_RAW_LENGTH];
+} page_buffer_t;
+
+
+// Frame state. Only touched from the SPI and pin change ISRs, which never nest.
+static frame_state_t frameState = FRAME_COMMAND;
+static uint8_t frameCommand;
+static uint8_t frameIndex;
+static uint8_t finishRaw[BOOT_FINISH_FRAME_LENGTH - 1];
+static uint8_t statusSnapshot[BOOT_STATUS_LENGTH];
+
+// Page ring. The pin change ISR adds pages, SPM_READY_vect takes them.
+// SPM_READY_vect runs with interrupts enabled, so it changes these with
+// interrupts disabled.
+static page_buffer_t pageBuffers[PAGE_BUFFER_COUNT];
+static volatile uint8_t receiveIndex;
+static volatile uint8_t programIndex;
+static volatile uint8_t bufferCount;
+
+static volatile uint8_t state = BOOT_STATE_RECEIVING;
+static volatile uint8_t lastError = BOOT_ERROR_NONE;
+static volatile uint8_t programStep = PROGRAM_IDLE;
+static uint16_t nextAddress;
+static volatile uint16_t writtenEnd;
+static uint32_t imageLength;
+static uint32_t imageCrc;
+
+
+// CRC-16/XMODEM (polynomial 0x1021, initial value 0), without a table.
+static uint16_t crc16_update( uint16_t crc, uint8_t data )
+{
+    crc = (crc >> 8) | (crc << 8);
+    crc ^= data;
+    crc ^= (crc & 0xFF) >> 4;
+    crc ^= crc << 12;
+    crc ^= (crc & 0xFF) << 5;
+    return crc;
+}
+
+
+// CRC-32 (reflected, polynomial 0xEDB88320), as zlib's crc32().
+static uint32_t crc32_update( uint32_t crc, uint8_t data )
+{
+    uint8_t bit;
+
+    crc ^= data;
+    for (bit = 0; bit < 8; ++bit) {
+        crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320UL : 0);
+    }
+    return crc;
+}
+
+
+// Nothing has been set up yet, so the application starts as it would after a reset.
+static void start_application( void )
+{
+    ((void (*)( void ))0)();
+}
+
+
+// Run: the watchdog resets the AVR, and the bootloader starts again.
+static void reset( void )
+{
+    wdt_enable(WDTO_15MS);
+    for (;;) {
+    }
+}
+
+
+//-------------------------------------
+// Programming, in SPM_READY_vect.
+//-------------------------------------
+static void verify_image( void )
+{
+    uint32_t crc = 0xFFFFFFFFUL;
+    uint16_t address;
+
+    // The application section can not be read until it is enabled again.
+    boot_spm_busy_wait();
+    cli();
+    boot_rww_enable();
+    sei();
+
+    for (address = 0; address < imageLength; ++address) {
+        crc = crc32_update(crc, pgm_read_byte(address));
+    }
+    if ((crc ^ 0xFFFFFFFFUL) == imageCrc) {
+        eeprom_write_byte(BOOT_APP_VALID_ADDRESS, BOOT_APP_VALID);
+        eeprom_busy_wait();
+        state = BOOT_STATE_DONE;
+    } else {
+        lastError = BOOT_ERROR_IMAGE_CRC;
+        state = BOOT_STATE_FAILED;
+    }
+}
+
+
+static uint16_t page_address( const page_buffer_t *page )
+{
+    return page->raw[0] | ((uint16_t)page->raw[1] << 8);
+}
+
+
+// Takes the next step. Returns with SPMIE set if an SPM operation was started.
+static void program_next( void )
+{
+    const page_buffer_t *page = &pageBuffers[programIndex];
+    uint16_t address = page_address(page);
+    uint8_t index;
+
+    switch (programStep) {
+        case PROGRAM_ERASING:
+            // Fill the temporary page buffer one word at a time, so the SPI
+            // ISR is never held off for long.
+            for (index = 0; index < BOOT_PAGE_SIZE; index += 2) {
+                uint16_t word = page->raw[PAGE_DATA_OFFSET + index]
+                              | ((uint16_t)page->raw[PAGE_DATA_OFFSET + index + 1] << 8);
+                cli();
+                boot_page_fill(address + index, word);
+                sei();
+            }
+            cli();
+            boot_page_write(address);
+            programStep = PROGRAM_WRITING;
+            boot_spm_interrupt_enable();
+            sei();
+            return;
+
+        case PROGRAM_WRITING:
+            cli();
+            writtenEnd = address + BOOT_PAGE_SIZE;
+            programIndex = (programIndex + 1) & (PAGE_BUFFER_COUNT - 1);
+            --bufferCount;
+            sei();
+            break;
+
+        default:
+            break;
+    }
+
+    cli();
+    if (bufferCount > 0) {
+        boot_page_erase(page_address(&pageBuffers[programIndex]));
+        programStep = PROGRAM_ERASING;
+        boot_spm_interrupt_enable();
+        sei();
+    } else if (state == BOOT_STATE_VERIFYING) {
+        programStep = PROGRAM_VERIFYING;
+        sei();
+        verify_image();
+        programStep = PROGRAM_IDLE;
+    } else {
+        programStep = PROGRAM_IDLE;
+        sei();
+    }
+}
+
+
+// Called with interrupts disabled.
+static void program_start( void )
+{
+    if (programStep == PROGRAM_IDLE) {
+        // SPMEN is clear, so this raises SPM_READY_vect straight away.
+        boot_spm_interrupt_enable();
+    }
+}
+
+
+// An SPM operation finished. SPM_READY_vect stays raised while SPMIE is
+// set, so clear it before enabling interrupts for the SPI.
+ISR( SPM_READY_vect )
+{
+    boot_spm_interrupt_disable();
+    sei();
+    program_next();
+}
+
+
+//-------------------------------------
+// Frames, in the SPI and pin change ISRs.
+//-------------------------------------
+static void take_status_snapshot( void )
+{
+    statusSnapshot[BOOT_STATUS_SIGNATURE] = BOOT_SIGNATURE;
+    statusSnapshot[BOOT_STATUS_STATE] = state;
+    statusSnapshot[BOOT_STATUS_ERROR] = lastError;
+    statusSnapshot[BOOT_STATUS_NEXT_LO] = nextAddress & 0xFF;
+    statusSnapshot[BOOT_STATUS_NEXT_HI] = nextAddress >> 8;
+    statusSnapshot[BOOT_STATUS_FREE_BUFFERS] = PAGE_BUFFER_COUNT - bufferCount;
+    statusSnapshot[BOOT_STATUS_WRITTEN_LO] = writtenEnd & 0xFF;
+    statusSnapshot[BOOT_STATUS_WRITTEN_HI] = writtenEnd >> 8;
+}
+
+
+static void frame_reject( uint8_t error )
+{
+    lastError = error;
+    frameState = FRAME_ERROR;
+}
+
+
+// Handles one received byte. SPDR is written first, as it must be loaded
+// before the master starts clocking the next byte.
+static void frame_receive( uint8_t rx )
+{
+    switch (frameState) {
+        case FRAME_COMMAND:
+            frameCommand = rx;
+            frameIndex = 0;
+            if (rx == BOOT_COMMAND_STATUS) {
+                take_status_snapshot();
+                SPDR = statusSnapshot[0];
+                frameIndex = 1;
+                frameState = FRAME_STATUS;
+                break;
+            }
+            SPDR = 0;
+            if (rx == BOOT_COMMAND_PAGE) {
+                if (bufferCount < PAGE_BUFFER_COUNT) {
+                    frameState = FRAME_PAGE;
+                } else {
+                    frame_reject(BOOT_ERROR_BUSY);
+                }
+            } else if (rx == BOOT_COMMAND_FINISH) {
+                frameState = FRAME_FINISH;
+            } else if (rx == BOOT_COMMAND_RUN) {
+                frameState = FRAME_END;
+            } else {
+                frame_reject(BOOT_ERROR_FRAME);
+            }
+            break;
+
+        case FRAME_PAGE:
+            SPDR = 0;
+            pageBuffers[receiveIndex].raw[frameIndex] = rx;
+            if (++frameIndex == PAGE_RAW_LENGTH) {
+                frameState = FRAME_END;
+            }
+            break;
+
+        case FRAME_FINISH:
+            SPDR = 0;
+            finishRaw[frameIndex] = rx;
+            if (++frameIndex == sizeof(finishRaw)) {
+                frameState = FRAME_END;
+            }
+            break;
+
+        case FRAME_STATUS:
+            if (frameIndex < BOOT_STATUS_LENGTH) {
+                SPDR = statusSnapshot[frameIndex++];
+            } else {
+                SPDR = 0;
+            }
+            break;
+
+        case FRAME_END:
+            SPDR = 0;
+            frame_reject(BOOT_ERROR_FRAME);
+            break;
+
+        case FRAME_ERROR:
+        default:
+            SPDR = 0;
+            break;
+    }
+}
+
+
+static void page_commit( void )
+{
+    const page_buffer_t *page = &pageBuffers[receiveIndex];
+    uint16_t address = page_address(page);
+    uint16_t crc = 0;
+    uint8_t index;
+
+    if (state != BOOT_STATE_RECEIVING || address != nextAddress || address >= BOOT_SECTION_START) {
+        lastError = BOOT_ERROR_ADDRESS;
+        return;
+    }
+    for (index = 0; index < PAGE_CRC_OFFSET; ++index) {
+        crc = crc16_update(crc, page->raw[index]);
+    }
+    if (crc != (page->raw[PAGE_CRC_OFFSET] | ((uint16_t)page->raw[PAGE_CRC_OFFSET + 1] << 8))) {
+        lastError = BOOT_ERROR_PAGE_CRC;
+        return;
+    }
+
+    receiveIndex = (receiveIndex + 1) & (PAGE_BUFFER_COUNT - 1);
+    ++bufferCount;
+    nextAddress += BOOT_PAGE_SIZE;
+    program_start();
+}
+
+
+static void finish_commit( void )
+{
+    uint32_t length = finishRaw[0] | ((uint32_t)finishRaw[1] << 8)
+                    | ((uint32_t)finishRaw[2] << 16) | ((uint32_t)finishRaw[3] << 24);
+    uint32_t pagesEnd = (length + BOOT_PAGE_SIZE - 1) & ~(uint32_t)(BOOT_PAGE_SIZE - 1);
+
+    if (state != BOOT_STATE_RECEIVING) {
+        return;
+    }
+    if (length == 0 || pagesEnd != nextAddress) {
+        lastError = BOOT_ERROR_LENGTH;
+        return;
+    }
+    imageLength = length;
+    imageCrc = finishRaw[4] | ((uint32_t)finishRaw[5] << 8)
+             | ((uint32_t)finishRaw[6] << 16) | ((uint32_t)finishRaw[7] << 24);
+    state = BOOT_STATE_VERIFYING;
+    program_start();
+}
+
+
+ISR( SPI_STC_vect )
+{
+    frame_receive(SPDR);
+}
+
+
+// SS changed. Going high ends the frame and acts on it.
+ISR( PCINT0_vect )
+{
+    if (PINB & (1<<PB2)) {
+        // This vector has priority over SPI_STC_vect, so the last byte
+        // of the frame may still be waiting.
+        if (SPSR & (1<<SPIF)) {
+            frame_receive(SPDR);
+        }
+        if (frameState == FRAME_END) {
+            switch (frameCommand) {
+                case BOOT_COMMAND_PAGE:     page_commit(); break;
+                case BOOT_COMMAND_FINISH:   finish_commit(); break;
+                case BOOT_COMMAND_RUN:      reset(); break;
+                default:                    break;
+            }
+        } else if (frameState == FRAME_PAGE || frameState == FRAME_FINISH) {
+            lastError = BOOT_ERROR_FRAME;
+        }
+        frameState = FRAME_COMMAND;
+        SPDR = 0;
+    }
+}
+
+
+static void spi_init_slave( void )
+{
+    // MISO as OUTPUT
+    DDRB = (1<<4);
+
+    // MSB first, SCK low when idle, sampled on the leading edge. As spi_master.c.
+    SPCR = (1<<SPE) | (1<<SPIE);
+    SPDR = 0;
+
+    // Pin change interrupt on SS (PB2 = PCINT2) marks the frame boundaries.
+    PCMSK0 = (1<<PCINT2);
+    PCICR = (1<<PCIE0);
+}
+
+
+int main( void ) {
+    // A watchdog reset leaves the watchdog running.
+    MCUSR = 0;
+    wdt_disable();
+
+    if (eeprom_read_byte(BOOT_APP_VALID_ADDRESS) == BOOT_APP_VALID) {
+        start_application();
+    }
+
+    // Vectors to the boot section.
+    MCUCR = (1<<IVCE);
+    MCUCR = (1<<IVSEL);
+
+    spi_init_slave();
+    sei();
+
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    while(1) {
+        sleep_mode();
+    }
+}
@@ -0,0 +1,84 @@
+/*  spi_bootloader.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+#ifndef _SPI_BOOTLOADER_H_
+#define _SPI_BOOTLOADER_H_
+
+
+/*  Bootloader protocol, shared by spi_master.c and spi_bootloader.c.
+    The master is the same SPI master as for the register map. A frame is
+    everything clocked while SS is low and holds one command:
+
+        page:   [0x01] [address lo] [address hi] [data 0] ... [data 127] [crc lo] [crc hi]
+        finish: [0x02] [length 0] ... [length 3] [crc 0] ... [crc 3]
+        run:    [0x03]
+        status: [0x80] [dummy 0] ... [dummy 7]
+
+    A page is taken only if it is the next one expected and a page buffer is
+    free. Its CRC-16 (XMODEM) covers the address and the data. Erasing and
+    writing a page runs in the background while the next page is clocked in.
+
+    Finish names the image length and its CRC-32 (as zlib's crc32()). Once
+    every page is written the flash is read back and checked, and only then
+    is the application marked valid.
+
+    Run resets the AVR: into the application if it is valid, otherwise back
+    into the bootloader.
+
+    Status returns BOOT_STATUS_LENGTH bytes in place of the dummy bytes. A
+    rejected page leaves nextAddress where it was, so the master resends
+    from there.
+*/
+#define BOOT_COMMAND_PAGE       0x01
+#define BOOT_COMMAND_FINISH     0x02
+#define BOOT_COMMAND_RUN        0x03
+#define BOOT_COMMAND_STATUS     0x80
+
+#define BOOT_PAGE_SIZE          128     // SPM_PAGESIZE of the ATmega168/328P.
+#define BOOT_PAGE_FRAME_LENGTH  (1 + 2 + BOOT_PAGE_SIZE + 2)
+#define BOOT_FINISH_FRAME_LENGTH (1 + 4 + 4)
+
+// Status reply.
+#define BOOT_STATUS_SIGNATURE       0   // BOOT_SIGNATURE: the bootloader is running.
+#define BOOT_STATUS_STATE           1
+#define BOOT_STATUS_ERROR           2   // Last error, kept until the next one.
+#define BOOT_STATUS_NEXT_LO         3   // Address of the next page to send.
+#define BOOT_STATUS_NEXT_HI         4
+#define BOOT_STATUS_FREE_BUFFERS    5
+#define BOOT_STATUS_WRITTEN_LO      6   // Every page below this is written.
+#define BOOT_STATUS_WRITTEN_HI      7
+#define BOOT_STATUS_LENGTH          8
+
+#define BOOT_SIGNATURE          0xB7
+
+#define BOOT_STATE_RECEIVING    0
+#define BOOT_STATE_VERIFYING    1
+#define BOOT_STATE_DONE         2       // The application is valid. Send run.
+#define BOOT_STATE_FAILED       3       // Send run to start again.
+
+#define BOOT_ERROR_NONE         0
+#define BOOT_ERROR_FRAME        1       // Unknown command, or the frame was cut short or too long.
+#define BOOT_ERROR_ADDRESS      2       // Not the next page, or inside the bootloader.
+#define BOOT_ERROR_BUSY         3       // No free page buffer.
+#define BOOT_ERROR_PAGE_CRC     4
+#define BOOT_ERROR_LENGTH       5       // Finish before every page of the image was sent.
+#define BOOT_ERROR_IMAGE_CRC    6
+
+// The last 2K of the flash (BOOTSZ = 1024 words) holds the bootloader.
+#define BOOT_SECTION_SIZE       2048
+#define BOOT_SECTION_START      (FLASHEND + 1 - BOOT_SECTION_SIZE)
+
+// Last EEPROM byte. BOOT_APP_VALID once an image has been checked, erased
+// by the application to get back into the bootloader.
+#define BOOT_APP_VALID_ADDRESS  ((uint8_t *)E2END)
+#define BOOT_APP_VALID          0xA5
+
+
+#endif // _SPI_BOOTLOADER_H_
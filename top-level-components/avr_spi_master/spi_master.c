@@ -1,73 +1,346 @@
-
-// F_CPU tells util/delay.h our clock frequency
-#ifndef F_CPU
-#define F_CPU 8000000UL // 8MHz
-#endif
-
-
-//#define DD_MISO   B,4
-//#define DD_MOSI   B,3
-//#define DD_SCK    B,5
-//#define DD_SS     B,2
-
-
-#include <avr/io.h>
-//#include <stdlib.h>
-//#include <util/delay.h>
-
-
-void spi_init_slave( void )
-{
-    // MISO as OUTPUT
-    DDRB = (1<<4);
-    //pinMode(MISO, OUTPUT); //Arduino
-
-    /*  Enable SPI.
-        SPCR0:
-        Bit 7 – SPIE0: SPI0 Interrupt Enable
-        Bit 6 – SPE0: SPI0 Enable
-        Bit 5 – DORD0: Data0 Order
-            0 = the MSB of the data word is transmitted first.
-            1 = the LSB of the data word is transmitted first.
-        Bit 4 – MSTR0: Master/Slave0 Select
-            0 = Slave
-            1 = Master
-        Bit 3 – CPOL0: Clock0 Polarity
-            0 = SCK is low when idle
-            1 = SCK is high when idle
-        Bit 2 – CPHA0: Clock0 Phase
-            0 = data is sampled on the leading edge of SCK
-            1 = data is sampled on the trailing edge of SCK
-        Bits 1:0 – SPR0n: SPI0 Clock Rate Select n [n = 1:0]
-    */
-    // MSB First,
-    // SCK is low when idle,
-    // data is sampled on the leading edge of SCK
-    SPCR = (1<<SPE);
-}
-
-
-unsigned char spi_tranceiver( unsigned char data )
-{
-    // Load data to send.
-    SPDR = data;
-
-    // Wait until transmission complete.
-    while(!( SPSR & (1<<SPIF) ));
-
-    // Return received data.
-    return(SPDR);
-}
-
-
-int main( void ) {
-    spi_init_slave();
-
-    // Port D: set all pins to HIGH, and to OUTPUT.
-    PORTD = 0xFF;
-    DDRD =  0xFF;
-
-    while(1) {
-        PORTD = spi_tranceiver( 0 );
-    }
-}
+// F_CPU tells util/delay.h our clock frequency
+#ifndef F_CPU
+#define F_CPU 8000000UL // 8MHz
+#endif
+
+
+//#define DD_MISO   B,4
+//#define DD_MOSI   B,3
+//#define DD_SCK    B,5
+//#define DD_SS     B,2
+
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include <stdint.h>
+//#include <stdlib.h>
+//#include <util/delay.h>
+
+#include "spi_bootloader.h"
+
+
+/*  Register-map protocol.
+    A frame is everything clocked while SS is low. It holds one or more records:
+
+        write:  [address]        [length] [data 0] ... [data length-1]
+        read:   [0x80 | address] [length] [dummy 0] ... [dummy length-1]
+
+    A write record stages its data for the registers address .. address+length-1.
+    The staged registers are applied together, with interrupts disabled, when SS
+    goes high. A frame with a bad record is discarded whole.
+
+    A read record snapshots the registers when its length byte arrives and
+    returns them in place of the dummy bytes.
+
+    Writing REG_BOOT_ENTER to REG_BOOT resets into spi_bootloader.c to take
+    a new image.
+
+    See README.md for the register map.
+*/
+#define REG_READ        0x80
+
+// Writable registers.
+#define REG_PORTB       0x00
+#define REG_PORTC       0x01
+#define REG_PORTD       0x02
+#define REG_DDRB        0x03
+#define REG_DDRC        0x04
+#define REG_DDRD        0x05
+#define REG_OCR0A       0x06    // PWM duty, OC0A (PD6).
+#define REG_OCR0B       0x07    // PWM duty, OC0B (PD5).
+#define REG_OCR2B       0x08    // PWM duty, OC2B (PD3).
+#define REG_PWM_ENABLE  0x09    // bit 0: OC0A, bit 1: OC0B, bit 2: OC2B.
+#define REG_WRITABLE_COUNT 10
+
+// Read only registers.
+#define REG_PINB        0x0A
+#define REG_PINC        0x0B
+#define REG_PIND        0x0C
+
+// Write only.
+#define REG_BOOT        0x0D
+#define REG_COUNT       14
+
+#define REG_BOOT_ENTER  0xB0
+
+#define PWM_ENABLE_OC0A (1<<0)
+#define PWM_ENABLE_OC0B (1<<1)
+#define PWM_ENABLE_OC2B (1<<2)
+
+// SS (PB2), MOSI (PB3), MISO (PB4) and SCK (PB5) belong to the SPI and can not be written.
+#define SPI_PINS_MASK   ((1<<PB2) | (1<<PB3) | (1<<PB4) | (1<<PB5))
+
+
+typedef enum {
+    FRAME_ADDRESS,
+    FRAME_LENGTH,
+    FRAME_WRITE_DATA,
+    FRAME_READ_DATA,
+    FRAME_ERROR         // Ignore everything until SS goes high.
+} frame_state_t;
+
+// Only touched from the SPI and pin change ISRs, which never nest.
+static frame_state_t frameState = FRAME_ADDRESS;
+static uint8_t recordAddress;
+static uint8_t recordRemaining;
+static uint8_t recordIsRead;
+
+static uint8_t stagedValues[REG_COUNT];
+static uint16_t stagedMask;                 // Bit n set: stagedValues[n] is waiting to be applied.
+
+static uint8_t readSnapshot[REG_COUNT];
+static uint8_t readIndex;
+
+static uint8_t pwmEnable;
+
+
+// The application is no longer marked valid, so the bootloader stays
+// after the reset. Without a bootloader this just restarts the application.
+static void enter_bootloader( void )
+{
+    eeprom_write_byte(BOOT_APP_VALID_ADDRESS, 0xFF);
+    eeprom_busy_wait();
+    wdt_enable(WDTO_15MS);
+    for (;;) {
+    }
+}
+
+
+static uint8_t read_register( uint8_t address )
+{
+    switch (address) {
+        case REG_PORTB:         return PORTB;
+        case REG_PORTC:         return PORTC;
+        case REG_PORTD:         return PORTD;
+        case REG_DDRB:          return DDRB;
+        case REG_DDRC:          return DDRC;
+        case REG_DDRD:          return DDRD;
+        case REG_OCR0A:         return OCR0A;
+        case REG_OCR0B:         return OCR0B;
+        case REG_OCR2B:         return OCR2B;
+        case REG_PWM_ENABLE:    return pwmEnable;
+        case REG_PINB:          return PINB;
+        case REG_PINC:          return PINC;
+        case REG_PIND:          return PIND;
+        default:                return 0;
+    }
+}
+
+
+static void write_register( uint8_t address, uint8_t value )
+{
+    switch (address) {
+        case REG_PORTB:     PORTB = (PORTB & SPI_PINS_MASK) | (value & ~SPI_PINS_MASK); break;
+        case REG_PORTC:     PORTC = value; break;
+        case REG_PORTD:     PORTD = value; break;
+        case REG_DDRB:      DDRB = (DDRB & SPI_PINS_MASK) | (value & ~SPI_PINS_MASK); break;
+        case REG_DDRC:      DDRC = value; break;
+        case REG_DDRD:      DDRD = value; break;
+        case REG_OCR0A:     OCR0A = value; break;
+        case REG_OCR0B:     OCR0B = value; break;
+        case REG_OCR2B:     OCR2B = value; break;
+        case REG_PWM_ENABLE:
+            // A disabled PWM pin goes back to following PORTD.
+            pwmEnable = value & (PWM_ENABLE_OC0A | PWM_ENABLE_OC0B | PWM_ENABLE_OC2B);
+            TCCR0A = (1<<WGM01) | (1<<WGM00)
+                   | ((pwmEnable & PWM_ENABLE_OC0A) ? (1<<COM0A1) : 0)
+                   | ((pwmEnable & PWM_ENABLE_OC0B) ? (1<<COM0B1) : 0);
+            TCCR2A = (1<<WGM21) | (1<<WGM20)
+                   | ((pwmEnable & PWM_ENABLE_OC2B) ? (1<<COM2B1) : 0);
+            break;
+        case REG_BOOT:
+            if (value == REG_BOOT_ENTER) {
+                enter_bootloader();
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+
+// Called with interrupts disabled, so no other code sees a partial update.
+static void apply_staged_registers( void )
+{
+    uint8_t address;
+
+    // REG_BOOT is last, so the frame's other registers are written first.
+    for (address = 0; address < REG_COUNT; ++address) {
+        if (stagedMask & (1u << address)) {
+            write_register(address, stagedValues[address]);
+        }
+    }
+    stagedMask = 0;
+}
+
+
+static void frame_reset( void )
+{
+    frameState = FRAME_ADDRESS;
+    stagedMask = 0;
+    SPDR = 0;
+}
+
+
+// Handles one received byte. SPDR is written first, as it must be loaded
+// before the master starts clocking the next byte.
+static void frame_receive( uint8_t rx )
+{
+    switch (frameState) {
+        case FRAME_ADDRESS:
+            SPDR = 0;
+            recordIsRead = rx & REG_READ;
+            recordAddress = rx & ~REG_READ;
+            frameState = FRAME_LENGTH;
+            break;
+
+        case FRAME_LENGTH:
+            recordRemaining = rx;
+            if (recordRemaining == 0) {
+                SPDR = 0;
+                frameState = FRAME_ADDRESS;
+            } else if (recordIsRead) {
+                if (recordAddress >= REG_COUNT || recordRemaining > REG_COUNT - recordAddress) {
+                    SPDR = 0;
+                    frameState = FRAME_ERROR;
+                } else {
+                    // Take every register at once, then start returning them.
+                    for (readIndex = 0; readIndex < recordRemaining; ++readIndex) {
+                        readSnapshot[readIndex] = read_register(recordAddress + readIndex);
+                    }
+                    SPDR = readSnapshot[0];
+                    readIndex = 1;
+                    frameState = FRAME_READ_DATA;
+                }
+            } else {
+                SPDR = 0;
+                if (recordAddress == REG_BOOT && recordRemaining == 1) {
+                    frameState = FRAME_WRITE_DATA;
+                } else if (recordAddress >= REG_WRITABLE_COUNT || recordRemaining > REG_WRITABLE_COUNT - recordAddress) {
+                    frameState = FRAME_ERROR;
+                } else {
+                    frameState = FRAME_WRITE_DATA;
+                }
+            }
+            break;
+
+        case FRAME_WRITE_DATA:
+            SPDR = 0;
+            stagedValues[recordAddress] = rx;
+            stagedMask |= (1u << recordAddress);
+            ++recordAddress;
+            if (--recordRemaining == 0) {
+                frameState = FRAME_ADDRESS;
+            }
+            break;
+
+        case FRAME_READ_DATA:
+            if (--recordRemaining == 0) {
+                SPDR = 0;
+                frameState = FRAME_ADDRESS;
+            } else {
+                SPDR = readSnapshot[readIndex++];
+            }
+            break;
+
+        case FRAME_ERROR:
+        default:
+            SPDR = 0;
+            break;
+    }
+}
+
+
+ISR( SPI_STC_vect )
+{
+    frame_receive(SPDR);
+}
+
+
+// SS changed. Going high ends the frame and applies what it staged,
+// unless the frame was cut short or had a bad record.
+ISR( PCINT0_vect )
+{
+    if (PINB & (1<<PB2)) {
+        // This vector has priority over SPI_STC_vect, so the last byte
+        // of the frame may still be waiting.
+        if (SPSR & (1<<SPIF)) {
+            frame_receive(SPDR);
+        }
+        if (frameState == FRAME_ADDRESS) {
+            apply_staged_registers();
+        }
+        frame_reset();
+    }
+}
+
+
+void spi_init_slave( void )
+{
+    // MISO as OUTPUT
+    DDRB = (1<<4);
+    //pinMode(MISO, OUTPUT); //Arduino
+
+    /*  Enable SPI.
+        SPCR0:
+        Bit 7 – SPIE0: SPI0 Interrupt Enable
+        Bit 6 – SPE0: SPI0 Enable
+        Bit 5 – DORD0: Data0 Order
+            0 = the MSB of the data word is transmitted first.
+            1 = the LSB of the data word is transmitted first.
+        Bit 4 – MSTR0: Master/Slave0 Select
+            0 = Slave
+            1 = Master
+        Bit 3 – CPOL0: Clock0 Polarity
+            0 = SCK is low when idle
+            1 = SCK is high when idle
+        Bit 2 – CPHA0: Clock0 Phase
+            0 = data is sampled on the leading edge of SCK
+            1 = data is sampled on the trailing edge of SCK
+        Bits 1:0 – SPR0n: SPI0 Clock Rate Select n [n = 1:0]
+    */
+    // MSB First,
+    // SCK is low when idle,
+    // data is sampled on the leading edge of SCK
+    SPCR = (1<<SPE) | (1<<SPIE);
+    SPDR = 0;
+
+    // Pin change interrupt on SS (PB2 = PCINT2) marks the frame boundaries.
+    PCMSK0 = (1<<PCINT2);
+    PCICR = (1<<PCIE0);
+}
+
+
+void pwm_init( void )
+{
+    // Timers 0 and 2: fast PWM, clk/8 (about 3.9kHz at 8MHz).
+    // The outputs stay disconnected until enabled through REG_PWM_ENABLE.
+    TCCR0A = (1<<WGM01) | (1<<WGM00);
+    TCCR0B = (1<<CS01);
+    TCCR2A = (1<<WGM21) | (1<<WGM20);
+    TCCR2B = (1<<CS21);
+}
+
+
+int main( void ) {
+    // A watchdog reset leaves the watchdog running.
+    MCUSR = 0;
+    wdt_disable();
+
+    // Port D: set all pins to HIGH, and to OUTPUT.
+    PORTD = 0xFF;
+    DDRD =  0xFF;
+
+    pwm_init();
+    spi_init_slave();
+    sei();
+
+    // Everything happens in the ISRs.
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    while(1) {
+        sleep_mode();
+    }
+}
@@ -0,0 +1,1008 @@
+/*  app_bench.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+
+    Benchmarks the application components through their public APIs:
+
+      queue hand-off   An AppMQTTQueueNode sent and received on a private queue.
+      outbox append    An upstream message appended to AppOutbox, on a file
+                       with flash erase/write semantics (FileOutboxStorage).
+      outbox replay    One record replayed from it and marked consumed.
+      topic lookup     lookupTopicIndex() against a strcmp() scan of TOPIC_MANIFEST
+                       and a std::unordered_map, for known and unknown topics.
+      config parser    Not timed. app_runtime_config_parse() on valid, malformed,
+                       out of range and truncated payloads, JSON and binary.
+      mqtt -> spi      MQTT_EVENT_DATA into app_mqtt_event_handler() until the
+                       virtual SPI master has clocked the message's null terminator.
+      spi -> queue     Bytes clocked in by the virtual master until AppSPI has
+                       reassembled the message and it is read from spiReceivedQueue.
+      uart -> queue    A line arriving on UART2 at a given baud rate until uart_echo.c
+                       has read it and it is read from spiReceivedQueue.
+
+    Usage: app_bench [message count]
+           app_bench placements [message count]
+
+    "placements" repeats the two way link run with the pipeline stages on
+    different cores, each in a child process: the bench thread stands in for
+    MQTT ingest and the upstream consumer for the publisher. The virtual SPI
+    master runs on the remaining host CPUs, so it needs at least three.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "driver/spi_slave.h"
+#include "driver/uart.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "host_spi_master.h"
+#include "mqtt_client.h"
+#include "nvs_flash.h"
+
+#include "app_actuator_state.h"
+#include "app_heap_stats.h"
+#include "app_mqtt.h"
+#include "app_pipeline.h"
+#include "app_queues.h"
+#include "app_runtime_config.h"
+#include "app_spi.h"
+#include "app_topic_dispatch.h"
+#include "file_outbox_storage.h"
+#include "uart_echo.h"
+
+
+typedef std::chrono::steady_clock Clock;
+
+// AppSPI's default transaction length.
+static const size_t TRANSACTION_LENGTH = 32;
+
+static const char *DOWNSTREAM_TOPIC = "irrigation/zone/on";
+static const char *UPSTREAM_TOPIC = "sensor/moisture";
+static const char *UART_TOPIC = "sensor/uart";
+
+static const unsigned DEFAULT_MESSAGE_COUNT = 2000;
+static const unsigned QUEUE_HANDOFF_COUNT = 100000;
+static const unsigned TOPIC_LOOKUP_COUNT = 1000000;
+
+// uart_echo.c's port, and the bytes the receive ISR takes from the FIFO at a time.
+static const uart_port_t UART_PORT = UART_NUM_2;
+static const size_t UART_FIFO_CHUNK = 120;
+// Each baud rate is offered this many seconds of lines, at most.
+static const double UART_RUN_SECONDS = 0.5;
+
+// The size of the "outbox" partition in partitions.csv.
+static const size_t OUTBOX_SIZE = 256 * 1024;
+
+
+//-------------------------------------
+// Allocation counting.
+//-------------------------------------
+#if CONFIG_APP_HEAP_ACCOUNTING
+// app_heap_stats.cpp owns new/delete and counts every allocation.
+static uint64_t allocationsSoFar() {
+    uint64_t count = 0;
+    for (unsigned subsystem = 0; subsystem < APP_HEAP_SUBSYSTEM_COUNT; ++subsystem) {
+        app_heap_stats_t stats;
+        app_heap_get_stats(static_cast<app_heap_subsystem_t>(subsystem), &stats);
+        count += stats.allocCount;
+    }
+    return count;
+}
+#else
+static std::atomic<uint64_t> allocationCount{0};
+
+static uint64_t allocationsSoFar() {
+    return allocationCount;
+}
+
+void * operator new(size_t size) {
+    ++allocationCount;
+    void *ptr = std::malloc(size ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    std::free(ptr);
+}
+#endif
+
+
+//-------------------------------------
+// Results.
+//-------------------------------------
+static int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+
+static void printHeader() {
+    std::printf("%-32s %8s %12s %10s %10s %10s %10s\n",
+        "benchmark", "messages", "msg/s", "p50 us", "p99 us", "p999 us", "allocs/msg");
+}
+
+
+// latenciesNs is sorted in place.
+static void printResult(const char *name, std::vector<int64_t> &latenciesNs, int64_t elapsedNs, uint64_t allocations) {
+    size_t count = latenciesNs.size();
+    if (count == 0) {
+        std::printf("%-32s no messages!\n", name);
+        return;
+    }
+    std::sort(latenciesNs.begin(), latenciesNs.end());
+    auto percentileUs = [&latenciesNs, count](double fraction) {
+        size_t index = static_cast<size_t>(fraction * (count - 1));
+        return latenciesNs[index] / 1000.0;
+    };
+    std::printf("%-32s %8u %12.0f %10.1f %10.1f %10.1f %10.2f\n",
+        name, static_cast<unsigned>(count), count * 1e9 / elapsedNs,
+        percentileUs(0.50), percentileUs(0.99), percentileUs(0.999),
+        static_cast<double>(allocations) / count);
+}
+
+
+// Reads the sequence number from "topic,<seq>:padding". Returns false for any other message.
+static bool parseSequence(const char *msg, size_t msgLength, const char *topic, unsigned &seq) {
+    size_t topicLength = std::strlen(topic);
+    if (msgLength <= topicLength + 1 || std::memcmp(msg, topic, topicLength) != 0 || msg[topicLength] != ',') {
+        return false;
+    }
+    seq = static_cast<unsigned>(std::strtoul(msg + topicLength + 1, nullptr, 10));
+    return true;
+}
+
+
+// "<seq>:" padded with 'x' to dataLength bytes.
+static size_t formatData(char *buffer, size_t bufferSize, unsigned seq, size_t dataLength) {
+    int length = std::snprintf(buffer, bufferSize, "%u:", seq);
+    size_t total = std::max(static_cast<size_t>(length), std::min(dataLength, bufferSize - 1));
+    std::memset(buffer + length, 'x', total - length);
+    buffer[total] = '\0';
+    return total;
+}
+
+
+//-------------------------------------
+// queue hand-off.
+//-------------------------------------
+static void benchQueueHandoff() {
+    QueueHandle_t queue = xQueueCreate(4, sizeof(AppMQTTQueueNode));
+    configASSERT(queue);
+    std::vector<int64_t> latenciesNs;
+    latenciesNs.reserve(QUEUE_HANDOFF_COUNT);
+    char data[16];
+
+    uint64_t allocationsBefore = allocationsSoFar();
+    int64_t startNs = nowNs();
+    for (unsigned seq = 0; seq < QUEUE_HANDOFF_COUNT; ++seq) {
+        size_t dataLength = formatData(data, sizeof(data), seq, 8);
+        int64_t sentNs = nowNs();
+        AppMQTTQueueNode sendNode(DOWNSTREAM_TOPIC, std::strlen(DOWNSTREAM_TOPIC), data, dataLength);
+        AppMQTTQueueNode receiveNode;
+        if (sendNode.queueSendToBack(queue, 0) != ESP_OK || receiveNode.queueReceive(queue, 0) != ESP_OK) {
+            std::printf("queue hand-off: message %u lost!\n", seq);
+            break;
+        }
+        latenciesNs.push_back(nowNs() - sentNs);
+    }
+    int64_t elapsedNs = nowNs() - startNs;
+
+    printResult("queue hand-off", latenciesNs, elapsedNs, allocationsSoFar() - allocationsBefore);
+    vQueueDelete(queue);
+}
+
+
+//-------------------------------------
+// outbox append and replay.
+//-------------------------------------
+struct OutboxReplay {
+    unsigned seq;
+    bool isInOrder;
+};
+
+
+static esp_err_t outboxReplayCallback(void *context, const char *record, size_t recordLength) {
+    OutboxReplay *replay = static_cast<OutboxReplay *>(context);
+    unsigned seq;
+    if (!parseSequence(record, recordLength, UPSTREAM_TOPIC, seq) || seq != replay->seq) {
+        replay->isInOrder = false;
+    }
+    ++replay->seq;
+    return ESP_OK;
+}
+
+
+// Fills the outbox as an outage would, then drains it as the publisher does
+// on reconnect. messageCount is capped so that nothing is dropped.
+static void benchOutbox(unsigned messageCount) {
+    char path[] = "/tmp/app_bench_outbox_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        std::printf("outbox: no temporary file!\n");
+        return;
+    }
+    close(fd);
+    unlink(path);
+
+    FileOutboxStorage storage(path, OUTBOX_SIZE);
+    AppOutbox *outbox = new AppOutbox;
+    if (outbox->init(&storage) != ESP_OK) {
+        std::printf("outbox: init failed!\n");
+        delete outbox;
+        unlink(path);
+        return;
+    }
+
+    char msg[64];
+    int topicLength = std::snprintf(msg, sizeof(msg), "%s,", UPSTREAM_TOPIC);
+    // A record and its header take under 40 bytes. Two sectors are left for
+    // the sector headers and the head.
+    messageCount = std::min(messageCount, static_cast<unsigned>((OUTBOX_SIZE - 2 * 4096) / 40));
+    std::vector<int64_t> latenciesNs;
+    latenciesNs.reserve(messageCount);
+
+    uint64_t allocationsBefore = allocationsSoFar();
+    int64_t startNs = nowNs();
+    for (unsigned seq = 0; seq < messageCount; ++seq) {
+        size_t msgLength = topicLength + formatData(msg + topicLength, sizeof(msg) - topicLength, seq, 8);
+        int64_t appendNs = nowNs();
+        if (outbox->append(msg, msgLength) != ESP_OK) {
+            std::printf("outbox append: message %u lost!\n", seq);
+            break;
+        }
+        latenciesNs.push_back(nowNs() - appendNs);
+    }
+    printResult("outbox append", latenciesNs, nowNs() - startNs, allocationsSoFar() - allocationsBefore);
+
+    OutboxReplay replay = { 0, true };
+    latenciesNs.clear();
+    allocationsBefore = allocationsSoFar();
+    startNs = nowNs();
+    while (!outbox->isEmpty()) {
+        int64_t replayNs = nowNs();
+        if (outbox->replay(1, outboxReplayCallback, &replay) != 1) {
+            std::printf("outbox replay: stuck with %u record(s) left!\n", outbox->getPendingCount());
+            break;
+        }
+        latenciesNs.push_back(nowNs() - replayNs);
+    }
+    printResult("outbox replay", latenciesNs, nowNs() - startNs, allocationsSoFar() - allocationsBefore);
+    if (!replay.isInOrder || replay.seq != messageCount || outbox->getDroppedCount() != 0) {
+        std::printf("outbox replay: %u of %u records, %u dropped, %s!\n", replay.seq, messageCount,
+            outbox->getDroppedCount(), replay.isInOrder ? "in order" : "out of order");
+    }
+
+    delete outbox;
+    unlink(path);
+}
+
+
+//-------------------------------------
+// topic lookup.
+//-------------------------------------
+// What the MQTT task sees: every known topic, plus topics that only differ
+// from one near the end and ones of the same length.
+static std::vector<std::string> lookupTopics() {
+    std::vector<std::string> topics;
+    for (const TopicManifestEntry &entry : TOPIC_MANIFEST) {
+        topics.push_back(entry.topic);
+        std::string similar(entry.topic);
+        similar.back() ^= 1;
+        topics.push_back(similar);
+    }
+    topics.push_back(UPSTREAM_TOPIC);
+    topics.push_back("irrigation/zone/off");
+    return topics;
+}
+
+
+static int lookupByStrcmp(const char *topic, size_t topicLength) {
+    for (size_t index = 0; index < TOPIC_MANIFEST_SIZE; ++index) {
+        const TopicManifestEntry &entry = TOPIC_MANIFEST[index];
+        if (entry.topicLength == topicLength && std::strncmp(entry.topic, topic, topicLength) == 0) {
+            return static_cast<int>(index);
+        }
+    }
+    return -1;
+}
+
+
+// Returns the nanoseconds per lookup, and the sum of the indexes found so the
+// loop can't be optimised away.
+template<typename Lookup>
+static double timeLookups(const std::vector<std::string> &topics, Lookup lookup, long &indexSum) {
+    int64_t startNs = nowNs();
+    for (unsigned count = 0; count < TOPIC_LOOKUP_COUNT; ++count) {
+        const std::string &topic = topics[count % topics.size()];
+        indexSum += lookup(topic.data(), topic.size());
+    }
+    return static_cast<double>(nowNs() - startNs) / TOPIC_LOOKUP_COUNT;
+}
+
+
+// Also checks that the perfect hash finds every manifest topic and nothing else.
+static bool benchTopicLookup() {
+    std::vector<std::string> topics = lookupTopics();
+    std::unordered_map<std::string, int> map;
+    for (size_t index = 0; index < TOPIC_MANIFEST_SIZE; ++index) {
+        map.emplace(TOPIC_MANIFEST[index].topic, static_cast<int>(index));
+    }
+
+    bool isCorrect = true;
+    for (const std::string &topic : topics) {
+        int expected = lookupByStrcmp(topic.data(), topic.size());
+        int found = lookupTopicIndex(topic.data(), topic.size());
+        if (found != expected) {
+            std::printf("topic lookup: '%s' found at %d, expected %d!\n", topic.c_str(), found, expected);
+            isCorrect = false;
+        }
+    }
+
+    long indexSums[3] = {};
+    double perfectNs = timeLookups(topics, lookupTopicIndex, indexSums[0]);
+    double strcmpNs = timeLookups(topics, lookupByStrcmp, indexSums[1]);
+    // Topics arrive as a pointer and a length, so the map needs a std::string each time.
+    double mapNs = timeLookups(topics, [&map](const char *topic, size_t topicLength) {
+        auto found = map.find(std::string(topic, topicLength));
+        return (found == map.end()) ? -1 : found->second;
+    }, indexSums[2]);
+    if (indexSums[0] != indexSums[1] || indexSums[0] != indexSums[2]) {
+        std::printf("topic lookup: the three lookups disagree!\n");
+        isCorrect = false;
+    }
+
+    std::printf("\ntopic lookup, %u manifest topic(s), %u topics: perfect hash %.1f ns, strcmp %.1f ns, unordered_map %.1f ns\n",
+        static_cast<unsigned>(TOPIC_MANIFEST_SIZE), static_cast<unsigned>(topics.size()), perfectNs, strcmpNs, mapNs);
+    return isCorrect;
+}
+
+
+//-------------------------------------
+// Runtime config parser.
+//-------------------------------------
+#if CONFIG_APP_RUNTIME_CONFIG
+// A payload and what app_runtime_config_parse() should make of it: nullptr
+// if it is valid, or part of the error it must report.
+struct ConfigCase {
+    std::string payload;
+    const char *expectedError;
+};
+
+
+// Binary encoding of spiQueueSize 8 and APP_SPI at debug, the rest the defaults.
+static std::string validBinaryConfig() {
+    const uint8_t bytes[] = {
+        'R', 'C', APP_CONFIG_BINARY_VERSION, ESP_LOG_INFO,
+        4, 0,   4, 0,   8, 0,   32, 0,   1, 0,   0xE8, 0x03,
+        1,   7, 'A', 'P', 'P', '_', 'S', 'P', 'I',   ESP_LOG_DEBUG,
+    };
+    return std::string(reinterpret_cast<const char *>(bytes), sizeof(bytes));
+}
+
+
+static std::vector<ConfigCase> configCases() {
+    std::vector<ConfigCase> cases = {
+        { "",                                                       nullptr },
+        { "{}",                                                     nullptr },
+        { "{\"mqttRxQueueLength\":8,\"spiQueueSize\":8,\"spiTransactionLength\":64,"
+          "\"logLevel\":\"info\",\"logLevels\":{\"APP_SPI\":\"debug\"}}", nullptr },
+        { validBinaryConfig(),                                      nullptr },
+
+        // Malformed JSON.
+        { "spiQueueSize:8",                                         "expected '{'" },
+        { "{\"spiQueueSize\" 8}",                                   "expected ':'" },
+        { "{\"logLevels\":{\"APP_SPI\" \"debug\"}}",                 "expected ':'" },
+        { "{\"spiQueueSize\":8",                                    "expected ',' or '}'" },
+        { "{\"logLevels\":{\"APP_SPI\":\"debug\"",                   "logLevels: expected ',' or '}'" },
+        { "{\"spiQueueSize\":8}}",                                  "trailing characters" },
+        { "{\"spiQueueSize:8}",                                     "unterminated string" },
+        { "{\"spi\\u0051ueueSize\":8}",                             "escapes are not supported" },
+        { "{\"spiQueueSize\":\"8\"}",                               "expected a number" },
+        { "{\"spiQueSize\":8}",                                     "unknown key" },
+        { "{\"logLevel\":\"loud\"}",                                "unknown level" },
+
+        // Out of range.
+        { "{\"spiQueueSize\":0}",                                   "is not in" },
+        { "{\"spiQueueSize\":17}",                                  "is not in" },
+        { "{\"mqttRxQueueLength\":70000}",                          "expected a number up to 65535" },
+        { "{\"spiTransactionLength\":30,\"spiQueueSize\":8}",       "not a multiple of 4" },
+        { "{\"spiQueueSize\":4}",                                   "spiQueueSize * spiTransactionLength" },
+        { "{\"logLevel\":9}",                                       "no level" },
+        { "{\"logLevels\":{\"a\":1,\"b\":1,\"c\":1,\"d\":1,\"e\":1}}", "more than 4 tags" },
+        { "{\"logLevels\":{\"\":1}}",                               "is empty or longer than" },
+    };
+
+    // Every binary payload cut short, from the magic on.
+    std::string binary = validBinaryConfig();
+    for (size_t length = 2; length < binary.size(); ++length) {
+        cases.push_back({ binary.substr(0, length), "binary:" });
+    }
+    std::string wrongVersion = binary;
+    wrongVersion[2] = APP_CONFIG_BINARY_VERSION + 1;
+    cases.push_back({ wrongVersion, "binary: version" });
+    cases.push_back({ binary + '\0', "binary: 1 trailing bytes" });
+    return cases;
+}
+
+
+static bool checkConfigParser() {
+    std::vector<ConfigCase> cases = configCases();
+    unsigned wrongCount = 0;
+    for (const ConfigCase &configCase : cases) {
+        app_runtime_config_t config;
+        char error[80] = "";
+        bool isValid = app_runtime_config_parse(configCase.payload.data(), configCase.payload.size(), &config,
+            error, sizeof(error));
+        bool isRight = configCase.expectedError
+            ? (!isValid && error[0] != '\0' && std::strstr(error, configCase.expectedError))
+            : isValid;
+        if (!isRight) {
+            std::printf("config parser: payload of %u bytes %s, error \"%s\", expected %s!\n",
+                static_cast<unsigned>(configCase.payload.size()), isValid ? "accepted" : "rejected", error,
+                configCase.expectedError ? configCase.expectedError : "valid");
+            ++wrongCount;
+        }
+    }
+
+    // The binary payload decodes to what it encodes.
+    app_runtime_config_t config;
+    char error[80] = "";
+    std::string binary = validBinaryConfig();
+    if (!app_runtime_config_parse(binary.data(), binary.size(), &config, error, sizeof(error))
+        || config.spiQueueSize != 8 || config.publisherPollMs != 1000 || config.tagLogLevelCount != 1
+        || std::strcmp(config.tagLogLevels[0].tag, "APP_SPI") != 0 || config.tagLogLevels[0].level != ESP_LOG_DEBUG) {
+        std::printf("config parser: the binary payload decoded wrongly!\n");
+        ++wrongCount;
+    }
+
+    std::printf("\nconfig parser: %u payloads, %u handled wrongly\n", static_cast<unsigned>(cases.size()), wrongCount);
+    return wrongCount == 0;
+}
+#endif
+
+
+//-------------------------------------
+// Virtual SPI master and upstream consumer.
+//-------------------------------------
+// One run of the link. The master clocks every transaction AppSPI queues; the
+// MISO bytes are split at null terminators into downstream messages and, if
+// upstreamCount > 0, MOSI carries a stream of upstream messages.
+struct LinkRun {
+    unsigned downstreamCount = 0;
+    unsigned upstreamCount = 0;
+    size_t upstreamDataLength = 0;
+
+    std::vector<int64_t> downstreamSentNs;
+    std::vector<int64_t> downstreamDoneNs;
+    std::vector<int64_t> upstreamSentNs;
+    std::vector<int64_t> upstreamDoneNs;
+    std::atomic<unsigned> downstreamDone{0};
+    std::atomic<unsigned> upstreamDone{0};
+    std::atomic<unsigned> generation{0};    // Bumped by reset() so the master restarts its upstream stream.
+    std::atomic<bool> isRunning{true};
+
+    void reset(unsigned downstream, unsigned upstream, size_t upstreamLength) {
+        downstreamCount = downstream;
+        upstreamCount = upstream;
+        upstreamDataLength = upstreamLength;
+        downstreamSentNs.assign(downstream, 0);
+        downstreamDoneNs.assign(downstream, 0);
+        upstreamSentNs.assign(upstream, 0);
+        upstreamDoneNs.assign(upstream, 0);
+        downstreamDone = 0;
+        upstreamDone = 0;
+        ++generation;
+    }
+};
+
+static LinkRun linkRun;
+static std::atomic<bool> isLinkActive{false};
+
+// One run of UART ingest; upstreamConsumerThread() marks lines done.
+struct UartRun {
+    unsigned lineCount = 0;
+    std::vector<int64_t> sentNs;
+    std::vector<int64_t> doneNs;
+    std::atomic<unsigned> done{0};
+
+    void reset(unsigned lines) {
+        lineCount = lines;
+        sentNs.assign(lines, 0);
+        doneNs.assign(lines, 0);
+        done = 0;
+    }
+};
+
+static UartRun uartRun;
+static std::atomic<bool> isUartActive{false};
+// AppSPI sends "ping,ready" once it takes messages from mqttReceivedQueue.
+static std::atomic<bool> isLinkReady{false};
+static const char *LINK_READY_MESSAGE = "ping,ready";
+
+
+static void masterThread() {
+    // The master is another chip, so it keeps off the ESP32's cores if it can.
+    host_pin_off_cores();
+
+    char miso[TRANSACTION_LENGTH];
+    char mosi[TRANSACTION_LENGTH];
+    char downstream[256];
+    size_t downstreamLength = 0;
+
+    // The upstream byte stream: the message being sent and how far into it we are.
+    unsigned generation = 0;
+    char upstream[128];
+    size_t upstreamLength = 0;
+    size_t upstreamOffset = 0;
+    unsigned upstreamSeq = 0;
+    unsigned upstreamNextSeq = 0;
+
+    // MOSI is kept until it has been clocked, along with the upstream messages it completes.
+    bool isMosiReady = false;
+    unsigned endingSeqs[TRANSACTION_LENGTH];
+    unsigned endingCount = 0;
+
+    while (linkRun.isRunning) {
+        if (generation != linkRun.generation) {
+            generation = linkRun.generation;
+            upstreamLength = 0;
+            upstreamOffset = 0;
+            upstreamNextSeq = 0;
+            isMosiReady = false;
+        }
+
+        // Fill MOSI, starting new upstream messages as the previous one runs out.
+        if (!isMosiReady) {
+            size_t mosiLength = 0;
+            endingCount = 0;
+            while (isLinkActive && mosiLength < TRANSACTION_LENGTH) {
+                if (upstreamOffset == upstreamLength) {
+                    if (upstreamNextSeq >= linkRun.upstreamCount) {
+                        break;
+                    }
+                    upstreamSeq = upstreamNextSeq++;
+                    int topicLength = std::snprintf(upstream, sizeof(upstream), "%s,", UPSTREAM_TOPIC);
+                    upstreamLength = topicLength + formatData(upstream + topicLength, sizeof(upstream) - topicLength,
+                                                              upstreamSeq, linkRun.upstreamDataLength);
+                    upstreamLength += 1; // The null terminator.
+                    upstreamOffset = 0;
+                }
+                size_t chunk = std::min(TRANSACTION_LENGTH - mosiLength, upstreamLength - upstreamOffset);
+                std::memcpy(mosi + mosiLength, upstream + upstreamOffset, chunk);
+                mosiLength += chunk;
+                upstreamOffset += chunk;
+                if (upstreamOffset == upstreamLength) {
+                    endingSeqs[endingCount++] = upstreamSeq;
+                }
+            }
+            std::memset(mosi + mosiLength, 0, TRANSACTION_LENGTH - mosiLength);
+            isMosiReady = true;
+        }
+
+        size_t clocked = host_spi_master_transfer(mosi, miso, TRANSACTION_LENGTH, 1);
+        if (clocked == 0) {
+            continue;
+        }
+        isMosiReady = false;
+        int64_t clockedNs = nowNs();
+        for (unsigned index = 0; index < endingCount; ++index) {
+            linkRun.upstreamSentNs[endingSeqs[index]] = clockedNs;
+        }
+
+        for (size_t index = 0; index < clocked; ++index) {
+            if (miso[index]) {
+                if (downstreamLength < sizeof(downstream) - 1) {
+                    downstream[downstreamLength++] = miso[index];
+                }
+                continue;
+            }
+            if (downstreamLength == std::strlen(LINK_READY_MESSAGE)
+                && std::memcmp(downstream, LINK_READY_MESSAGE, downstreamLength) == 0) {
+                isLinkReady = true;
+            }
+            unsigned seq;
+            if (downstreamLength > 0 && isLinkActive
+                && parseSequence(downstream, downstreamLength, DOWNSTREAM_TOPIC, seq)
+                && seq < linkRun.downstreamCount)
+            {
+                linkRun.downstreamDoneNs[seq] = clockedNs;
+                ++linkRun.downstreamDone;
+            }
+            downstreamLength = 0;
+        }
+    }
+}
+
+
+static void upstreamConsumerThread(BaseType_t coreId) {
+    host_pin_to_core(coreId);
+    while (linkRun.isRunning) {
+        AppSPIQueueNode node;
+        if (node.queueReceive(spiReceivedQueue, 1) != ESP_OK) {
+            continue;
+        }
+        int64_t receivedNs = nowNs();
+        const SpiMessageString &msg = node.getData();
+        unsigned seq;
+        if (isLinkActive && parseSequence(msg.c_str(), msg.size(), UPSTREAM_TOPIC, seq) && seq < linkRun.upstreamCount) {
+            linkRun.upstreamDoneNs[seq] = receivedNs;
+            ++linkRun.upstreamDone;
+        } else if (isUartActive && parseSequence(msg.c_str(), msg.size(), UART_TOPIC, seq) && seq < uartRun.lineCount) {
+            uartRun.doneNs[seq] = receivedNs;
+            ++uartRun.done;
+        }
+    }
+}
+
+
+//-------------------------------------
+// mqtt -> spi (and spi -> queue).
+//-------------------------------------
+// Sends messageCount downstream messages, keeping at most window of them in
+// flight. Upstream messages ride along on the same transactions.
+static void benchLink(const char *name, unsigned messageCount, size_t dataLength, unsigned window,
+                      unsigned upstreamCount, size_t upstreamDataLength) {
+    linkRun.reset(messageCount, upstreamCount, upstreamDataLength);
+    static int msgId = 0;
+    char data[128];
+    char topic[64];
+    std::strncpy(topic, DOWNSTREAM_TOPIC, sizeof(topic));
+
+    esp_mqtt_event_t event = {};
+    event.event_id = MQTT_EVENT_DATA;
+    event.user_context = get_static_app_mqtt();
+    event.topic = topic;
+    event.topic_len = static_cast<int>(std::strlen(topic));
+    event.data = data;
+
+    uint64_t allocationsBefore = allocationsSoFar();
+    int64_t startNs = nowNs();
+    isLinkActive = true;
+    for (unsigned seq = 0; seq < messageCount; ++seq) {
+        while (seq - linkRun.downstreamDone >= window) {
+            std::this_thread::yield();
+        }
+        event.data_len = static_cast<int>(formatData(data, sizeof(data), seq, dataLength));
+        event.total_data_len = event.data_len;
+        event.current_data_offset = 0;
+        // The duplicate filter keeps 16 bit ids, and 0 means QoS 0.
+        event.msg_id = (msgId++ % 65535) + 1;
+
+        linkRun.downstreamSentNs[seq] = nowNs();
+        if (app_mqtt_event_handler(&event) != ESP_OK) {
+            std::printf("%s: message %u was not queued!\n", name, seq);
+        }
+    }
+
+    // Wait for the stragglers; give up after a second without progress.
+    unsigned lastProgress = 0;
+    int64_t lastProgressNs = nowNs();
+    while (linkRun.downstreamDone < messageCount || linkRun.upstreamDone < upstreamCount) {
+        unsigned progress = linkRun.downstreamDone + linkRun.upstreamDone;
+        if (progress != lastProgress) {
+            lastProgress = progress;
+            lastProgressNs = nowNs();
+        } else if (nowNs() - lastProgressNs > 1000LL * 1000 * 1000) {
+            std::printf("%s: stalled with %u/%u downstream and %u/%u upstream messages delivered!\n", name,
+                linkRun.downstreamDone.load(), messageCount, linkRun.upstreamDone.load(), upstreamCount);
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    // Downstream traffic keeps the link clocking while upstream messages finish.
+    int64_t elapsedNs = nowNs() - startNs;
+    isLinkActive = false;
+    uint64_t allocations = allocationsSoFar() - allocationsBefore;
+
+    std::vector<int64_t> latenciesNs;
+    for (unsigned seq = 0; seq < messageCount; ++seq) {
+        if (linkRun.downstreamDoneNs[seq]) {
+            latenciesNs.push_back(linkRun.downstreamDoneNs[seq] - linkRun.downstreamSentNs[seq]);
+        }
+    }
+    char label[64];
+    std::snprintf(label, sizeof(label), "mqtt -> spi %s", name);
+    // Both directions share the allocations, so with upstream traffic they are
+    // reported once, per upstream message.
+    printResult(label, latenciesNs, elapsedNs, upstreamCount ? 0 : allocations);
+
+    if (upstreamCount) {
+        latenciesNs.clear();
+        for (unsigned seq = 0; seq < upstreamCount; ++seq) {
+            if (linkRun.upstreamDoneNs[seq] && linkRun.upstreamSentNs[seq]) {
+                latenciesNs.push_back(linkRun.upstreamDoneNs[seq] - linkRun.upstreamSentNs[seq]);
+            }
+        }
+        std::snprintf(label, sizeof(label), "spi -> queue %s", name);
+        printResult(label, latenciesNs, elapsedNs, allocations);
+    }
+}
+
+
+//-------------------------------------
+// uart -> queue.
+//-------------------------------------
+struct UartResult {
+    int baudRate;
+    unsigned lineCount;
+    unsigned linesDone;
+    double offeredBytesPerSecond;
+    double deliveredBytesPerSecond;
+};
+
+
+// Plays the far end of UART2 at baudRate (8N1), sending lines of
+// "sensor/uart,<seq>:padding\n" back to back. Each chunk is handed to the
+// driver when its last byte would have arrived: at a line terminator, as the
+// pattern interrupt fires there, or else after a FIFO full.
+static UartResult benchUart(int baudRate, unsigned maxLineCount, size_t dataLength) {
+    char line[128];
+    int topicLength = std::snprintf(line, sizeof(line), "%s,", UART_TOPIC);
+    size_t lineLength = topicLength + formatData(line + topicLength, sizeof(line) - topicLength, 0, dataLength) + 1;
+    double bytesPerSecond = baudRate / 10.0;
+    unsigned lineCount = std::min(maxLineCount, static_cast<unsigned>(bytesPerSecond * UART_RUN_SECONDS / lineLength));
+    lineCount = std::max(lineCount, 1u);
+
+    std::string stream;
+    std::vector<size_t> lineEnds;
+    for (unsigned seq = 0; seq < lineCount; ++seq) {
+        size_t length = topicLength + formatData(line + topicLength, sizeof(line) - topicLength, seq, dataLength);
+        line[length++] = '\n';
+        stream.append(line, length);
+        lineEnds.push_back(stream.size());
+    }
+
+    uartRun.reset(lineCount);
+    isUartActive = true;
+    uint64_t allocationsBefore = allocationsSoFar();
+    int64_t startNs = nowNs();
+    size_t offset = 0;
+    unsigned nextSeq = 0;
+    while (offset < stream.size()) {
+        size_t end = std::min(offset + UART_FIFO_CHUNK, lineEnds[nextSeq]);
+        int64_t arrivalNs = startNs + static_cast<int64_t>(end * 1e9 / bytesPerSecond);
+        while (nowNs() < arrivalNs) {
+            if (arrivalNs - nowNs() > 200 * 1000) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+        int64_t receivedNs = nowNs();
+        // A full ring buffer drops the rest of the chunk, as the hardware FIFO overflows.
+        host_uart_receive(UART_PORT, stream.data() + offset, end - offset);
+        if (end == lineEnds[nextSeq]) {
+            uartRun.sentNs[nextSeq++] = receivedNs;
+        }
+        offset = end;
+    }
+    int64_t offeredNs = nowNs() - startNs;
+
+    // Wait for the stragglers; give up after a second without progress.
+    unsigned lastProgress = 0;
+    int64_t lastProgressNs = nowNs();
+    while (uartRun.done < lineCount) {
+        unsigned progress = uartRun.done;
+        if (progress != lastProgress) {
+            lastProgress = progress;
+            lastProgressNs = nowNs();
+        } else if (nowNs() - lastProgressNs > 1000LL * 1000 * 1000) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    isUartActive = false;
+    uint64_t allocations = allocationsSoFar() - allocationsBefore;
+
+    std::vector<int64_t> latenciesNs;
+    int64_t lastDoneNs = startNs;
+    for (unsigned seq = 0; seq < lineCount; ++seq) {
+        if (uartRun.doneNs[seq]) {
+            latenciesNs.push_back(uartRun.doneNs[seq] - uartRun.sentNs[seq]);
+            lastDoneNs = std::max(lastDoneNs, uartRun.doneNs[seq]);
+        }
+    }
+    char label[64];
+    std::snprintf(label, sizeof(label), "uart -> queue (%d baud)", baudRate);
+    printResult(label, latenciesNs, lastDoneNs - startNs, allocations);
+
+    UartResult result;
+    result.baudRate = baudRate;
+    result.lineCount = lineCount;
+    result.linesDone = static_cast<unsigned>(latenciesNs.size());
+    result.offeredBytesPerSecond = stream.size() * 1e9 / offeredNs;
+    result.deliveredBytesPerSecond = latenciesNs.size() * lineLength * 1e9 / (lastDoneNs - startNs);
+    return result;
+}
+
+
+static void printUartResults(const std::vector<UartResult> &results) {
+    std::printf("\nuart ingest, sustained:\n");
+    for (const UartResult &result : results) {
+        std::printf("  %8d baud %10.0f bytes/s offered %10.0f bytes/s delivered, %u of %u lines lost\n",
+            result.baudRate, result.offeredBytesPerSecond, result.deliveredBytesPerSecond,
+            result.lineCount - result.linesDone, result.lineCount);
+    }
+}
+
+
+//-------------------------------------
+// Placements.
+//-------------------------------------
+struct Placement {
+    const char *name;
+    BaseType_t ingestCore;      // The bench thread, calling app_mqtt_event_handler().
+    BaseType_t linkCore;        // The App SPI task.
+    BaseType_t publisherCore;   // The upstream consumer.
+};
+
+static const Placement PLACEMENTS[] = {
+    //  name                ingest          link            publisher
+    {   "split",            PRO_CPU_NUM,    APP_CPU_NUM,    PRO_CPU_NUM    },
+    {   "publisher on APP", PRO_CPU_NUM,    APP_CPU_NUM,    APP_CPU_NUM    },
+    {   "ingest on APP",    APP_CPU_NUM,    APP_CPU_NUM,    PRO_CPU_NUM    },
+    {   "all on PRO",       PRO_CPU_NUM,    PRO_CPU_NUM,    PRO_CPU_NUM    },
+    {   "all on APP",       APP_CPU_NUM,    APP_CPU_NUM,    APP_CPU_NUM    },
+    {   "unpinned",         tskNO_AFFINITY, tskNO_AFFINITY, tskNO_AFFINITY },
+};
+
+
+static const char *coreName(BaseType_t coreId) {
+    return (coreId == PRO_CPU_NUM) ? "PRO" : (coreId == APP_CPU_NUM) ? "APP" : "any";
+}
+
+
+// The parts of app_main()'s boot sequence that do not need the network.
+// The publisher is not started; the upstream consumer reads spiReceivedQueue instead.
+static void startComponents() {
+    nvs_flash_init();
+    app_queues_init();
+    app_actuator_state_init();
+    app_spi_init();
+}
+
+
+static void waitForLink() {
+    int64_t startNs = nowNs();
+    while (!isLinkReady) {
+        if (nowNs() - startNs > 5000LL * 1000 * 1000) {
+            std::printf("The SPI link did not come up!\n");
+            std::fflush(stdout);
+            std::_Exit(EXIT_FAILURE);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+
+static void stopLink(std::thread &master, std::thread &consumer) {
+    linkRun.isRunning = false;
+    master.join();
+    consumer.join();
+}
+
+
+// Runs in a child process, as the task placement is fixed once the App SPI task exists.
+static void benchPlacement(const Placement &placement, unsigned messageCount) {
+    app_stage_config_t link = *app_pipeline_get(APP_STAGE_SPI_LINK);
+    link.coreId = placement.linkCore;
+    app_pipeline_set(APP_STAGE_SPI_LINK, &link);
+    esp_log_level_set("*", ESP_LOG_WARN);
+    startComponents();
+
+    host_pin_to_core(placement.ingestCore);
+    std::thread master(masterThread);
+    std::thread consumer(upstreamConsumerThread, placement.publisherCore);
+    waitForLink();
+    benchLink(placement.name, messageCount, 8, 4, messageCount, 8);
+    stopLink(master, consumer);
+}
+
+
+static int benchPlacements(unsigned messageCount) {
+    unsigned cpuCount = host_cpu_count();
+    if (cpuCount <= portNUM_PROCESSORS) {
+        std::printf("Only %u host CPU(s): the cores and the SPI master share them, so the placements can not differ.\n",
+            cpuCount);
+    }
+    std::printf("Placements of ingest/link/publisher, two way traffic (1+1 trans), %u messages each way.\n\n", messageCount);
+    for (const Placement &placement : PLACEMENTS) {
+        std::printf("  %-18s %s/%s/%s\n", placement.name,
+            coreName(placement.ingestCore), coreName(placement.linkCore), coreName(placement.publisherCore));
+    }
+    std::printf("\n");
+    printHeader();
+    std::fflush(stdout);
+
+    for (const Placement &placement : PLACEMENTS) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            benchPlacement(placement, messageCount);
+            std::fflush(stdout);
+            std::_Exit(EXIT_SUCCESS);
+        }
+        int status = 0;
+        if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+            std::printf("%s: the run failed!\n", placement.name);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+
+int main(int argc, char *argv[]) {
+    bool isPlacements = (argc > 1) && std::strcmp(argv[1], "placements") == 0;
+    if (isPlacements) {
+        --argc;
+        ++argv;
+    }
+    unsigned messageCount = (argc > 1) ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10)) : DEFAULT_MESSAGE_COUNT;
+    if (messageCount == 0) {
+        messageCount = DEFAULT_MESSAGE_COUNT;
+    }
+    if (isPlacements) {
+        return benchPlacements(messageCount);
+    }
+
+    startComponents();
+    uart_echo_init();
+
+    std::thread master(masterThread);
+    std::thread consumer(upstreamConsumerThread, tskNO_AFFINITY);
+    waitForLink();
+
+    std::printf("FreeRTOS tick %d Hz, %u byte SPI transactions.\n\n", HOST_FREERTOS_HZ, static_cast<unsigned>(TRANSACTION_LENGTH));
+    printHeader();
+    benchQueueHandoff();
+    benchOutbox(messageCount);
+    //        name                  messages      data  window  upstream      upstream data
+    benchLink("(1 trans, window 1)", messageCount, 8,    1,      0,            0);
+    benchLink("(1 trans, window 4)", messageCount, 8,    4,      0,            0);
+    benchLink("(3 trans, window 4)", messageCount / 2, 64, 4,    0,            0);
+    benchLink("(1+1 trans)",        messageCount, 8,    4,      messageCount, 8);
+    benchLink("(1+3 trans)",        messageCount, 8,    4,      messageCount / 4, 70);
+    std::vector<UartResult> uartResults;
+    for (int baudRate : { 115200, 921600, 2000000, 5000000 }) {
+        uartResults.push_back(benchUart(baudRate, messageCount, 16));
+    }
+
+    stopLink(master, consumer);
+    printUartResults(uartResults);
+    bool isCorrect = benchTopicLookup();
+#if CONFIG_APP_RUNTIME_CONFIG
+    isCorrect = checkConfigParser() && isCorrect;
+#endif
+
+#if CONFIG_APP_HEAP_ACCOUNTING
+    char heapStats[768];
+    app_heap_format_stats(heapStats, sizeof(heapStats));
+    std::printf("\nheap: %s\n", heapStats);
+#endif
+
+    // The application tasks never return, so leave without running static destructors under them.
+    std::fflush(stdout);
+    std::_Exit(isCorrect ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,114 @@
+/*  file_outbox_storage.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <cstring>
+#include "esp_log.h"
+
+#include "file_outbox_storage.h"
+
+
+static const char *LOG_TAG = "FILE_OUTBOX";
+
+
+//-------------------------------------
+// FileOutboxStorage.
+//-------------------------------------
+FileOutboxStorage::FileOutboxStorage(const char *path, size_t storageSize, size_t storageSectorSize)
+    : storageSize(storageSize)
+    , storageSectorSize(storageSectorSize)
+{
+    file = std::fopen(path, "r+b");
+    if (!file) {
+        // A new file starts out fully erased.
+        file = std::fopen(path, "w+b");
+        if (file) {
+            for (size_t offset = 0; offset < storageSize; offset += storageSectorSize) {
+                eraseSector(offset);
+            }
+        }
+    }
+    if (!file) {
+        ESP_LOGE(LOG_TAG, "FileOutboxStorage(...): unable to open '%s'!", path);
+    }
+}
+
+
+FileOutboxStorage::~FileOutboxStorage() {
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+
+esp_err_t FileOutboxStorage::read(size_t offset, void *dst, size_t length) {
+    if (!file || offset + length > storageSize) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (std::fseek(file, static_cast<long>(offset), SEEK_SET) != 0 ||
+        std::fread(dst, 1, length, file) != length)
+    {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+
+esp_err_t FileOutboxStorage::write(size_t offset, const void *src, size_t length) {
+    if (!file || offset + length > storageSize) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Like NOR flash, a write can only clear bits.
+    const uint8_t *srcBytes = static_cast<const uint8_t *>(src);
+    uint8_t chunk[64];
+    for (size_t done = 0; done < length; ) {
+        size_t chunkLength = length - done;
+        if (chunkLength > sizeof(chunk)) {
+            chunkLength = sizeof(chunk);
+        }
+        esp_err_t err_code = read(offset + done, chunk, chunkLength);
+        if (err_code != ESP_OK) {
+            return err_code;
+        }
+        for (size_t index = 0; index < chunkLength; ++index) {
+            chunk[index] &= srcBytes[done + index];
+        }
+        if (std::fseek(file, static_cast<long>(offset + done), SEEK_SET) != 0 ||
+            std::fwrite(chunk, 1, chunkLength, file) != chunkLength)
+        {
+            return ESP_FAIL;
+        }
+        done += chunkLength;
+    }
+    std::fflush(file);
+    return ESP_OK;
+}
+
+
+esp_err_t FileOutboxStorage::eraseSector(size_t offset) {
+    if (!file || offset % storageSectorSize != 0 || offset + storageSectorSize > storageSize) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t erased[64];
+    std::memset(erased, 0xFF, sizeof(erased));
+    if (std::fseek(file, static_cast<long>(offset), SEEK_SET) != 0) {
+        return ESP_FAIL;
+    }
+    for (size_t done = 0; done < storageSectorSize; done += sizeof(erased)) {
+        if (std::fwrite(erased, 1, sizeof(erased), file) != sizeof(erased)) {
+            return ESP_FAIL;
+        }
+    }
+    std::fflush(file);
+    return ESP_OK;
+}
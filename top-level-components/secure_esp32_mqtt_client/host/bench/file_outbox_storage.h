@@ -0,0 +1,40 @@
+/*  file_outbox_storage.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+#ifndef _FILE_OUTBOX_STORAGE_H_
+#define _FILE_OUTBOX_STORAGE_H_
+
+#include <cstdio>
+#include "app_outbox.h"
+
+
+//------------------------------------------------------------------------------
+// File backed stand-in with the same erase/write semantics as flash.
+// Used by app_bench to measure AppOutbox against a real file.
+class FileOutboxStorage : public OutboxStorage {
+public:
+    FileOutboxStorage(const char *path, size_t storageSize, size_t storageSectorSize = 4096);
+    virtual ~FileOutboxStorage();
+
+    size_t size() const override { return storageSize; }
+    size_t sectorSize() const override { return storageSectorSize; }
+
+    esp_err_t read(size_t offset, void *dst, size_t length) override;
+    esp_err_t write(size_t offset, const void *src, size_t length) override;
+    esp_err_t eraseSector(size_t offset) override;
+
+private:
+    FILE *file = nullptr;
+    const size_t storageSize;
+    const size_t storageSectorSize;
+};
+
+
+#endif // _FILE_OUTBOX_STORAGE_H_
@@ -0,0 +1,77 @@
+/*  driver/spi_slave.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+
+    Host build: transactions wait for a virtual master, see host_spi_master.h.
+*/
+#ifndef _HOST_DRIVER_SPI_SLAVE_H_
+#define _HOST_DRIVER_SPI_SLAVE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef enum {
+    SPI_HOST = 0,
+    HSPI_HOST = 1,
+    VSPI_HOST = 2
+} spi_host_device_t;
+
+#define SPICOMMON_BUSFLAG_SLAVE 0
+
+typedef struct {
+    int mosi_io_num;
+    int miso_io_num;
+    int sclk_io_num;
+    int quadwp_io_num;
+    int quadhd_io_num;
+    int max_transfer_sz;
+    uint32_t flags;
+    int intr_flags;
+} spi_bus_config_t;
+
+typedef struct spi_slave_transaction_t spi_slave_transaction_t;
+typedef void (*slave_transaction_cb_t)(spi_slave_transaction_t *trans);
+
+typedef struct {
+    int spics_io_num;
+    uint32_t flags;
+    int queue_size;
+    uint8_t mode;
+    slave_transaction_cb_t post_setup_cb;
+    slave_transaction_cb_t post_trans_cb;
+} spi_slave_interface_config_t;
+
+struct spi_slave_transaction_t {
+    size_t length;
+    size_t trans_len;
+    const void *tx_buffer;
+    void *rx_buffer;
+    void *user;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern esp_err_t spi_slave_initialize(spi_host_device_t host, const spi_bus_config_t *bus_config,
+                                      const spi_slave_interface_config_t *slave_config, int dma_chan);
+extern esp_err_t spi_slave_free(spi_host_device_t host);
+extern esp_err_t spi_slave_queue_trans(spi_host_device_t host, const spi_slave_transaction_t *trans_desc,
+                                       TickType_t ticks_to_wait);
+extern esp_err_t spi_slave_get_trans_result(spi_host_device_t host, spi_slave_transaction_t **trans_desc,
+                                            TickType_t ticks_to_wait);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HOST_DRIVER_SPI_SLAVE_H_
@@ -0,0 +1,94 @@
+/*  driver/uart.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+
+    Host build: the receive side of the UART driver, with pattern detection.
+    Bytes arrive through host_uart_receive(), as the ISR would take them from
+    the hardware FIFO.
+*/
+#ifndef _HOST_DRIVER_UART_H_
+#define _HOST_DRIVER_UART_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef enum {
+    UART_NUM_0 = 0,
+    UART_NUM_1 = 1,
+    UART_NUM_2 = 2,
+    UART_NUM_MAX = 3
+} uart_port_t;
+
+typedef enum { UART_DATA_5_BITS = 0, UART_DATA_6_BITS, UART_DATA_7_BITS, UART_DATA_8_BITS } uart_word_length_t;
+typedef enum { UART_PARITY_DISABLE = 0, UART_PARITY_EVEN = 2, UART_PARITY_ODD = 3 } uart_parity_t;
+typedef enum { UART_STOP_BITS_1 = 1, UART_STOP_BITS_1_5 = 2, UART_STOP_BITS_2 = 3 } uart_stop_bits_t;
+typedef enum { UART_HW_FLOWCTRL_DISABLE = 0, UART_HW_FLOWCTRL_RTS, UART_HW_FLOWCTRL_CTS, UART_HW_FLOWCTRL_CTS_RTS } uart_hw_flowcontrol_t;
+
+#define UART_PIN_NO_CHANGE (-1)
+
+typedef struct {
+    int baud_rate;
+    uart_word_length_t data_bits;
+    uart_parity_t parity;
+    uart_stop_bits_t stop_bits;
+    uart_hw_flowcontrol_t flow_ctrl;
+    uint8_t rx_flow_ctrl_thresh;
+} uart_config_t;
+
+typedef enum {
+    UART_DATA,
+    UART_BREAK,
+    UART_BUFFER_FULL,
+    UART_FIFO_OVF,
+    UART_FRAME_ERR,
+    UART_PARITY_ERR,
+    UART_DATA_BREAK,
+    UART_PATTERN_DET,
+    UART_EVENT_MAX
+} uart_event_type_t;
+
+typedef struct {
+    uart_event_type_t type;
+    size_t size;
+} uart_event_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config);
+extern esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num);
+extern esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size,
+                                     int queue_size, QueueHandle_t *uart_queue, int intr_alloc_flags);
+extern esp_err_t uart_driver_delete(uart_port_t uart_num);
+extern int uart_read_bytes(uart_port_t uart_num, uint8_t *buf, uint32_t length, TickType_t ticks_to_wait);
+extern esp_err_t uart_flush_input(uart_port_t uart_num);
+extern esp_err_t uart_enable_pattern_det_intr(uart_port_t uart_num, char pattern_chr, uint8_t chr_num,
+                                              int chr_tout, int post_idle, int pre_idle);
+extern esp_err_t uart_pattern_queue_reset(uart_port_t uart_num, int queue_length);
+// The position of the oldest pattern still buffered, relative to the next byte
+// uart_read_bytes() returns. -1 if there is none, or if positions were lost
+// because the pattern queue was full.
+extern int uart_pattern_pop_pos(uart_port_t uart_num);
+
+// Host build: hands bytes to the driver as the receive ISR would. Like the ISR,
+// it posts UART_PATTERN_DET for every pattern character, UART_DATA for a chunk
+// without one and UART_BUFFER_FULL once, dropping the rest, if the ring buffer
+// is full. Pass at most one FIFO full (120 bytes) at a time. Returns the number
+// of bytes buffered.
+extern size_t host_uart_receive(uart_port_t uart_num, const void *data, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HOST_DRIVER_UART_H_
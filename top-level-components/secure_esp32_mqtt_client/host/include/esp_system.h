@@ -0,0 +1,43 @@
+/*  esp_system.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+
+    Host build: system information.
+*/
+#ifndef _HOST_ESP_SYSTEM_H_
+#define _HOST_ESP_SYSTEM_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "sdkconfig.h"
+
+typedef enum {
+    ESP_MAC_WIFI_STA,
+    ESP_MAC_WIFI_SOFTAP,
+    ESP_MAC_BT,
+    ESP_MAC_ETH,
+} esp_mac_type_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern uint32_t esp_get_free_heap_size(void);
+extern uint32_t esp_get_minimum_free_heap_size(void);
+extern const char *esp_get_idf_version(void);
+extern void esp_restart(void);
+extern esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HOST_ESP_SYSTEM_H_
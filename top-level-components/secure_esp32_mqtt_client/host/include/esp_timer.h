@@ -0,0 +1,49 @@
+/*  esp_timer.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+
+    Host build: one thread runs every timer callback, in expiry order.
+*/
+#ifndef _HOST_ESP_TIMER_H_
+#define _HOST_ESP_TIMER_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef struct esp_timer *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef enum {
+    ESP_TIMER_TASK,
+} esp_timer_dispatch_t;
+
+typedef struct {
+    esp_timer_cb_t callback;
+    void *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char *name;
+} esp_timer_create_args_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern int64_t esp_timer_get_time(void);
+extern esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle);
+extern esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+extern esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period);
+extern esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+extern esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HOST_ESP_TIMER_H_
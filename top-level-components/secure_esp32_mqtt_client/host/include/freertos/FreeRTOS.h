@@ -0,0 +1,123 @@
+/*  freertos/FreeRTOS.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+
+    Host build: FreeRTOS on POSIX threads. Tasks are threads and priorities
+    are ignored. A task pinned to core n runs on host CPU n, and an unpinned
+    one on either, if the host has them. Every critical section shares one
+    recursive lock, as if the ESP32 had a single core with interrupts disabled.
+*/
+#ifndef _HOST_FREERTOS_H_
+#define _HOST_FREERTOS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+// ESP-IDF defaults to a 100Hz tick. Override to see how the tick-based
+// timeouts in the application affect latency.
+#ifndef HOST_FREERTOS_HZ
+#define HOST_FREERTOS_HZ 100
+#endif
+
+typedef uint32_t TickType_t;
+// The FreeRTOS 8 name, still used by the ESP-IDF examples.
+typedef TickType_t portTickType;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t EventBits_t;
+
+typedef struct HostQueue *QueueHandle_t;
+typedef struct HostQueue *SemaphoreHandle_t;
+typedef struct HostEventGroup *EventGroupHandle_t;
+typedef struct HostTask *TaskHandle_t;
+
+// Static storage is accepted but the host objects are always allocated.
+typedef struct { int unused; } StaticQueue_t;
+typedef StaticQueue_t StaticSemaphore_t;
+typedef struct { int unused; } StaticEventGroup_t;
+
+typedef struct {
+    uint32_t owner;
+    uint32_t count;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { 0, 0 }
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdFAIL  0
+#define pdPASS  1
+
+#define portMAX_DELAY       ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS  (1000 / HOST_FREERTOS_HZ)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(((TickType_t)(ms) * HOST_FREERTOS_HZ) / 1000))
+#define portNUM_PROCESSORS  2
+#define PRO_CPU_NUM         0
+#define APP_CPU_NUM         1
+#define tskNO_AFFINITY      0x7FFFFFFF
+#define configMAX_PRIORITIES 25
+
+#define configSUPPORT_STATIC_ALLOCATION 1
+#define configUSE_TRACE_FACILITY        1
+#define configASSERT(x) do {                                                            \
+        if (!(x)) {                                                                     \
+            fprintf(stderr, "configASSERT(%s) failed at %s:%d\n", #x, __FILE__, __LINE__); \
+            abort();                                                                    \
+        }                                                                               \
+    } while (0)
+
+#define IRAM_ATTR
+
+#define BIT0  0x00000001
+#define BIT1  0x00000002
+#define BIT2  0x00000004
+#define BIT3  0x00000008
+#define BIT4  0x00000010
+#define BIT5  0x00000020
+#define BIT6  0x00000040
+#define BIT7  0x00000080
+#define BIT8  0x00000100
+#define BIT9  0x00000200
+#define BIT10 0x00000400
+#define BIT11 0x00000800
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern void host_enter_critical(void);
+extern void host_exit_critical(void);
+extern BaseType_t host_get_core_id(void);
+// Moves the calling thread to the host CPU of coreId, as a task pinned there
+// would run. Does nothing if the host has fewer than two CPUs.
+extern void host_pin_to_core(BaseType_t coreId);
+// Moves the calling thread off the host CPUs that stand in for the ESP32's
+// cores, as if it were another chip. Returns false if the host has no others.
+extern bool host_pin_off_cores(void);
+// CPUs the process may run on.
+extern unsigned host_cpu_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define portENTER_CRITICAL(mux)         do { (void)(mux); host_enter_critical(); } while (0)
+#define portEXIT_CRITICAL(mux)          do { (void)(mux); host_exit_critical(); } while (0)
+#define portENTER_CRITICAL_ISR(mux)     portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_ISR(mux)      portEXIT_CRITICAL(mux)
+#define portENTER_CRITICAL_NESTED()     (host_enter_critical(), 0u)
+#define portEXIT_CRITICAL_NESTED(state) do { (void)(state); host_exit_critical(); } while (0)
+#define xPortGetCoreID()                host_get_core_id()
+
+#endif // _HOST_FREERTOS_H_
@@ -0,0 +1,35 @@
+/*  freertos/event_groups.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+
+    Host build: event groups wait on a condition variable.
+*/
+#ifndef _HOST_FREERTOS_EVENT_GROUPS_H_
+#define _HOST_FREERTOS_EVENT_GROUPS_H_
+
+#include "FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern EventGroupHandle_t xEventGroupCreate(void);
+extern EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet);
+extern EventBits_t xEventGroupClearBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToClear);
+extern EventBits_t xEventGroupGetBits(EventGroupHandle_t xEventGroup);
+extern EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToWaitFor,
+                                       const BaseType_t xClearOnExit, const BaseType_t xWaitForAllBits,
+                                       TickType_t xTicksToWait);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HOST_FREERTOS_EVENT_GROUPS_H_
@@ -0,0 +1,43 @@
+/*  freertos/queue.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+
+    Host build: queues copy items into a ring under a mutex.
+*/
+#ifndef _HOST_FREERTOS_QUEUE_H_
+#define _HOST_FREERTOS_QUEUE_H_
+
+#include "FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize);
+extern QueueHandle_t xQueueCreateStatic(UBaseType_t uxQueueLength, UBaseType_t uxItemSize,
+                                        uint8_t *pucQueueStorageBuffer, StaticQueue_t *pxQueueBuffer);
+extern void vQueueDelete(QueueHandle_t xQueue);
+extern BaseType_t xQueueSendToBack(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait);
+extern BaseType_t xQueueSendToFront(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait);
+// Only for queues of length 1, as in FreeRTOS.
+extern BaseType_t xQueueOverwrite(QueueHandle_t xQueue, const void *pvItemToQueue);
+extern BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait);
+extern BaseType_t xQueuePeek(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait);
+extern BaseType_t xQueueReset(QueueHandle_t xQueue);
+extern UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue);
+extern UBaseType_t uxQueueSpacesAvailable(QueueHandle_t xQueue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define xQueueSend(xQueue, pvItemToQueue, xTicksToWait) xQueueSendToBack(xQueue, pvItemToQueue, xTicksToWait)
+
+#endif // _HOST_FREERTOS_QUEUE_H_
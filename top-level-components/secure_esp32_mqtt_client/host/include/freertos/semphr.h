@@ -0,0 +1,39 @@
+/*  freertos/semphr.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+
+    Host build: semaphores are queues of zero sized items, as in FreeRTOS.
+*/
+#ifndef _HOST_FREERTOS_SEMPHR_H_
+#define _HOST_FREERTOS_SEMPHR_H_
+
+#include "queue.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define xSemaphoreCreateBinary()                    xSemaphoreCreateCounting(1, 0)
+#define xSemaphoreCreateMutex()                     xSemaphoreCreateCounting(1, 1)
+#define xSemaphoreCreateBinaryStatic(buffer)        ((void)(buffer), xSemaphoreCreateBinary())
+#define xSemaphoreCreateMutexStatic(buffer)         ((void)(buffer), xSemaphoreCreateMutex())
+#define xSemaphoreCreateCountingStatic(max, initial, buffer) ((void)(buffer), xSemaphoreCreateCounting(max, initial))
+#define xSemaphoreTake(sem, ticks)                  xQueueReceive(sem, NULL, ticks)
+#define xSemaphoreGive(sem)                         xQueueSendToBack(sem, NULL, 0)
+#define uxSemaphoreGetCount(sem)                    uxQueueMessagesWaiting(sem)
+#define vSemaphoreDelete(sem)                       vQueueDelete(sem)
+
+#endif // _HOST_FREERTOS_SEMPHR_H_
@@ -0,0 +1,43 @@
+/*  freertos/task.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+
+    Host build: tasks are detached POSIX threads.
+*/
+#ifndef _HOST_FREERTOS_TASK_H_
+#define _HOST_FREERTOS_TASK_H_
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *parameters);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char *pcName, uint32_t usStackDepth,
+                                          void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pvCreatedTask,
+                                          BaseType_t xCoreID);
+extern BaseType_t xTaskCreate(TaskFunction_t pvTaskCode, const char *pcName, uint32_t usStackDepth,
+                              void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pvCreatedTask);
+// Only a task can delete itself (NULL or its own handle).
+extern void vTaskDelete(TaskHandle_t xTaskToDelete);
+extern void vTaskDelay(TickType_t xTicksToDelay);
+extern TickType_t xTaskGetTickCount(void);
+extern TaskHandle_t xTaskGetCurrentTaskHandle(void);
+extern char *pcTaskGetTaskName(TaskHandle_t xTaskToQuery);
+// In bytes, as on ESP-IDF. Stacks are not measured on the host.
+extern UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HOST_FREERTOS_TASK_H_
@@ -0,0 +1,38 @@
+/*  host_spi_master.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+
+    Host build: the virtual SPI master that completes queued slave transactions.
+*/
+#ifndef _HOST_SPI_MASTER_H_
+#define _HOST_SPI_MASTER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Clocks the oldest transaction queued by the slave, if one is queued within
+// ticksToWait. miso receives what the slave sent and mosi (NULL for zeros) is
+// what the slave receives. Both are transactionLength bytes, as set by
+// spi_slave_initialize's caller. Returns the number of bytes clocked, 0 on timeout.
+extern size_t host_spi_master_transfer(const void *mosi, void *miso, size_t length, TickType_t ticksToWait);
+
+// Transactions queued by the slave and not yet clocked.
+extern unsigned host_spi_master_pending(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HOST_SPI_MASTER_H_
@@ -0,0 +1,105 @@
+/*  mqtt_client.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+
+    Host build: the client never connects. Publishes and subscribes are counted
+    and given message ids, and events are injected by calling the handler directly.
+*/
+#ifndef _HOST_MQTT_CLIENT_H_
+#define _HOST_MQTT_CLIENT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef struct esp_mqtt_client *esp_mqtt_client_handle_t;
+
+typedef enum {
+    MQTT_EVENT_ERROR = 0,
+    MQTT_EVENT_CONNECTED,
+    MQTT_EVENT_DISCONNECTED,
+    MQTT_EVENT_SUBSCRIBED,
+    MQTT_EVENT_UNSUBSCRIBED,
+    MQTT_EVENT_PUBLISHED,
+    MQTT_EVENT_DATA,
+} esp_mqtt_event_id_t;
+
+typedef enum {
+    MQTT_TRANSPORT_UNKNOWN = 0x0,
+    MQTT_TRANSPORT_OVER_TCP,
+    MQTT_TRANSPORT_OVER_SSL,
+    MQTT_TRANSPORT_OVER_WS,
+    MQTT_TRANSPORT_OVER_WSS
+} esp_mqtt_transport_t;
+
+typedef struct {
+    esp_mqtt_event_id_t event_id;
+    esp_mqtt_client_handle_t client;
+    void *user_context;
+    char *data;
+    int data_len;
+    int total_data_len;
+    int current_data_offset;
+    char *topic;
+    int topic_len;
+    int msg_id;
+    int session_present;
+} esp_mqtt_event_t;
+
+typedef esp_mqtt_event_t *esp_mqtt_event_handle_t;
+typedef esp_err_t (*mqtt_event_callback_t)(esp_mqtt_event_handle_t event);
+
+typedef struct {
+    mqtt_event_callback_t event_handle;
+    const char *host;
+    const char *uri;
+    uint32_t port;
+    const char *client_id;
+    const char *username;
+    const char *password;
+    const char *lwt_topic;
+    const char *lwt_msg;
+    int lwt_qos;
+    int lwt_retain;
+    int lwt_msg_len;
+    int disable_clean_session;
+    int keepalive;
+    bool disable_auto_reconnect;
+    void *user_context;
+    int task_prio;
+    int task_stack;
+    int buffer_size;
+    const char *cert_pem;
+    const char *client_cert_pem;
+    const char *client_key_pem;
+    esp_mqtt_transport_t transport;
+} esp_mqtt_client_config_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *config);
+extern esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client);
+extern esp_err_t esp_mqtt_client_stop(esp_mqtt_client_handle_t client);
+extern esp_err_t esp_mqtt_client_destroy(esp_mqtt_client_handle_t client);
+extern int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client, const char *topic, int qos);
+extern int esp_mqtt_client_unsubscribe(esp_mqtt_client_handle_t client, const char *topic);
+extern int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic, const char *data, int len,
+                                   int qos, int retain);
+
+// Number of successful esp_mqtt_client_publish() calls on every client.
+extern uint32_t host_mqtt_get_publish_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HOST_MQTT_CLIENT_H_
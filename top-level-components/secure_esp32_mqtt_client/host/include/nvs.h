@@ -0,0 +1,52 @@
+/*  nvs.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+
+    Host build: one in-memory key/value map per namespace.
+*/
+#ifndef _HOST_NVS_H_
+#define _HOST_NVS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define ESP_ERR_NVS_BASE                0x1100
+#define ESP_ERR_NVS_NOT_INITIALIZED     (ESP_ERR_NVS_BASE + 0x01)
+#define ESP_ERR_NVS_NOT_FOUND           (ESP_ERR_NVS_BASE + 0x02)
+#define ESP_ERR_NVS_INVALID_LENGTH      (ESP_ERR_NVS_BASE + 0x0c)
+#define ESP_ERR_NVS_NO_FREE_PAGES       (ESP_ERR_NVS_BASE + 0x0d)
+#define ESP_ERR_NVS_NEW_VERSION_FOUND   (ESP_ERR_NVS_BASE + 0x10)
+
+typedef uint32_t nvs_handle;
+
+typedef enum {
+    NVS_READONLY,
+    NVS_READWRITE
+} nvs_open_mode;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern esp_err_t nvs_open(const char *name, nvs_open_mode open_mode, nvs_handle *out_handle);
+extern void nvs_close(nvs_handle handle);
+extern esp_err_t nvs_commit(nvs_handle handle);
+extern esp_err_t nvs_set_blob(nvs_handle handle, const char *key, const void *value, size_t length);
+extern esp_err_t nvs_get_blob(nvs_handle handle, const char *key, void *out_value, size_t *length);
+extern esp_err_t nvs_set_u32(nvs_handle handle, const char *key, uint32_t value);
+extern esp_err_t nvs_get_u32(nvs_handle handle, const char *key, uint32_t *out_value);
+extern esp_err_t nvs_erase_key(nvs_handle handle, const char *key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _HOST_NVS_H_
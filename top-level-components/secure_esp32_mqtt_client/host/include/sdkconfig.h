@@ -0,0 +1,62 @@
+/*  sdkconfig.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+
+    Host build: the Kconfig values, at their defaults.
+*/
+#ifndef _HOST_SDKCONFIG_H_
+#define _HOST_SDKCONFIG_H_
+
+#define CONFIG_WIFI_SSID "myssid"
+#define CONFIG_WIFI_PASSWORD "mypassword"
+#define CONFIG_NTP_SERVER_URL "pool.ntp.org"
+#define CONFIG_MQTT_BROKER_URL "mqtts://iot.eclipse.org"
+
+// The drain task would print every hot path record, so it is off unless asked for.
+#ifndef CONFIG_APP_DEFERRED_LOG
+#define CONFIG_APP_DEFERRED_LOG 0
+#endif
+
+#ifndef CONFIG_APP_LATENCY_TRACE
+#define CONFIG_APP_LATENCY_TRACE 0
+#endif
+#if CONFIG_APP_LATENCY_TRACE
+#define CONFIG_APP_LATENCY_STATS_TOPIC "irrigation/stats/latency"
+#endif
+
+#ifndef CONFIG_APP_HEAP_ACCOUNTING
+#define CONFIG_APP_HEAP_ACCOUNTING 0
+#endif
+#if CONFIG_APP_HEAP_ACCOUNTING
+#if !defined(CONFIG_APP_HEAP_GUARD_COUNT) && !defined(CONFIG_APP_HEAP_GUARD_ABORT)
+#define CONFIG_APP_HEAP_GUARD_LOG 1
+#endif
+#define CONFIG_APP_HEAP_STATS_TOPIC "irrigation/stats/heap"
+#endif
+
+#ifndef CONFIG_APP_STACK_REPORT
+#define CONFIG_APP_STACK_REPORT 1
+#endif
+
+#ifndef CONFIG_APP_RUNTIME_CONFIG
+#define CONFIG_APP_RUNTIME_CONFIG 1
+#endif
+#if CONFIG_APP_RUNTIME_CONFIG
+#define CONFIG_APP_CONFIG_TOPIC_PREFIX "irrigation/config"
+#define CONFIG_APP_QUEUE_MAX_LENGTH 16
+#endif
+
+#ifndef CONFIG_APP_AVR_OTA
+#define CONFIG_APP_AVR_OTA 0
+#endif
+#if CONFIG_APP_AVR_OTA
+#define CONFIG_APP_AVR_OTA_TOPIC "irrigation/ota/avr"
+#endif
+
+#endif // _HOST_SDKCONFIG_H_
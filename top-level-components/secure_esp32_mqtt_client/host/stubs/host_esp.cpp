@@ -0,0 +1,528 @@
+/*  host_esp.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+
+    Host build: logging, errors, heap, timers, NVS, partitions, GPIO and the SPI
+    master.
+*/
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+
+
+typedef std::chrono::steady_clock Clock;
+
+static const Clock::time_point startTime = Clock::now();
+
+// Reported by the heap functions. The host heap is not measured.
+static const uint32_t HOST_FREE_HEAP_SIZE = 160 * 1024;
+
+
+//-------------------------------------
+// Logging and errors.
+//-------------------------------------
+esp_log_level_t host_log_level = ESP_LOG_WARN;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+    if (std::strcmp(tag, "*") == 0) {
+        host_log_level = level;
+    }
+}
+
+
+uint32_t esp_log_timestamp(void) {
+    return static_cast<uint32_t>(esp_timer_get_time() / 1000);
+}
+
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK:                        return "ESP_OK";
+        case ESP_FAIL:                      return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:                return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:           return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE:         return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:          return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:             return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED:         return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:               return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_RESPONSE:      return "ESP_ERR_INVALID_RESPONSE";
+        case ESP_ERR_INVALID_CRC:           return "ESP_ERR_INVALID_CRC";
+        case ESP_ERR_INVALID_VERSION:       return "ESP_ERR_INVALID_VERSION";
+        case ESP_ERR_NVS_NOT_INITIALIZED:   return "ESP_ERR_NVS_NOT_INITIALIZED";
+        case ESP_ERR_NVS_NOT_FOUND:         return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_INVALID_LENGTH:    return "ESP_ERR_NVS_INVALID_LENGTH";
+        case ESP_ERR_NVS_NO_FREE_PAGES:     return "ESP_ERR_NVS_NO_FREE_PAGES";
+        case ESP_ERR_NVS_NEW_VERSION_FOUND: return "ESP_ERR_NVS_NEW_VERSION_FOUND";
+        default:                            return "UNKNOWN ERROR";
+    }
+}
+
+
+//-------------------------------------
+// System and heap.
+//-------------------------------------
+uint32_t esp_get_free_heap_size(void) {
+    return HOST_FREE_HEAP_SIZE;
+}
+
+
+uint32_t esp_get_minimum_free_heap_size(void) {
+    return HOST_FREE_HEAP_SIZE;
+}
+
+
+const char *esp_get_idf_version(void) {
+    return "host";
+}
+
+
+void esp_restart(void) {
+    std::fprintf(stderr, "esp_restart() called.\n");
+    std::exit(EXIT_FAILURE);
+}
+
+
+// A locally administered address, the same on every run.
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type) {
+    if (!mac) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    static const uint8_t HOST_MAC[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+    std::memcpy(mac, HOST_MAC, sizeof(HOST_MAC));
+    mac[5] += static_cast<uint8_t>(type);
+    return ESP_OK;
+}
+
+
+void *heap_caps_malloc(size_t size, uint32_t caps) {
+    return std::malloc(size);
+}
+
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    return HOST_FREE_HEAP_SIZE;
+}
+
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    return HOST_FREE_HEAP_SIZE;
+}
+
+
+//-------------------------------------
+// esp_timer.
+//-------------------------------------
+// Every callback runs on one thread, like ESP_TIMER_TASK dispatch.
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    bool isArmed;
+    uint64_t periodUs;
+    int64_t deadlineUs;
+};
+
+static std::mutex timerMutex;
+static std::condition_variable timerChanged;
+static std::vector<esp_timer *> timers;
+static bool isTimerThreadStarted = false;
+
+
+int64_t esp_timer_get_time(void) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - startTime).count();
+}
+
+
+static void timerThread() {
+    std::unique_lock<std::mutex> lock(timerMutex);
+    while (true) {
+        esp_timer *next = nullptr;
+        for (esp_timer *timer : timers) {
+            if (timer->isArmed && (!next || timer->deadlineUs < next->deadlineUs)) {
+                next = timer;
+            }
+        }
+
+        if (!next) {
+            timerChanged.wait(lock);
+            continue;
+        }
+        int64_t nowUs = esp_timer_get_time();
+        if (next->deadlineUs > nowUs) {
+            timerChanged.wait_for(lock, std::chrono::microseconds(next->deadlineUs - nowUs));
+            continue;
+        }
+
+        if (next->periodUs > 0) {
+            next->deadlineUs += next->periodUs;
+        } else {
+            next->isArmed = false;
+        }
+        esp_timer_cb_t callback = next->callback;
+        void *arg = next->arg;
+        lock.unlock();
+        callback(arg);
+        lock.lock();
+    }
+}
+
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle) {
+    if (!create_args || !create_args->callback || !out_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    std::lock_guard<std::mutex> lock(timerMutex);
+    if (!isTimerThreadStarted) {
+        std::thread(timerThread).detach();
+        isTimerThreadStarted = true;
+    }
+    esp_timer *timer = new esp_timer{ create_args->callback, create_args->arg, false, 0, 0 };
+    timers.push_back(timer);
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+
+static esp_err_t timerStart(esp_timer_handle_t timer, uint64_t timeoutUs, uint64_t periodUs) {
+    {
+        std::lock_guard<std::mutex> lock(timerMutex);
+        if (timer->isArmed) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        timer->isArmed = true;
+        timer->periodUs = periodUs;
+        timer->deadlineUs = esp_timer_get_time() + static_cast<int64_t>(timeoutUs);
+    }
+    timerChanged.notify_one();
+    return ESP_OK;
+}
+
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    return timerStart(timer, timeout_us, 0);
+}
+
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+    return timerStart(timer, period, period);
+}
+
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    std::lock_guard<std::mutex> lock(timerMutex);
+    if (!timer->isArmed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->isArmed = false;
+    return ESP_OK;
+}
+
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    std::lock_guard<std::mutex> lock(timerMutex);
+    if (timer->isArmed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (auto it = timers.begin(); it != timers.end(); ++it) {
+        if (*it == timer) {
+            timers.erase(it);
+            break;
+        }
+    }
+    delete timer;
+    return ESP_OK;
+}
+
+
+//-------------------------------------
+// NVS.
+//-------------------------------------
+typedef std::map<std::string, std::vector<uint8_t>> NvsNamespace;
+
+static std::mutex nvsMutex;
+static bool isNvsInitialized = false;
+static std::map<std::string, NvsNamespace> nvsNamespaces;
+static std::vector<std::string> nvsHandles;         // handle - 1 indexes the namespace name.
+
+
+esp_err_t nvs_flash_init(void) {
+    std::lock_guard<std::mutex> lock(nvsMutex);
+    isNvsInitialized = true;
+    return ESP_OK;
+}
+
+
+esp_err_t nvs_flash_erase(void) {
+    std::lock_guard<std::mutex> lock(nvsMutex);
+    nvsNamespaces.clear();
+    return ESP_OK;
+}
+
+
+// Call with nvsMutex held.
+static NvsNamespace * findNamespace(nvs_handle handle) {
+    if (handle == 0 || handle > nvsHandles.size()) {
+        return nullptr;
+    }
+    return &nvsNamespaces[nvsHandles[handle - 1]];
+}
+
+
+esp_err_t nvs_open(const char *name, nvs_open_mode open_mode, nvs_handle *out_handle) {
+    std::lock_guard<std::mutex> lock(nvsMutex);
+    if (!isNvsInitialized) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    if (open_mode == NVS_READONLY && nvsNamespaces.find(name) == nvsNamespaces.end()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    nvsHandles.push_back(name);
+    *out_handle = static_cast<nvs_handle>(nvsHandles.size());
+    return ESP_OK;
+}
+
+
+void nvs_close(nvs_handle handle) {
+}
+
+
+esp_err_t nvs_commit(nvs_handle handle) {
+    std::lock_guard<std::mutex> lock(nvsMutex);
+    return findNamespace(handle) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+
+esp_err_t nvs_set_blob(nvs_handle handle, const char *key, const void *value, size_t length) {
+    std::lock_guard<std::mutex> lock(nvsMutex);
+    NvsNamespace *ns = findNamespace(handle);
+    if (!ns) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const uint8_t *bytes = static_cast<const uint8_t *>(value);
+    (*ns)[key].assign(bytes, bytes + length);
+    return ESP_OK;
+}
+
+
+// As on the device, a NULL out_value only asks for the length.
+esp_err_t nvs_get_blob(nvs_handle handle, const char *key, void *out_value, size_t *length) {
+    std::lock_guard<std::mutex> lock(nvsMutex);
+    NvsNamespace *ns = findNamespace(handle);
+    if (!ns || !length) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    auto it = ns->find(key);
+    if (it == ns->end()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out_value) {
+        if (*length < it->second.size()) {
+            return ESP_ERR_NVS_INVALID_LENGTH;
+        }
+        std::memcpy(out_value, it->second.data(), it->second.size());
+    }
+    *length = it->second.size();
+    return ESP_OK;
+}
+
+
+esp_err_t nvs_set_u32(nvs_handle handle, const char *key, uint32_t value) {
+    return nvs_set_blob(handle, key, &value, sizeof(value));
+}
+
+
+esp_err_t nvs_get_u32(nvs_handle handle, const char *key, uint32_t *out_value) {
+    size_t length = sizeof(*out_value);
+    return nvs_get_blob(handle, key, out_value, &length);
+}
+
+
+esp_err_t nvs_erase_key(nvs_handle handle, const char *key) {
+    std::lock_guard<std::mutex> lock(nvsMutex);
+    NvsNamespace *ns = findNamespace(handle);
+    if (!ns) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ns->erase(key) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+
+//-------------------------------------
+// Partitions.
+//-------------------------------------
+// Writes can only clear bits and erases set whole sectors to 0xFF, like NOR flash.
+struct HostPartition {
+    esp_partition_t partition;
+    std::vector<uint8_t> flash;
+};
+
+static std::mutex partitionMutex;
+static std::vector<HostPartition *> partitions;
+
+
+// Call with partitionMutex held.
+static HostPartition * findPartition(const esp_partition_t *partition) {
+    for (HostPartition *hostPartition : partitions) {
+        if (&hostPartition->partition == partition) {
+            return hostPartition;
+        }
+    }
+    return nullptr;
+}
+
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label) {
+    std::lock_guard<std::mutex> lock(partitionMutex);
+    if (type != ESP_PARTITION_TYPE_DATA) {
+        return nullptr;
+    }
+    for (HostPartition *hostPartition : partitions) {
+        const esp_partition_t &partition = hostPartition->partition;
+        if (partition.subtype == subtype && (!label || std::strcmp(partition.label, label) == 0)) {
+            return &partition;
+        }
+    }
+
+    HostPartition *hostPartition = new HostPartition();
+    hostPartition->partition.type = type;
+    hostPartition->partition.subtype = subtype;
+    hostPartition->partition.address = 0x300000 + static_cast<uint32_t>(partitions.size()) * HOST_PARTITION_SIZE;
+    hostPartition->partition.size = HOST_PARTITION_SIZE;
+    std::strncpy(hostPartition->partition.label, label ? label : "", sizeof(hostPartition->partition.label) - 1);
+    hostPartition->partition.encrypted = false;
+    hostPartition->flash.assign(HOST_PARTITION_SIZE, 0xFF);
+    partitions.push_back(hostPartition);
+    return &hostPartition->partition;
+}
+
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size) {
+    std::lock_guard<std::mutex> lock(partitionMutex);
+    HostPartition *hostPartition = findPartition(partition);
+    if (!hostPartition || !dst || src_offset > partition->size || size > partition->size - src_offset) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::memcpy(dst, &hostPartition->flash[src_offset], size);
+    return ESP_OK;
+}
+
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size) {
+    std::lock_guard<std::mutex> lock(partitionMutex);
+    HostPartition *hostPartition = findPartition(partition);
+    if (!hostPartition || !src || dst_offset > partition->size || size > partition->size - dst_offset) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const uint8_t *bytes = static_cast<const uint8_t *>(src);
+    for (size_t index = 0; index < size; ++index) {
+        hostPartition->flash[dst_offset + index] &= bytes[index];
+    }
+    return ESP_OK;
+}
+
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, uint32_t start_addr, uint32_t size) {
+    std::lock_guard<std::mutex> lock(partitionMutex);
+    HostPartition *hostPartition = findPartition(partition);
+    if (!hostPartition || start_addr % SPI_FLASH_SEC_SIZE != 0 || size % SPI_FLASH_SEC_SIZE != 0
+        || start_addr > partition->size || size > partition->size - start_addr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::memset(&hostPartition->flash[start_addr], 0xFF, size);
+    return ESP_OK;
+}
+
+
+//-------------------------------------
+// GPIO.
+//-------------------------------------
+static volatile int gpioLevels[GPIO_NUM_MAX];
+
+
+esp_err_t gpio_config(const gpio_config_t *pGPIOConfig) {
+    return pGPIOConfig ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+
+esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, gpio_pull_mode_t pull) {
+    return (gpio_num < GPIO_NUM_MAX) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level) {
+    if (gpio_num >= GPIO_NUM_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpioLevels[gpio_num] = level ? 1 : 0;
+    return ESP_OK;
+}
+
+
+int host_gpio_get_level(gpio_num_t gpio_num) {
+    return (gpio_num < GPIO_NUM_MAX) ? gpioLevels[gpio_num] : 0;
+}
+
+
+//-------------------------------------
+// SPI master.
+//-------------------------------------
+struct spi_device_t {
+    spi_host_device_t host;
+};
+
+static spi_device_t spiDevices[VSPI_HOST + 1];
+
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t *bus_config, int dma_chan) {
+    return (host <= VSPI_HOST && bus_config) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t *dev_config,
+                             spi_device_handle_t *handle) {
+    if (host > VSPI_HOST || !dev_config || !handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    spiDevices[host].host = host;
+    *handle = &spiDevices[host];
+    return ESP_OK;
+}
+
+
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t *trans_desc) {
+    if (!handle || !trans_desc) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t rxLength = (trans_desc->rxlength ? trans_desc->rxlength : trans_desc->length) / 8;
+    if (trans_desc->flags & SPI_TRANS_USE_RXDATA) {
+        std::memset(trans_desc->rx_data, 0, sizeof(trans_desc->rx_data));
+    } else if (trans_desc->rx_buffer) {
+        std::memset(trans_desc->rx_buffer, 0, rxLength);
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,409 @@
+/*  host_freertos.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+
+    Host build: queues, semaphores, event groups and tasks on std::thread.
+*/
+
+#include <pthread.h>
+#include <sched.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+
+typedef std::chrono::steady_clock Clock;
+
+static const Clock::time_point startTime = Clock::now();
+
+
+// Waits on cv until isReady() or ticks expire. Returns isReady().
+template<typename Predicate>
+static bool waitTicks(std::condition_variable &cv, std::unique_lock<std::mutex> &lock, TickType_t ticks, Predicate isReady) {
+    if (ticks == portMAX_DELAY) {
+        cv.wait(lock, isReady);
+        return true;
+    }
+    return cv.wait_for(lock, std::chrono::milliseconds(static_cast<uint64_t>(ticks) * portTICK_PERIOD_MS), isReady);
+}
+
+
+//-------------------------------------
+// Critical sections.
+//-------------------------------------
+static std::recursive_mutex criticalMutex;
+
+void host_enter_critical(void) {
+    criticalMutex.lock();
+}
+
+
+void host_exit_critical(void) {
+    criticalMutex.unlock();
+}
+
+
+//-------------------------------------
+// Queues.
+//-------------------------------------
+struct HostQueue {
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::vector<uint8_t> storage;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    UBaseType_t head = 0;
+    UBaseType_t count = 0;
+
+    HostQueue(UBaseType_t length, UBaseType_t itemSize)
+        : storage(length * itemSize), length(length), itemSize(itemSize)
+    { }
+
+    uint8_t * slot(UBaseType_t index) { return storage.data() + (index % length) * itemSize; }
+};
+
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize) {
+    if (uxQueueLength == 0) {
+        return nullptr;
+    }
+    return new HostQueue(uxQueueLength, uxItemSize);
+}
+
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t uxQueueLength, UBaseType_t uxItemSize,
+                                 uint8_t *pucQueueStorageBuffer, StaticQueue_t *pxQueueBuffer) {
+    return xQueueCreate(uxQueueLength, uxItemSize);
+}
+
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount) {
+    HostQueue *queue = xQueueCreate(uxMaxCount, 0);
+    if (queue) {
+        queue->count = (uxInitialCount < uxMaxCount) ? uxInitialCount : uxMaxCount;
+    }
+    return queue;
+}
+
+
+void vQueueDelete(QueueHandle_t xQueue) {
+    delete xQueue;
+}
+
+
+static BaseType_t queueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait, bool toFront) {
+    std::unique_lock<std::mutex> lock(xQueue->mutex);
+    if (!waitTicks(xQueue->notFull, lock, xTicksToWait, [xQueue] { return xQueue->count < xQueue->length; })) {
+        return pdFALSE;
+    }
+
+    UBaseType_t index;
+    if (toFront) {
+        xQueue->head = (xQueue->head + xQueue->length - 1) % xQueue->length;
+        index = xQueue->head;
+    } else {
+        index = xQueue->head + xQueue->count;
+    }
+    if (xQueue->itemSize > 0) {
+        std::memcpy(xQueue->slot(index), pvItemToQueue, xQueue->itemSize);
+    }
+    ++xQueue->count;
+
+    lock.unlock();
+    xQueue->notEmpty.notify_one();
+    return pdTRUE;
+}
+
+
+BaseType_t xQueueSendToBack(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait) {
+    return queueSend(xQueue, pvItemToQueue, xTicksToWait, false);
+}
+
+
+BaseType_t xQueueSendToFront(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait) {
+    return queueSend(xQueue, pvItemToQueue, xTicksToWait, true);
+}
+
+
+BaseType_t xQueueOverwrite(QueueHandle_t xQueue, const void *pvItemToQueue) {
+    {
+        std::lock_guard<std::mutex> lock(xQueue->mutex);
+        if (xQueue->itemSize > 0) {
+            std::memcpy(xQueue->slot(xQueue->head), pvItemToQueue, xQueue->itemSize);
+        }
+        xQueue->count = 1;
+    }
+    xQueue->notEmpty.notify_one();
+    return pdPASS;
+}
+
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait) {
+    std::unique_lock<std::mutex> lock(xQueue->mutex);
+    if (!waitTicks(xQueue->notEmpty, lock, xTicksToWait, [xQueue] { return xQueue->count > 0; })) {
+        return pdFALSE;
+    }
+
+    if (xQueue->itemSize > 0) {
+        std::memcpy(pvBuffer, xQueue->slot(xQueue->head), xQueue->itemSize);
+    }
+    xQueue->head = (xQueue->head + 1) % xQueue->length;
+    --xQueue->count;
+
+    lock.unlock();
+    xQueue->notFull.notify_one();
+    return pdTRUE;
+}
+
+
+BaseType_t xQueuePeek(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait) {
+    std::unique_lock<std::mutex> lock(xQueue->mutex);
+    if (!waitTicks(xQueue->notEmpty, lock, xTicksToWait, [xQueue] { return xQueue->count > 0; })) {
+        return pdFALSE;
+    }
+    if (xQueue->itemSize > 0) {
+        std::memcpy(pvBuffer, xQueue->slot(xQueue->head), xQueue->itemSize);
+    }
+    return pdTRUE;
+}
+
+
+BaseType_t xQueueReset(QueueHandle_t xQueue) {
+    {
+        std::lock_guard<std::mutex> lock(xQueue->mutex);
+        xQueue->head = 0;
+        xQueue->count = 0;
+    }
+    xQueue->notFull.notify_all();
+    return pdPASS;
+}
+
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue) {
+    std::lock_guard<std::mutex> lock(xQueue->mutex);
+    return xQueue->count;
+}
+
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t xQueue) {
+    std::lock_guard<std::mutex> lock(xQueue->mutex);
+    return xQueue->length - xQueue->count;
+}
+
+
+//-------------------------------------
+// Event groups.
+//-------------------------------------
+struct HostEventGroup {
+    std::mutex mutex;
+    std::condition_variable changed;
+    EventBits_t bits = 0;
+};
+
+
+EventGroupHandle_t xEventGroupCreate(void) {
+    return new HostEventGroup();
+}
+
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet) {
+    EventBits_t bits;
+    {
+        std::lock_guard<std::mutex> lock(xEventGroup->mutex);
+        xEventGroup->bits |= uxBitsToSet;
+        bits = xEventGroup->bits;
+    }
+    xEventGroup->changed.notify_all();
+    return bits;
+}
+
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToClear) {
+    std::lock_guard<std::mutex> lock(xEventGroup->mutex);
+    EventBits_t bits = xEventGroup->bits;
+    xEventGroup->bits &= ~uxBitsToClear;
+    return bits;
+}
+
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t xEventGroup) {
+    std::lock_guard<std::mutex> lock(xEventGroup->mutex);
+    return xEventGroup->bits;
+}
+
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToWaitFor,
+                                const BaseType_t xClearOnExit, const BaseType_t xWaitForAllBits,
+                                TickType_t xTicksToWait) {
+    std::unique_lock<std::mutex> lock(xEventGroup->mutex);
+    auto isSet = [xEventGroup, uxBitsToWaitFor, xWaitForAllBits] {
+        EventBits_t matched = xEventGroup->bits & uxBitsToWaitFor;
+        return xWaitForAllBits ? (matched == uxBitsToWaitFor) : (matched != 0);
+    };
+
+    bool isMatched = waitTicks(xEventGroup->changed, lock, xTicksToWait, isSet);
+    EventBits_t bits = xEventGroup->bits;
+    if (isMatched && xClearOnExit) {
+        xEventGroup->bits &= ~uxBitsToWaitFor;
+    }
+    return bits;
+}
+
+
+//-------------------------------------
+// Tasks.
+//-------------------------------------
+struct HostTask {
+    std::string name;
+    BaseType_t coreId;
+    uint32_t stackDepth;
+};
+
+static thread_local HostTask *currentTask = nullptr;
+
+
+// The CPUs the process started with. The first two stand in for PRO_CPU_NUM
+// and APP_CPU_NUM.
+static const std::vector<int> &hostCpus() {
+    static const std::vector<int> cpus = [] {
+        std::vector<int> allowed;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &set)) {
+                    allowed.push_back(cpu);
+                }
+            }
+        }
+        return allowed;
+    }();
+    return cpus;
+}
+
+
+static void pinThread(const std::vector<int> &cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &set);
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+
+unsigned host_cpu_count(void) {
+    return static_cast<unsigned>(hostCpus().size());
+}
+
+
+void host_pin_to_core(BaseType_t coreId) {
+    const std::vector<int> &cpus = hostCpus();
+    if (cpus.size() < 2) {
+        return;
+    }
+    if (coreId == tskNO_AFFINITY) {
+        pinThread({ cpus[0], cpus[1] });
+    } else {
+        pinThread({ cpus[coreId % portNUM_PROCESSORS] });
+    }
+}
+
+
+bool host_pin_off_cores(void) {
+    const std::vector<int> &cpus = hostCpus();
+    if (cpus.size() <= portNUM_PROCESSORS) {
+        return false;
+    }
+    pinThread(std::vector<int>(cpus.begin() + portNUM_PROCESSORS, cpus.end()));
+    return true;
+}
+
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char *pcName, uint32_t usStackDepth,
+                                   void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pvCreatedTask,
+                                   BaseType_t xCoreID) {
+    HostTask *task = new HostTask{ pcName ? pcName : "", (xCoreID == tskNO_AFFINITY) ? 0 : xCoreID, usStackDepth };
+    std::thread([task, pvTaskCode, pvParameters, xCoreID] {
+        currentTask = task;
+        host_pin_to_core(xCoreID);
+        pvTaskCode(pvParameters);
+        // A FreeRTOS task must never return.
+        configASSERT(!"task returned");
+    }).detach();
+
+    if (pvCreatedTask) {
+        *pvCreatedTask = task;
+    }
+    return pdPASS;
+}
+
+
+BaseType_t xTaskCreate(TaskFunction_t pvTaskCode, const char *pcName, uint32_t usStackDepth,
+                       void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pvCreatedTask) {
+    return xTaskCreatePinnedToCore(pvTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pvCreatedTask, tskNO_AFFINITY);
+}
+
+
+void vTaskDelete(TaskHandle_t xTaskToDelete) {
+    configASSERT(xTaskToDelete == nullptr || xTaskToDelete == currentTask);
+    delete currentTask;
+    currentTask = nullptr;
+    pthread_exit(nullptr);
+}
+
+
+void vTaskDelay(TickType_t xTicksToDelay) {
+    if (xTicksToDelay == 0) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<uint64_t>(xTicksToDelay) * portTICK_PERIOD_MS));
+    }
+}
+
+
+TickType_t xTaskGetTickCount(void) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - startTime);
+    return static_cast<TickType_t>(elapsed.count() / portTICK_PERIOD_MS);
+}
+
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return currentTask;
+}
+
+
+char *pcTaskGetTaskName(TaskHandle_t xTaskToQuery) {
+    HostTask *task = xTaskToQuery ? xTaskToQuery : currentTask;
+    static char mainName[] = "main";
+    return task ? &task->name[0] : mainName;
+}
+
+
+// Threads run on the host's own stacks, so as far as FreeRTOS knows nothing is ever used.
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask) {
+    HostTask *task = xTask ? xTask : currentTask;
+    return task ? task->stackDepth : 0;
+}
+
+
+BaseType_t host_get_core_id(void) {
+    return currentTask ? currentTask->coreId : PRO_CPU_NUM;
+}
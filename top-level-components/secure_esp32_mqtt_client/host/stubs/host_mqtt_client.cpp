@@ -0,0 +1,82 @@
+/*  host_mqtt_client.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+
+    Host build: an MQTT client that never connects.
+*/
+
+#include <atomic>
+
+#include "mqtt_client.h"
+
+
+struct esp_mqtt_client {
+    esp_mqtt_client_config_t config;
+    std::atomic<int> nextMsgId{1};
+};
+
+static std::atomic<uint32_t> publishCount{0};
+
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *config) {
+    if (!config) {
+        return nullptr;
+    }
+    esp_mqtt_client *client = new esp_mqtt_client();
+    client->config = *config;
+    return client;
+}
+
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client) {
+    return client ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+
+esp_err_t esp_mqtt_client_stop(esp_mqtt_client_handle_t client) {
+    return client ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+
+esp_err_t esp_mqtt_client_destroy(esp_mqtt_client_handle_t client) {
+    delete client;
+    return ESP_OK;
+}
+
+
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client, const char *topic, int qos) {
+    if (!client || !topic) {
+        return -1;
+    }
+    return client->nextMsgId++;
+}
+
+
+int esp_mqtt_client_unsubscribe(esp_mqtt_client_handle_t client, const char *topic) {
+    if (!client || !topic) {
+        return -1;
+    }
+    return client->nextMsgId++;
+}
+
+
+// As in ESP-MQTT, a QoS 0 publish has no message id and returns 0.
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic, const char *data, int len,
+                            int qos, int retain) {
+    if (!client || !topic) {
+        return -1;
+    }
+    ++publishCount;
+    return (qos > 0) ? client->nextMsgId++ : 0;
+}
+
+
+uint32_t host_mqtt_get_publish_count(void) {
+    return publishCount;
+}
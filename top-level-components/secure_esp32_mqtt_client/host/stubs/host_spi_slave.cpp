@@ -0,0 +1,160 @@
+/*  host_spi_slave.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+
+    Host build: the SPI slave driver. Queued transactions wait until the virtual
+    master in host_spi_master.h clocks them, and then wait to be collected.
+*/
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+
+#include "driver/spi_slave.h"
+#include "host_spi_master.h"
+
+
+static std::mutex spiMutex;
+static std::condition_variable spiQueued;
+static std::condition_variable spiDone;
+static std::condition_variable spiSpace;
+static bool isSpiInitialized = false;
+static spi_slave_interface_config_t slaveConfig;
+static std::deque<spi_slave_transaction_t *> queuedTransactions;
+static std::deque<spi_slave_transaction_t *> doneTransactions;
+
+
+template<typename Predicate>
+static bool waitTicks(std::condition_variable &cv, std::unique_lock<std::mutex> &lock, TickType_t ticks, Predicate isReady) {
+    if (ticks == portMAX_DELAY) {
+        cv.wait(lock, isReady);
+        return true;
+    }
+    return cv.wait_for(lock, std::chrono::milliseconds(static_cast<uint64_t>(ticks) * portTICK_PERIOD_MS), isReady);
+}
+
+
+esp_err_t spi_slave_initialize(spi_host_device_t host, const spi_bus_config_t *bus_config,
+                               const spi_slave_interface_config_t *slave_config, int dma_chan) {
+    std::lock_guard<std::mutex> lock(spiMutex);
+    if (isSpiInitialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!bus_config || !slave_config || slave_config->queue_size <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    slaveConfig = *slave_config;
+    isSpiInitialized = true;
+    return ESP_OK;
+}
+
+
+esp_err_t spi_slave_free(spi_host_device_t host) {
+    std::lock_guard<std::mutex> lock(spiMutex);
+    if (!isSpiInitialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // The driver drops whatever is still queued.
+    queuedTransactions.clear();
+    doneTransactions.clear();
+    isSpiInitialized = false;
+    return ESP_OK;
+}
+
+
+esp_err_t spi_slave_queue_trans(spi_host_device_t host, const spi_slave_transaction_t *trans_desc,
+                                TickType_t ticks_to_wait) {
+    std::unique_lock<std::mutex> lock(spiMutex);
+    if (!isSpiInitialized || !trans_desc || trans_desc->length == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Like the driver, a transaction stays "in flight" from here until it is collected.
+    auto hasSpace = [] {
+        return queuedTransactions.size() + doneTransactions.size() < static_cast<size_t>(slaveConfig.queue_size);
+    };
+    if (!waitTicks(spiSpace, lock, ticks_to_wait, hasSpace)) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    spi_slave_transaction_t *trans = const_cast<spi_slave_transaction_t *>(trans_desc);
+    queuedTransactions.push_back(trans);
+    if (slaveConfig.post_setup_cb) {
+        slaveConfig.post_setup_cb(trans);
+    }
+
+    lock.unlock();
+    spiQueued.notify_one();
+    return ESP_OK;
+}
+
+
+esp_err_t spi_slave_get_trans_result(spi_host_device_t host, spi_slave_transaction_t **trans_desc,
+                                     TickType_t ticks_to_wait) {
+    std::unique_lock<std::mutex> lock(spiMutex);
+    if (!isSpiInitialized || !trans_desc) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!waitTicks(spiDone, lock, ticks_to_wait, [] { return !doneTransactions.empty(); })) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    *trans_desc = doneTransactions.front();
+    doneTransactions.pop_front();
+
+    lock.unlock();
+    spiSpace.notify_one();
+    return ESP_OK;
+}
+
+
+size_t host_spi_master_transfer(const void *mosi, void *miso, size_t length, TickType_t ticksToWait) {
+    std::unique_lock<std::mutex> lock(spiMutex);
+    if (!waitTicks(spiQueued, lock, ticksToWait, [] { return !queuedTransactions.empty(); })) {
+        return 0;
+    }
+
+    spi_slave_transaction_t *trans = queuedTransactions.front();
+    queuedTransactions.pop_front();
+
+    // The slave's length is in bits. The master decides how much is clocked.
+    size_t slaveLength = trans->length / 8;
+    size_t clocked = (length < slaveLength) ? length : slaveLength;
+    if (miso) {
+        std::memset(miso, 0, length);
+        if (trans->tx_buffer) {
+            std::memcpy(miso, trans->tx_buffer, clocked);
+        }
+    }
+    if (trans->rx_buffer) {
+        if (mosi) {
+            std::memcpy(trans->rx_buffer, mosi, clocked);
+        } else {
+            std::memset(trans->rx_buffer, 0, clocked);
+        }
+    }
+    trans->trans_len = clocked * 8;
+
+    if (slaveConfig.post_trans_cb) {
+        slaveConfig.post_trans_cb(trans);
+    }
+    doneTransactions.push_back(trans);
+
+    lock.unlock();
+    spiDone.notify_one();
+    return clocked;
+}
+
+
+unsigned host_spi_master_pending(void) {
+    std::lock_guard<std::mutex> lock(spiMutex);
+    return static_cast<unsigned>(queuedTransactions.size());
+}
@@ -0,0 +1,219 @@
+/*  host_uart.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+
+    Host build: the receive side of the UART driver. host_uart_receive() plays
+    the ISR, filling the ring buffer, recording pattern positions and posting
+    events; the application reads as it would on the ESP32.
+*/
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+
+#include "driver/uart.h"
+#include "freertos/queue.h"
+
+
+struct HostUart {
+    bool isInstalled = false;
+    size_t rxBufferSize = 0;
+    QueueHandle_t eventQueue = nullptr;
+    std::deque<uint8_t> rxBuffer;
+    uint64_t receivedCount = 0;     // Bytes ever buffered...
+    uint64_t readCount = 0;         // ...and read or flushed, so positions survive reads.
+    bool isBufferFull = false;      // UART_BUFFER_FULL posted, until there is space again.
+
+    bool isPatternEnabled = false;
+    char patternChr = 0;
+    size_t patternQueueLength = 0;
+    std::deque<uint64_t> patternPositions;
+};
+
+static std::mutex uartMutex;
+static HostUart uarts[UART_NUM_MAX];
+
+
+static HostUart * findUart(uart_port_t uart_num) {
+    return (uart_num >= 0 && uart_num < UART_NUM_MAX && uarts[uart_num].isInstalled) ? &uarts[uart_num] : nullptr;
+}
+
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config) {
+    return (uart_num >= 0 && uart_num < UART_NUM_MAX && uart_config) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num) {
+    return (uart_num >= 0 && uart_num < UART_NUM_MAX) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size,
+                              int queue_size, QueueHandle_t *uart_queue, int intr_alloc_flags) {
+    std::lock_guard<std::mutex> lock(uartMutex);
+    // The driver needs more than the 128 byte hardware FIFO.
+    if (uart_num < 0 || uart_num >= UART_NUM_MAX || rx_buffer_size <= 128) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    HostUart &uart = uarts[uart_num];
+    if (uart.isInstalled) {
+        return ESP_FAIL;
+    }
+    uart = HostUart();
+    uart.rxBufferSize = static_cast<size_t>(rx_buffer_size);
+    if (queue_size > 0 && uart_queue) {
+        uart.eventQueue = xQueueCreate(queue_size, sizeof(uart_event_t));
+        if (!uart.eventQueue) {
+            return ESP_ERR_NO_MEM;
+        }
+        *uart_queue = uart.eventQueue;
+    }
+    uart.isInstalled = true;
+    return ESP_OK;
+}
+
+
+esp_err_t uart_driver_delete(uart_port_t uart_num) {
+    std::lock_guard<std::mutex> lock(uartMutex);
+    HostUart *uart = findUart(uart_num);
+    if (!uart) {
+        return ESP_FAIL;
+    }
+    if (uart->eventQueue) {
+        vQueueDelete(uart->eventQueue);
+    }
+    *uart = HostUart();
+    return ESP_OK;
+}
+
+
+// Everything is buffered already, so ticks_to_wait is only honoured as "don't wait".
+int uart_read_bytes(uart_port_t uart_num, uint8_t *buf, uint32_t length, TickType_t ticks_to_wait) {
+    std::lock_guard<std::mutex> lock(uartMutex);
+    HostUart *uart = findUart(uart_num);
+    if (!uart || !buf) {
+        return -1;
+    }
+    size_t count = std::min(static_cast<size_t>(length), uart->rxBuffer.size());
+    std::copy(uart->rxBuffer.begin(), uart->rxBuffer.begin() + count, buf);
+    uart->rxBuffer.erase(uart->rxBuffer.begin(), uart->rxBuffer.begin() + count);
+    uart->readCount += count;
+    if (count) {
+        uart->isBufferFull = false;
+    }
+    return static_cast<int>(count);
+}
+
+
+// Like the driver, the pattern positions are left alone; see uart_pattern_queue_reset().
+esp_err_t uart_flush_input(uart_port_t uart_num) {
+    std::lock_guard<std::mutex> lock(uartMutex);
+    HostUart *uart = findUart(uart_num);
+    if (!uart) {
+        return ESP_FAIL;
+    }
+    uart->readCount += uart->rxBuffer.size();
+    uart->rxBuffer.clear();
+    uart->isBufferFull = false;
+    return ESP_OK;
+}
+
+
+esp_err_t uart_enable_pattern_det_intr(uart_port_t uart_num, char pattern_chr, uint8_t chr_num,
+                                       int chr_tout, int post_idle, int pre_idle) {
+    std::lock_guard<std::mutex> lock(uartMutex);
+    HostUart *uart = findUart(uart_num);
+    // Only single character patterns are emulated.
+    if (!uart || chr_num != 1) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uart->patternChr = pattern_chr;
+    uart->isPatternEnabled = true;
+    return ESP_OK;
+}
+
+
+esp_err_t uart_pattern_queue_reset(uart_port_t uart_num, int queue_length) {
+    std::lock_guard<std::mutex> lock(uartMutex);
+    HostUart *uart = findUart(uart_num);
+    if (!uart || queue_length <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uart->patternPositions.clear();
+    uart->patternQueueLength = static_cast<size_t>(queue_length);
+    return ESP_OK;
+}
+
+
+int uart_pattern_pop_pos(uart_port_t uart_num) {
+    std::lock_guard<std::mutex> lock(uartMutex);
+    HostUart *uart = findUart(uart_num);
+    if (!uart) {
+        return -1;
+    }
+    // Positions of flushed bytes are stale; the driver returns garbage for them.
+    while (!uart->patternPositions.empty()) {
+        uint64_t position = uart->patternPositions.front();
+        uart->patternPositions.pop_front();
+        if (position >= uart->readCount) {
+            return static_cast<int>(position - uart->readCount);
+        }
+    }
+    return -1;
+}
+
+
+size_t host_uart_receive(uart_port_t uart_num, const void *data, size_t length) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    // Posting can block on the host queue's lock, so events are posted after uartMutex is released.
+    uart_event_t events[130];
+    size_t eventCount = 0;
+    size_t buffered = 0;
+    QueueHandle_t eventQueue;
+    {
+        std::lock_guard<std::mutex> lock(uartMutex);
+        HostUart *uart = findUart(uart_num);
+        if (!uart) {
+            return 0;
+        }
+        eventQueue = uart->eventQueue;
+        length = std::min(length, sizeof(events) / sizeof(events[0]) - 2);
+
+        bool isPatternFound = false;
+        for (; buffered < length; ++buffered) {
+            if (uart->rxBuffer.size() >= uart->rxBufferSize) {
+                break;
+            }
+            uart->rxBuffer.push_back(bytes[buffered]);
+            if (uart->isPatternEnabled && static_cast<char>(bytes[buffered]) == uart->patternChr) {
+                isPatternFound = true;
+                // A full pattern queue loses the position, but the event is still posted.
+                if (uart->patternPositions.size() < uart->patternQueueLength) {
+                    uart->patternPositions.push_back(uart->receivedCount);
+                }
+                events[eventCount++] = { UART_PATTERN_DET, uart->rxBuffer.size() };
+            }
+            ++uart->receivedCount;
+        }
+        if (buffered && !isPatternFound) {
+            events[eventCount++] = { UART_DATA, buffered };
+        }
+        if (buffered < length && !uart->isBufferFull) {
+            uart->isBufferFull = true;
+            events[eventCount++] = { UART_BUFFER_FULL, 0 };
+        }
+    }
+
+    // The ISR drops events that don't fit in the queue.
+    for (size_t index = 0; eventQueue && index < eventCount; ++index) {
+        xQueueSendToBack(eventQueue, &events[index], 0);
+    }
+    return buffered;
+}
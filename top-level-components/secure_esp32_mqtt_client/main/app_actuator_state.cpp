@@ -0,0 +1,205 @@
+/*  app_actuator_state.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+
+#include "app_actuator_state.h"
+#include "app_hash.h"
+
+
+static const char *LOG_TAG = "APP_ACTUATOR_STATE";
+
+static const char *NVS_NAMESPACE = "actuators";
+
+
+static ActuatorStateStore static_actuator_state_store;
+
+
+// Keys are derived from the topic, not its position, so reordering
+// TOPIC_MANIFEST keeps the stored values. NVS keys are at most 15 characters.
+void ActuatorStateStore::makeKey(int manifestIndex, char *key, size_t keySize) {
+    const TopicManifestEntry &entry = TOPIC_MANIFEST[manifestIndex];
+    std::snprintf(key, keySize, "t%08x", static_cast<unsigned>(fnv1a(entry.topic, entry.topicLength)));
+}
+
+
+esp_err_t ActuatorStateStore::init() {
+    esp_err_t err_code = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvsHandle);
+    if (err_code != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "init(): nvs_open(...) failed, err_code=0x%x. Actuator state will not be kept.", err_code);
+        return err_code;
+    }
+    isOpen = true;
+
+    unsigned loadedCount = 0;
+    for (unsigned index = 0; index < TOPIC_MANIFEST_SIZE; ++index) {
+        if (!TOPIC_MANIFEST[index].isPersistent) {
+            continue;
+        }
+
+        char key[16];
+        makeKey(index, key, sizeof(key));
+        ActuatorValue &value = values[index];
+        size_t size = sizeof(value.data);
+        if (nvs_get_blob(nvsHandle, key, value.data, &size) == ESP_OK) {
+            value.size = static_cast<uint8_t>(size);
+            value.isValid = true;
+            ++loadedCount;
+        }
+    }
+
+    ESP_LOGI(LOG_TAG, "init(): %u actuator value(s) restored from NVS.", loadedCount);
+    return ESP_OK;
+}
+
+
+void ActuatorStateStore::update(int manifestIndex, const char *data, size_t dataSize) {
+    if (!isOpen || manifestIndex < 0 || !TOPIC_MANIFEST[manifestIndex].isPersistent) {
+        return;
+    }
+    if (dataSize > MAX_VALUE_SIZE) {
+        ESP_LOGW(LOG_TAG, "update(...): value of %s is too long to keep (%u bytes).",
+            TOPIC_MANIFEST[manifestIndex].topic, static_cast<unsigned>(dataSize));
+        return;
+    }
+
+    int64_t nowUs = esp_timer_get_time();
+    portENTER_CRITICAL(&valuesMux);
+    ActuatorValue &value = values[manifestIndex];
+    if (!value.isValid || value.size != dataSize || std::memcmp(value.data, data, dataSize) != 0) {
+        std::memcpy(value.data, data, dataSize);
+        value.size = static_cast<uint8_t>(dataSize);
+        value.isValid = true;
+        value.isDirty = true;
+        if (commitAtUs == 0) {
+            commitAtUs = nowUs + COMMIT_DELAY_US;
+        }
+    }
+    portEXIT_CRITICAL(&valuesMux);
+}
+
+
+void ActuatorStateStore::commitIfDue(int64_t nowUs) {
+    bool isDue = false;
+
+    portENTER_CRITICAL(&valuesMux);
+    if (commitAtUs != 0 && nowUs >= commitAtUs) {
+        // Anything that changes from here on sets a new deadline.
+        commitAtUs = 0;
+        isDue = true;
+    }
+    portEXIT_CRITICAL(&valuesMux);
+
+    if (isDue) {
+        commit();
+    }
+}
+
+
+// Values are copied out under the lock and written without it, since a
+// flash write can take several milliseconds.
+void ActuatorStateStore::commit() {
+    bool isWritten[TOPIC_MANIFEST_SIZE] = {};
+    unsigned writtenCount = 0;
+
+    for (unsigned index = 0; index < TOPIC_MANIFEST_SIZE; ++index) {
+        ActuatorValue value;
+        portENTER_CRITICAL(&valuesMux);
+        value = values[index];
+        values[index].isDirty = false;
+        portEXIT_CRITICAL(&valuesMux);
+
+        if (!value.isDirty) {
+            continue;
+        }
+
+        char key[16];
+        makeKey(index, key, sizeof(key));
+        esp_err_t err_code = nvs_set_blob(nvsHandle, key, value.data, value.size);
+        if (err_code != ESP_OK) {
+            ESP_LOGE(LOG_TAG, "commit(): nvs_set_blob(%s) failed, err_code=0x%x", TOPIC_MANIFEST[index].topic, err_code);
+            retryLater(index);
+            continue;
+        }
+        isWritten[index] = true;
+        ++writtenCount;
+    }
+
+    if (writtenCount == 0) {
+        return;
+    }
+    esp_err_t err_code = nvs_commit(nvsHandle);
+    if (err_code != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "commit(): nvs_commit(...) failed, err_code=0x%x", err_code);
+        for (unsigned index = 0; index < TOPIC_MANIFEST_SIZE; ++index) {
+            if (isWritten[index]) {
+                retryLater(index);
+            }
+        }
+        return;
+    }
+    ++commitCount;
+    ESP_LOGI(LOG_TAG, "commit(): %u value(s) written, commit #%u.", writtenCount, commitCount);
+}
+
+
+// Marks a value that failed to reach the flash as changed again, so it is
+// written with the next commit.
+void ActuatorStateStore::retryLater(unsigned index) {
+    int64_t nowUs = esp_timer_get_time();
+    portENTER_CRITICAL(&valuesMux);
+    values[index].isDirty = true;
+    if (commitAtUs == 0) {
+        commitAtUs = nowUs + COMMIT_DELAY_US;
+    }
+    portEXIT_CRITICAL(&valuesMux);
+}
+
+
+unsigned ActuatorStateStore::replay(ReplayCallback callback, void *context) {
+    unsigned replayedCount = 0;
+
+    for (unsigned index = 0; index < TOPIC_MANIFEST_SIZE; ++index) {
+        ActuatorValue value;
+        portENTER_CRITICAL(&valuesMux);
+        value = values[index];
+        portEXIT_CRITICAL(&valuesMux);
+
+        if (value.isValid) {
+            const TopicManifestEntry &entry = TOPIC_MANIFEST[index];
+            callback(context, entry.topic, entry.topicLength, value.data, value.size);
+            ++replayedCount;
+        }
+    }
+    return replayedCount;
+}
+
+
+//-------------------------------------
+// C wrappers.
+//-------------------------------------
+ActuatorStateStore & app_get_actuator_state_store() {
+    return static_actuator_state_store;
+}
+
+
+void app_actuator_state_init(void) {
+    static_actuator_state_store.init();
+}
+
+
+void app_actuator_state_commit_if_due(int64_t nowUs) {
+    static_actuator_state_store.commitIfDue(nowUs);
+}
@@ -0,0 +1,94 @@
+/*  app_actuator_state.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+#ifndef _APP_ACTUATOR_STATE_H_
+#define _APP_ACTUATOR_STATE_H_
+
+#include "esp_err.h"
+
+
+//-------------------
+#ifdef __cplusplus
+#include "freertos/FreeRTOS.h"
+#include "nvs.h"
+
+#include "app_topic_dispatch.h"
+
+
+//------------------------------------------------------------------------------
+// The last value received on every persistent TOPIC_MANIFEST topic, kept in
+// NVS so the peripheral can be put back in its last state right after a reboot
+// instead of waiting for the broker.
+//
+// Writes are coalesced: a change sets a deadline and everything that changed
+// until then is committed together, so a chatty topic costs at most one
+// NVS commit per COMMIT_DELAY_US. The publisher task does the writes, so the
+// MQTT and esp_timer tasks never wait for the flash.
+class ActuatorStateStore {
+public:
+    static const size_t MAX_VALUE_SIZE = 64;
+    static const int64_t COMMIT_DELAY_US = 5LL * 1000 * 1000;
+
+    typedef void (*ReplayCallback)(void *context, const char *topic, size_t topicSize, const char *data, size_t dataSize);
+
+    ActuatorStateStore() { }
+    virtual ~ActuatorStateStore() { }
+
+    // Opens the NVS namespace and loads the stored values. nvs_flash_init() must have been called.
+    esp_err_t init();
+    // Called from the MQTT task for every complete message on a manifest topic.
+    void update(int manifestIndex, const char *data, size_t dataSize);
+    // Calls callback once for every stored value. Returns the number of values.
+    unsigned replay(ReplayCallback callback, void *context);
+    // Writes the changed values once COMMIT_DELAY_US has passed since the first change.
+    void commitIfDue(int64_t nowUs);
+
+private:
+    struct ActuatorValue {
+        char data[MAX_VALUE_SIZE];
+        uint8_t size;
+        bool isValid;
+        bool isDirty;
+    };
+
+    ActuatorValue values[TOPIC_MANIFEST_SIZE] = {};
+    portMUX_TYPE valuesMux = portMUX_INITIALIZER_UNLOCKED;
+    nvs_handle nvsHandle = 0;
+    bool isOpen = false;
+    int64_t commitAtUs = 0;     // 0 while nothing is waiting to be written.
+    uint32_t commitCount = 0;
+
+    void commit();
+    void retryLater(unsigned index);
+    static void makeKey(int manifestIndex, char *key, size_t keySize);
+};
+
+extern ActuatorStateStore & app_get_actuator_state_store();
+
+#endif //__cplusplus
+//-------------------
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// C wrappers.
+extern void app_actuator_state_init(void);
+// Called from the publisher task.
+extern void app_actuator_state_commit_if_due(int64_t nowUs);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // _APP_ACTUATOR_STATE_H_
@@ -0,0 +1,635 @@
+/*  app_avr_ota.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include "app_avr_ota.h"
+
+#if CONFIG_APP_AVR_OTA
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "nvs.h"
+
+#include "app_queues.h"
+#include "app_spi.h"
+#include "app_stack_monitor.h"
+
+
+static const char *LOG_TAG = "APP_AVR_OTA";
+
+// HSPI, with the ESP32 as master. HSPI's own MISO (GPIO12) is a strapping
+// pin that the AVR would drive at reset, so the bus goes through the GPIO
+// matrix. CS is driven by hand, so a frame can span several transactions.
+static const gpio_num_t PIN_NUM_MISO = GPIO_NUM_27;
+static const gpio_num_t PIN_NUM_MOSI = GPIO_NUM_26;
+static const gpio_num_t PIN_NUM_CLK  = GPIO_NUM_25;
+static const gpio_num_t PIN_NUM_CS   = GPIO_NUM_4;
+#define GPIO_SEL_CS_PIN GPIO_SEL_4
+
+// The AVR takes each byte in its SPI ISR, which needs most of a byte at 8MHz.
+static const int SPI_CLOCK_HZ = 500000;
+static const int SPI_DMA_CHANNEL = 2;   // AppSPI has 1.
+
+static const char        *OTA_TASK_NAME = "App AVR OTA";
+static const uint32_t     OTA_TASK_STACK_DEPTH = 3072;
+static const UBaseType_t  OTA_TASK_PRIORITY = 3;
+
+static const char *NVS_NAMESPACE = "app_avr_ota";
+static const char *NVS_KEY_CRC = "crc";
+
+#define OTA_QUEUE_LENGTH    4
+#define OTA_RESEND_PAGES    2       // The bootloader only ever rejects the last page sent.
+#define OTA_ERROR_CAPACITY  64
+#define OTA_STATUS_INFIX    "/status/"
+
+// The MQTT task waits this long for room in the queue.
+static const TickType_t PAGE_SEND_TIMEOUT = 2000 / portTICK_PERIOD_MS;
+// The OTA task waits this long for the next page from MQTT.
+static const TickType_t PAGE_RECEIVE_TIMEOUT = 10000 / portTICK_PERIOD_MS;
+// From REG_BOOT to the bootloader answering: a 15ms watchdog reset and the start up.
+static const TickType_t BOOT_RESET_DELAY = 100 / portTICK_PERIOD_MS;
+static const TickType_t BOOT_ANSWER_TIMEOUT = 1000 / portTICK_PERIOD_MS;
+// Without the next address moving on for this long the update is abandoned.
+static const TickType_t PROGRESS_TIMEOUT = 2000 / portTICK_PERIOD_MS;
+// Reading back 14K and its CRC takes the AVR about 0.2s.
+static const TickType_t VERIFY_TIMEOUT = 2000 / portTICK_PERIOD_MS;
+static const TickType_t VERIFY_POLL_DELAY = 10 / portTICK_PERIOD_MS;
+// After a page frame, for the bootloader's CRC check.
+static const int64_t PAGE_GAP_US = 400;
+
+static const uint8_t IMAGE_MAGIC[4] = { 'A', 'V', 'R', '1' };
+
+// Register map and bootloader protocol, as in avr_spi_master/spi_master.c
+// and avr_spi_master/spi_bootloader.h.
+static const uint8_t REG_BOOT = 0x0D;
+static const uint8_t REG_BOOT_ENTER = 0xB0;
+
+#define BOOT_COMMAND_PAGE       0x01
+#define BOOT_COMMAND_FINISH     0x02
+#define BOOT_COMMAND_RUN        0x03
+#define BOOT_COMMAND_STATUS     0x80
+#define BOOT_PAGE_SIZE          128
+#define BOOT_PAGE_FRAME_LENGTH  (1 + 2 + BOOT_PAGE_SIZE + 2)
+#define BOOT_FINISH_FRAME_LENGTH (1 + 4 + 4)
+
+#define BOOT_STATUS_SIGNATURE       0
+#define BOOT_STATUS_STATE           1
+#define BOOT_STATUS_ERROR           2
+#define BOOT_STATUS_NEXT_LO         3
+#define BOOT_STATUS_NEXT_HI         4
+#define BOOT_STATUS_FREE_BUFFERS    5
+#define BOOT_STATUS_WRITTEN_LO      6
+#define BOOT_STATUS_WRITTEN_HI      7
+#define BOOT_STATUS_LENGTH          8
+#define BOOT_SIGNATURE              0xB7
+
+#define BOOT_STATE_RECEIVING    0
+#define BOOT_STATE_VERIFYING    1
+#define BOOT_STATE_DONE         2
+#define BOOT_STATE_FAILED       3
+
+
+// From the MQTT task to the OTA task.
+enum OtaItemKind : uint8_t {
+    OTA_ITEM_START,     // A new image: length and crc.
+    OTA_ITEM_PAGE,      // The next page of it: address and data.
+};
+
+struct OtaItem {
+    OtaItemKind kind;
+    uint16_t address;
+    uint32_t length;
+    uint32_t crc;
+    uint8_t data[BOOT_PAGE_SIZE];
+};
+
+// The message being received, in the MQTT task.
+struct OtaReceiver {
+    bool isTaking;          // false once the message is skipped or failed.
+    uint8_t header[APP_AVR_OTA_HEADER_LENGTH];
+    uint32_t imageLength;
+    uint32_t imageOffset;
+    OtaItem page;
+};
+
+static OtaReceiver receiver;
+
+static QueueHandle_t itemQueue;
+static StaticQueue_t itemQueueBuffer;
+static uint8_t itemQueueStorage[OTA_QUEUE_LENGTH * sizeof(OtaItem)];
+
+// The OTA task's. The last pages taken from the queue, by page number.
+static OtaItem receivedItem;
+static OtaItem sentPages[OTA_RESEND_PAGES];
+static bool isStartPending;
+
+static spi_device_handle_t avrDevice;
+alignas(4) static uint8_t frameBuffer[BOOT_PAGE_FRAME_LENGTH];
+
+static char statusTopic[sizeof(CONFIG_APP_AVR_OTA_TOPIC) + sizeof(OTA_STATUS_INFIX) + 12];
+// CRC of the image last installed. Written by the OTA task, read by the MQTT task.
+static volatile uint32_t installedCrc;
+
+
+// CRC-16 (XMODEM) of a page frame, as spi_bootloader.c checks it. A bit at
+// a time is quick enough next to the 4.5ms page write.
+static uint16_t crc16(const uint8_t *data, size_t length) {
+    uint16_t crc = 0;
+    for (size_t index = 0; index < length; ++index) {
+        crc ^= static_cast<uint16_t>(data[index]) << 8;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+        }
+    }
+    return crc;
+}
+
+
+static uint32_t readLe32(const uint8_t *bytes) {
+    return bytes[0] | (static_cast<uint32_t>(bytes[1]) << 8)
+         | (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+
+static void writeLe32(uint8_t *bytes, uint32_t value) {
+    bytes[0] = value & 0xFF;
+    bytes[1] = (value >> 8) & 0xFF;
+    bytes[2] = (value >> 16) & 0xFF;
+    bytes[3] = value >> 24;
+}
+
+
+static void publishStatus(const char *result, uint32_t crc, const char *error) {
+    char msg[APP_SPI_MESSAGE_CAPACITY + 1];
+    if (result) {
+        std::snprintf(msg, sizeof(msg), "%s,{\"ok\":true,\"result\":\"%s\",\"crc\":\"%08x\"}",
+            statusTopic, result, crc);
+    } else {
+        std::snprintf(msg, sizeof(msg), "%s,{\"ok\":false,\"crc\":\"%08x\",\"error\":\"%s\"}",
+            statusTopic, crc, error);
+    }
+    app_queues_send_upstream(msg);
+}
+
+
+//-------------------------------------
+// NVS.
+//-------------------------------------
+static void loadInstalledCrc() {
+    nvs_handle nvsHandle;
+    uint32_t crc = 0;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvsHandle) == ESP_OK) {
+        nvs_get_u32(nvsHandle, NVS_KEY_CRC, &crc);
+        nvs_close(nvsHandle);
+    }
+    installedCrc = crc;
+}
+
+
+static void saveInstalledCrc(uint32_t crc) {
+    nvs_handle nvsHandle;
+    esp_err_t err_code = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvsHandle);
+    if (err_code == ESP_OK) {
+        err_code = nvs_set_u32(nvsHandle, NVS_KEY_CRC, crc);
+        if (err_code == ESP_OK) {
+            err_code = nvs_commit(nvsHandle);
+        }
+        nvs_close(nvsHandle);
+    }
+    if (err_code != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "saveInstalledCrc(): failed, err_code=0x%x", err_code);
+    }
+    installedCrc = crc;
+}
+
+
+//-------------------------------------
+// SPI link to the AVR.
+//-------------------------------------
+static void selectAvr(bool isSelected) {
+    gpio_set_level(PIN_NUM_CS, isSelected ? 0 : 1);
+}
+
+
+static esp_err_t sendFrame(const uint8_t *frame, size_t length) {
+    spi_transaction_t transaction;
+    std::memset(&transaction, 0, sizeof(transaction));
+    transaction.length = length * 8;
+    transaction.tx_buffer = frame;
+
+    selectAvr(true);
+    esp_err_t err_code = spi_device_transmit(avrDevice, &transaction);
+    selectAvr(false);
+    return err_code;
+}
+
+
+// One transaction per byte: the AVR loads each reply byte in its SPI ISR,
+// which has to run between two bytes.
+static bool readStatus(uint8_t *status) {
+    spi_transaction_t transaction;
+    std::memset(&transaction, 0, sizeof(transaction));
+    transaction.flags = SPI_TRANS_USE_TXDATA | SPI_TRANS_USE_RXDATA;
+    transaction.length = 8;
+    transaction.tx_data[0] = BOOT_COMMAND_STATUS;
+
+    bool isOk = true;
+    selectAvr(true);
+    for (int index = -1; index < BOOT_STATUS_LENGTH && isOk; ++index) {
+        isOk = spi_device_transmit(avrDevice, &transaction) == ESP_OK;
+        if (index >= 0) {
+            status[index] = transaction.rx_data[0];
+        }
+        transaction.tx_data[0] = 0;
+    }
+    selectAvr(false);
+    return isOk && status[BOOT_STATUS_SIGNATURE] == BOOT_SIGNATURE;
+}
+
+
+static uint16_t nextAddress(const uint8_t *status) {
+    return status[BOOT_STATUS_NEXT_LO] | (status[BOOT_STATUS_NEXT_HI] << 8);
+}
+
+
+static esp_err_t sendPage(const OtaItem &page) {
+    frameBuffer[0] = BOOT_COMMAND_PAGE;
+    frameBuffer[1] = page.address & 0xFF;
+    frameBuffer[2] = page.address >> 8;
+    std::memcpy(frameBuffer + 3, page.data, BOOT_PAGE_SIZE);
+    uint16_t crc = crc16(frameBuffer + 1, 2 + BOOT_PAGE_SIZE);
+    frameBuffer[3 + BOOT_PAGE_SIZE] = crc & 0xFF;
+    frameBuffer[4 + BOOT_PAGE_SIZE] = crc >> 8;
+
+    esp_err_t err_code = sendFrame(frameBuffer, BOOT_PAGE_FRAME_LENGTH);
+    int64_t doneUs = esp_timer_get_time() + PAGE_GAP_US;
+    while (esp_timer_get_time() < doneUs) {
+    }
+    return err_code;
+}
+
+
+static void sendRun() {
+    frameBuffer[0] = BOOT_COMMAND_RUN;
+    sendFrame(frameBuffer, 1);
+}
+
+
+static esp_err_t initializeMaster() {
+    gpio_config_t gpioConfig = {
+        GPIO_SEL_CS_PIN,        //uint64_t pin_bit_mask
+        GPIO_MODE_OUTPUT,       //gpio_mode_t mode
+        GPIO_PULLUP_DISABLE,    //gpio_pullup_t pull_up_en
+        GPIO_PULLDOWN_DISABLE,  //gpio_pulldown_t pull_down_en
+        GPIO_INTR_DISABLE       //gpio_int_type_t intr_type
+    };
+    gpio_config(&gpioConfig);
+    selectAvr(false);
+
+    spi_bus_config_t busConfig;
+    std::memset(&busConfig, 0, sizeof(busConfig));
+    busConfig.mosi_io_num = PIN_NUM_MOSI;
+    busConfig.miso_io_num = PIN_NUM_MISO;
+    busConfig.sclk_io_num = PIN_NUM_CLK;
+    busConfig.quadwp_io_num = -1;
+    busConfig.quadhd_io_num = -1;
+    busConfig.max_transfer_sz = BOOT_PAGE_FRAME_LENGTH;
+    esp_err_t err_code = spi_bus_initialize(HSPI_HOST, &busConfig, SPI_DMA_CHANNEL);
+    if (err_code != ESP_OK) {
+        return err_code;
+    }
+
+    // Mode 0, MSB first, as spi_init_slave() sets up the AVR.
+    spi_device_interface_config_t deviceConfig;
+    std::memset(&deviceConfig, 0, sizeof(deviceConfig));
+    deviceConfig.mode = 0;
+    deviceConfig.clock_speed_hz = SPI_CLOCK_HZ;
+    deviceConfig.spics_io_num = -1;
+    deviceConfig.queue_size = 1;
+    return spi_bus_add_device(HSPI_HOST, &deviceConfig, &avrDevice);
+}
+
+
+//-------------------------------------
+// Update, in the OTA task.
+//-------------------------------------
+static bool formatError(char *error, const char *text, unsigned value = 0) {
+    std::snprintf(error, OTA_ERROR_CAPACITY, text, value);
+    return false;
+}
+
+
+// The application resets into the bootloader. A bootloader left half way
+// through an earlier image is reset to start again.
+static bool enterBootloader(char *error) {
+    const uint8_t bootFrame[] = { REG_BOOT, 1, REG_BOOT_ENTER };
+    uint8_t status[BOOT_STATUS_LENGTH];
+    bool isRunSent = false;
+
+    std::memcpy(frameBuffer, bootFrame, sizeof(bootFrame));
+    sendFrame(frameBuffer, sizeof(bootFrame));
+    vTaskDelay(BOOT_RESET_DELAY);
+
+    TickType_t startTicks = xTaskGetTickCount();
+    while (xTaskGetTickCount() - startTicks < BOOT_ANSWER_TIMEOUT) {
+        if (readStatus(status)) {
+            if (status[BOOT_STATUS_STATE] == BOOT_STATE_RECEIVING && nextAddress(status) == 0) {
+                return true;
+            }
+            if (!isRunSent) {
+                sendRun();
+                isRunSent = true;
+                vTaskDelay(BOOT_RESET_DELAY);
+                continue;
+            }
+        }
+        vTaskDelay(VERIFY_POLL_DELAY);
+    }
+    return formatError(error, "no answer from the bootloader");
+}
+
+
+// The page at address: one kept from before, or the next from the queue.
+// Returns nullptr if it is gone, or a new image has started.
+static const OtaItem *pageAt(uint32_t address, uint32_t &takenEnd, char *error) {
+    OtaItem &slot = sentPages[(address / BOOT_PAGE_SIZE) % OTA_RESEND_PAGES];
+    if (address < takenEnd) {
+        if (slot.address != address || takenEnd - address > OTA_RESEND_PAGES * BOOT_PAGE_SIZE) {
+            formatError(error, "page 0x%04x no longer held for a resend", address);
+            return nullptr;
+        }
+        return &slot;
+    }
+
+    if (xQueueReceive(itemQueue, &receivedItem, PAGE_RECEIVE_TIMEOUT) != pdTRUE) {
+        formatError(error, "timed out waiting for page 0x%04x from MQTT", address);
+        return nullptr;
+    }
+    if (receivedItem.kind == OTA_ITEM_START) {
+        isStartPending = true;
+        formatError(error, "replaced by a newer image");
+        return nullptr;
+    }
+    slot = receivedItem;
+    takenEnd = address + BOOT_PAGE_SIZE;
+    return &slot;
+}
+
+
+// Streams the pages, keeping both of the bootloader's page buffers full.
+static bool sendImage(uint32_t length, unsigned &resendCount, char *error) {
+    const uint32_t pagesEnd = (length + BOOT_PAGE_SIZE - 1) & ~static_cast<uint32_t>(BOOT_PAGE_SIZE - 1);
+    uint8_t status[BOOT_STATUS_LENGTH];
+    uint32_t sentEnd = 0;
+    uint32_t takenEnd = 0;
+    uint32_t lastNext = 0;
+    TickType_t progressTicks = xTaskGetTickCount();
+
+    while (1) {
+        if (!readStatus(status)) {
+            return formatError(error, "the bootloader stopped answering");
+        }
+        uint32_t next = nextAddress(status);
+        if (next >= pagesEnd) {
+            return true;
+        }
+        if (next != lastNext) {
+            lastNext = next;
+            progressTicks = xTaskGetTickCount();
+        } else if (xTaskGetTickCount() - progressTicks > PROGRESS_TIMEOUT) {
+            return formatError(error, "no progress, bootloader error %u", status[BOOT_STATUS_ERROR]);
+        }
+        if (next < sentEnd) {
+            // Rejected, most likely a bad CRC. Go back.
+            ++resendCount;
+            sentEnd = next;
+        }
+
+        if (status[BOOT_STATUS_FREE_BUFFERS] > 0 && sentEnd < pagesEnd) {
+            const OtaItem *page = pageAt(sentEnd, takenEnd, error);
+            if (!page) {
+                return false;
+            }
+            sendPage(*page);
+            sentEnd += BOOT_PAGE_SIZE;
+        } else {
+            vTaskDelay(1);
+        }
+    }
+}
+
+
+static bool finishImage(uint32_t length, uint32_t crc, char *error) {
+    uint8_t status[BOOT_STATUS_LENGTH];
+
+    frameBuffer[0] = BOOT_COMMAND_FINISH;
+    writeLe32(frameBuffer + 1, length);
+    writeLe32(frameBuffer + 5, crc);
+    sendFrame(frameBuffer, BOOT_FINISH_FRAME_LENGTH);
+
+    TickType_t startTicks = xTaskGetTickCount();
+    do {
+        vTaskDelay(VERIFY_POLL_DELAY);
+        if (!readStatus(status)) {
+            return formatError(error, "the bootloader stopped answering");
+        }
+        if (status[BOOT_STATUS_STATE] == BOOT_STATE_DONE) {
+            return true;
+        }
+        if (status[BOOT_STATUS_STATE] == BOOT_STATE_FAILED) {
+            return formatError(error, "CRC mismatch reading the image back");
+        }
+    } while (xTaskGetTickCount() - startTicks < VERIFY_TIMEOUT);
+    return formatError(error, "finish not taken, bootloader error %u", status[BOOT_STATUS_ERROR]);
+}
+
+
+static void update(const OtaItem &start) {
+    char error[OTA_ERROR_CAPACITY] = "";
+    unsigned resendCount = 0;
+    int64_t startUs = esp_timer_get_time();
+
+    ESP_LOGI(LOG_TAG, "Updating the AVR: %u bytes, CRC %08x.", start.length, start.crc);
+    bool isOk = enterBootloader(error)
+             && sendImage(start.length, resendCount, error)
+             && finishImage(start.length, start.crc, error);
+    // Into the new application, or back into the bootloader to wait for another try.
+    sendRun();
+
+    unsigned elapsedMs = static_cast<unsigned>((esp_timer_get_time() - startUs) / 1000);
+    if (isOk) {
+        saveInstalledCrc(start.crc);
+        ESP_LOGI(LOG_TAG, "AVR updated in %u ms, %u page(s) resent.", elapsedMs, resendCount);
+        publishStatus("updated", start.crc, nullptr);
+    } else {
+        ESP_LOGE(LOG_TAG, "AVR update failed after %u ms: %s.", elapsedMs, error);
+        publishStatus(nullptr, start.crc, error);
+    }
+}
+
+
+static void app_avr_ota_task_callback(void *parameters) {
+    while(1) {
+        if (!isStartPending) {
+            // Pages left over from an abandoned image are dropped here.
+            if (xQueueReceive(itemQueue, &receivedItem, portMAX_DELAY) != pdTRUE
+                    || receivedItem.kind != OTA_ITEM_START) {
+                continue;
+            }
+        }
+        isStartPending = false;
+        OtaItem start = receivedItem;
+        update(start);
+    }
+}
+
+
+//-------------------------------------
+// Receive, in the MQTT task.
+//-------------------------------------
+static bool sendItem(const OtaItem &item) {
+    if (xQueueSend(itemQueue, &item, PAGE_SEND_TIMEOUT) != pdTRUE) {
+        ESP_LOGE(LOG_TAG, "The update task is not taking pages, rest of the image dropped!");
+        receiver.isTaking = false;
+        return false;
+    }
+    return true;
+}
+
+
+static esp_err_t startImage(size_t totalLength) {
+    uint32_t length = readLe32(receiver.header + 4);
+    uint32_t crc = readLe32(receiver.header + 8);
+    char error[OTA_ERROR_CAPACITY] = "";
+
+    receiver.isTaking = false;
+    if (std::memcmp(receiver.header, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0) {
+        formatError(error, "not an AVR image");
+    } else if (length == 0 || length > APP_AVR_OTA_MAX_IMAGE_LENGTH) {
+        formatError(error, "image length %u out of range", length);
+    } else if (APP_AVR_OTA_HEADER_LENGTH + length != totalLength) {
+        formatError(error, "message length does not match the header");
+    } else if (crc == installedCrc) {
+        ESP_LOGI(LOG_TAG, "AVR image %08x is already installed.", crc);
+        publishStatus("unchanged", crc, nullptr);
+        return ESP_OK;
+    }
+    if (error[0]) {
+        ESP_LOGE(LOG_TAG, "AVR image rejected: %s.", error);
+        publishStatus(nullptr, crc, error);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    OtaItem &start = receiver.page;
+    start.kind = OTA_ITEM_START;
+    start.length = length;
+    start.crc = crc;
+    receiver.imageLength = length;
+    receiver.imageOffset = 0;
+    receiver.isTaking = sendItem(start);
+    return receiver.isTaking ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+
+//-------------------------------------
+// C wrappers.
+//-------------------------------------
+void app_avr_ota_init(void) {
+    uint8_t mac[6] = {};
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    std::snprintf(statusTopic, sizeof(statusTopic), "%s" OTA_STATUS_INFIX "%02x%02x%02x%02x%02x%02x",
+        CONFIG_APP_AVR_OTA_TOPIC, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    loadInstalledCrc();
+
+    esp_err_t err_code = initializeMaster();
+    if (err_code != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "app_avr_ota_init(): SPI master failed, err_code=0x%x. AVR images are ignored.", err_code);
+        return;
+    }
+
+    itemQueue = xQueueCreateStatic(OTA_QUEUE_LENGTH, sizeof(OtaItem), itemQueueStorage, &itemQueueBuffer);
+    configASSERT(itemQueue);
+
+    TaskHandle_t taskHandle = NULL;
+    BaseType_t result = xTaskCreatePinnedToCore(
+        app_avr_ota_task_callback,
+        OTA_TASK_NAME,
+        OTA_TASK_STACK_DEPTH,
+        NULL,                   //constpvParameters
+        OTA_TASK_PRIORITY,      //uxPriority
+        &taskHandle,            //constpvCreatedTask
+        tskNO_AFFINITY          //xCoreID
+    );
+    if (result == pdPASS) {
+        app_stack_register(taskHandle, OTA_TASK_NAME, OTA_TASK_STACK_DEPTH);
+    } else {
+        ESP_LOGE(LOG_TAG, "app_avr_ota_init(): xTaskCreatePinnedToCore(...) failed! AVR images are ignored.");
+        vQueueDelete(itemQueue);
+        itemQueue = NULL;
+    }
+
+    ESP_LOGI(LOG_TAG, "AVR images on %s, installed CRC %08x.", CONFIG_APP_AVR_OTA_TOPIC, installedCrc);
+}
+
+
+esp_err_t app_avr_ota_receive(const char *data, size_t dataLength, size_t offset, size_t totalLength) {
+    if (!itemQueue) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (offset == 0) {
+        receiver.isTaking = true;
+        receiver.imageLength = 0;
+    }
+    esp_err_t err_code = ESP_OK;
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+    size_t index = 0;
+
+    // The header may be split over two events.
+    while (receiver.isTaking && index < dataLength && offset + index < APP_AVR_OTA_HEADER_LENGTH) {
+        receiver.header[offset + index] = bytes[index];
+        if (offset + ++index == APP_AVR_OTA_HEADER_LENGTH) {
+            err_code = startImage(totalLength);
+        }
+    }
+
+    // Then whole pages, the last one padded as erased flash.
+    OtaItem &page = receiver.page;
+    while (receiver.isTaking && index < dataLength) {
+        uint32_t pageOffset = receiver.imageOffset % BOOT_PAGE_SIZE;
+        size_t count = std::min<size_t>(BOOT_PAGE_SIZE - pageOffset, dataLength - index);
+        std::memcpy(page.data + pageOffset, bytes + index, count);
+        index += count;
+        receiver.imageOffset += count;
+
+        bool isLast = receiver.imageOffset == receiver.imageLength;
+        if (pageOffset + count == BOOT_PAGE_SIZE || isLast) {
+            std::memset(page.data + pageOffset + count, 0xFF, BOOT_PAGE_SIZE - pageOffset - count);
+            page.kind = OTA_ITEM_PAGE;
+            page.address = static_cast<uint16_t>((receiver.imageOffset - 1) & ~static_cast<uint32_t>(BOOT_PAGE_SIZE - 1));
+            if (!sendItem(page)) {
+                err_code = ESP_ERR_TIMEOUT;
+            }
+        }
+        if (isLast) {
+            receiver.isTaking = false;
+        }
+    }
+    return err_code;
+}
+
+#endif // CONFIG_APP_AVR_OTA
@@ -0,0 +1,68 @@
+/*  app_avr_ota.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+#ifndef _APP_AVR_OTA_H_
+#define _APP_AVR_OTA_H_
+
+#include <stddef.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+
+//------------------------------------------------------------------------------
+// Over-the-air update of the AVR peripheral (avr_spi_master).
+//
+// Every device subscribes to CONFIG_APP_AVR_OTA_TOPIC, so one publish
+// updates the fleet. The message is a header and the image, little endian:
+//   0  'A' 'V' 'R' '1'
+//   4  image length (uint32), at most APP_AVR_OTA_MAX_IMAGE_LENGTH
+//   8  image CRC-32 (uint32, as zlib's crc32())
+//   12 the image (spi_master.bin)
+// tools/avr_ota_image.py writes it.
+//
+// The MQTT task cuts the image into flash pages as it arrives and hands
+// them to the "App AVR OTA" task through a short queue, waiting when it is
+// full. That task talks to avr_spi_master/spi_bootloader.c over its own SPI
+// bus with the ESP32 as master, and keeps the last pages for resends.
+// An image whose CRC matches the last one installed is skipped, so the
+// message can be retained. The outcome is published to
+// "<topic>/status/<Wi-Fi station MAC>".
+//
+// Enabled with CONFIG_APP_AVR_OTA.
+//------------------------------------------------------------------------------
+#define APP_AVR_OTA_HEADER_LENGTH       12
+#define APP_AVR_OTA_MAX_IMAGE_LENGTH    (16384 - 2048)  // ATmega168 flash, less the boot section.
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if CONFIG_APP_AVR_OTA
+
+// C wrappers.
+// Boot stage, after NVS and the queues.
+extern void app_avr_ota_init(void);
+// Called from the MQTT task with each part of a message on CONFIG_APP_AVR_OTA_TOPIC.
+extern esp_err_t app_avr_ota_receive(const char *data, size_t dataLength, size_t offset, size_t totalLength);
+
+#else
+
+static inline void app_avr_ota_init(void) { }
+
+#endif // CONFIG_APP_AVR_OTA
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // _APP_AVR_OTA_H_
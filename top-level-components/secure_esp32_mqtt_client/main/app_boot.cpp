@@ -0,0 +1,97 @@
+/*  app_boot.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/task.h"
+
+#include "app_boot.h"
+#include "app_heap_stats.h"
+#include "app_stack_monitor.h"
+
+
+static const char *LOG_TAG = "APP_BOOT";
+
+static const UBaseType_t APP_BOOT_TASK_PRIORITY = 5;
+
+static EventGroupHandle_t bootEventGroup = nullptr;
+
+
+static void app_boot_stage_task_callback( void * parameters ) {
+    const app_boot_stage_t *stage = static_cast<const app_boot_stage_t *>(parameters);
+    app_stack_register(NULL, stage->name, stage->stackDepth);
+
+    int64_t waitStartUs = esp_timer_get_time();
+    if (stage->dependsOn) {
+        xEventGroupWaitBits(bootEventGroup, stage->dependsOn, pdFALSE, pdTRUE, portMAX_DELAY);
+    }
+
+    // The heap guard is armed once the local stages are done, while the
+    // network stages may still be waiting. Whatever a stage allocates is init.
+    int64_t runStartUs = esp_timer_get_time();
+    app_heap_reinit_begin();
+    stage->run();
+    app_heap_reinit_end();
+    int64_t doneUs = esp_timer_get_time();
+
+    ESP_LOGI(LOG_TAG, "Stage '%s' done %lld ms after boot (waited %lld ms, ran %lld ms).",
+        stage->name, static_cast<long long>(doneUs / 1000),
+        static_cast<long long>((runStartUs - waitStartUs) / 1000), static_cast<long long>((doneUs - runStartUs) / 1000));
+    xEventGroupSetBits(bootEventGroup, stage->doneBit);
+
+    app_stack_task_exiting();
+    vTaskDelete(NULL);
+}
+
+
+esp_err_t app_boot_run(const app_boot_stage_t *stages, unsigned stageCount) {
+    esp_err_t err_code = ESP_OK;
+
+    if (!bootEventGroup) {
+        bootEventGroup = xEventGroupCreate();
+        configASSERT(bootEventGroup);
+    }
+
+    for (unsigned index = 0; index < stageCount; ++index) {
+        const app_boot_stage_t *stage = &stages[index];
+        BaseType_t result = xTaskCreatePinnedToCore(
+            app_boot_stage_task_callback,
+            stage->name,
+            stage->stackDepth,
+            const_cast<app_boot_stage_t *>(stage), //constpvParameters
+            APP_BOOT_TASK_PRIORITY,                //uxPriority
+            NULL,                                  //constpvCreatedTask
+            tskNO_AFFINITY                         //xCoreID
+        );
+
+        if (result != pdPASS) {
+            err_code = ESP_ERR_NO_MEM;
+            ESP_LOGE(LOG_TAG, "app_boot_run(...): xTaskCreatePinnedToCore(%s) failed!", stage->name);
+            ESP_ERROR_CHECK(err_code);
+        }
+    }
+
+    return err_code;
+}
+
+
+void app_boot_wait(EventBits_t bits, const char *name) {
+    configASSERT(bootEventGroup);
+    xEventGroupWaitBits(bootEventGroup, bits, pdFALSE, pdTRUE, portMAX_DELAY);
+    app_boot_milestone(name);
+}
+
+
+void app_boot_milestone(const char *name) {
+    ESP_LOGI(LOG_TAG, "*** %s %lld ms after boot. ***", name, static_cast<long long>(esp_timer_get_time() / 1000));
+}
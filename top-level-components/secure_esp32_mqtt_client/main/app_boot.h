@@ -0,0 +1,52 @@
+/*  app_boot.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+#ifndef _APP_BOOT_H_
+#define _APP_BOOT_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+
+//------------------------------------------------------------------------------
+// One step of the boot sequence.
+//
+// Every stage runs in its own short lived task as soon as all the stages named
+// in dependsOn have finished, so slow stages (e.g. waiting for Wi-Fi) never
+// hold up the ones that don't need them.
+typedef struct {
+    const char *name;
+    EventBits_t doneBit;    // Set when run() returns. One bit per stage.
+    EventBits_t dependsOn;  // doneBits that must all be set before run() is called.
+    void (*run)(void);
+    uint32_t stackDepth;
+} app_boot_stage_t;
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Starts every stage of the table. The table must outlive the boot sequence.
+extern esp_err_t app_boot_run(const app_boot_stage_t *stages, unsigned stageCount);
+// Blocks until all of bits are set, then logs the time since boot under name.
+extern void app_boot_wait(EventBits_t bits, const char *name);
+// Logs the time since boot under name.
+extern void app_boot_milestone(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // _APP_BOOT_H_
@@ -0,0 +1,154 @@
+/*  app_deferred_log.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include "app_deferred_log.h"
+
+#if CONFIG_APP_DEFERRED_LOG
+#include <cstdio>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "app_stack_monitor.h"
+
+
+static const char *LOG_TAG = "APP_DLOG";
+
+static const char       *APP_DLOG_TASK_NAME = "App DLog";
+static const uint32_t    APP_DLOG_STACK_DEPTH = 2048;
+static const UBaseType_t APP_DLOG_TASK_PRIORITY = 1;
+static const TickType_t  APP_DLOG_DRAIN_PERIOD = 50 / portTICK_PERIOD_MS;
+
+// Record layout, in 32-bit words: format address, timestamp (us), argument count, arguments.
+static const uint32_t HEADER_WORDS = 3;
+// Must be a power of 2.
+static const uint32_t RING_WORDS = 1024;
+static const uint32_t RING_MASK = RING_WORDS - 1;
+
+
+// One ring per core. Producers on a core are serialized by masking interrupts
+// on that core only, so there is exactly one writer and one reader (the drain
+// task) per ring and no lock is shared between the cores.
+struct DeferredLogRing {
+    uint32_t words[RING_WORDS];
+    volatile uint32_t head;     // Free running. Written by the producing core.
+    volatile uint32_t tail;     // Free running. Written by the drain task.
+    volatile uint32_t dropped;  // Records lost to a full ring.
+};
+
+static DeferredLogRing rings[portNUM_PROCESSORS];
+
+
+void IRAM_ATTR app_dlog_write(const char *fmt, unsigned argCount, const uint32_t *args) {
+    uint32_t timestampUs = static_cast<uint32_t>(esp_timer_get_time());
+    if (argCount > APP_DLOG_MAX_ARGS) {
+        argCount = APP_DLOG_MAX_ARGS;
+    }
+    uint32_t recordWords = HEADER_WORDS + argCount;
+
+    unsigned state = portENTER_CRITICAL_NESTED();
+    DeferredLogRing &ring = rings[xPortGetCoreID()];
+    uint32_t head = ring.head;
+
+    if (RING_WORDS - (head - ring.tail) < recordWords) {
+        ring.dropped = ring.dropped + 1;
+    } else {
+        ring.words[head++ & RING_MASK] = reinterpret_cast<uintptr_t>(fmt);
+        ring.words[head++ & RING_MASK] = timestampUs;
+        ring.words[head++ & RING_MASK] = argCount;
+        for (unsigned index = 0; index < argCount; ++index) {
+            ring.words[head++ & RING_MASK] = args[index];
+        }
+        // The record must be visible to the other core before the new head is.
+        __sync_synchronize();
+        ring.head = head;
+    }
+
+    portEXIT_CRITICAL_NESTED(state);
+}
+
+
+// Prints every complete record of one ring as "#DL:<core>:<hex words>".
+static unsigned drainRing(unsigned core) {
+    DeferredLogRing &ring = rings[core];
+    uint32_t tail = ring.tail;
+    uint32_t head = ring.head;
+    __sync_synchronize();
+
+    unsigned recordCount = 0;
+    while (tail != head) {
+        uint32_t recordWords = HEADER_WORDS + ring.words[(tail + 2) & RING_MASK];
+        std::printf("#DL:%u:", core);
+        for (uint32_t index = 0; index < recordWords; ++index) {
+            std::printf("%08x", ring.words[(tail + index) & RING_MASK]);
+        }
+        std::printf("\n");
+        tail += recordWords;
+        ++recordCount;
+    }
+
+    __sync_synchronize();
+    ring.tail = tail;
+    return recordCount;
+}
+
+
+static void app_dlog_task_callback( void * parameters ) {
+    uint32_t reportedDropped[portNUM_PROCESSORS] = {};
+
+    while(1) {
+        for (unsigned core = 0; core < portNUM_PROCESSORS; ++core) {
+            drainRing(core);
+
+            uint32_t dropped = rings[core].dropped;
+            if (dropped != reportedDropped[core]) {
+                ESP_LOGW(LOG_TAG, "core %u: %u record(s) dropped, ring full.", core, dropped - reportedDropped[core]);
+                reportedDropped[core] = dropped;
+            }
+        }
+        vTaskDelay(APP_DLOG_DRAIN_PERIOD);
+    }//while(1)
+
+    vTaskDelete(NULL);
+}
+
+
+esp_err_t app_dlog_init(void) {
+    esp_err_t err_code = ESP_OK;
+    TaskHandle_t taskHandle = NULL;
+
+    BaseType_t result = xTaskCreatePinnedToCore(
+        app_dlog_task_callback,
+        APP_DLOG_TASK_NAME,
+        APP_DLOG_STACK_DEPTH,
+        NULL,                   //constpvParameters
+        APP_DLOG_TASK_PRIORITY, //uxPriority
+        &taskHandle,            //constpvCreatedTask
+        tskNO_AFFINITY          //xCoreID
+    );
+
+    if (result == pdPASS) {
+        app_stack_register(taskHandle, APP_DLOG_TASK_NAME, APP_DLOG_STACK_DEPTH);
+    } else {
+        err_code = ESP_ERR_NO_MEM;
+        ESP_LOGE(LOG_TAG, "app_dlog_init(): xTaskCreatePinnedToCore(...) failed!");
+    }
+    return err_code;
+}
+
+#else
+
+esp_err_t app_dlog_init(void) {
+    return ESP_OK;
+}
+
+#endif // CONFIG_APP_DEFERRED_LOG
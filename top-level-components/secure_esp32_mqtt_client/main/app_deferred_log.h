@@ -0,0 +1,83 @@
+/*  app_deferred_log.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+#ifndef _APP_DEFERRED_LOG_H_
+#define _APP_DEFERRED_LOG_H_
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+
+//------------------------------------------------------------------------------
+// Deferred binary logging for hot paths.
+//
+//   APP_DLOG("processMqttNode(): %u bytes, result=%d", size, result);
+//
+// Nothing is formatted on the device. The record holds the address of the
+// format string, a microsecond timestamp and up to 6 raw 32-bit arguments,
+// and goes into a ring owned by the calling core. A low priority task prints
+// the records as "#DL:" hex lines and tools/dlog_decode.py uses the ELF file
+// to turn them back into text.
+//
+// The format must be a string literal. Arguments are truncated to 32 bits,
+// and %s only works for string literals (the decoder reads them from the ELF).
+//------------------------------------------------------------------------------
+#define APP_DLOG_MAX_ARGS 6
+
+#if CONFIG_APP_DEFERRED_LOG
+
+#define APP_DLOG_ARG(x) ((uint32_t)(uintptr_t)(x))
+
+#define _APP_DLOG_NTH(_0, _1, _2, _3, _4, _5, _6, N, ...) N
+#define _APP_DLOG_COUNT(...) _APP_DLOG_NTH(_0, ##__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+#define _APP_DLOG_CAT(a, b) _APP_DLOG_CAT_(a, b)
+#define _APP_DLOG_CAT_(a, b) a##b
+
+#define _APP_DLOG_ARGS0()
+#define _APP_DLOG_ARGS1(a)                 , APP_DLOG_ARG(a)
+#define _APP_DLOG_ARGS2(a, b)              , APP_DLOG_ARG(a), APP_DLOG_ARG(b)
+#define _APP_DLOG_ARGS3(a, b, c)           _APP_DLOG_ARGS2(a, b), APP_DLOG_ARG(c)
+#define _APP_DLOG_ARGS4(a, b, c, d)        _APP_DLOG_ARGS3(a, b, c), APP_DLOG_ARG(d)
+#define _APP_DLOG_ARGS5(a, b, c, d, e)     _APP_DLOG_ARGS4(a, b, c, d), APP_DLOG_ARG(e)
+#define _APP_DLOG_ARGS6(a, b, c, d, e, f)  _APP_DLOG_ARGS5(a, b, c, d, e), APP_DLOG_ARG(f)
+
+#define APP_DLOG(fmt, ...) do { \
+        const uint32_t _appDlogArgs[] = { 0 _APP_DLOG_CAT(_APP_DLOG_ARGS, _APP_DLOG_COUNT(__VA_ARGS__))(__VA_ARGS__) }; \
+        app_dlog_write(fmt, _APP_DLOG_COUNT(__VA_ARGS__), _appDlogArgs + 1); \
+    } while (0)
+
+#else
+
+#define APP_DLOG(fmt, ...) do { } while (0)
+
+#endif // CONFIG_APP_DEFERRED_LOG
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if CONFIG_APP_DEFERRED_LOG
+// Appends one record to the ring of the calling core. Safe from tasks and ISRs.
+// Drops the record, and counts it, if the ring is full.
+extern void app_dlog_write(const char *fmt, unsigned argCount, const uint32_t *args);
+#endif
+
+// C wrapper. Starts the task that prints the records. A no-op when disabled.
+extern esp_err_t app_dlog_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // _APP_DEFERRED_LOG_H_
@@ -0,0 +1,54 @@
+/*  app_duplicate_filter.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include "esp_log.h"
+
+#include "app_duplicate_filter.h"
+#include "app_hash.h"
+
+
+static const char *LOG_TAG = "APP_DUP_FILTER";
+
+
+bool DuplicateFilter::isDuplicate(int msg_id, const char *topic, size_t topicSize, int64_t nowUs) {
+    if (msg_id <= 0) {
+        return false;
+    }
+
+    uint32_t topicHash = fnv1a(topic, topicSize);
+    uint16_t nowSeconds = static_cast<uint16_t>(nowUs / (1000 * 1000));
+    const uint16_t windowSeconds = static_cast<uint16_t>(WINDOW_US / (1000 * 1000));
+
+    for (unsigned index = 0; index < usedCount; ++index) {
+        const HistoryEntry &entry = history[index];
+        // uint16_t subtraction keeps the age correct when the seconds wrap.
+        uint16_t ageSeconds = static_cast<uint16_t>(nowSeconds - entry.seenSeconds);
+        if (entry.msg_id == static_cast<uint16_t>(msg_id) &&
+            entry.topicHash == topicHash &&
+            ageSeconds <= windowSeconds)
+        {
+            ++suppressedCount;
+            ESP_LOGD(LOG_TAG, "isDuplicate(...): redelivery of msg_id=%d suppressed (%u so far).",
+                msg_id, suppressedCount);
+            return true;
+        }
+    }
+
+    HistoryEntry &entry = history[nextIndex];
+    entry.topicHash = topicHash;
+    entry.msg_id = static_cast<uint16_t>(msg_id);
+    entry.seenSeconds = nowSeconds;
+    nextIndex = (nextIndex + 1) % HISTORY_SIZE;
+    if (usedCount < HISTORY_SIZE) {
+        ++usedCount;
+    }
+    return false;
+}
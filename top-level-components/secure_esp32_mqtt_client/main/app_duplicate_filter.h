@@ -0,0 +1,58 @@
+/*  app_duplicate_filter.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+#ifndef _APP_DUPLICATE_FILTER_H_
+#define _APP_DUPLICATE_FILTER_H_
+
+
+//-------------------
+#ifdef __cplusplus
+#include <stddef.h>
+#include <stdint.h>
+
+
+//------------------------------------------------------------------------------
+// Drops QoS1 messages that the broker sends again (e.g. after a reconnect).
+//
+// Remembers the (msg_id, topic hash) of the last HISTORY_SIZE messages that
+// had a msg_id. A message that matches one of them within the time window is
+// a redelivery. QoS0 messages have no msg_id and are never filtered.
+// 8 bytes per entry. Only used from the MQTT task, so it is not locked.
+class DuplicateFilter {
+public:
+    static const unsigned HISTORY_SIZE = 32;
+    static const int64_t WINDOW_US = 30LL * 1000 * 1000;
+
+    DuplicateFilter() = default;
+    virtual ~DuplicateFilter() { }
+
+    // Records the message and returns true if it was already seen.
+    bool isDuplicate(int msg_id, const char *topic, size_t topicSize, int64_t nowUs);
+
+    uint32_t getSuppressedCount() const { return suppressedCount; }
+
+private:
+    struct HistoryEntry {
+        uint32_t topicHash;
+        uint16_t msg_id;
+        uint16_t seenSeconds; // Low 16 bits of the time seen, in seconds.
+    };
+
+    HistoryEntry history[HISTORY_SIZE] = {};
+    unsigned nextIndex = 0;
+    unsigned usedCount = 0;
+    uint32_t suppressedCount = 0;
+};
+
+#endif //__cplusplus
+//-------------------
+
+
+#endif // _APP_DUPLICATE_FILTER_H_
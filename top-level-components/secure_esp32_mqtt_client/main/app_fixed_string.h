@@ -0,0 +1,148 @@
+/*  app_fixed_string.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+#ifndef _APP_FIXED_STRING_H_
+#define _APP_FIXED_STRING_H_
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+
+//-------------------
+#ifdef __cplusplus
+
+//------------------------------------------------------------------------------
+// A pointer and a length. Does not own the characters and is not null terminated.
+class StringView {
+public:
+    StringView() : ptr(""), length(0) { }
+    StringView(const char *str) : ptr(str ? str : ""), length(str ? strlen(str) : 0) { }
+    StringView(const char *str, size_t length) : ptr(str ? str : ""), length(str ? length : 0) { }
+
+    const char * data() const { return ptr; }
+    size_t size() const       { return length; }
+    bool empty() const        { return length == 0; }
+    char operator[](size_t index) const { return ptr[index]; }
+
+    bool equals(StringView other) const {
+        return length == other.length && memcmp(ptr, other.ptr, length) == 0;
+    }
+
+    bool startsWith(StringView prefix) const {
+        return length >= prefix.length && memcmp(ptr, prefix.ptr, prefix.length) == 0;
+    }
+
+    // Everything from start on.
+    StringView substr(size_t start) const {
+        return (start >= length) ? StringView(ptr + length, 0) : StringView(ptr + start, length - start);
+    }
+
+private:
+    const char *ptr;
+    size_t length;
+};
+
+
+//------------------------------------------------------------------------------
+// A null terminated string held in place, with room for Capacity characters.
+// Never allocates. Whatever does not fit is dropped and truncated() stays
+// true until the next clear() or assign().
+//
+// Trivially copyable, so it can be copied through a FreeRTOS queue.
+template<size_t Capacity>
+class FixedString {
+public:
+    static_assert(Capacity > 0 && Capacity < 0xFFFF, "Capacity MUST fit in 16 bits.");
+
+    FixedString() { clear(); }
+    explicit FixedString(StringView str) { assign(str); }
+
+    static size_t capacity() { return Capacity; }
+
+    const char * data() const  { return buffer; }
+    const char * c_str() const { return buffer; }
+    size_t size() const        { return length; }
+    bool empty() const         { return length == 0; }
+    bool full() const          { return length == Capacity; }
+    bool truncated() const     { return isTruncated; }
+    char operator[](size_t index) const { return buffer[index]; }
+    StringView view() const    { return StringView(buffer, length); }
+    operator StringView() const { return view(); }
+
+    void clear() {
+        length = 0;
+        isTruncated = false;
+        buffer[0] = '\0';
+    }
+
+    // Returns false if str was truncated.
+    bool assign(StringView str) {
+        clear();
+        return append(str);
+    }
+
+    bool append(char ch) {
+        if (length == Capacity) {
+            isTruncated = true;
+            return false;
+        }
+        buffer[length++] = ch;
+        buffer[length] = '\0';
+        return true;
+    }
+
+    bool append(StringView str) {
+        size_t count = str.size();
+        if (count > Capacity - length) {
+            count = Capacity - length;
+            isTruncated = true;
+        }
+        memcpy(buffer + length, str.data(), count);
+        length += static_cast<uint16_t>(count);
+        buffer[length] = '\0';
+        return count == str.size();
+    }
+
+    // snprintf onto the end. Returns false if the output was truncated.
+    __attribute__((format(printf, 2, 3)))
+    bool appendFormat(const char *format, ...) {
+        va_list args;
+        va_start(args, format);
+        int written = vsnprintf(buffer + length, Capacity + 1 - length, format, args);
+        va_end(args);
+
+        if (written < 0) {
+            buffer[length] = '\0';
+            isTruncated = true;
+            return false;
+        }
+        if (static_cast<size_t>(written) > Capacity - length) {
+            length = static_cast<uint16_t>(Capacity);
+            isTruncated = true;
+            return false;
+        }
+        length += static_cast<uint16_t>(written);
+        return true;
+    }
+
+private:
+    char buffer[Capacity + 1];
+    uint16_t length;
+    bool isTruncated;
+};
+
+#endif //__cplusplus
+//-------------------
+
+
+#endif // _APP_FIXED_STRING_H_
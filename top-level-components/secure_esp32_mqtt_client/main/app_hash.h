@@ -0,0 +1,45 @@
+/*  app_hash.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+#ifndef _APP_HASH_H_
+#define _APP_HASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+//-------------------
+#ifdef __cplusplus
+
+//------------------------------------------------------------------------------
+// 32 bit FNV-1a.
+// The runtime and compile time versions MUST return the same values.
+static const uint32_t FNV1A_OFFSET_BASIS = 2166136261u;
+static const uint32_t FNV1A_PRIME = 16777619u;
+
+inline uint32_t fnv1a(const char *str, size_t length, uint32_t hash = FNV1A_OFFSET_BASIS) {
+    for (size_t index = 0; index < length; ++index) {
+        hash = (hash ^ static_cast<uint8_t>(str[index])) * FNV1A_PRIME;
+    }
+    return hash;
+}
+
+// C++11 constexpr functions are limited to a single return statement, hence the recursion.
+constexpr uint32_t fnv1aConst(const char *str, size_t length, uint32_t hash = FNV1A_OFFSET_BASIS) {
+    return length == 0
+        ? hash
+        : fnv1aConst(str + 1, length - 1, (hash ^ static_cast<uint8_t>(str[0])) * FNV1A_PRIME);
+}
+
+#endif //__cplusplus
+//-------------------
+
+
+#endif // _APP_HASH_H_
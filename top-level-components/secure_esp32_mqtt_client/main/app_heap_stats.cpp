@@ -0,0 +1,424 @@
+/*  app_heap_stats.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include "app_heap_stats.h"
+
+#if CONFIG_APP_HEAP_ACCOUNTING
+#include <cstddef>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include "esp_log.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+
+static const char *LOG_TAG = "APP_HEAP_STATS";
+
+// Every counted block starts with this header, so a free knows what to take
+// off which subsystem. The union keeps the caller's pointer fully aligned.
+union AllocHeader {
+    struct {
+        uint32_t size;
+        uint8_t subsystem;
+    } info;
+    std::max_align_t align;
+};
+
+// The counters are updated from every task on both cores.
+static portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+static app_heap_stats_t stats[APP_HEAP_SUBSYSTEM_COUNT];
+
+static bool isInitDone = false;
+static uint32_t freeHeapAtInit = 0;
+static uint32_t bytesInUseAtInit = 0;
+
+// The subsystem each task is working for, if not APP_HEAP_OTHER. Keyed by
+// task handle rather than thread local storage, as global constructors
+// allocate before the scheduler has started; they all share the NULL entry.
+#define MAX_TAGGED_TASKS 16
+
+struct TaskSubsystem {
+    TaskHandle_t task;
+    uint8_t subsystem;
+};
+
+static TaskSubsystem taskSubsystems[MAX_TAGGED_TASKS];
+static unsigned taskSubsystemCount = 0;
+
+// The tasks inside app_heap_reinit_begin()/app_heap_reinit_end(), and how deep.
+#define MAX_REINIT_TASKS 8
+
+struct ReinitTask {
+    TaskHandle_t task;
+    unsigned depth;
+};
+
+static ReinitTask reinitTasks[MAX_REINIT_TASKS];
+static unsigned reinitTaskCount = 0;
+
+static const char *SUBSYSTEM_NAMES[APP_HEAP_SUBSYSTEM_COUNT] = {
+    "other",
+    "mqtt",
+    "spi",
+    "uart",
+    "publisher",
+};
+
+
+// Called with statsMux held.
+static int findTask(TaskHandle_t task) {
+    for (unsigned index = 0; index < taskSubsystemCount; ++index) {
+        if (taskSubsystems[index].task == task) {
+            return static_cast<int>(index);
+        }
+    }
+    return -1;
+}
+
+
+// Called with statsMux held.
+static uint8_t currentSubsystem() {
+    int index = findTask(xTaskGetCurrentTaskHandle());
+    return (index < 0) ? static_cast<uint8_t>(APP_HEAP_OTHER) : taskSubsystems[index].subsystem;
+}
+
+
+// Called with statsMux held.
+static int findReinitTask(TaskHandle_t task) {
+    for (unsigned index = 0; index < reinitTaskCount; ++index) {
+        if (reinitTasks[index].task == task) {
+            return static_cast<int>(index);
+        }
+    }
+    return -1;
+}
+
+
+// Called with statsMux held.
+static uint32_t totalBytesInUse() {
+    uint32_t bytes = 0;
+    for (unsigned subsystem = 0; subsystem < APP_HEAP_SUBSYSTEM_COUNT; ++subsystem) {
+        bytes += stats[subsystem].bytesInUse;
+    }
+    return bytes;
+}
+
+
+// Reports an allocation made after app_heap_mark_init_done().
+// Called without statsMux held, as logging may block.
+static void lateAllocation(uint8_t subsystem, size_t size, const void *caller) {
+#if CONFIG_APP_HEAP_GUARD_ABORT
+    ESP_LOGE(LOG_TAG, "%s: %u byte allocation after init from %p!", SUBSYSTEM_NAMES[subsystem], static_cast<unsigned>(size), caller);
+    abort();
+#elif CONFIG_APP_HEAP_GUARD_LOG
+    ESP_LOGW(LOG_TAG, "%s: %u byte allocation after init from %p.", SUBSYSTEM_NAMES[subsystem], static_cast<unsigned>(size), caller);
+#endif
+}
+
+
+static void *countedMalloc(size_t size, uint32_t caps, const void *caller) {
+    AllocHeader *header = static_cast<AllocHeader *>(heap_caps_malloc(sizeof(AllocHeader) + size, caps));
+
+    uint8_t subsystem;
+    bool isLate;
+    portENTER_CRITICAL(&statsMux);
+    subsystem = currentSubsystem();
+    app_heap_stats_t &subsystemStats = stats[subsystem];
+    isLate = isInitDone && findReinitTask(xTaskGetCurrentTaskHandle()) < 0;
+    if (!header) {
+        ++subsystemStats.failedCount;
+    } else {
+        ++subsystemStats.allocCount;
+        subsystemStats.bytesInUse += size;
+        subsystemStats.totalBytes += size;
+        if (subsystemStats.bytesInUse > subsystemStats.peakBytes) {
+            subsystemStats.peakBytes = subsystemStats.bytesInUse;
+        }
+    }
+    if (isLate) {
+        ++subsystemStats.lateCount;
+    }
+    portEXIT_CRITICAL(&statsMux);
+
+    if (isLate) {
+        lateAllocation(subsystem, size, caller);
+    }
+    if (!header) {
+        return nullptr;
+    }
+
+    header->info.size = static_cast<uint32_t>(size);
+    header->info.subsystem = subsystem;
+    return header + 1;
+}
+
+
+static void countedFree(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    // Charged to the subsystem that made the allocation, whoever frees it.
+    AllocHeader *header = static_cast<AllocHeader *>(ptr) - 1;
+    portENTER_CRITICAL(&statsMux);
+    app_heap_stats_t &subsystemStats = stats[header->info.subsystem];
+    ++subsystemStats.freeCount;
+    subsystemStats.bytesInUse -= header->info.size;
+    portEXIT_CRITICAL(&statsMux);
+
+    free(header);
+}
+
+
+//-------------------------------------
+// C++ allocations.
+//-------------------------------------
+// Exceptions are disabled, so a failed new aborts as the toolchain's own does.
+static void *countedNew(size_t size, const void *caller) {
+    void *ptr = countedMalloc(size, MALLOC_CAP_DEFAULT, caller);
+    if (!ptr) {
+        ESP_LOGE(LOG_TAG, "operator new: %u bytes failed!", static_cast<unsigned>(size));
+        abort();
+    }
+    return ptr;
+}
+
+void *operator new(size_t size) {
+    return countedNew(size, __builtin_return_address(0));
+}
+
+void *operator new[](size_t size) {
+    return countedNew(size, __builtin_return_address(0));
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    return countedMalloc(size, MALLOC_CAP_DEFAULT, __builtin_return_address(0));
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return countedMalloc(size, MALLOC_CAP_DEFAULT, __builtin_return_address(0));
+}
+
+void operator delete(void *ptr) noexcept {
+    countedFree(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    countedFree(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+    countedFree(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+    countedFree(ptr);
+}
+
+#if __cpp_sized_deallocation
+void operator delete(void *ptr, size_t) noexcept {
+    countedFree(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+    countedFree(ptr);
+}
+#endif
+
+
+//-------------------------------------
+// C wrappers.
+//-------------------------------------
+app_heap_subsystem_t app_heap_enter(app_heap_subsystem_t subsystem) {
+    if (subsystem < 0 || subsystem >= APP_HEAP_SUBSYSTEM_COUNT) {
+        subsystem = APP_HEAP_OTHER;
+    }
+
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    app_heap_subsystem_t previous = APP_HEAP_OTHER;
+    bool isTableFull = false;
+
+    portENTER_CRITICAL(&statsMux);
+    int index = findTask(task);
+    if (index >= 0) {
+        previous = static_cast<app_heap_subsystem_t>(taskSubsystems[index].subsystem);
+        if (subsystem == APP_HEAP_OTHER) {
+            taskSubsystems[index] = taskSubsystems[--taskSubsystemCount];
+        } else {
+            taskSubsystems[index].subsystem = static_cast<uint8_t>(subsystem);
+        }
+    } else if (subsystem != APP_HEAP_OTHER) {
+        if (taskSubsystemCount < MAX_TAGGED_TASKS) {
+            taskSubsystems[taskSubsystemCount].task = task;
+            taskSubsystems[taskSubsystemCount].subsystem = static_cast<uint8_t>(subsystem);
+            ++taskSubsystemCount;
+        } else {
+            isTableFull = true;
+        }
+    }
+    portEXIT_CRITICAL(&statsMux);
+
+    if (isTableFull) {
+        ESP_LOGW(LOG_TAG, "app_heap_enter(%s): more than %d tagged tasks, charged to other.",
+            SUBSYSTEM_NAMES[subsystem], MAX_TAGGED_TASKS);
+    }
+    return previous;
+}
+
+
+void app_heap_leave(app_heap_subsystem_t previous) {
+    app_heap_enter(previous);
+}
+
+
+void *app_heap_malloc(size_t size, uint32_t caps) {
+    return countedMalloc(size, caps, __builtin_return_address(0));
+}
+
+
+void app_heap_free(void *ptr) {
+    countedFree(ptr);
+}
+
+
+// The free heap and our share of it, to explain later changes against.
+static void takeBaseline(const char *caller) {
+    uint32_t freeHeap = esp_get_free_heap_size();
+    uint32_t bytesInUse;
+
+    portENTER_CRITICAL(&statsMux);
+    freeHeapAtInit = freeHeap;
+    bytesInUseAtInit = bytesInUse = totalBytesInUse();
+    portEXIT_CRITICAL(&statsMux);
+
+    ESP_LOGI(LOG_TAG, "%s: %u bytes in use by our components, %u bytes free.", caller, bytesInUse, freeHeap);
+}
+
+
+void app_heap_mark_init_done(void) {
+    portENTER_CRITICAL(&statsMux);
+    isInitDone = true;
+    portEXIT_CRITICAL(&statsMux);
+
+    takeBaseline("app_heap_mark_init_done()");
+}
+
+
+void app_heap_reinit_begin(void) {
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    bool isTableFull = false;
+
+    portENTER_CRITICAL(&statsMux);
+    int index = findReinitTask(task);
+    if (index >= 0) {
+        ++reinitTasks[index].depth;
+    } else if (reinitTaskCount < MAX_REINIT_TASKS) {
+        reinitTasks[reinitTaskCount].task = task;
+        reinitTasks[reinitTaskCount].depth = 1;
+        ++reinitTaskCount;
+    } else {
+        isTableFull = true;
+    }
+    portEXIT_CRITICAL(&statsMux);
+
+    if (isTableFull) {
+        ESP_LOGW(LOG_TAG, "app_heap_reinit_begin(): more than %d tasks, allocations still count as late.",
+            MAX_REINIT_TASKS);
+    }
+}
+
+
+void app_heap_reinit_end(void) {
+    bool isLastEnded = false;
+
+    portENTER_CRITICAL(&statsMux);
+    int index = findReinitTask(xTaskGetCurrentTaskHandle());
+    if (index >= 0 && --reinitTasks[index].depth == 0) {
+        reinitTasks[index] = reinitTasks[--reinitTaskCount];
+        isLastEnded = isInitDone && reinitTaskCount == 0;
+    }
+    portEXIT_CRITICAL(&statsMux);
+
+    if (isLastEnded) {
+        takeBaseline("app_heap_reinit_end()");
+    }
+}
+
+
+const char *app_heap_subsystem_name(app_heap_subsystem_t subsystem) {
+    if (subsystem < 0 || subsystem >= APP_HEAP_SUBSYSTEM_COUNT) {
+        return "unknown";
+    }
+    return SUBSYSTEM_NAMES[subsystem];
+}
+
+
+esp_err_t app_heap_get_stats(app_heap_subsystem_t subsystem, app_heap_stats_t *subsystemStats) {
+    if (subsystem < 0 || subsystem >= APP_HEAP_SUBSYSTEM_COUNT || !subsystemStats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&statsMux);
+    *subsystemStats = stats[subsystem];
+    portEXIT_CRITICAL(&statsMux);
+    return ESP_OK;
+}
+
+
+int app_heap_format_stats(char *buffer, size_t bufferSize) {
+    int length = 0;
+    const char *separator = "{";
+
+    for (unsigned subsystem = 0; subsystem < APP_HEAP_SUBSYSTEM_COUNT; ++subsystem) {
+        app_heap_stats_t subsystemStats;
+        app_heap_get_stats(static_cast<app_heap_subsystem_t>(subsystem), &subsystemStats);
+
+        // Past a truncation, buffer + length would point outside the buffer.
+        size_t used = std::min(static_cast<size_t>(length), bufferSize);
+        int written = std::snprintf(
+            buffer + used, bufferSize - used,
+            "%s\"%s\":{\"allocs\":%u,\"frees\":%u,\"failed\":%u,\"late\":%u,\"inUse\":%u,\"peak\":%u,\"total\":%llu}",
+            separator, SUBSYSTEM_NAMES[subsystem],
+            subsystemStats.allocCount, subsystemStats.freeCount, subsystemStats.failedCount, subsystemStats.lateCount,
+            subsystemStats.bytesInUse, subsystemStats.peakBytes, static_cast<unsigned long long>(subsystemStats.totalBytes)
+        );
+        if (written < 0) {
+            return written;
+        }
+        length += written;
+        separator = ",";
+    }
+
+    // Whatever the free heap lost since init that our counters do not account
+    // for was taken by ESP-MQTT, Wi-Fi, lwIP or the rest of ESP-IDF.
+    uint32_t freeHeap = esp_get_free_heap_size();
+    int32_t untrackedBytes = 0;
+    portENTER_CRITICAL(&statsMux);
+    if (isInitDone) {
+        int32_t heapDelta = static_cast<int32_t>(freeHeapAtInit - freeHeap);
+        int32_t trackedDelta = static_cast<int32_t>(totalBytesInUse() - bytesInUseAtInit);
+        untrackedBytes = heapDelta - trackedDelta;
+    }
+    portEXIT_CRITICAL(&statsMux);
+
+    size_t used = std::min(static_cast<size_t>(length), bufferSize);
+    int written = std::snprintf(
+        buffer + used, bufferSize - used,
+        ",\"heap\":{\"free\":%u,\"minFree\":%u,\"untrackedSinceInit\":%d}}",
+        freeHeap, esp_get_minimum_free_heap_size(), untrackedBytes
+    );
+    return (written < 0) ? written : length + written;
+}
+
+#endif // CONFIG_APP_HEAP_ACCOUNTING
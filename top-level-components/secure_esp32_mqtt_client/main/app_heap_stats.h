@@ -0,0 +1,134 @@
+/*  app_heap_stats.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+#ifndef _APP_HEAP_STATS_H_
+#define _APP_HEAP_STATS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+
+
+//------------------------------------------------------------------------------
+// Heap use of our own components, per subsystem.
+//
+// Every C++ new/delete, and every app_heap_malloc()/app_heap_free(), is
+// charged to the subsystem the calling task is working for. A task names its
+// subsystem with app_heap_enter() (or AppHeapScope in C++), anything else is
+// charged to APP_HEAP_OTHER. ESP-MQTT, Wi-Fi and lwIP allocate with malloc()
+// directly and are not counted; app_heap_format_stats() reports their share
+// as the change in free heap that the counters do not explain.
+//
+// Once app_heap_mark_init_done() has been called, every counted allocation is
+// a steady state allocation. Depending on CONFIG_APP_HEAP_GUARD_* it is only
+// counted, also logged with the caller's address (decode it with
+// xtensa-esp32-elf-addr2line), or it aborts so the panic handler prints the
+// whole backtrace.
+//
+// Enabled with CONFIG_APP_HEAP_ACCOUNTING. When it is disabled nothing is
+// counted, app_heap_malloc() is heap_caps_malloc() and new/delete are the
+// toolchain's own.
+//------------------------------------------------------------------------------
+typedef enum {
+    APP_HEAP_OTHER = 0,     // Not claimed by any subsystem.
+    APP_HEAP_MQTT,          // MQTT ingest, topic cache.
+    APP_HEAP_SPI,           // SPI link to the peripheral.
+    APP_HEAP_UART,          // UART ingest.
+    APP_HEAP_PUBLISHER,     // Publisher, scheduler and outbox.
+    APP_HEAP_SUBSYSTEM_COUNT
+} app_heap_subsystem_t;
+
+typedef struct {
+    uint32_t allocCount;
+    uint32_t freeCount;
+    uint32_t failedCount;   // Allocations that returned NULL.
+    uint32_t lateCount;     // Allocations after app_heap_mark_init_done().
+    uint32_t bytesInUse;    // Requested bytes, not counting heap overhead.
+    uint32_t peakBytes;
+    uint64_t totalBytes;    // Every byte ever allocated.
+} app_heap_stats_t;
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if CONFIG_APP_HEAP_ACCOUNTING
+
+// C wrappers.
+// Charges the calling task's allocations to subsystem until app_heap_leave().
+// Returns the subsystem to hand back to app_heap_leave().
+extern app_heap_subsystem_t app_heap_enter(app_heap_subsystem_t subsystem);
+extern void app_heap_leave(app_heap_subsystem_t previous);
+
+// heap_caps_malloc()/free() with accounting. Only free memory from
+// app_heap_malloc() with app_heap_free().
+extern void *app_heap_malloc(size_t size, uint32_t caps);
+extern void app_heap_free(void *ptr);
+
+// From here on every counted allocation is a steady state allocation.
+extern void app_heap_mark_init_done(void);
+// Brackets init work that may run after app_heap_mark_init_done(): the boot
+// stages that wait for the network and deliberate rebuilds (see
+// app_runtime_config.h). Only the calling task's allocations are exempt, so
+// the rest of the pipeline stays guarded. Brackets may nest; the baseline is
+// taken again once the last one in any task ends.
+extern void app_heap_reinit_begin(void);
+extern void app_heap_reinit_end(void);
+
+extern const char *app_heap_subsystem_name(app_heap_subsystem_t subsystem);
+extern esp_err_t app_heap_get_stats(app_heap_subsystem_t subsystem, app_heap_stats_t *stats);
+// Writes the counters of every subsystem and the heap totals as JSON.
+// Returns the length written, as snprintf() does.
+extern int app_heap_format_stats(char *buffer, size_t bufferSize);
+
+#else
+
+static inline app_heap_subsystem_t app_heap_enter(app_heap_subsystem_t subsystem) { (void)subsystem; return APP_HEAP_OTHER; }
+static inline void app_heap_leave(app_heap_subsystem_t previous) { (void)previous; }
+static inline void *app_heap_malloc(size_t size, uint32_t caps) { return heap_caps_malloc(size, caps); }
+static inline void app_heap_free(void *ptr) { free(ptr); }
+static inline void app_heap_mark_init_done(void) { }
+static inline void app_heap_reinit_begin(void) { }
+static inline void app_heap_reinit_end(void) { }
+
+#endif // CONFIG_APP_HEAP_ACCOUNTING
+
+#ifdef __cplusplus
+}
+#endif
+
+
+//-------------------
+#ifdef __cplusplus
+
+// Charges the calling task's allocations to subsystem while in scope.
+class AppHeapScope {
+public:
+    explicit AppHeapScope(app_heap_subsystem_t subsystem) : previous(app_heap_enter(subsystem)) { }
+    ~AppHeapScope() { app_heap_leave(previous); }
+
+    AppHeapScope(const AppHeapScope&) = delete;
+    AppHeapScope& operator=(const AppHeapScope&) = delete;
+
+private:
+    app_heap_subsystem_t previous;
+};
+
+#endif //__cplusplus
+//-------------------
+
+
+#endif // _APP_HEAP_STATS_H_
@@ -0,0 +1,151 @@
+/*  app_latency_trace.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include "app_latency_trace.h"
+
+#if CONFIG_APP_LATENCY_TRACE
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "freertos/FreeRTOS.h"
+
+
+// Written by the SPI task and read by the publisher task, which run on different cores.
+static portMUX_TYPE histogramsMux = portMUX_INITIALIZER_UNLOCKED;
+static app_latency_histogram_t histograms[APP_LATENCY_STAGE_COUNT];
+
+static const char *STAGE_NAMES[APP_LATENCY_STAGE_COUNT] = {
+    "dispatch",
+    "queue",
+    "spi_setup",
+    "spi_transfer",
+    "total",
+};
+
+
+static unsigned bucketOf(uint32_t us) {
+    unsigned bucket = 0;
+    while (us > 1 && bucket < APP_LATENCY_BUCKET_COUNT - 1) {
+        us >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+
+// Called with histogramsMux held.
+static void addSample(app_latency_histogram_t &histogram, int64_t fromUs, int64_t toUs) {
+    int64_t deltaUs = toUs - fromUs;
+    uint32_t us = (deltaUs <= 0) ? 0 : (deltaUs > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(deltaUs));
+
+    ++histogram.count;
+    histogram.totalUs += us;
+    if (us > histogram.maxUs) {
+        histogram.maxUs = us;
+    }
+    ++histogram.buckets[bucketOf(us)];
+}
+
+
+// Upper edge of the bucket holding the given percentile, capped at the maximum seen.
+static uint32_t percentileUs(const app_latency_histogram_t &histogram, unsigned percent) {
+    if (histogram.count == 0) {
+        return 0;
+    }
+
+    uint64_t target = (static_cast<uint64_t>(histogram.count) * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (unsigned bucket = 0; bucket < APP_LATENCY_BUCKET_COUNT; ++bucket) {
+        seen += histogram.buckets[bucket];
+        if (seen >= target) {
+            uint32_t upperUs = 1UL << (bucket + 1);
+            return (upperUs < histogram.maxUs) ? upperUs : histogram.maxUs;
+        }
+    }
+    return histogram.maxUs;
+}
+
+
+void app_latency_record(const LatencyStamps &stamps) {
+    if (!stamps.mqttDataUs || !stamps.enqueueUs || !stamps.dequeueUs || !stamps.spiQueuedUs || !stamps.spiDoneUs) {
+        return;
+    }
+
+    portENTER_CRITICAL(&histogramsMux);
+    addSample(histograms[APP_LATENCY_STAGE_DISPATCH],     stamps.mqttDataUs,  stamps.enqueueUs);
+    addSample(histograms[APP_LATENCY_STAGE_QUEUE],        stamps.enqueueUs,   stamps.dequeueUs);
+    addSample(histograms[APP_LATENCY_STAGE_SPI_SETUP],    stamps.dequeueUs,   stamps.spiQueuedUs);
+    addSample(histograms[APP_LATENCY_STAGE_SPI_TRANSFER], stamps.spiQueuedUs, stamps.spiDoneUs);
+    addSample(histograms[APP_LATENCY_STAGE_TOTAL],        stamps.mqttDataUs,  stamps.spiDoneUs);
+    portEXIT_CRITICAL(&histogramsMux);
+}
+
+
+//-------------------------------------
+// C wrappers.
+//-------------------------------------
+const char *app_latency_stage_name(app_latency_stage_t stage) {
+    if (stage < 0 || stage >= APP_LATENCY_STAGE_COUNT) {
+        return "unknown";
+    }
+    return STAGE_NAMES[stage];
+}
+
+
+esp_err_t app_latency_get_histogram(app_latency_stage_t stage, app_latency_histogram_t *histogram) {
+    if (stage < 0 || stage >= APP_LATENCY_STAGE_COUNT || !histogram) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&histogramsMux);
+    *histogram = histograms[stage];
+    portEXIT_CRITICAL(&histogramsMux);
+    return ESP_OK;
+}
+
+
+void app_latency_reset(void) {
+    portENTER_CRITICAL(&histogramsMux);
+    std::memset(histograms, 0, sizeof(histograms));
+    portEXIT_CRITICAL(&histogramsMux);
+}
+
+
+int app_latency_format_stats(char *buffer, size_t bufferSize) {
+    int length = 0;
+    const char *separator = "{";
+
+    for (unsigned stage = 0; stage < APP_LATENCY_STAGE_COUNT; ++stage) {
+        app_latency_histogram_t histogram;
+        app_latency_get_histogram(static_cast<app_latency_stage_t>(stage), &histogram);
+        uint32_t meanUs = histogram.count ? static_cast<uint32_t>(histogram.totalUs / histogram.count) : 0;
+
+        // Past a truncation, buffer + length would point outside the buffer.
+        size_t used = std::min(static_cast<size_t>(length), bufferSize);
+        int written = std::snprintf(
+            buffer + used, bufferSize - used,
+            "%s\"%s\":{\"n\":%u,\"mean\":%u,\"p50\":%u,\"p99\":%u,\"max\":%u}",
+            separator, STAGE_NAMES[stage],
+            histogram.count, meanUs, percentileUs(histogram, 50), percentileUs(histogram, 99), histogram.maxUs
+        );
+        if (written < 0) {
+            return written;
+        }
+        length += written;
+        separator = ",";
+    }
+
+    size_t used = std::min(static_cast<size_t>(length), bufferSize);
+    int written = std::snprintf(buffer + used, bufferSize - used, "}");
+    return (written < 0) ? written : length + written;
+}
+
+#endif // CONFIG_APP_LATENCY_TRACE
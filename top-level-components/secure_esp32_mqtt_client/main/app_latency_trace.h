@@ -0,0 +1,100 @@
+/*  app_latency_trace.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+#ifndef _APP_LATENCY_TRACE_H_
+#define _APP_LATENCY_TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+
+//------------------------------------------------------------------------------
+// End-to-end latency of a message from MQTT_EVENT_DATA to the SPI master
+// picking it up, split into stages.
+//
+// Enabled with CONFIG_APP_LATENCY_TRACE. When it is disabled the stamps are
+// not stored anywhere and the macros below compile to nothing.
+//------------------------------------------------------------------------------
+#if CONFIG_APP_LATENCY_TRACE
+#include "esp_timer.h"
+#define APP_LATENCY_STAMP(stamps, field)    ((stamps).field = esp_timer_get_time())
+#define APP_LATENCY_COPY(dst, src, field)   ((dst).field = (src).field)
+#else
+#define APP_LATENCY_STAMP(stamps, field)    ((void)0)
+#define APP_LATENCY_COPY(dst, src, field)   ((void)0)
+#endif
+
+
+typedef enum {
+    APP_LATENCY_STAGE_DISPATCH = 0, // MQTT_EVENT_DATA to mqttReceivedQueue.
+    APP_LATENCY_STAGE_QUEUE,        // Waiting in mqttReceivedQueue.
+    APP_LATENCY_STAGE_SPI_SETUP,    // Dequeued to spi_slave_queue_trans().
+    APP_LATENCY_STAGE_SPI_TRANSFER, // Queued to collected by the SPI master.
+    APP_LATENCY_STAGE_TOTAL,        // MQTT_EVENT_DATA to collected by the SPI master.
+    APP_LATENCY_STAGE_COUNT
+} app_latency_stage_t;
+
+// Bucket n counts latencies in [2^n, 2^(n+1)) microseconds, bucket 0 also
+// counts 0 and the last bucket counts everything above about half a second.
+#define APP_LATENCY_BUCKET_COUNT 20
+
+typedef struct {
+    uint32_t count;
+    uint32_t maxUs;
+    uint64_t totalUs;
+    uint32_t buckets[APP_LATENCY_BUCKET_COUNT];
+} app_latency_histogram_t;
+
+
+//-------------------
+#ifdef __cplusplus
+
+// esp_timer timestamps of one message, in microseconds. Zero means not stamped.
+struct LatencyStamps {
+    int64_t mqttDataUs;
+    int64_t enqueueUs;
+    int64_t dequeueUs;
+    int64_t spiQueuedUs;
+    int64_t spiDoneUs;
+};
+
+#if CONFIG_APP_LATENCY_TRACE
+// Adds a fully stamped message to the histograms. Partial stamps are ignored.
+extern void app_latency_record(const LatencyStamps &stamps);
+#endif
+
+#endif //__cplusplus
+//-------------------
+
+
+#if CONFIG_APP_LATENCY_TRACE
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// C wrappers.
+extern const char *app_latency_stage_name(app_latency_stage_t stage);
+// Copies the histogram of one stage, collected since the last reset.
+extern esp_err_t app_latency_get_histogram(app_latency_stage_t stage, app_latency_histogram_t *histogram);
+extern void app_latency_reset(void);
+// Writes count, mean, p50, p99 and max of every stage as JSON.
+// Returns the length written, as snprintf() does.
+extern int app_latency_format_stats(char *buffer, size_t bufferSize);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // CONFIG_APP_LATENCY_TRACE
+
+
+#endif // _APP_LATENCY_TRACE_H_
@@ -22,9 +22,18 @@
 #include "esp_log.h"
 #include "mqtt_client.h"
 
+#include "app_actuator_state.h"
+#include "app_avr_ota.h"
+#include "app_boot.h"
+#include "app_deferred_log.h"
+#include "app_heap_stats.h"
 #include "app_mqtt.h"
+#include "app_pipeline.h"
+#include "app_publisher.h"
 #include "app_queues.h"
+#include "app_runtime_config.h"
 #include "app_spi.h"
+#include "app_stack_monitor.h"
 #include "uart_echo.h"
 
 
@@ -120,10 +129,16 @@ extern const uint8_t client_key_pem_end[] asm("_binary_client_key_end");
 
 
 static void app_mqtt_start(void) {
+    // ESP-MQTT creates its own task; its core is set in menuconfig.
+    const app_stage_config_t *ingest = app_pipeline_get(APP_STAGE_MQTT_INGEST);
     const esp_mqtt_client_config_t mqtt_cfg = {
         .event_handle = app_mqtt_event_handler,
         .uri = CONFIG_MQTT_BROKER_URL,
         .user_context = get_static_app_mqtt(),
+        // Keep the session on the broker so that a reconnect doesn't need to resubscribe.
+        .disable_clean_session = 1,
+        .task_prio = ingest->priority,
+        .task_stack = ingest->stackDepth,
         //.cert_pem = NULL,
         .client_cert_pem = (const char *)client_cert_pem_start,
         .client_key_pem = (const char *)client_key_pem_start,
@@ -131,10 +146,65 @@ static void app_mqtt_start(void) {
 
     ESP_LOGI(LOG_TAG, "[APP] Free memory: %d bytes", esp_get_free_heap_size());
     esp_mqtt_client_handle_t client = esp_mqtt_client_init(&mqtt_cfg);
+    app_publisher_set_client(client);
+    app_mqtt_connect_started();
     esp_mqtt_client_start(client);
 }
 
 
+static void app_nvs_init(void) {
+    nvs_flash_init();
+}
+
+
+static void app_spi_start(void) {
+    app_spi_init();
+}
+
+
+static void app_publisher_start(void) {
+    app_publisher_init();
+}
+
+
+//-------------------------------------
+// Boot stages.
+//-------------------------------------
+// The link to the peripheral comes up straight away. The network stages run
+// in the background and MQTT starts as soon as Wi-Fi has an IP address.
+#define BOOT_NVS        BIT0
+#define BOOT_QUEUES     BIT1
+#define BOOT_SPI        BIT2
+#define BOOT_PUBLISHER  BIT3
+#define BOOT_UART       BIT4
+#define BOOT_WIFI       BIT5
+#define BOOT_SNTP       BIT6
+#define BOOT_MQTT       BIT7
+#define BOOT_ACTUATORS  BIT8
+#define BOOT_CONFIG     BIT9
+#define BOOT_AVR_OTA    BIT10
+
+// Everything the peripheral needs to talk to us, with or without the cloud.
+#define BOOT_LOCAL_READY (BOOT_QUEUES | BOOT_SPI | BOOT_PUBLISHER | BOOT_UART)
+
+static const app_boot_stage_t BOOT_STAGES[] = {
+    //name         doneBit         dependsOn                                    run                      stackDepth
+    { "nvs",       BOOT_NVS,       0,                                           app_nvs_init,            3072 },
+    { "config",    BOOT_CONFIG,    BOOT_NVS,                                    app_runtime_config_init, 3072 },
+    // The queues, the SPI pool and the poll delays are sized from the loaded configuration.
+    { "queues",    BOOT_QUEUES,    BOOT_CONFIG,                                 app_queues_init,         2048 },
+    { "actuators", BOOT_ACTUATORS, BOOT_NVS,                                    app_actuator_state_init, 3072 },
+    { "spi",       BOOT_SPI,       BOOT_QUEUES | BOOT_ACTUATORS,                app_spi_start,           3072 },
+    { "publisher", BOOT_PUBLISHER, BOOT_QUEUES,                                 app_publisher_start,     3072 },
+    { "uart",      BOOT_UART,      BOOT_QUEUES,                                 uart_echo_init,          3072 },
+    { "avr ota",   BOOT_AVR_OTA,   BOOT_NVS | BOOT_QUEUES,                      app_avr_ota_init,        3072 },
+    { "wifi",      BOOT_WIFI,      BOOT_NVS,                                    wifi_init,               4096 },
+    { "sntp",      BOOT_SNTP,      BOOT_WIFI,                                   sntp_set_time,           4096 },
+    // An image may be waiting, retained, on the first connect.
+    { "mqtt",      BOOT_MQTT,      BOOT_WIFI | BOOT_PUBLISHER | BOOT_ACTUATORS | BOOT_AVR_OTA, app_mqtt_start, 4096 },
+};
+
+
 void app_main() {
     ESP_LOGI(LOG_TAG, "[APP] Startup..");
     ESP_LOGI(LOG_TAG, "[APP] Free memory: %d bytes", esp_get_free_heap_size());
@@ -147,12 +217,19 @@ void app_main() {
     esp_log_level_set("TRANSPORT", ESP_LOG_VERBOSE);
     esp_log_level_set("OUTBOX", ESP_LOG_VERBOSE);
 
-    nvs_flash_init();
-    wifi_init();
-    sntp_set_time();
+    app_dlog_init();
+    app_pipeline_log();
+    app_boot_run(BOOT_STAGES, sizeof(BOOT_STAGES) / sizeof(BOOT_STAGES[0]));
 
-    app_queues_init();
-    app_mqtt_start();
-    uart_echo_init();
-    app_spi_init();
+    // Time-to-cloud-ready is logged by AppMQTT on the first broker connect.
+    app_boot_wait(BOOT_LOCAL_READY, "Local ready");
+
+#if CONFIG_APP_STACK_STRESS
+    app_stack_stress_run();
+#endif
+
+    // The pipeline should run without allocating from here on. Wi-Fi, SNTP
+    // and MQTT may take much longer, or never finish, so they are not waited
+    // for; app_boot runs every stage inside app_heap_reinit_begin()/end().
+    app_heap_mark_init_done();
 }
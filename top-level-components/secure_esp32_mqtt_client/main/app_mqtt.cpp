@@ -13,15 +13,53 @@
 #include "freertos/queue.h"
 //#include "freertos/task.h"
 #include "esp_log.h"
-
+#include "esp_system.h"
+#include "esp_timer.h"
+
+#include "app_actuator_state.h"
+#include "app_avr_ota.h"
+#include "app_boot.h"
+#include "app_deferred_log.h"
+#include "app_heap_stats.h"
+#include "app_stack_monitor.h"
 #include "app_mqtt.h"
+#include "app_pipeline.h"
+#include "app_publisher.h"
 #include "app_queues.h"
+#include "app_runtime_config.h"
 
 
 static const char *LOG_TAG = "APP_MQTT";
+
+
+//-------------------------------------
+// Subscriptions.
+//-------------------------------------
+// Everything the device listens to. All of them are (re)subscribed on every connect.
+static const MqttSubscription SUBSCRIPTION_TABLE[] = {
+    //topicFilter           qos
+    { "irrigation/zone/on", 0 },
+#if CONFIG_APP_RUNTIME_CONFIG
+    // Filled in by app_runtime_config_init(), before the first connect.
+    { app_runtime_config_topic(), 1 },
+#endif
+#if CONFIG_APP_AVR_OTA
+    { CONFIG_APP_AVR_OTA_TOPIC, 1 },
+#endif
+};
+
+static const unsigned NUM_SUBSCRIPTIONS = sizeof(SUBSCRIPTION_TABLE) / sizeof(SUBSCRIPTION_TABLE[0]);
+
+
 static AppMQTT static_app_mqtt;
 
 
+AppMQTT::AppMQTT()
+    : subscriptions(SUBSCRIPTION_TABLE, NUM_SUBSCRIPTIONS)
+{
+}
+
+
 //-------------------------------------
 // MQTT Events.
 //-------------------------------------
@@ -55,7 +93,7 @@ esp_err_t AppMQTT::eventHandler(esp_mqtt_event_handle_t event) {
             err_code = published(event);
             break;
         case MQTT_EVENT_DATA:
-            ESP_LOGV(LOG_TAG, "MQTT_EVENT_DATA");
+            APP_DLOG("MQTT_EVENT_DATA: msg_id=%d, offset=%d, data_len=%d", event->msg_id, event->current_data_offset, event->data_len);
             //ESP_LOGV(LOG_TAG, "LEN=%d, TOPIC=%s", event->topic_len, event->topic);
             //ESP_LOGV(LOG_TAG, "LEN=%d, DATA=%s", event->data_len, event->data);
             err_code = dataReceived(event);
@@ -70,13 +108,42 @@ esp_err_t AppMQTT::eventHandler(esp_mqtt_event_handle_t event) {
 }
 
 
+void AppMQTT::connectStarted() {
+    connectStartUs = esp_timer_get_time();
+}
+
+
+void AppMQTT::reconnectScheduled() {
+    connectStarted();
+    // ESP-MQTT waits before it tries to reconnect. Don't count that as connect time.
+#ifdef MQTT_RECONNECT_TIMEOUT_MS
+    connectStartUs += static_cast<int64_t>(MQTT_RECONNECT_TIMEOUT_MS) * 1000;
+#endif
+}
+
+
 esp_err_t AppMQTT::connected(esp_mqtt_event_handle_t event) {
     esp_err_t err_code = ESP_OK;
 
-    // FOR TESTING PURPOSES ONLY!
-    //esp_err_t esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client, const char *topic, int qos);
-    err_code = esp_mqtt_client_subscribe(event->client, "irrigation/zone/on", 0);
-    ESP_LOGI(LOG_TAG, "TEST Subcribed to: irrigation/zone/on");
+    // Every (re)connect is a full mutual-auth TLS handshake.
+    // Log what it cost so that reconnect storms show up in the field.
+    int64_t connectMs = (esp_timer_get_time() - connectStartUs) / 1000;
+    isConnected = true;
+    ++connectCount;
+    ESP_LOGI(LOG_TAG,
+        "Broker connect #%u took %lld ms (%u failed attempt(s)). Free heap: %u bytes, minimum ever: %u bytes.",
+        connectCount, static_cast<long long>(connectMs), failedConnectCount,
+        esp_get_free_heap_size(), esp_get_minimum_free_heap_size()
+    );
+    failedConnectCount = 0;
+    if (connectCount == 1) {
+        app_boot_milestone("Cloud ready");
+    }
+
+    // Let the publisher replay anything stored while we were offline.
+    app_publisher_set_broker_connected(true);
+
+    err_code = subscriptions.subscribeAll(event->client, event->session_present != 0);
 
     return err_code;
 }
@@ -84,12 +151,20 @@ esp_err_t AppMQTT::connected(esp_mqtt_event_handle_t event) {
 
 esp_err_t AppMQTT::disconnected(esp_mqtt_event_handle_t event) {
     esp_err_t err_code = ESP_OK;
+
+    isConnected = false;
+    reconnectScheduled();
+    subscriptions.disconnected();
+
+    // Upstream messages go to the flash outbox until we reconnect.
+    app_publisher_set_broker_connected(false);
     return err_code;
 }
 
 
 esp_err_t AppMQTT::subscribed(esp_mqtt_event_handle_t event) {
     esp_err_t err_code = ESP_OK;
+    subscriptions.subscribed(event->msg_id);
     return err_code;
 }
 
@@ -102,13 +177,75 @@ esp_err_t AppMQTT::unsubscribed(esp_mqtt_event_handle_t event) {
 
 esp_err_t AppMQTT::published(esp_mqtt_event_handle_t event) {
     esp_err_t err_code = ESP_OK;
+    // Free the in-flight window slot held by this msg_id.
+    app_publisher_published(event->msg_id);
     return err_code;
 }
 
 
 esp_err_t AppMQTT::dataReceived(esp_mqtt_event_handle_t event) {
+    APP_LATENCY_STAMP(receivedStamps, mqttDataUs);
+
+    // Drop QoS1 redeliveries before they reach the peripheral.
+    // A long message arrives in several events, so decide on the first one.
+    if (event->current_data_offset == 0) {
+        isSuppressingMessage = duplicateFilter.isDuplicate(
+            event->msg_id, event->topic, event->topic_len, esp_timer_get_time()
+        );
+    }
+    if (isSuppressingMessage) {
+        return ESP_OK;
+    }
+
+    // Only the first event of a message carries the topic.
+    if (event->current_data_offset == 0) {
+        currentTopicIndex = lookupTopicIndex(event->topic, event->topic_len);
+#if CONFIG_APP_RUNTIME_CONFIG
+        isConfigMessage = currentTopicIndex < 0 && app_runtime_config_is_topic(event->topic, event->topic_len);
+#endif
+    }
+#if CONFIG_APP_RUNTIME_CONFIG
+    // Ours, not the peripheral's.
+    if (isConfigMessage) {
+        return app_runtime_config_receive(event->data, event->data_len, event->current_data_offset, event->total_data_len);
+    }
+#endif
+
+    TopicHandlerId handlerId = (currentTopicIndex < 0) ? TOPIC_HANDLER_UNKNOWN : TOPIC_MANIFEST[currentTopicIndex].handlerId;
+    switch (handlerId) {
+        case TOPIC_HANDLER_FORWARD_TO_SPI:
+            return forwardToSPI(event);
+#if CONFIG_APP_AVR_OTA
+        case TOPIC_HANDLER_AVR_OTA:
+            return app_avr_ota_receive(event->data, event->data_len, event->current_data_offset, event->total_data_len);
+#endif
+        case TOPIC_HANDLER_UNKNOWN:
+        default:
+            // Not in TOPIC_MANIFEST (e.g. matched a wildcard filter); forward it as before.
+            return forwardToSPI(event);
+    }
+}
+
+
+esp_err_t AppMQTT::forwardToSPI(esp_mqtt_event_handle_t event) {
     AppMQTTQueueNode node(event->topic, event->topic_len, event->data, event->data_len);
-    return node.queueSendToBack(mqttReceivedQueue);
+    if (node.isTruncated()) {
+        ESP_LOGE(LOG_TAG, "forwardToSPI(...): topic (%d bytes) or data (%d bytes) too long, dropped!",
+            event->topic_len, event->data_len);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Only cache messages that arrived in a single event.
+    if (event->current_data_offset == 0 && event->data_len == event->total_data_len) {
+        topicCache.update(event->topic, event->topic_len, event->data, event->data_len);
+        app_get_actuator_state_store().update(currentTopicIndex, event->data, event->data_len);
+    }
+
+    APP_LATENCY_COPY(node.getStamps(), receivedStamps, mqttDataUs);
+    app_queues_gate_enter();
+    esp_err_t err_code = node.queueSendToBack(mqttReceivedQueue);
+    app_queues_gate_exit();
+    return err_code;
 }
 /***
 esp_err_t AppMQTT::dataReceived(esp_mqtt_event_handle_t event) {
@@ -162,6 +299,11 @@ typedef struct {
 
 esp_err_t AppMQTT::errorOccurred(esp_mqtt_event_handle_t event) {
     esp_err_t err_code = ESP_OK;
+    if (!isConnected) {
+        // A failed TCP connect or TLS handshake. Only time the next attempt.
+        ++failedConnectCount;
+        reconnectScheduled();
+    }
     return err_code;
 }
 
@@ -174,6 +316,26 @@ void *get_static_app_mqtt(void) {
 }
 
 
+TopicValueCache & app_mqtt_get_topic_cache() {
+    return static_app_mqtt.getTopicCache();
+}
+
+
+uint32_t app_mqtt_get_duplicates_suppressed(void) {
+    return static_app_mqtt.getDuplicatesSuppressed();
+}
+
+
+void app_mqtt_retry_subscriptions(int64_t nowUs) {
+    static_app_mqtt.retrySubscriptions(nowUs);
+}
+
+
+void app_mqtt_connect_started(void) {
+    static_app_mqtt.connectStarted();
+}
+
+
 esp_err_t app_mqtt_event_handler(esp_mqtt_event_handle_t event) {
     AppMQTT *appMQTT = static_cast<AppMQTT *>(event->user_context);
     //AppMQTT *appMQTT = (AppMQTT *)event->user_context;
@@ -183,6 +345,16 @@ esp_err_t app_mqtt_event_handler(esp_mqtt_event_handle_t event) {
         return ESP_ERR_INVALID_ARG;
     }
 
+    // Runs in the ESP-MQTT task, which is not ours to register when it is created.
+    static bool isTaskRegistered = false;
+    if (!isTaskRegistered) {
+        const app_stage_config_t *stage = app_pipeline_get(APP_STAGE_MQTT_INGEST);
+        app_stack_register(NULL, stage->taskName, stage->stackDepth);
+        app_pipeline_check_core(APP_STAGE_MQTT_INGEST);
+        isTaskRegistered = true;
+    }
+
+    AppHeapScope heapScope(APP_HEAP_MQTT);
     return appMQTT->eventHandler(event);
 }
 
@@ -17,15 +17,28 @@
 //-------------------
 #ifdef __cplusplus
 #include "mqtt_client.h"
+#include "app_duplicate_filter.h"
+#include "app_latency_trace.h"
+#include "app_subscriptions.h"
+#include "app_topic_cache.h"
+#include "app_topic_dispatch.h"
 
 
 class AppMQTT {
 public:
-    //AppMQTT() { }
+    AppMQTT();
     //virtual ~AppMQTT() { }
 
     esp_err_t eventHandler(esp_mqtt_event_handle_t event);
 
+    // Marks the start of a connection attempt, so the cost of establishing
+    // the TLS session and MQTT connection can be measured.
+    void connectStarted();
+
+    TopicValueCache & getTopicCache() { return topicCache; }
+    uint32_t getDuplicatesSuppressed() const { return duplicateFilter.getSuppressedCount(); }
+    void retrySubscriptions(int64_t nowUs) { subscriptions.retryIfDue(nowUs); }
+
 protected:
     virtual esp_err_t connected(esp_mqtt_event_handle_t event);
     virtual esp_err_t disconnected(esp_mqtt_event_handle_t event);
@@ -34,8 +47,30 @@ protected:
     virtual esp_err_t published(esp_mqtt_event_handle_t event);
     virtual esp_err_t dataReceived(esp_mqtt_event_handle_t event);
     virtual esp_err_t errorOccurred(esp_mqtt_event_handle_t event);
+
+private:
+    SubscriptionTracker subscriptions;
+    TopicValueCache topicCache;
+    DuplicateFilter duplicateFilter;
+    bool isSuppressingMessage = false;
+    int currentTopicIndex = -1; // TOPIC_MANIFEST index of the message being received.
+#if CONFIG_APP_RUNTIME_CONFIG
+    bool isConfigMessage = false;
+#endif
+#if CONFIG_APP_LATENCY_TRACE
+    LatencyStamps receivedStamps = {};
+#endif
+    bool isConnected = false;
+    int64_t connectStartUs = 0;
+    unsigned connectCount = 0;
+    unsigned failedConnectCount = 0;
+
+    void reconnectScheduled();
+    esp_err_t forwardToSPI(esp_mqtt_event_handle_t event);
 };
 
+extern TopicValueCache & app_mqtt_get_topic_cache();
+
 #endif //__cplusplus
 //-------------------
 
@@ -49,6 +84,10 @@ extern "C"
 #endif
 
 extern void *get_static_app_mqtt(void);
+extern void app_mqtt_connect_started(void);
+extern uint32_t app_mqtt_get_duplicates_suppressed(void);
+// Called from the publisher task, see SubscriptionTracker::retryIfDue().
+extern void app_mqtt_retry_subscriptions(int64_t nowUs);
 extern esp_err_t app_mqtt_event_handler(esp_mqtt_event_handle_t event);
 
 #ifdef __cplusplus
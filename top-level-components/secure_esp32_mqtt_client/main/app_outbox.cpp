@@ -0,0 +1,336 @@
+/*  app_outbox.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <cstddef>
+#include <cstring>
+#include "esp_log.h"
+
+#include "app_outbox.h"
+
+
+static const char *LOG_TAG = "APP_OUTBOX";
+
+static const uint32_t OUTBOX_MAGIC = 0x3158424F; // "OBX1"
+
+// Record states. Each transition only clears bits so it can be written in place.
+static const uint8_t RECORD_STATE_COMMITTED_MASK = 0x80; // Cleared once the payload is fully written.
+static const uint8_t RECORD_STATE_CONSUMED_MASK  = 0x40; // Cleared once the record has been replayed.
+static const uint8_t RECORD_STATE_COMMITTED = 0x7F;
+static const uint8_t RECORD_STATE_CONSUMED  = 0x3F;
+
+static const uint16_t RECORD_LENGTH_ERASED = 0xFFFF;
+
+
+//-------------------------------------
+// AppOutbox.
+//-------------------------------------
+size_t AppOutbox::recordSpan(size_t recordLength) {
+    // Keep every record header 4 byte aligned.
+    return sizeof(RecordHeader) + ((recordLength + 3) & ~static_cast<size_t>(3));
+}
+
+
+uint8_t AppOutbox::checksum(const char *record, size_t recordLength) {
+    uint8_t sum = 0;
+    for (size_t index = 0; index < recordLength; ++index) {
+        sum = static_cast<uint8_t>((sum << 1) | (sum >> 7)) ^ static_cast<uint8_t>(record[index]);
+    }
+    return sum;
+}
+
+
+bool AppOutbox::readSectorHeader(unsigned sector, SectorHeader &header) {
+    if (storage->read(sector * sectorSize, &header, sizeof(header)) != ESP_OK) {
+        return false;
+    }
+    return header.magic == OUTBOX_MAGIC && header.sequenceCheck == ~header.sequence;
+}
+
+
+esp_err_t AppOutbox::startSector(unsigned sector, uint32_t sequence) {
+    esp_err_t err_code = storage->eraseSector(sector * sectorSize);
+    if (err_code != ESP_OK) {
+        return err_code;
+    }
+
+    SectorHeader header;
+    header.magic = OUTBOX_MAGIC;
+    header.sequence = sequence;
+    header.sequenceCheck = ~sequence;
+    header.reserved = 0xFFFFFFFF;
+    return storage->write(sector * sectorSize, &header, sizeof(header));
+}
+
+
+// Walks the records of one sector from startOffset.
+// Returns the number of committed but unconsumed records and sets *endOffset
+// to the first such record, or to the end of the written records if there are none.
+unsigned AppOutbox::countPending(unsigned sector, size_t startOffset, size_t *endOffset) {
+    unsigned count = 0;
+    size_t offset = startOffset;
+    size_t firstPendingOffset = 0;
+
+    while (offset + sizeof(RecordHeader) <= sectorSize) {
+        RecordHeader recordHeader;
+        if (storage->read(sector * sectorSize + offset, &recordHeader, sizeof(recordHeader)) != ESP_OK) {
+            break;
+        }
+        if (recordHeader.length == RECORD_LENGTH_ERASED) {
+            break;
+        }
+        if (recordHeader.length > MAX_RECORD_SIZE || offset + recordSpan(recordHeader.length) > sectorSize) {
+            // A torn header. Nothing after it can be trusted so treat the sector as full.
+            offset = sectorSize;
+            break;
+        }
+
+        bool isCommitted = (recordHeader.state & RECORD_STATE_COMMITTED_MASK) == 0;
+        bool isConsumed  = (recordHeader.state & RECORD_STATE_CONSUMED_MASK) == 0;
+        if (isCommitted && !isConsumed) {
+            if (count == 0) {
+                firstPendingOffset = offset;
+            }
+            ++count;
+        }
+        offset += recordSpan(recordHeader.length);
+    }
+
+    if (endOffset) {
+        *endOffset = count ? firstPendingOffset : offset;
+    }
+    return count;
+}
+
+
+esp_err_t AppOutbox::setRecordState(size_t offset, uint8_t state) {
+    return storage->write(offset + offsetof(RecordHeader, state), &state, sizeof(state));
+}
+
+
+esp_err_t AppOutbox::init(OutboxStorage *storage) {
+    this->storage = nullptr;
+    sectorSize = storage->sectorSize();
+    sectorCount = storage->size() / sectorSize;
+    if (sectorCount < 2) {
+        ESP_LOGE(LOG_TAG, "init(...): the outbox needs at least 2 sectors!");
+        return ESP_ERR_INVALID_SIZE;
+    }
+    this->storage = storage;
+
+    pendingCount = 0;
+    appendedCount = 0;
+    replayedCount = 0;
+    droppedCount = 0;
+
+    // The head is the sector with the highest sequence number.
+    bool isHeadFound = false;
+    for (unsigned sector = 0; sector < sectorCount; ++sector) {
+        SectorHeader header;
+        if (readSectorHeader(sector, header) && (!isHeadFound || header.sequence > headSequence)) {
+            headSector = sector;
+            headSequence = header.sequence;
+            isHeadFound = true;
+        }
+    }
+
+    if (!isHeadFound) {
+        // Blank (or unrecognised) storage.
+        headSector = 0;
+        headSequence = 1;
+        esp_err_t err_code = startSector(headSector, headSequence);
+        if (err_code != ESP_OK) {
+            this->storage = nullptr;
+            return err_code;
+        }
+        headOffset = sizeof(SectorHeader);
+        tailSector = headSector;
+        tailOffset = headOffset;
+        ESP_LOGI(LOG_TAG, "init(...): formatted %u sectors.", sectorCount);
+        return ESP_OK;
+    }
+
+    // Find the end of the written records in the head sector.
+    headOffset = sizeof(SectorHeader);
+    while (headOffset + sizeof(RecordHeader) <= sectorSize) {
+        RecordHeader recordHeader;
+        if (storage->read(headSector * sectorSize + headOffset, &recordHeader, sizeof(recordHeader)) != ESP_OK ||
+            recordHeader.length == RECORD_LENGTH_ERASED)
+        {
+            break;
+        }
+        if (recordHeader.length > MAX_RECORD_SIZE || headOffset + recordSpan(recordHeader.length) > sectorSize) {
+            headOffset = sectorSize;
+            break;
+        }
+        headOffset += recordSpan(recordHeader.length);
+    }
+
+    // Sectors are used round-robin, so the oldest data follows the head.
+    // Any sector whose sequence doesn't fit that order is stale and ignored.
+    tailSector = headSector;
+    tailOffset = headOffset;
+    bool isTailFound = false;
+    uint32_t expectedSequence = 0;
+    for (unsigned step = 1; step <= sectorCount; ++step) {
+        unsigned sector = (headSector + step) % sectorCount;
+        SectorHeader header;
+        if (!readSectorHeader(sector, header)) {
+            continue;
+        }
+        if (sector != headSector && (header.sequence >= headSequence || header.sequence < expectedSequence)) {
+            continue;
+        }
+        expectedSequence = header.sequence;
+
+        size_t firstPendingOffset = 0;
+        unsigned count = countPending(sector, sizeof(SectorHeader), &firstPendingOffset);
+        if (count > 0) {
+            if (!isTailFound) {
+                tailSector = sector;
+                tailOffset = firstPendingOffset;
+                isTailFound = true;
+            }
+            pendingCount += count;
+        }
+    }
+
+    ESP_LOGI(LOG_TAG, "init(...): %u sectors, head=%u, %u record(s) pending.", sectorCount, headSector, pendingCount);
+    return ESP_OK;
+}
+
+
+// Moves the tail forward to the next pending record, or to the head when there is none.
+bool AppOutbox::advanceTail() {
+    for (unsigned step = 0; step <= sectorCount; ++step) {
+        size_t firstPendingOffset = 0;
+        unsigned count = countPending(tailSector, tailOffset, &firstPendingOffset);
+        if (count > 0) {
+            tailOffset = firstPendingOffset;
+            return true;
+        }
+        if (tailSector == headSector) {
+            tailOffset = headOffset;
+            return false;
+        }
+        tailSector = (tailSector + 1) % sectorCount;
+        tailOffset = sizeof(SectorHeader);
+    }
+    return false;
+}
+
+
+esp_err_t AppOutbox::append(const char *record, size_t recordLength) {
+    if (!storage) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!record || recordLength == 0 || recordLength > MAX_RECORD_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    esp_err_t err_code;
+    size_t span = recordSpan(recordLength);
+
+    if (headOffset + span > sectorSize) {
+        unsigned nextSector = (headSector + 1) % sectorCount;
+
+        if (tailSector == nextSector) {
+            // The log is full. Drop whatever is still pending in the oldest sector.
+            unsigned dropped = countPending(tailSector, tailOffset, nullptr);
+            droppedCount += dropped;
+            pendingCount -= dropped;
+            tailSector = (nextSector + 1) % sectorCount;
+            tailOffset = sizeof(SectorHeader);
+            if (dropped > 0) {
+                ESP_LOGW(LOG_TAG, "append(...): outbox full, dropped %u record(s).", dropped);
+            }
+        }
+
+        err_code = startSector(nextSector, headSequence + 1);
+        if (err_code != ESP_OK) {
+            return err_code;
+        }
+        headSector = nextSector;
+        ++headSequence;
+        headOffset = sizeof(SectorHeader);
+        advanceTail();
+    }
+
+    size_t recordOffset = headSector * sectorSize + headOffset;
+    RecordHeader recordHeader;
+    recordHeader.length = static_cast<uint16_t>(recordLength);
+    recordHeader.state = 0xFF;
+    recordHeader.checksum = checksum(record, recordLength);
+
+    // Header, then payload, then the commit flag. A record torn by a reset is never replayed.
+    err_code = storage->write(recordOffset, &recordHeader, sizeof(recordHeader));
+    if (err_code == ESP_OK) {
+        err_code = storage->write(recordOffset + sizeof(recordHeader), record, recordLength);
+    }
+    if (err_code == ESP_OK) {
+        err_code = setRecordState(recordOffset, RECORD_STATE_COMMITTED);
+    }
+
+    // Even a failed write has used up the space.
+    headOffset += span;
+    if (err_code != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "append(...): write failed, err_code=%d", err_code);
+        return err_code;
+    }
+
+    if (pendingCount == 0) {
+        tailSector = headSector;
+        tailOffset = headOffset - span;
+    }
+    ++pendingCount;
+    ++appendedCount;
+    return ESP_OK;
+}
+
+
+unsigned AppOutbox::replay(unsigned maxRecords, ReplayCallback callback, void *context) {
+    unsigned count = 0;
+
+    while (storage && count < maxRecords && pendingCount > 0) {
+        if (!advanceTail()) {
+            // The counters and the storage disagree. Trust the storage.
+            pendingCount = 0;
+            break;
+        }
+
+        size_t recordOffset = tailSector * sectorSize + tailOffset;
+        RecordHeader recordHeader;
+        if (storage->read(recordOffset, &recordHeader, sizeof(recordHeader)) != ESP_OK ||
+            storage->read(recordOffset + sizeof(recordHeader), recordBuffer, recordHeader.length) != ESP_OK)
+        {
+            ESP_LOGE(LOG_TAG, "replay(...): read failed.");
+            break;
+        }
+
+        bool isValid = checksum(recordBuffer, recordHeader.length) == recordHeader.checksum;
+        if (isValid && callback(context, recordBuffer, recordHeader.length) != ESP_OK) {
+            // Not delivered. Leave it at the tail for the next replay.
+            break;
+        }
+
+        setRecordState(recordOffset, RECORD_STATE_CONSUMED);
+        tailOffset += recordSpan(recordHeader.length);
+        --pendingCount;
+        if (isValid) {
+            ++replayedCount;
+            ++count;
+        } else {
+            ++droppedCount;
+            ESP_LOGE(LOG_TAG, "replay(...): corrupt record dropped.");
+        }
+    }
+
+    return count;
+}
@@ -0,0 +1,142 @@
+/*  app_outbox.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+#ifndef _APP_OUTBOX_H_
+#define _APP_OUTBOX_H_
+
+
+//-------------------
+#ifdef __cplusplus
+#include "esp_err.h"
+#include "esp_partition.h"
+
+
+//------------------------------------------------------------------------------
+// Raw NOR-flash-like storage used by AppOutbox.
+// Erased bytes read as 0xFF and a write can only clear bits.
+class OutboxStorage {
+public:
+    virtual ~OutboxStorage() { }
+
+    virtual size_t size() const = 0;
+    virtual size_t sectorSize() const = 0;
+
+    virtual esp_err_t read(size_t offset, void *dst, size_t length) = 0;
+    virtual esp_err_t write(size_t offset, const void *src, size_t length) = 0;
+    virtual esp_err_t eraseSector(size_t offset) = 0;
+};
+
+
+//------------------------------------------------------------------------------
+// The dedicated "outbox" data partition (see partitions.csv).
+class PartitionOutboxStorage : public OutboxStorage {
+public:
+    explicit PartitionOutboxStorage(const esp_partition_t *partition) : partition(partition)
+    { }
+
+    size_t size() const override { return partition->size; }
+    size_t sectorSize() const override { return SPI_FLASH_SEC_SIZE; }
+
+    esp_err_t read(size_t offset, void *dst, size_t length) override {
+        return esp_partition_read(partition, offset, dst, length);
+    }
+    esp_err_t write(size_t offset, const void *src, size_t length) override {
+        return esp_partition_write(partition, offset, src, length);
+    }
+    esp_err_t eraseSector(size_t offset) override {
+        return esp_partition_erase_range(partition, offset, SPI_FLASH_SEC_SIZE);
+    }
+
+private:
+    const esp_partition_t *partition;
+};
+
+
+//------------------------------------------------------------------------------
+// Append-only, log-structured outbox.
+//
+// Each sector starts with a header holding a sequence number. Records are
+// appended to the head sector and sectors are reused round-robin, which
+// spreads erases evenly across the partition. Records are marked as consumed
+// in place (by clearing bits), so a partially replayed outbox resumes where
+// it left off after a reboot. When the log is full the oldest sector is
+// dropped.
+//
+// RAM use is one record buffer, independent of the number of stored records.
+class AppOutbox {
+public:
+    static const size_t MAX_RECORD_SIZE = 512;
+
+    // Return ESP_OK if the record was delivered and may be marked as consumed.
+    typedef esp_err_t (*ReplayCallback)(void *context, const char *record, size_t recordLength);
+
+    AppOutbox() = default;
+    virtual ~AppOutbox() { }
+
+    // Scans the storage and recovers the head and tail positions.
+    esp_err_t init(OutboxStorage *storage);
+
+    esp_err_t append(const char *record, size_t recordLength);
+    // Replays up to maxRecords, oldest first. Stops at the first record the callback rejects.
+    unsigned replay(unsigned maxRecords, ReplayCallback callback, void *context);
+
+    bool isEmpty() const { return pendingCount == 0; }
+    bool isReady() const { return storage != nullptr; }
+    unsigned getPendingCount()  const { return pendingCount; }
+    unsigned getAppendedCount() const { return appendedCount; }
+    unsigned getReplayedCount() const { return replayedCount; }
+    unsigned getDroppedCount()  const { return droppedCount; }
+
+private:
+    struct SectorHeader {
+        uint32_t magic;
+        uint32_t sequence;
+        uint32_t sequenceCheck; // ~sequence, guards against a torn header write.
+        uint32_t reserved;
+    };
+
+    struct RecordHeader {
+        uint16_t length;   // 0xFFFF marks the end of the sector's records.
+        uint8_t  state;
+        uint8_t  checksum;
+    };
+
+    OutboxStorage *storage = nullptr;
+    size_t sectorSize = 0;
+    unsigned sectorCount = 0;
+
+    unsigned headSector = 0;
+    uint32_t headSequence = 0;
+    size_t   headOffset = 0;   // Within headSector.
+    unsigned tailSector = 0;
+    size_t   tailOffset = 0;   // Within tailSector.
+
+    unsigned pendingCount = 0;
+    unsigned appendedCount = 0;
+    unsigned replayedCount = 0;
+    unsigned droppedCount = 0;
+
+    char recordBuffer[MAX_RECORD_SIZE];
+
+    static size_t recordSpan(size_t recordLength);
+    static uint8_t checksum(const char *record, size_t recordLength);
+
+    bool readSectorHeader(unsigned sector, SectorHeader &header);
+    esp_err_t startSector(unsigned sector, uint32_t sequence);
+    unsigned countPending(unsigned sector, size_t startOffset, size_t *endOffset);
+    esp_err_t setRecordState(size_t offset, uint8_t state);
+    bool advanceTail();
+};
+
+#endif //__cplusplus
+//-------------------
+
+
+#endif // _APP_OUTBOX_H_
@@ -0,0 +1,133 @@
+/*  app_pipeline.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include "esp_log.h"
+#include "app_pipeline.h"
+#include "app_stack_monitor.h"
+
+
+static const char *LOG_TAG = "APP_PIPELINE";
+
+// Wi-Fi and lwIP run on PRO_CPU_NUM. The SPI link gets APP_CPU_NUM to itself
+// so the transaction turnaround does not wait behind TLS. Compare layouts
+// with "app_bench placements" before changing them.
+static app_stage_config_t PIPELINE_STAGES[APP_STAGE_COUNT] = {
+    //  taskName            coreId          priority  stackDepth
+    {   "mqtt_task",        tskNO_AFFINITY, 5,        6144 },   // ESP-MQTT's defaults.
+    {   "App SPI",          APP_CPU_NUM,    5,        4000 },
+    {   "uart_echo_task",   tskNO_AFFINITY, 12,       2048 },
+    {   "App Publisher",    PRO_CPU_NUM,    5,        4000 },
+};
+
+static bool isCoreChecked[APP_STAGE_COUNT] = {};
+
+
+static bool isValidStage(app_stage_t stage) {
+    return stage >= 0 && stage < APP_STAGE_COUNT;
+}
+
+
+static const char *coreName(BaseType_t coreId) {
+    switch (coreId) {
+        case PRO_CPU_NUM: return "PRO";
+        case APP_CPU_NUM: return "APP";
+        default:          return "any";
+    }
+}
+
+
+//-------------------------------------
+// C wrappers.
+//-------------------------------------
+const app_stage_config_t *app_pipeline_get(app_stage_t stage) {
+    return isValidStage(stage) ? &PIPELINE_STAGES[stage] : NULL;
+}
+
+
+esp_err_t app_pipeline_set(app_stage_t stage, const app_stage_config_t *config) {
+    if (!isValidStage(stage) || !config || !config->taskName) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (config->coreId != tskNO_AFFINITY && (config->coreId < 0 || config->coreId >= portNUM_PROCESSORS)) {
+        ESP_LOGE(LOG_TAG, "app_pipeline_set(%s): there is no core %d!", config->taskName, static_cast<int>(config->coreId));
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (config->priority >= configMAX_PRIORITIES) {
+        ESP_LOGE(LOG_TAG, "app_pipeline_set(%s): priority %u is above the maximum!", config->taskName, config->priority);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    PIPELINE_STAGES[stage] = *config;
+    isCoreChecked[stage] = false;
+    return ESP_OK;
+}
+
+
+esp_err_t app_pipeline_create_task(app_stage_t stage, TaskFunction_t function, void *parameters,
+                                   TaskHandle_t *taskHandle) {
+    const app_stage_config_t *config = app_pipeline_get(stage);
+    if (!config || !function) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    TaskHandle_t handle = NULL;
+    BaseType_t result = xTaskCreatePinnedToCore(
+        function,
+        config->taskName,
+        config->stackDepth,
+        parameters,         //constpvParameters
+        config->priority,   //uxPriority
+        &handle,            //constpvCreatedTask
+        config->coreId      //xCoreID
+    );
+    if (result != pdPASS) {
+        ESP_LOGE(LOG_TAG, "app_pipeline_create_task(%s): xTaskCreatePinnedToCore(...) failed!", config->taskName);
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(LOG_TAG, "%s: core %s, priority %u, stack %u.",
+        config->taskName, coreName(config->coreId), config->priority, config->stackDepth);
+    app_stack_register(handle, config->taskName, config->stackDepth);
+    if (taskHandle) {
+        *taskHandle = handle;
+    }
+    return ESP_OK;
+}
+
+
+void app_pipeline_check_core(app_stage_t stage) {
+    const app_stage_config_t *config = app_pipeline_get(stage);
+    if (!config || isCoreChecked[stage]) {
+        return;
+    }
+    isCoreChecked[stage] = true;
+
+    BaseType_t coreId = xPortGetCoreID();
+    if (config->coreId == tskNO_AFFINITY || config->coreId == coreId) {
+        return;
+    }
+    if (stage == APP_STAGE_MQTT_INGEST) {
+        ESP_LOGW(LOG_TAG, "%s runs on core %s, not %s: set the MQTT task core in menuconfig to match.",
+            config->taskName, coreName(coreId), coreName(config->coreId));
+    } else {
+        ESP_LOGW(LOG_TAG, "%s runs on core %s, not %s!", config->taskName, coreName(coreId), coreName(config->coreId));
+    }
+}
+
+
+void app_pipeline_log(void) {
+    ESP_LOGI(LOG_TAG, "Pipeline:");
+    for (unsigned stage = 0; stage < APP_STAGE_COUNT; ++stage) {
+        const app_stage_config_t &config = PIPELINE_STAGES[stage];
+        ESP_LOGI(LOG_TAG, "  %-16s core %-3s  priority %2u  stack %5u",
+            config.taskName, coreName(config.coreId), config.priority, config.stackDepth);
+    }
+}
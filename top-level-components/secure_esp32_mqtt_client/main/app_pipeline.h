@@ -0,0 +1,73 @@
+/*  app_pipeline.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+#ifndef _APP_PIPELINE_H_
+#define _APP_PIPELINE_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+
+//------------------------------------------------------------------------------
+// Where each stage of the message pipeline runs.
+//
+// Every long lived task of the pipeline takes its core, priority and stack
+// size from PIPELINE_STAGES in app_pipeline.cpp, so the whole layout can be
+// read and changed in one place.
+//
+// Routing (duplicate filter, topic dispatch, topic cache and actuator state)
+// runs inside app_mqtt_event_handler(), so it is part of APP_STAGE_MQTT_INGEST.
+// That task belongs to ESP-MQTT: its priority and stack size are passed in
+// esp_mqtt_client_config_t, but its core can only be chosen in menuconfig
+// (MQTT_TASK_CORE_SELECTION). app_pipeline_check_core() warns when the
+// two disagree.
+//------------------------------------------------------------------------------
+typedef enum {
+    APP_STAGE_MQTT_INGEST = 0,  // ESP-MQTT's task, including routing.
+    APP_STAGE_SPI_LINK,         // AppSPI.
+    APP_STAGE_UART,             // UART ingest.
+    APP_STAGE_PUBLISHER,        // AppPublisher.
+    APP_STAGE_COUNT
+} app_stage_t;
+
+typedef struct {
+    const char *taskName;
+    BaseType_t coreId;          // PRO_CPU_NUM, APP_CPU_NUM or tskNO_AFFINITY.
+    UBaseType_t priority;
+    uint32_t stackDepth;        // In bytes.
+} app_stage_config_t;
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// C wrappers.
+extern const app_stage_config_t *app_pipeline_get(app_stage_t stage);
+// Replaces a stage's placement. Only affects tasks created afterwards.
+extern esp_err_t app_pipeline_set(app_stage_t stage, const app_stage_config_t *config);
+
+// Creates the stage's task as configured and registers its stack.
+extern esp_err_t app_pipeline_create_task(app_stage_t stage, TaskFunction_t function, void *parameters,
+                                          TaskHandle_t *taskHandle);
+// Call from the stage's own task. Warns once if it runs on another core than configured.
+extern void app_pipeline_check_core(app_stage_t stage);
+// Logs the placement of every stage.
+extern void app_pipeline_log(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // _APP_PIPELINE_H_
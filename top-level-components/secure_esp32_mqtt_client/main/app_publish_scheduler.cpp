@@ -0,0 +1,326 @@
+/*  app_publish_scheduler.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <cstring>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "app_publish_scheduler.h"
+
+
+static const char *LOG_TAG = "APP_PUB_SCHED";
+
+
+//-------------------------------------
+// Topic classes.
+//-------------------------------------
+// The first entry whose prefix matches the outgoing topic wins,
+// so the catch-all "" entry MUST be last.
+static const PublishTopicClass TOPIC_CLASS_TABLE[] = {
+    //name       topicPrefix    qos  tokensPerSecond  bucketSize
+    { "control", "irrigation/", 1,   20,              10 },
+    { "default", "",            0,   50,              25 },
+};
+
+static_assert(sizeof(TOPIC_CLASS_TABLE) / sizeof(TOPIC_CLASS_TABLE[0]) == PublishScheduler::NUM_TOPIC_CLASSES,
+    "PublishScheduler::NUM_TOPIC_CLASSES MUST match TOPIC_CLASS_TABLE.");
+
+
+//-------------------------------------
+// TokenBucket.
+//-------------------------------------
+void TokenBucket::init(uint32_t tokensPerSecond, uint32_t bucketSize, int64_t nowUs) {
+    this->tokensPerSecond = tokensPerSecond;
+    maxMilliTokens = static_cast<int64_t>(bucketSize) * 1000;
+    milliTokens = maxMilliTokens;
+    lastRefillUs = nowUs;
+}
+
+
+void TokenBucket::refill(int64_t nowUs) {
+    int64_t elapsedUs = nowUs - lastRefillUs;
+    if (elapsedUs <= 0) {
+        return;
+    }
+
+    // (elapsedUs / 1000000) * tokensPerSecond * 1000
+    int64_t addedMilliTokens = (elapsedUs * tokensPerSecond) / 1000;
+    if (addedMilliTokens > 0) {
+        milliTokens += addedMilliTokens;
+        if (milliTokens > maxMilliTokens) {
+            milliTokens = maxMilliTokens;
+        }
+        lastRefillUs = nowUs;
+    }
+}
+
+
+bool TokenBucket::tryTake(int64_t nowUs) {
+    refill(nowUs);
+    if (milliTokens >= 1000) {
+        milliTokens -= 1000;
+        return true;
+    }
+    return false;
+}
+
+
+int64_t TokenBucket::waitTimeUs(int64_t nowUs) {
+    refill(nowUs);
+    if (milliTokens >= 1000 || tokensPerSecond == 0) {
+        return 0;
+    }
+    return ((1000 - milliTokens) * 1000) / tokensPerSecond;
+}
+
+
+//-------------------------------------
+// PublishScheduler.
+//-------------------------------------
+void PublishScheduler::init() {
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    windowSemaphore = xSemaphoreCreateCountingStatic(WINDOW_SIZE, WINDOW_SIZE, &windowSemaphoreBuffer);
+#else
+    windowSemaphore = xSemaphoreCreateCounting(WINDOW_SIZE, WINDOW_SIZE);
+#endif
+    configASSERT(windowSemaphore);
+
+    for (InFlightSlot &slot : slots) {
+        slot.isInUse = false;
+    }
+    earlyAckCount = 0;
+
+    int64_t nowUs = esp_timer_get_time();
+    for (unsigned classIndex = 0; classIndex < NUM_TOPIC_CLASSES; ++classIndex) {
+        const PublishTopicClass &topicClass = TOPIC_CLASS_TABLE[classIndex];
+        buckets[classIndex].init(topicClass.tokensPerSecond, topicClass.bucketSize, nowUs);
+        std::memset(&stats[classIndex], 0, sizeof(RoundTripStats));
+    }
+
+    ESP_LOGI(LOG_TAG, "PublishScheduler initialized: window=%u, topic classes=%u.", WINDOW_SIZE, NUM_TOPIC_CLASSES);
+}
+
+
+unsigned PublishScheduler::classify(StringView topic) const {
+    for (unsigned classIndex = 0; classIndex < NUM_TOPIC_CLASSES; ++classIndex) {
+        if (topic.startsWith(TOPIC_CLASS_TABLE[classIndex].topicPrefix)) {
+            return classIndex;
+        }
+    }
+    return NUM_TOPIC_CLASSES - 1;
+}
+
+
+const PublishTopicClass & PublishScheduler::topicClass(unsigned classIndex) const {
+    return TOPIC_CLASS_TABLE[classIndex];
+}
+
+
+esp_err_t PublishScheduler::acquire(unsigned classIndex, TickType_t maxWait) {
+    TickType_t startTicks = xTaskGetTickCount();
+
+    // Pace first so that a full window does not also burn tokens.
+    while (!buckets[classIndex].tryTake(esp_timer_get_time())) {
+        TickType_t delayTicks = pdMS_TO_TICKS(buckets[classIndex].waitTimeUs(esp_timer_get_time()) / 1000);
+        if (delayTicks == 0) {
+            delayTicks = 1;
+        }
+        if (maxWait != portMAX_DELAY && (xTaskGetTickCount() - startTicks) + delayTicks > maxWait) {
+            return ESP_ERR_TIMEOUT;
+        }
+        vTaskDelay(delayTicks);
+    }
+
+    if (TOPIC_CLASS_TABLE[classIndex].qos == 0) {
+        // QoS0 publishes are never acknowledged, so they don't occupy the window.
+        return ESP_OK;
+    }
+
+    const TickType_t pollTicks = pdMS_TO_TICKS(100);
+    while (xSemaphoreTake(windowSemaphore, pollTicks) != pdTRUE) {
+        expireStaleSlots(esp_timer_get_time());
+        if (maxWait != portMAX_DELAY && (xTaskGetTickCount() - startTicks) > maxWait) {
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+
+    return ESP_OK;
+}
+
+
+void PublishScheduler::sent(unsigned classIndex, int msg_id) {
+    if (TOPIC_CLASS_TABLE[classIndex].qos == 0) {
+        return;
+    }
+
+    if (msg_id < 0) {
+        // The publish failed so return the reservation taken by acquire().
+        xSemaphoreGive(windowSemaphore);
+        return;
+    }
+
+    int64_t nowUs = esp_timer_get_time();
+    bool alreadyAcked = false;
+    bool isRecorded = false;
+
+    portENTER_CRITICAL(&slotsMux);
+    expireEarlyAcks(nowUs);
+    for (unsigned ackIndex = 0; ackIndex < earlyAckCount; ++ackIndex) {
+        if (earlyAcks[ackIndex].msg_id == msg_id) {
+            earlyAcks[ackIndex] = earlyAcks[--earlyAckCount];
+            alreadyAcked = true;
+            break;
+        }
+    }
+    if (!alreadyAcked) {
+        for (InFlightSlot &slot : slots) {
+            if (!slot.isInUse) {
+                slot.msg_id = msg_id;
+                slot.classIndex = classIndex;
+                slot.sentUs = nowUs;
+                slot.isInUse = true;
+                isRecorded = true;
+                break;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&slotsMux);
+
+    if (alreadyAcked) {
+        // The broker answered before esp_mqtt_client_publish() returned.
+        recordRoundTrip(classIndex, 0);
+        xSemaphoreGive(windowSemaphore);
+    } else if (!isRecorded) {
+        // Can't happen while the semaphore and the slots agree, but don't leak the reservation.
+        ESP_LOGE(LOG_TAG, "sent(...): no free in-flight slot for msg_id=%d!", msg_id);
+        xSemaphoreGive(windowSemaphore);
+    }
+}
+
+
+void PublishScheduler::released(int msg_id) {
+    int64_t nowUs = esp_timer_get_time();
+    bool isFound = false;
+    unsigned classIndex = 0;
+    int64_t roundTripUs = 0;
+
+    portENTER_CRITICAL(&slotsMux);
+    for (InFlightSlot &slot : slots) {
+        if (slot.isInUse && slot.msg_id == msg_id) {
+            slot.isInUse = false;
+            classIndex = slot.classIndex;
+            roundTripUs = nowUs - slot.sentUs;
+            isFound = true;
+            break;
+        }
+    }
+    if (!isFound) {
+        expireEarlyAcks(nowUs);
+        if (earlyAckCount < WINDOW_SIZE) {
+            earlyAcks[earlyAckCount].msg_id = msg_id;
+            earlyAcks[earlyAckCount].ackedUs = nowUs;
+            ++earlyAckCount;
+        }
+    }
+    portEXIT_CRITICAL(&slotsMux);
+
+    if (isFound) {
+        recordRoundTrip(classIndex, roundTripUs);
+        xSemaphoreGive(windowSemaphore);
+    }
+}
+
+
+// No ack kept from the old connection can belong to a publish still to come.
+void PublishScheduler::disconnected() {
+    portENTER_CRITICAL(&slotsMux);
+    earlyAckCount = 0;
+    portEXIT_CRITICAL(&slotsMux);
+}
+
+
+void PublishScheduler::recordRoundTrip(unsigned classIndex, int64_t roundTripUs) {
+    portENTER_CRITICAL(&slotsMux);
+    RoundTripStats &classStats = stats[classIndex];
+    if (classStats.count == 0 || roundTripUs < classStats.minUs) {
+        classStats.minUs = roundTripUs;
+    }
+    if (roundTripUs > classStats.maxUs) {
+        classStats.maxUs = roundTripUs;
+    }
+    classStats.totalUs += roundTripUs;
+    ++classStats.count;
+    portEXIT_CRITICAL(&slotsMux);
+}
+
+
+void PublishScheduler::expireStaleSlots(int64_t nowUs) {
+    unsigned expiredCount = 0;
+
+    portENTER_CRITICAL(&slotsMux);
+    expireEarlyAcks(nowUs);
+    for (InFlightSlot &slot : slots) {
+        if (slot.isInUse && (nowUs - slot.sentUs) > IN_FLIGHT_TIMEOUT_US) {
+            slot.isInUse = false;
+            ++stats[slot.classIndex].expiredCount;
+            ++expiredCount;
+        }
+    }
+    portEXIT_CRITICAL(&slotsMux);
+
+    for (unsigned count = 0; count < expiredCount; ++count) {
+        xSemaphoreGive(windowSemaphore);
+    }
+    if (expiredCount > 0) {
+        ESP_LOGW(LOG_TAG, "expireStaleSlots(...): %u in-flight publish(es) never acknowledged.", expiredCount);
+    }
+}
+
+
+void PublishScheduler::expireEarlyAcks(int64_t nowUs) {
+    unsigned ackIndex = 0;
+    while (ackIndex < earlyAckCount) {
+        if ((nowUs - earlyAcks[ackIndex].ackedUs) > IN_FLIGHT_TIMEOUT_US) {
+            earlyAcks[ackIndex] = earlyAcks[--earlyAckCount];
+        } else {
+            ++ackIndex;
+        }
+    }
+}
+
+
+void PublishScheduler::reportStats() {
+    for (unsigned classIndex = 0; classIndex < NUM_TOPIC_CLASSES; ++classIndex) {
+        RoundTripStats classStats;
+        portENTER_CRITICAL(&slotsMux);
+        classStats = stats[classIndex];
+        std::memset(&stats[classIndex], 0, sizeof(RoundTripStats));
+        portEXIT_CRITICAL(&slotsMux);
+
+        if (classStats.count == 0 && classStats.expiredCount == 0) {
+            continue;
+        }
+        ESP_LOGI(LOG_TAG,
+            "class '%s': acked=%u, expired=%u, rtt min/avg/max = %lld/%lld/%lld us",
+            TOPIC_CLASS_TABLE[classIndex].name,
+            classStats.count,
+            classStats.expiredCount,
+            static_cast<long long>(classStats.minUs),
+            static_cast<long long>(classStats.count ? classStats.totalUs / classStats.count : 0),
+            static_cast<long long>(classStats.maxUs)
+        );
+    }
+    ESP_LOGI(LOG_TAG, "in-flight window: %u of %u free.",
+        static_cast<unsigned>(uxSemaphoreGetCount(windowSemaphore)), WINDOW_SIZE);
+}
@@ -0,0 +1,137 @@
+/*  app_publish_scheduler.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+#ifndef _APP_PUBLISH_SCHEDULER_H_
+#define _APP_PUBLISH_SCHEDULER_H_
+
+
+//-------------------
+#ifdef __cplusplus
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "app_fixed_string.h"
+
+
+//------------------------------------------------------------------------------
+// Outgoing topics are grouped into classes that share a QoS and a send rate.
+struct PublishTopicClass {
+    const char *name;
+    const char *topicPrefix;  // "" matches every topic.
+    int qos;
+    uint32_t tokensPerSecond; // Sustained publish rate.
+    uint32_t bucketSize;      // Largest burst allowed after an idle period.
+};
+
+
+//------------------------------------------------------------------------------
+// Classic token bucket. Tokens are kept in thousandths to avoid floating point.
+class TokenBucket {
+public:
+    void init(uint32_t tokensPerSecond, uint32_t bucketSize, int64_t nowUs);
+
+    bool tryTake(int64_t nowUs);
+
+    // Microseconds until the next token is available (0 if one is available now).
+    int64_t waitTimeUs(int64_t nowUs);
+
+private:
+    uint32_t tokensPerSecond = 0;
+    int64_t  maxMilliTokens = 0;
+    int64_t  milliTokens = 0;
+    int64_t  lastRefillUs = 0;
+
+    void refill(int64_t nowUs);
+};
+
+
+//------------------------------------------------------------------------------
+// Bounds the number of outstanding QoS1/QoS2 publishes and paces all publishes.
+//
+// The in-flight window is keyed by msg_id. A slot is taken by the publisher
+// task before a publish and released by the MQTT task from AppMQTT::published().
+class PublishScheduler {
+public:
+    static const unsigned WINDOW_SIZE = 8;
+    // Entries in TOPIC_CLASS_TABLE (app_publish_scheduler.cpp).
+    static const unsigned NUM_TOPIC_CLASSES = 2;
+
+    // ESP-MQTT silently drops outbox entries after 30 seconds,
+    // so reclaim any slot that has been waiting longer than that.
+    static const int64_t IN_FLIGHT_TIMEOUT_US = 30LL * 1000 * 1000;
+
+    PublishScheduler() = default;
+    virtual ~PublishScheduler() { }
+
+    void init();
+
+    // Returns the index of the topic class for the given topic.
+    unsigned classify(StringView topic) const;
+    const PublishTopicClass & topicClass(unsigned classIndex) const;
+
+    // Blocks until the topic class has a token and, for QoS > 0, an in-flight slot is free.
+    esp_err_t acquire(unsigned classIndex, TickType_t maxWait);
+    // Called after a publish that used acquire().
+    // A negative msg_id means the publish failed and the reservation is returned.
+    void sent(unsigned classIndex, int msg_id);
+    // Called from AppMQTT::published().
+    void released(int msg_id);
+    // Called from the MQTT task when the broker connection is lost.
+    void disconnected();
+
+    void reportStats();
+
+private:
+    struct InFlightSlot {
+        int msg_id;
+        unsigned classIndex;
+        int64_t sentUs;
+        bool isInUse;
+    };
+
+    struct EarlyAck {
+        int msg_id;
+        int64_t ackedUs;
+    };
+
+    struct RoundTripStats {
+        uint32_t count;
+        uint32_t expiredCount;
+        int64_t totalUs;
+        int64_t minUs;
+        int64_t maxUs;
+    };
+
+    portMUX_TYPE slotsMux = portMUX_INITIALIZER_UNLOCKED;
+    SemaphoreHandle_t windowSemaphore = nullptr;
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    StaticSemaphore_t windowSemaphoreBuffer;
+#endif
+
+    InFlightSlot slots[WINDOW_SIZE];
+    // Acks that arrived before sent() recorded their msg_id. Also acks for
+    // slots that already expired, so they are dropped after IN_FLIGHT_TIMEOUT_US.
+    EarlyAck earlyAcks[WINDOW_SIZE];
+    unsigned earlyAckCount = 0;
+
+    TokenBucket buckets[NUM_TOPIC_CLASSES];
+    RoundTripStats stats[NUM_TOPIC_CLASSES];
+
+    void recordRoundTrip(unsigned classIndex, int64_t roundTripUs);
+    void expireStaleSlots(int64_t nowUs);
+    // With slotsMux held.
+    void expireEarlyAcks(int64_t nowUs);
+};
+
+#endif //__cplusplus
+//-------------------
+
+
+#endif // _APP_PUBLISH_SCHEDULER_H_
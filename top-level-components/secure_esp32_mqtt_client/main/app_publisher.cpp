@@ -0,0 +1,325 @@
+/*  app_publisher.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include "esp_system.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include "app_actuator_state.h"
+#include "app_deferred_log.h"
+#include "app_heap_stats.h"
+#include "app_stack_monitor.h"
+#include "app_latency_trace.h"
+#include "app_mqtt.h"
+#include "app_pipeline.h"
+#include "app_queues.h"
+#include "app_publisher.h"
+#include "app_runtime_config.h"
+
+
+static const char *LOG_TAG = "APP_PUBLISHER";
+
+static AppPublisher static_app_publisher;
+
+
+// How often the publish round-trip statistics are logged.
+static const int64_t STATS_REPORT_INTERVAL_US = 60LL * 1000 * 1000;
+
+// The data partition used as the offline outbox (see partitions.csv).
+static const char *OUTBOX_PARTITION_LABEL = "outbox";
+static const esp_partition_subtype_t OUTBOX_PARTITION_SUBTYPE = static_cast<esp_partition_subtype_t>(0x40);
+
+
+//-------------------------------------
+// AppPublisher.
+//-------------------------------------
+AppPublisher::AppPublisher(const unsigned batchSize)
+                          : batchSize(batchSize)
+{
+}
+
+
+void AppPublisher::init() {
+    AppHeapScope heapScope(APP_HEAP_PUBLISHER);
+    scheduler.init();
+
+    const esp_partition_t *partition = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA,
+        OUTBOX_PARTITION_SUBTYPE,
+        OUTBOX_PARTITION_LABEL
+    );
+    if (partition) {
+        // Lives as long as the publisher.
+        PartitionOutboxStorage *storage = new PartitionOutboxStorage(partition);
+        if (outbox.init(storage) != ESP_OK) {
+            ESP_LOGE(LOG_TAG, "init(): the outbox could not be initialized!");
+        }
+    } else {
+        ESP_LOGW(LOG_TAG, "init(): no '%s' partition, messages will be dropped while disconnected.", OUTBOX_PARTITION_LABEL);
+    }
+}
+
+
+void AppPublisher::taskStart() {
+    AppHeapScope heapScope(APP_HEAP_PUBLISHER);
+    task();
+}
+
+
+void AppPublisher::task() {
+    int64_t lastStatsReportUs = esp_timer_get_time();
+    app_runtime_config_join(APP_STAGE_PUBLISHER);
+
+    while(1) {
+        // The SPI task parks first, so nothing new arrives once the queue is empty.
+        if (app_runtime_config_is_pause_requested(APP_STAGE_PUBLISHER) && uxQueueMessagesWaiting(spiReceivedQueue) == 0) {
+            app_runtime_config_park(APP_STAGE_PUBLISHER);
+        }
+
+        // Replay the outbox first so that messages go out in the order they were produced.
+        TickType_t queueReceiveDelay = app_runtime_config_get()->publisherPollMs / portTICK_PERIOD_MS;
+        if (isBrokerConnected && !outbox.isEmpty()) {
+            replayOutbox();
+            queueReceiveDelay = 0;
+        }
+
+        processOutgoingBatch(queueReceiveDelay);
+
+        int64_t nowUs = esp_timer_get_time();
+        app_actuator_state_commit_if_due(nowUs);
+        if (isBrokerConnected) {
+            app_mqtt_retry_subscriptions(nowUs);
+        }
+        if (nowUs - lastStatsReportUs >= STATS_REPORT_INTERVAL_US) {
+            lastStatsReportUs = nowUs;
+            scheduler.reportStats();
+#if CONFIG_APP_LATENCY_TRACE
+            publishLatencyStats();
+#endif
+#if CONFIG_APP_HEAP_ACCOUNTING
+            publishHeapStats();
+#endif
+            app_stack_report();
+        }
+    }//while(1)
+
+    // This should never be reached, but just incase...
+    if(taskHandle) {
+        vTaskDelete(taskHandle);
+        taskHandle = nullptr;
+    }
+}
+
+
+// Wait for at least one message and then drain up to batchSize messages
+// without waiting. The wait is bounded so that the task can do other work.
+unsigned AppPublisher::processOutgoingBatch(TickType_t queueReceiveDelay) {
+    unsigned processedCount = 0;
+
+    while (processedCount < batchSize) {
+        AppSPIQueueNode node;
+        esp_err_t err_code = node.queueReceive(spiReceivedQueue, queueReceiveDelay);
+        if (err_code != ESP_OK) {
+            break;
+        }
+
+        publishNode(node);
+        ++processedCount;
+        queueReceiveDelay = 0;
+    }
+
+    APP_DLOG("processOutgoingBatch(): %u message(s) processed.", processedCount);
+    return processedCount;
+}
+
+
+unsigned AppPublisher::replayOutbox() {
+    unsigned replayedCount = outbox.replay(batchSize, replayCallback, this);
+    if (replayedCount > 0 && outbox.isEmpty()) {
+        ESP_LOGI(LOG_TAG, "replayOutbox(): outbox drained, %u replayed, %u dropped in total.",
+            outbox.getReplayedCount(), outbox.getDroppedCount());
+    }
+    return replayedCount;
+}
+
+
+esp_err_t AppPublisher::replayCallback(void *context, const char *record, size_t recordLength) {
+    AppPublisher *appPublisher = static_cast<AppPublisher *>(context);
+    esp_err_t err_code = appPublisher->publishMessage(record, recordLength);
+    // A malformed record will never succeed, so let the outbox discard it.
+    return (err_code == ESP_ERR_INVALID_ARG) ? ESP_OK : err_code;
+}
+
+
+esp_err_t AppPublisher::publishNode(const AppSPIQueueNode &node) {
+    const SpiMessageString &msg = node.getData();
+
+    // While anything is waiting in the outbox new messages queue up behind it.
+    if (!isBrokerConnected || !outbox.isEmpty()) {
+        return stashMessage(msg.c_str(), msg.size());
+    }
+
+    esp_err_t err_code = publishMessage(msg.c_str(), msg.size());
+    if (err_code == ESP_FAIL) {
+        // The connection probably dropped between the check above and the publish.
+        return stashMessage(msg.c_str(), msg.size());
+    }
+    return err_code;
+}
+
+
+esp_err_t AppPublisher::stashMessage(const char *msg, size_t msgLength) {
+    esp_err_t err_code = outbox.append(msg, msgLength);
+    if (err_code != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "stashMessage(...): broker unavailable, message dropped!\n%.*s",
+            static_cast<int>(msgLength), msg);
+    }
+    return err_code;
+}
+
+
+// Returns ESP_ERR_INVALID_ARG for a malformed message and ESP_FAIL if the publish failed.
+esp_err_t AppPublisher::publishMessage(const char *msg, size_t msgLength) {
+    // Messages from the peripheral are formatted as "topic,data".
+    const char *separator = static_cast<const char *>(std::memchr(msg, ',', msgLength));
+    if (!separator || separator == msg) {
+        ESP_LOGE(LOG_TAG, "publishMessage(...): malformed message dropped!\n%.*s",
+            static_cast<int>(msgLength), msg);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!client) {
+        ESP_LOGE(LOG_TAG, "publishMessage(...): no MQTT client!");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    MqttTopicString topic(StringView(msg, separator - msg));
+    if (topic.truncated()) {
+        ESP_LOGE(LOG_TAG, "publishMessage(...): topic longer than %u bytes, message dropped!\n%.*s",
+            APP_MQTT_TOPIC_CAPACITY, static_cast<int>(msgLength), msg);
+        return ESP_ERR_INVALID_ARG;
+    }
+    const char *data = separator + 1;
+    int dataLength = static_cast<int>(msgLength - (data - msg));
+    unsigned classIndex = scheduler.classify(topic);
+    int qos = scheduler.topicClass(classIndex).qos;
+
+    // Wait for a token and an in-flight slot. This is what throttles an upstream burst.
+    esp_err_t err_code = scheduler.acquire(classIndex, portMAX_DELAY);
+    if (err_code != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "publishMessage(...): scheduler.acquire(...) failed!\ntopic:%s", topic.c_str());
+        return err_code;
+    }
+
+    int msg_id = esp_mqtt_client_publish(client, topic.c_str(), data, dataLength, qos, 0);
+    scheduler.sent(classIndex, msg_id);
+    if (msg_id < 0) {
+        ESP_LOGE(LOG_TAG, "publishMessage(...): esp_mqtt_client_publish(...) failed!\ntopic:%s", topic.c_str());
+        return ESP_FAIL;
+    }
+
+    APP_DLOG("publishMessage(...): class=%u, qos=%d, msg_id=%d", classIndex, qos, msg_id);
+    return ESP_OK;
+}
+
+
+#if CONFIG_APP_LATENCY_TRACE
+// Publishes the latency histograms collected since the last report and starts a new window.
+void AppPublisher::publishLatencyStats() {
+    char msg[512];
+    int topicLength = std::snprintf(msg, sizeof(msg), "%s,", CONFIG_APP_LATENCY_STATS_TOPIC);
+    int statsLength = app_latency_format_stats(msg + topicLength, sizeof(msg) - topicLength);
+    app_latency_reset();
+
+    if (statsLength < 0 || topicLength + statsLength >= static_cast<int>(sizeof(msg))) {
+        ESP_LOGE(LOG_TAG, "publishLatencyStats(): statistics do not fit the buffer!");
+        return;
+    }
+
+    ESP_LOGI(LOG_TAG, "publishLatencyStats(): %s", msg + topicLength);
+    if (isBrokerConnected) {
+        publishMessage(msg, topicLength + statsLength);
+    }
+}
+#endif
+
+
+#if CONFIG_APP_HEAP_ACCOUNTING
+// Publishes the heap counters of every subsystem. They are never reset.
+void AppPublisher::publishHeapStats() {
+    char msg[768];
+    int topicLength = std::snprintf(msg, sizeof(msg), "%s,", CONFIG_APP_HEAP_STATS_TOPIC);
+    int statsLength = app_heap_format_stats(msg + topicLength, sizeof(msg) - topicLength);
+
+    if (statsLength < 0 || topicLength + statsLength >= static_cast<int>(sizeof(msg))) {
+        ESP_LOGE(LOG_TAG, "publishHeapStats(): statistics do not fit the buffer!");
+        return;
+    }
+
+    ESP_LOGI(LOG_TAG, "publishHeapStats(): %s", msg + topicLength);
+    if (isBrokerConnected) {
+        publishMessage(msg, topicLength + statsLength);
+    }
+}
+#endif
+
+
+void AppPublisher::published(int msg_id) {
+    scheduler.released(msg_id);
+}
+
+
+//-------------------------------------
+// C wrappers.
+//-------------------------------------
+void app_publisher_published(int msg_id) {
+    static_app_publisher.published(msg_id);
+}
+
+
+// The publisher starts before the network is up; until then everything goes to the outbox.
+void app_publisher_set_client(esp_mqtt_client_handle_t client) {
+    static_app_publisher.setClient(client);
+}
+
+
+void app_publisher_set_broker_connected(bool isConnected) {
+    static_app_publisher.setBrokerConnected(isConnected);
+}
+
+
+static void app_publisher_task_callback( void * parameters ) {
+    AppPublisher *appPublisher = static_cast<AppPublisher *>(parameters);
+    appPublisher->taskStart();
+}
+
+
+esp_err_t app_publisher_init(void) {
+    TaskHandle_t taskHandle = NULL;
+
+    static_app_publisher.init();
+
+    esp_err_t err_code = app_pipeline_create_task(APP_STAGE_PUBLISHER, app_publisher_task_callback, &static_app_publisher, &taskHandle);
+    if (err_code == ESP_OK) {
+        static_app_publisher.setTaskHandle(taskHandle);
+    } else {
+        ESP_LOGE(LOG_TAG, "app_publisher_init(): the App Publisher task could not be created!");
+        ESP_ERROR_CHECK(err_code);
+    }
+
+    return err_code;
+}
@@ -0,0 +1,101 @@
+/*  app_publisher.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+#ifndef _APP_PUBLISHER_H_
+#define _APP_PUBLISHER_H_
+
+#include <stdbool.h>
+#include "mqtt_client.h"
+
+
+//-------------------
+#ifdef __cplusplus
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "app_outbox.h"
+#include "app_publish_scheduler.h"
+#include "app_queues.h"
+
+
+//------------------------------------------------------------------------------
+// Drains spiReceivedQueue and publishes each "topic,data" message to the broker.
+// Runs in its own task so that upstream traffic is never gated by the SPI loop.
+// While the broker is unreachable messages are stored in the flash outbox
+// and replayed, in order, once the connection is back.
+class AppPublisher {
+public:
+    AppPublisher(const unsigned batchSize = 8);
+    virtual ~AppPublisher() { }
+
+    void init();
+    void taskStart();
+    // Called from the MQTT task when a QoS1/QoS2 publish has been acknowledged.
+    void published(int msg_id);
+    // Called from the MQTT task as the broker connection comes and goes.
+    void setBrokerConnected(bool isConnected) {
+        isBrokerConnected = isConnected;
+        if (!isConnected) {
+            scheduler.disconnected();
+        }
+    }
+
+    void setClient(esp_mqtt_client_handle_t client) {
+        this->client = client;
+    }
+
+    void setTaskHandle(TaskHandle_t taskHandle) {
+        this->taskHandle = taskHandle;
+    }
+
+private:
+    const unsigned batchSize;
+    esp_mqtt_client_handle_t client = nullptr;
+    TaskHandle_t taskHandle = nullptr;
+    PublishScheduler scheduler;
+    AppOutbox outbox;
+    volatile bool isBrokerConnected = false;
+
+    void task();
+    unsigned processOutgoingBatch(TickType_t queueReceiveDelay);
+    unsigned replayOutbox();
+    esp_err_t publishNode(const AppSPIQueueNode &node);
+    esp_err_t publishMessage(const char *msg, size_t msgLength);
+    esp_err_t stashMessage(const char *msg, size_t msgLength);
+#if CONFIG_APP_LATENCY_TRACE
+    void publishLatencyStats();
+#endif
+#if CONFIG_APP_HEAP_ACCOUNTING
+    void publishHeapStats();
+#endif
+    static esp_err_t replayCallback(void *context, const char *record, size_t recordLength);
+};
+
+#endif //__cplusplus
+//-------------------
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// C wrapper.
+extern esp_err_t app_publisher_init(void);
+extern void app_publisher_set_client(esp_mqtt_client_handle_t client);
+extern void app_publisher_published(int msg_id);
+extern void app_publisher_set_broker_connected(bool isConnected);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // _APP_PUBLISHER_H_
@@ -9,22 +9,33 @@
     CONDITIONS OF ANY KIND, either express or implied.
 */
 
+#include <cstring>
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 
+#include "app_deferred_log.h"
 #include "app_queues.h"
+#include "app_runtime_config.h"
 
 static const char *LOG_TAG = "APP_QUEUES";
 
+#if CONFIG_APP_RUNTIME_CONFIG
+// Held by producers while they send, and by the runtime configuration while it resizes.
+static SemaphoreHandle_t producerGate;
+static StaticSemaphore_t producerGateBuffer;
+#endif
+
 
 //-------------------------------------
 // MQTT Received Queue.
 //-------------------------------------
-#define MQTT_RX_QUEUE_LENGTH 4
-#define MQTT_RX_ITEM_SIZE sizeof( AppMQTTQueueNode * )
+// The length comes from the runtime configuration. The storage is reserved
+// for the longest queue it may ask for, so a resize never touches the heap.
+#define MQTT_RX_ITEM_SIZE sizeof( AppMQTTQueueNode )
 #if (configSUPPORT_STATIC_ALLOCATION == 1)
-static uint8_t mqttRxQueueStorage[ MQTT_RX_QUEUE_LENGTH * MQTT_RX_ITEM_SIZE ];
+static uint8_t mqttRxQueueStorage[ APP_QUEUE_MAX_LENGTH * MQTT_RX_ITEM_SIZE ];
 static StaticQueue_t mqttRxQueueBuffer;
 #endif // configSUPPORT_STATIC_ALLOCATION
 QueueHandle_t mqttReceivedQueue;
@@ -33,111 +44,143 @@ QueueHandle_t mqttReceivedQueue;
 //-------------------------------------
 // SPI Received Queue.
 //-------------------------------------
-#define SPI_RX_QUEUE_LENGTH 4
-#define SPI_RX_ITEM_SIZE sizeof( AppSPIQueueNode * )
+#define SPI_RX_ITEM_SIZE sizeof( AppSPIQueueNode )
 #if (configSUPPORT_STATIC_ALLOCATION == 1)
-static uint8_t spiRxQueueStorage[ SPI_RX_QUEUE_LENGTH * SPI_RX_ITEM_SIZE ];
+static uint8_t spiRxQueueStorage[ APP_QUEUE_MAX_LENGTH * SPI_RX_ITEM_SIZE ];
 static StaticQueue_t spiRxQueueBuffer;
 #endif // configSUPPORT_STATIC_ALLOCATION
 QueueHandle_t spiReceivedQueue;
 
 
-//-------------------------------------
-// SPI Transmit Queue.
-//-------------------------------------
-#define SPI_TX_QUEUE_LENGTH 4
-#define SPI_TX_ITEM_SIZE sizeof( AppSPIQueueNode * )
-#if (configSUPPORT_STATIC_ALLOCATION == 1)
-static uint8_t spiTxQueueStorage[ SPI_TX_QUEUE_LENGTH * SPI_TX_ITEM_SIZE ];
-static StaticQueue_t spiTxQueueBuffer;
-#endif // configSUPPORT_STATIC_ALLOCATION
-QueueHandle_t spiTransmitQueue;
-
-
-//-------------------------------------
-// app_queues_init()
-//-------------------------------------
-void app_queues_init(void) {
-    //----------------------
-    // MQTT Received Queue.
+static QueueHandle_t createMqttRxQueue(unsigned length) {
 #if (configSUPPORT_STATIC_ALLOCATION == 1)
-    mqttReceivedQueue = xQueueCreateStatic(
-        MQTT_RX_QUEUE_LENGTH,
+    return xQueueCreateStatic(
+        length,
         MQTT_RX_ITEM_SIZE,
         mqttRxQueueStorage,
         &mqttRxQueueBuffer
     );
 #else
-    mqttReceivedQueue = xQueueCreate(
-        MQTT_RX_QUEUE_LENGTH,
+    return xQueueCreate(
+        length,
         MQTT_RX_ITEM_SIZE
     );
 #endif
-    configASSERT(mqttReceivedQueue);
-    ESP_LOGI(LOG_TAG, "mqttReceivedQueue initialized.");
+}
 
-    //----------------------
-    // SPI Received Queue.
+
+static QueueHandle_t createSpiRxQueue(unsigned length) {
 #if (configSUPPORT_STATIC_ALLOCATION == 1)
-    spiReceivedQueue = xQueueCreateStatic(
-        SPI_RX_QUEUE_LENGTH,
+    return xQueueCreateStatic(
+        length,
         SPI_RX_ITEM_SIZE,
         spiRxQueueStorage,
         &spiRxQueueBuffer
     );
 #else
-    spiReceivedQueue = xQueueCreate(
-        SPI_RX_QUEUE_LENGTH,
+    return xQueueCreate(
+        length,
         SPI_RX_ITEM_SIZE
     );
 #endif
-    configASSERT(spiReceivedQueue);
-    ESP_LOGI(LOG_TAG, "spiReceivedQueue initialized.");
+}
+
+
+//-------------------------------------
+// app_queues_init()
+//-------------------------------------
+void app_queues_init(void) {
+    const app_runtime_config_t *config = app_runtime_config_get();
 
     //----------------------
-    // SPI Transmit Queue.
-#if (configSUPPORT_STATIC_ALLOCATION == 1)
-    spiTransmitQueue = xQueueCreateStatic(
-        SPI_TX_QUEUE_LENGTH,
-        SPI_TX_ITEM_SIZE,
-        spiTxQueueStorage,
-        &spiTxQueueBuffer
-    );
-#else
-    spiTransmitQueue = xQueueCreate(
-        SPI_TX_QUEUE_LENGTH,
-        SPI_TX_ITEM_SIZE
-    );
+    // MQTT Received Queue.
+    mqttReceivedQueue = createMqttRxQueue(config->mqttRxQueueLength);
+    configASSERT(mqttReceivedQueue);
+    ESP_LOGI(LOG_TAG, "mqttReceivedQueue initialized, length %u.", config->mqttRxQueueLength);
+
+    //----------------------
+    // SPI Received Queue.
+    spiReceivedQueue = createSpiRxQueue(config->spiRxQueueLength);
+    configASSERT(spiReceivedQueue);
+    ESP_LOGI(LOG_TAG, "spiReceivedQueue initialized, length %u.", config->spiRxQueueLength);
+
+#if CONFIG_APP_RUNTIME_CONFIG
+    producerGate = xSemaphoreCreateMutexStatic(&producerGateBuffer);
+    configASSERT(producerGate);
 #endif
-    configASSERT(spiTransmitQueue);
-    ESP_LOGI(LOG_TAG, "spiTransmitQueue initialized.");
 }
 
 
+#if CONFIG_APP_RUNTIME_CONFIG
+//-------------------------------------
+// Resizing.
+//-------------------------------------
+void app_queues_gate_enter(void) {
+    xSemaphoreTake(producerGate, portMAX_DELAY);
+}
+
+
+void app_queues_gate_exit(void) {
+    xSemaphoreGive(producerGate);
+}
+
+
+bool app_queues_close_gate(TickType_t ticksToWait) {
+    return xSemaphoreTake(producerGate, ticksToWait) == pdTRUE;
+}
+
+
+void app_queues_open_gate(void) {
+    xSemaphoreGive(producerGate);
+}
+
+
+esp_err_t app_queues_resize(unsigned mqttRxLength, unsigned spiRxLength) {
+    if (mqttRxLength == 0 || mqttRxLength > APP_QUEUE_MAX_LENGTH || spiRxLength == 0 || spiRxLength > APP_QUEUE_MAX_LENGTH) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // Whatever is still queued would be lost.
+    if (uxQueueMessagesWaiting(mqttReceivedQueue) > 0 || uxQueueMessagesWaiting(spiReceivedQueue) > 0) {
+        ESP_LOGE(LOG_TAG, "app_queues_resize(...): the queues are not empty!");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    vQueueDelete(mqttReceivedQueue);
+    mqttReceivedQueue = createMqttRxQueue(mqttRxLength);
+    configASSERT(mqttReceivedQueue);
+
+    vQueueDelete(spiReceivedQueue);
+    spiReceivedQueue = createSpiRxQueue(spiRxLength);
+    configASSERT(spiReceivedQueue);
+
+    ESP_LOGI(LOG_TAG, "app_queues_resize(...): mqttReceivedQueue length %u, spiReceivedQueue length %u.",
+        mqttRxLength, spiRxLength);
+    return ESP_OK;
+}
+#endif // CONFIG_APP_RUNTIME_CONFIG
+
+
+
+// The queues hold the nodes themselves, so FreeRTOS copies them in and out with memcpy.
+static_assert(std::is_trivially_copyable<AppMQTTQueueNode>::value, "AppMQTTQueueNode MUST be trivially copyable.");
+static_assert(std::is_trivially_copyable<AppSPIQueueNode>::value, "AppSPIQueueNode MUST be trivially copyable.");
+
 
 template<typename T>
 static esp_err_t sendToBack(T &node, QueueHandle_t queueHandle, TickType_t queueReceiveDelay) {
-    esp_err_t err_code = ESP_OK;
-    T *heapNode = new T(std::move(node));
-
-    BaseType_t result = xQueueSendToBack(queueHandle, &heapNode, queueReceiveDelay);
+    BaseType_t result = xQueueSendToBack(queueHandle, &node, queueReceiveDelay);
     if (result == pdFALSE) {
         // The queue was full and timed out.
-        ESP_LOGE(
-            LOG_TAG,
-            "queueSendToBack(...): Queue was full and timed out!\n%s\n",
-            heapNode->toString().c_str()
-        );
-
-        // The node did NOT get queued so delete it now to prevent memory leak.
-        delete heapNode;
-
+        char description[96];
+        if (node.format(description, sizeof(description)) >= static_cast<int>(sizeof(description))) {
+            std::strcpy(description + sizeof(description) - 4, "...");
+        }
+        ESP_LOGE(LOG_TAG, "queueSendToBack(...): Queue was full and timed out!\n%s\n", description);
         return ESP_ERR_TIMEOUT;
-    } else {
-        ESP_LOGV(LOG_TAG, "queueSendToBack(...) - message successfully queued.");
     }
 
-    return err_code;
+    APP_DLOG("queueSendToBack(...): node queued on %p.", queueHandle);
+    return ESP_OK;
 }
 
 template<typename T>
@@ -150,9 +193,11 @@ static esp_err_t sendToBack(T &node, QueueHandle_t queueHandle) {
 
 
 esp_err_t AppMQTTQueueNode::queueSendToBack(QueueHandle_t queueHandle) {
+    APP_LATENCY_STAMP(stamps, enqueueUs);
     return sendToBack<AppMQTTQueueNode>(*this, queueHandle);
 }
 esp_err_t AppMQTTQueueNode::queueSendToBack(QueueHandle_t queueHandle, TickType_t queueReceiveDelay) {
+    APP_LATENCY_STAMP(stamps, enqueueUs);
     return sendToBack<AppMQTTQueueNode>(*this, queueHandle, queueReceiveDelay);
 }
 
@@ -168,31 +213,9 @@ esp_err_t AppSPIQueueNode::queueSendToBack(QueueHandle_t queueHandle, TickType_t
 
 template<typename T>
 static esp_err_t receive(T &node, QueueHandle_t queueHandle, TickType_t queueReceiveDelay) {
-    esp_err_t err_code = ESP_FAIL;
-    T *heapNode = nullptr;
-
-    BaseType_t result = xQueueReceive(
-        queueHandle,
-        (void *)&heapNode,
-        queueReceiveDelay
-    );
-    ESP_LOGV(LOG_TAG,
-        "receive(...) heapNode is %s, result=%d",
-        heapNode ? "NOT NULL" : "NULL", result
-    );
-
-    // The default value of err_code is ESP_FAIL.
-    if (result == pdTRUE) {
-        if (heapNode) {
-            std::swap(node, *heapNode);
-            err_code = ESP_OK;
-        }
-    } else {
-        err_code = ESP_ERR_TIMEOUT;
-    }
-
-    delete heapNode;
-    return err_code;
+    BaseType_t result = xQueueReceive(queueHandle, &node, queueReceiveDelay);
+    APP_DLOG("receive(...): from %p, result=%d", queueHandle, result);
+    return (result == pdTRUE) ? ESP_OK : ESP_ERR_TIMEOUT;
 }
 
 template<typename T>
@@ -203,10 +226,18 @@ static esp_err_t receive(T &node, QueueHandle_t queueHandle) {
 
 
 esp_err_t AppMQTTQueueNode::queueReceive(QueueHandle_t queueHandle) {
-    return receive<AppMQTTQueueNode>(*this, queueHandle);
+    esp_err_t err_code = receive<AppMQTTQueueNode>(*this, queueHandle);
+    if (err_code == ESP_OK) {
+        APP_LATENCY_STAMP(stamps, dequeueUs);
+    }
+    return err_code;
 }
 esp_err_t AppMQTTQueueNode::queueReceive(QueueHandle_t queueHandle, TickType_t queueReceiveDelay) {
-    return receive<AppMQTTQueueNode>(*this, queueHandle, queueReceiveDelay);
+    esp_err_t err_code = receive<AppMQTTQueueNode>(*this, queueHandle, queueReceiveDelay);
+    if (err_code == ESP_OK) {
+        APP_LATENCY_STAMP(stamps, dequeueUs);
+    }
+    return err_code;
 }
 
 
@@ -217,3 +248,15 @@ esp_err_t AppSPIQueueNode::queueReceive(QueueHandle_t queueHandle, TickType_t qu
     return receive<AppSPIQueueNode>(*this, queueHandle, queueReceiveDelay);
 }
 
+
+esp_err_t app_queues_send_upstream(const char *msg) {
+    AppSPIQueueNode node(msg);
+    if (node.isTruncated()) {
+        ESP_LOGE(LOG_TAG, "app_queues_send_upstream(...): message longer than %u bytes dropped!", APP_SPI_MESSAGE_CAPACITY);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    app_queues_gate_enter();
+    esp_err_t err_code = node.queueSendToBack(spiReceivedQueue);
+    app_queues_gate_exit();
+    return err_code;
+}
@@ -11,49 +11,81 @@
 #ifndef _APP_QUEUES_H_
 #define _APP_QUEUES_H_
 
+#include "sdkconfig.h"
+#include "esp_err.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 
+#include "app_latency_trace.h"
+
+
+// Largest topic and data carried by an AppMQTTQueueNode. Anything longer is
+// rejected where the node is made. The peripheral sizes its message buffer
+// for the longest "topic,data" these allow (MSG_BUFFER_SIZE in
+// arduino_spi_master.ino), so change both together.
+#define APP_MQTT_TOPIC_CAPACITY 64
+#define APP_MQTT_DATA_CAPACITY  96
+
+// Largest "topic,data" message carried by an AppSPIQueueNode, from the SPI
+// peripheral or the UART.
+#define APP_SPI_MESSAGE_CAPACITY 256
+
+// Length of mqttReceivedQueue and spiReceivedQueue unless the runtime
+// configuration says otherwise, and the longest it may ask for.
+#define APP_QUEUE_DEFAULT_LENGTH 4
+#if CONFIG_APP_RUNTIME_CONFIG
+#define APP_QUEUE_MAX_LENGTH CONFIG_APP_QUEUE_MAX_LENGTH
+#else
+#define APP_QUEUE_MAX_LENGTH APP_QUEUE_DEFAULT_LENGTH
+#endif
+
 
 //-------------------
 #ifdef __cplusplus
-#include <sstream>
-#include <string>
+#include <type_traits>
+
+#include "app_fixed_string.h"
+
+
+typedef FixedString<APP_MQTT_TOPIC_CAPACITY> MqttTopicString;
+typedef FixedString<APP_MQTT_DATA_CAPACITY> MqttDataString;
+typedef FixedString<APP_SPI_MESSAGE_CAPACITY> SpiMessageString;
 
 
 //*************************************
+// Nodes are copied into and out of the queues by value, so they never touch the heap.
 class AppMQTTQueueNode {
 public:
     AppMQTTQueueNode() = default;
     explicit AppMQTTQueueNode(const char *topic, size_t topicSize, const char *data, size_t dataSize)
-        : topic{topic, topicSize}, data{data, dataSize}
+        : topic{StringView(topic, topicSize)}, data{StringView(data, dataSize)}
     { }
-    ~AppMQTTQueueNode() = default;
-
-     // Disallow Copy.
-    AppMQTTQueueNode(const AppMQTTQueueNode&) = delete;
-    AppMQTTQueueNode& operator=(const AppMQTTQueueNode&) = delete;
 
-    // Implement Move.
-    AppMQTTQueueNode(AppMQTTQueueNode&&) = default;
-    AppMQTTQueueNode& operator=(AppMQTTQueueNode&&) = default;
-
-    const std::string & getTopic() const { return topic; }
-    const std::string & getData()  const { return data; }
+    const MqttTopicString & getTopic() const { return topic; }
+    const MqttDataString & getData()  const { return data; }
+    // True if the topic or data did not fit.
+    bool isTruncated() const { return topic.truncated() || data.truncated(); }
+#if CONFIG_APP_LATENCY_TRACE
+    LatencyStamps & getStamps() { return stamps; }
+    const LatencyStamps & getStamps() const { return stamps; }
+#endif
 
     esp_err_t queueSendToBack(QueueHandle_t queueHandle);
     esp_err_t queueSendToBack(QueueHandle_t queueHandle, TickType_t queueReceiveDelay);
     esp_err_t queueReceive(QueueHandle_t queueHandle);
     esp_err_t queueReceive(QueueHandle_t queueHandle, TickType_t queueReceiveDelay);
 
-    std::string toString() const {
-        std::stringstream sstr;
-        sstr << "topic:" << topic << ", data:" << data;
-        return sstr.str();
+    // snprintf style, for logging.
+    int format(char *buffer, size_t bufferSize) const {
+        return snprintf(buffer, bufferSize, "topic:%s, data:%s", topic.c_str(), data.c_str());
     }
 
 private:
-    std::string topic, data;
+    MqttTopicString topic;
+    MqttDataString data;
+#if CONFIG_APP_LATENCY_TRACE
+    LatencyStamps stamps = {};
+#endif
 };
 
 
@@ -61,31 +93,24 @@ private:
 class AppSPIQueueNode {
 public:
     AppSPIQueueNode() = default;
-    explicit AppSPIQueueNode(const char *data) : data{data}
+    explicit AppSPIQueueNode(StringView data) : data{data}
     { }
-    ~AppSPIQueueNode() = default;
-
-    //AppSPIQueueNode(const AppSPIQueueNode&) = default;
-    AppSPIQueueNode(AppSPIQueueNode&&) = default;
-    //AppSPIQueueNode& operator=(const AppSPIQueueNode&) = default;
-    AppSPIQueueNode& operator=(AppSPIQueueNode&&) = default;
 
-    const std::string & getData()  const { return data; }
+    const SpiMessageString & getData()  const { return data; }
+    bool isTruncated() const { return data.truncated(); }
 
     esp_err_t queueSendToBack(QueueHandle_t queueHandle);
     esp_err_t queueSendToBack(QueueHandle_t queueHandle, TickType_t queueReceiveDelay);
     esp_err_t queueReceive(QueueHandle_t queueHandle);
     esp_err_t queueReceive(QueueHandle_t queueHandle, TickType_t queueReceiveDelay);
 
-    std::string toString() const {
-        return std::string( "data:" + data);
-        //std::stringstream sstr;
-        //sstr << "data:" << data;
-        //return sstr.str();
+    // snprintf style, for logging.
+    int format(char *buffer, size_t bufferSize) const {
+        return snprintf(buffer, bufferSize, "data:%s", data.c_str());
     }
 
 private:
-    std::string data;
+    SpiMessageString data;
 };
 
 
@@ -106,10 +131,29 @@ extern "C"
 
 extern QueueHandle_t mqttReceivedQueue;
 extern QueueHandle_t spiReceivedQueue;
-extern QueueHandle_t spiTransmitQueue;
 
 // c wrapper.
+// Creates the queues with the lengths from app_runtime_config_get().
 extern void app_queues_init(void);
+// Queues a "topic,data" message for publishing, as if it came from the SPI peripheral.
+extern esp_err_t app_queues_send_upstream(const char *msg);
+
+#if CONFIG_APP_RUNTIME_CONFIG
+// Producers that are not parked by the runtime configuration (MQTT ingest,
+// UART ingest) send inside the gate, so the queues are never recreated under
+// them. app_queues_send_upstream() does this itself.
+extern void app_queues_gate_enter(void);
+extern void app_queues_gate_exit(void);
+// Keeps producers out. Returns false if one held the gate for longer than ticksToWait.
+extern bool app_queues_close_gate(TickType_t ticksToWait);
+extern void app_queues_open_gate(void);
+// Recreates both queues, empty, with new lengths. Only call with the gate
+// closed and the SPI and publisher tasks parked.
+extern esp_err_t app_queues_resize(unsigned mqttRxLength, unsigned spiRxLength);
+#else
+static inline void app_queues_gate_enter(void) { }
+static inline void app_queues_gate_exit(void) { }
+#endif
 
 #ifdef __cplusplus
 }
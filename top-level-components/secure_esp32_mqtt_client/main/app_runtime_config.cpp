@@ -0,0 +1,836 @@
+/*  app_runtime_config.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include "esp_log.h"
+
+#include "app_queues.h"
+#include "app_runtime_config.h"
+#include "app_spi.h"
+
+
+// AppSPI queues every transaction of a message at once, so the pool must hold
+// the longest "topic,data" message and its terminator.
+#define SPI_POOL_MIN_BYTES (APP_MQTT_TOPIC_CAPACITY + 1 + APP_MQTT_DATA_CAPACITY + 1)
+
+static_assert(APP_SPI_DEFAULT_QUEUE_SIZE * APP_SPI_DEFAULT_TRANSACTION_LENGTH >= SPI_POOL_MIN_BYTES,
+    "The default SPI pool MUST hold the longest message.");
+
+static const app_runtime_config_t DEFAULT_CONFIG = {
+    APP_QUEUE_DEFAULT_LENGTH,           //mqttRxQueueLength
+    APP_QUEUE_DEFAULT_LENGTH,           //spiRxQueueLength
+    APP_SPI_DEFAULT_QUEUE_SIZE,         //spiQueueSize
+    APP_SPI_DEFAULT_TRANSACTION_LENGTH, //spiTransactionLength
+    1,                                  //spiPollTicks
+    1000,                               //publisherPollMs
+    ESP_LOG_INFO,                       //logLevel
+    0,                                  //tagLogLevelCount
+    {}                                  //tagLogLevels
+};
+
+// Other tasks only read the uint16_t fields, which are written in one go.
+static app_runtime_config_t currentConfig = DEFAULT_CONFIG;
+
+
+//-------------------------------------
+// C wrappers.
+//-------------------------------------
+const app_runtime_config_t *app_runtime_config_get(void) {
+    return &currentConfig;
+}
+
+
+#if CONFIG_APP_RUNTIME_CONFIG
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "nvs.h"
+
+#include "app_fixed_string.h"
+#include "app_heap_stats.h"
+#include "app_stack_monitor.h"
+
+
+static const char *LOG_TAG = "APP_CONFIG";
+
+static const char *NVS_NAMESPACE = "app_config";
+static const char *NVS_KEY = "runtime";
+
+static const char        *CONFIG_TASK_NAME = "App Config";
+static const uint32_t     CONFIG_TASK_STACK_DEPTH = 3072;
+static const UBaseType_t  CONFIG_TASK_PRIORITY = 2;
+
+// How long a producer may hold the queue gate, and each stage may take to drain and park.
+static const TickType_t GATE_TIMEOUT = 1000 / portTICK_PERIOD_MS;
+static const TickType_t PARK_TIMEOUT = 5000 / portTICK_PERIOD_MS;
+static const TickType_t PARK_POLL_DELAY = 10 / portTICK_PERIOD_MS;
+
+// Longest payload taken from the config topic.
+#define CONFIG_PAYLOAD_CAPACITY 512
+// The binary encoding with every tag at its longest.
+#define CONFIG_BINARY_CAPACITY (17 + APP_CONFIG_MAX_TAG_LEVELS * (APP_CONFIG_TAG_CAPACITY + 1))
+#define CONFIG_ERROR_CAPACITY 80
+#define CONFIG_STATUS_SUFFIX "/status"
+
+static const uint8_t BINARY_MAGIC_0 = 'R';
+static const uint8_t BINARY_MAGIC_1 = 'C';
+static const size_t BINARY_FIELDS_OFFSET = 4;
+
+static const char *LOG_LEVEL_NAMES[] = { "none", "error", "warn", "info", "debug", "verbose" };
+static const unsigned LOG_LEVEL_COUNT = sizeof(LOG_LEVEL_NAMES) / sizeof(LOG_LEVEL_NAMES[0]);
+
+// The numeric fields, in the order of the binary encoding, with their valid ranges.
+struct ConfigField {
+    const char *key;
+    size_t offset;
+    uint16_t minValue;
+    uint16_t maxValue;
+};
+
+static const ConfigField CONFIG_FIELDS[] = {
+    //key                       offset                                                  min   max
+    { "mqttRxQueueLength",      offsetof(app_runtime_config_t, mqttRxQueueLength),      1,    APP_QUEUE_MAX_LENGTH },
+    { "spiRxQueueLength",       offsetof(app_runtime_config_t, spiRxQueueLength),       1,    APP_QUEUE_MAX_LENGTH },
+    { "spiQueueSize",           offsetof(app_runtime_config_t, spiQueueSize),           1,    16 },
+    { "spiTransactionLength",   offsetof(app_runtime_config_t, spiTransactionLength),   4,    256 },
+    { "spiPollTicks",           offsetof(app_runtime_config_t, spiPollTicks),           1,    100 },
+    { "publisherPollMs",        offsetof(app_runtime_config_t, publisherPollMs),        10,   10000 },
+};
+static const unsigned CONFIG_FIELD_COUNT = sizeof(CONFIG_FIELDS) / sizeof(CONFIG_FIELDS[0]);
+
+static uint16_t & fieldValue(app_runtime_config_t &config, const ConfigField &field) {
+    return *reinterpret_cast<uint16_t *>(reinterpret_cast<uint8_t *>(&config) + field.offset);
+}
+
+static uint16_t fieldValue(const app_runtime_config_t &config, const ConfigField &field) {
+    return *reinterpret_cast<const uint16_t *>(reinterpret_cast<const uint8_t *>(&config) + field.offset);
+}
+
+
+// A complete message from the config topic, handed from the MQTT task to the config task.
+struct ConfigPayload {
+    uint16_t length;
+    bool isTooLong;
+    char data[CONFIG_PAYLOAD_CAPACITY];
+};
+
+static char configTopic[sizeof(CONFIG_APP_CONFIG_TOPIC_PREFIX) + 16];
+static size_t configTopicLength = 0;
+
+// Only touched by the MQTT task.
+static ConfigPayload receivedPayload;
+
+// Holds the newest payload only; an older one not yet applied is replaced.
+static QueueHandle_t payloadQueue;
+static StaticQueue_t payloadQueueBuffer;
+static uint8_t payloadQueueStorage[sizeof(ConfigPayload)];
+
+// Only touched by the config task.
+static ConfigPayload pendingPayload;
+
+// Parking. Bits are app_stage_t values.
+static portMUX_TYPE parkMux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t joinedStages = 0;
+static volatile uint32_t requestedStages = 0;
+static uint32_t parkedStages = 0;
+static SemaphoreHandle_t resumeSemaphores[APP_STAGE_COUNT];
+static StaticSemaphore_t resumeSemaphoreBuffers[APP_STAGE_COUNT];
+
+
+static bool formatError(char *error, size_t errorSize, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    std::vsnprintf(error, errorSize, format, args);
+    va_end(args);
+    return false;
+}
+
+
+//-------------------------------------
+// Validation.
+//-------------------------------------
+static bool validate(const app_runtime_config_t &config, char *error, size_t errorSize) {
+    for (unsigned index = 0; index < CONFIG_FIELD_COUNT; ++index) {
+        const ConfigField &field = CONFIG_FIELDS[index];
+        uint16_t value = fieldValue(config, field);
+        if (value < field.minValue || value > field.maxValue) {
+            return formatError(error, errorSize, "%s: %u is not in %u..%u",
+                field.key, value, field.minValue, field.maxValue);
+        }
+    }
+    if (config.spiTransactionLength % 4 != 0) {
+        return formatError(error, errorSize, "spiTransactionLength: not a multiple of 4");
+    }
+    if (static_cast<unsigned>(config.spiQueueSize) * config.spiTransactionLength < SPI_POOL_MIN_BYTES) {
+        return formatError(error, errorSize, "spiQueueSize * spiTransactionLength: %u is less than %u",
+            static_cast<unsigned>(config.spiQueueSize) * config.spiTransactionLength, SPI_POOL_MIN_BYTES);
+    }
+    if (config.logLevel >= LOG_LEVEL_COUNT) {
+        return formatError(error, errorSize, "logLevel: no level %u", config.logLevel);
+    }
+    if (config.tagLogLevelCount > APP_CONFIG_MAX_TAG_LEVELS) {
+        return formatError(error, errorSize, "logLevels: more than %u tags", APP_CONFIG_MAX_TAG_LEVELS);
+    }
+    for (unsigned index = 0; index < config.tagLogLevelCount; ++index) {
+        const app_tag_log_level_t &tagLevel = config.tagLogLevels[index];
+        if (tagLevel.tag[0] == '\0' || tagLevel.level >= LOG_LEVEL_COUNT) {
+            return formatError(error, errorSize, "logLevels: bad entry %u", index);
+        }
+    }
+    return true;
+}
+
+
+// The fields that need the pipeline rebuilt.
+static bool isSameStructure(const app_runtime_config_t &a, const app_runtime_config_t &b) {
+    return a.mqttRxQueueLength == b.mqttRxQueueLength
+        && a.spiRxQueueLength == b.spiRxQueueLength
+        && a.spiQueueSize == b.spiQueueSize
+        && a.spiTransactionLength == b.spiTransactionLength;
+}
+
+
+static const app_tag_log_level_t *findTag(const app_runtime_config_t &config, const char *tag) {
+    for (unsigned index = 0; index < config.tagLogLevelCount; ++index) {
+        if (std::strcmp(config.tagLogLevels[index].tag, tag) == 0) {
+            return &config.tagLogLevels[index];
+        }
+    }
+    return nullptr;
+}
+
+
+static bool isSameLogLevels(const app_runtime_config_t &a, const app_runtime_config_t &b) {
+    if (a.logLevel != b.logLevel || a.tagLogLevelCount != b.tagLogLevelCount) {
+        return false;
+    }
+    for (unsigned index = 0; index < a.tagLogLevelCount; ++index) {
+        const app_tag_log_level_t *other = findTag(b, a.tagLogLevels[index].tag);
+        if (!other || other->level != a.tagLogLevels[index].level) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+static bool isSame(const app_runtime_config_t &a, const app_runtime_config_t &b) {
+    return isSameStructure(a, b)
+        && a.spiPollTicks == b.spiPollTicks
+        && a.publisherPollMs == b.publisherPollMs
+        && isSameLogLevels(a, b);
+}
+
+
+//-------------------------------------
+// Binary encoding.
+//-------------------------------------
+static size_t encodeBinary(const app_runtime_config_t &config, uint8_t *buffer) {
+    size_t length = 0;
+    buffer[length++] = BINARY_MAGIC_0;
+    buffer[length++] = BINARY_MAGIC_1;
+    buffer[length++] = APP_CONFIG_BINARY_VERSION;
+    buffer[length++] = config.logLevel;
+    for (unsigned index = 0; index < CONFIG_FIELD_COUNT; ++index) {
+        uint16_t value = fieldValue(config, CONFIG_FIELDS[index]);
+        buffer[length++] = static_cast<uint8_t>(value);
+        buffer[length++] = static_cast<uint8_t>(value >> 8);
+    }
+    buffer[length++] = config.tagLogLevelCount;
+    for (unsigned index = 0; index < config.tagLogLevelCount; ++index) {
+        const app_tag_log_level_t &tagLevel = config.tagLogLevels[index];
+        size_t tagLength = std::strlen(tagLevel.tag);
+        buffer[length++] = static_cast<uint8_t>(tagLength);
+        std::memcpy(buffer + length, tagLevel.tag, tagLength);
+        length += tagLength;
+        buffer[length++] = tagLevel.level;
+    }
+    return length;
+}
+
+
+static bool decodeBinary(const uint8_t *data, size_t length, app_runtime_config_t &config,
+                         char *error, size_t errorSize) {
+    const size_t fieldsEnd = BINARY_FIELDS_OFFSET + CONFIG_FIELD_COUNT * 2;
+    if (length < fieldsEnd + 1 || data[0] != BINARY_MAGIC_0 || data[1] != BINARY_MAGIC_1) {
+        return formatError(error, errorSize, "binary: too short");
+    }
+    if (data[2] != APP_CONFIG_BINARY_VERSION) {
+        return formatError(error, errorSize, "binary: version %u, expected %u", data[2], APP_CONFIG_BINARY_VERSION);
+    }
+
+    config = DEFAULT_CONFIG;
+    config.logLevel = data[3];
+    for (unsigned index = 0; index < CONFIG_FIELD_COUNT; ++index) {
+        const uint8_t *value = data + BINARY_FIELDS_OFFSET + index * 2;
+        fieldValue(config, CONFIG_FIELDS[index]) = static_cast<uint16_t>(value[0] | (value[1] << 8));
+    }
+
+    size_t position = fieldsEnd;
+    unsigned tagCount = data[position++];
+    if (tagCount > APP_CONFIG_MAX_TAG_LEVELS) {
+        return formatError(error, errorSize, "logLevels: more than %u tags", APP_CONFIG_MAX_TAG_LEVELS);
+    }
+    for (unsigned index = 0; index < tagCount; ++index) {
+        if (position >= length) {
+            return formatError(error, errorSize, "binary: truncated");
+        }
+        size_t tagLength = data[position++];
+        if (tagLength == 0 || tagLength >= APP_CONFIG_TAG_CAPACITY || position + tagLength + 1 > length) {
+            return formatError(error, errorSize, "binary: bad tag %u", index);
+        }
+        app_tag_log_level_t &tagLevel = config.tagLogLevels[index];
+        std::memcpy(tagLevel.tag, data + position, tagLength);
+        tagLevel.tag[tagLength] = '\0';
+        position += tagLength;
+        tagLevel.level = data[position++];
+    }
+    config.tagLogLevelCount = static_cast<uint8_t>(tagCount);
+
+    if (position != length) {
+        return formatError(error, errorSize, "binary: %u trailing bytes", static_cast<unsigned>(length - position));
+    }
+    return true;
+}
+
+
+//-------------------------------------
+// JSON.
+//-------------------------------------
+// Only what a config needs: one flat object of numbers and level names, plus
+// "logLevels", an object of tag to level. No escapes, no nesting beyond that.
+class ConfigJsonParser {
+public:
+    ConfigJsonParser(const char *json, size_t length, char *error, size_t errorSize)
+        : start(json), position(json), end(json + length), error(error), errorSize(errorSize)
+    { }
+
+    bool parse(app_runtime_config_t &config) {
+        config = DEFAULT_CONFIG;
+        if (!consume('{')) {
+            return fail("expected '{'");
+        }
+        if (consume('}')) {
+            return isAtEnd();
+        }
+        do {
+            StringView key;
+            if (!parseString(key) || !(consume(':') || fail("expected ':'")) || !parseMember(key, config)) {
+                return false;
+            }
+        } while (consume(','));
+        if (!consume('}')) {
+            return fail("expected ',' or '}'");
+        }
+        return isAtEnd();
+    }
+
+private:
+    const char *start;
+    const char *position;
+    const char *end;
+    char *error;
+    size_t errorSize;
+
+    bool fail(const char *message) {
+        return formatError(error, errorSize, "json: %s at offset %u", message, static_cast<unsigned>(position - start));
+    }
+
+    void skipSpace() {
+        while (position < end && (*position == ' ' || *position == '\t' || *position == '\r' || *position == '\n')) {
+            ++position;
+        }
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (position < end && *position == c) {
+            ++position;
+            return true;
+        }
+        return false;
+    }
+
+    bool isAtEnd() {
+        skipSpace();
+        return (position == end) ? true : fail("trailing characters");
+    }
+
+    bool parseString(StringView &str) {
+        if (!consume('"')) {
+            return fail("expected a string");
+        }
+        const char *first = position;
+        while (position < end && *position != '"') {
+            if (*position == '\\') {
+                return fail("escapes are not supported");
+            }
+            ++position;
+        }
+        if (position == end) {
+            return fail("unterminated string");
+        }
+        str = StringView(first, position - first);
+        ++position;
+        return true;
+    }
+
+    bool parseNumber(StringView key, uint16_t &value) {
+        skipSpace();
+        uint32_t number = 0;
+        const char *digits = position;
+        while (position < end && *position >= '0' && *position <= '9' && number <= 0xFFFF) {
+            number = number * 10 + (*position - '0');
+            ++position;
+        }
+        if (position == digits || number > 0xFFFF) {
+            return formatError(error, errorSize, "%.*s: expected a number up to 65535",
+                static_cast<int>(key.size()), key.data());
+        }
+        value = static_cast<uint16_t>(number);
+        return true;
+    }
+
+    // A name from LOG_LEVEL_NAMES or its number.
+    bool parseLevel(StringView key, uint8_t &level) {
+        skipSpace();
+        if (position < end && *position == '"') {
+            StringView name;
+            if (!parseString(name)) {
+                return false;
+            }
+            for (unsigned index = 0; index < LOG_LEVEL_COUNT; ++index) {
+                if (name.equals(LOG_LEVEL_NAMES[index])) {
+                    level = static_cast<uint8_t>(index);
+                    return true;
+                }
+            }
+            return formatError(error, errorSize, "%.*s: unknown level \"%.*s\"",
+                static_cast<int>(key.size()), key.data(), static_cast<int>(name.size()), name.data());
+        }
+        uint16_t value = 0;
+        if (!parseNumber(key, value)) {
+            return false;
+        }
+        level = static_cast<uint8_t>((value < LOG_LEVEL_COUNT) ? value : LOG_LEVEL_COUNT);
+        return true;
+    }
+
+    bool parseTagLevels(app_runtime_config_t &config) {
+        if (!consume('{')) {
+            return fail("logLevels: expected '{'");
+        }
+        config.tagLogLevelCount = 0;
+        if (consume('}')) {
+            return true;
+        }
+        do {
+            StringView tag;
+            if (!parseString(tag) || !(consume(':') || fail("expected ':'"))) {
+                return false;
+            }
+            if (tag.empty() || tag.size() >= APP_CONFIG_TAG_CAPACITY) {
+                return formatError(error, errorSize, "logLevels: tag \"%.*s\" is empty or longer than %u",
+                    static_cast<int>(tag.size()), tag.data(), APP_CONFIG_TAG_CAPACITY - 1);
+            }
+            if (config.tagLogLevelCount >= APP_CONFIG_MAX_TAG_LEVELS) {
+                return formatError(error, errorSize, "logLevels: more than %u tags", APP_CONFIG_MAX_TAG_LEVELS);
+            }
+            app_tag_log_level_t &tagLevel = config.tagLogLevels[config.tagLogLevelCount];
+            std::memcpy(tagLevel.tag, tag.data(), tag.size());
+            tagLevel.tag[tag.size()] = '\0';
+            if (!parseLevel(tag, tagLevel.level)) {
+                return false;
+            }
+            ++config.tagLogLevelCount;
+        } while (consume(','));
+        return consume('}') ? true : fail("logLevels: expected ',' or '}'");
+    }
+
+    bool parseMember(StringView key, app_runtime_config_t &config) {
+        for (unsigned index = 0; index < CONFIG_FIELD_COUNT; ++index) {
+            if (key.equals(CONFIG_FIELDS[index].key)) {
+                return parseNumber(key, fieldValue(config, CONFIG_FIELDS[index]));
+            }
+        }
+        if (key.equals("logLevel")) {
+            return parseLevel(key, config.logLevel);
+        }
+        if (key.equals("logLevels")) {
+            return parseTagLevels(config);
+        }
+        // A misspelt key would otherwise quietly take its default.
+        return formatError(error, errorSize, "unknown key \"%.*s\"", static_cast<int>(key.size()), key.data());
+    }
+};
+
+
+// An empty payload is the defaults.
+static bool parsePayload(const char *data, size_t length, app_runtime_config_t &config,
+                         char *error, size_t errorSize) {
+    if (length == 0) {
+        config = DEFAULT_CONFIG;
+        return true;
+    }
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+    if (length >= 2 && bytes[0] == BINARY_MAGIC_0 && bytes[1] == BINARY_MAGIC_1) {
+        return decodeBinary(bytes, length, config, error, errorSize)
+            && validate(config, error, errorSize);
+    }
+    ConfigJsonParser parser(data, length, error, errorSize);
+    return parser.parse(config) && validate(config, error, errorSize);
+}
+
+
+//-------------------------------------
+// NVS.
+//-------------------------------------
+static void load() {
+    nvs_handle nvsHandle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvsHandle) != ESP_OK) {
+        return;
+    }
+
+    uint8_t buffer[CONFIG_BINARY_CAPACITY];
+    size_t length = sizeof(buffer);
+    esp_err_t err_code = nvs_get_blob(nvsHandle, NVS_KEY, buffer, &length);
+    nvs_close(nvsHandle);
+    if (err_code != ESP_OK) {
+        return;
+    }
+
+    app_runtime_config_t config;
+    char error[CONFIG_ERROR_CAPACITY];
+    if (!decodeBinary(buffer, length, config, error, sizeof(error)) || !validate(config, error, sizeof(error))) {
+        ESP_LOGE(LOG_TAG, "load(): saved configuration ignored, %s.", error);
+        return;
+    }
+    currentConfig = config;
+    ESP_LOGI(LOG_TAG, "load(): saved configuration loaded.");
+}
+
+
+// The defaults are not stored, so a later build can change them.
+static void save(const app_runtime_config_t &config) {
+    nvs_handle nvsHandle;
+    esp_err_t err_code = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvsHandle);
+    if (err_code != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "save(): nvs_open(...) failed, err_code=0x%x", err_code);
+        return;
+    }
+
+    if (isSame(config, DEFAULT_CONFIG)) {
+        err_code = nvs_erase_key(nvsHandle, NVS_KEY);
+        if (err_code == ESP_ERR_NVS_NOT_FOUND) {
+            err_code = ESP_OK;
+        }
+    } else {
+        uint8_t buffer[CONFIG_BINARY_CAPACITY];
+        err_code = nvs_set_blob(nvsHandle, NVS_KEY, buffer, encodeBinary(config, buffer));
+    }
+    if (err_code == ESP_OK) {
+        err_code = nvs_commit(nvsHandle);
+    }
+    nvs_close(nvsHandle);
+
+    if (err_code != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "save(): failed, err_code=0x%x. Applied, but not kept across a reboot.", err_code);
+    }
+}
+
+
+//-------------------------------------
+// Applying.
+//-------------------------------------
+// Setting "*" also drops every per-tag level, including those set in code,
+// so it is only done when logLevel changes.
+static void applyLogLevels(const app_runtime_config_t &from, const app_runtime_config_t &to) {
+    if (to.logLevel != from.logLevel) {
+        esp_log_level_set("*", static_cast<esp_log_level_t>(to.logLevel));
+    } else {
+        for (unsigned index = 0; index < from.tagLogLevelCount; ++index) {
+            const char *tag = from.tagLogLevels[index].tag;
+            if (!findTag(to, tag)) {
+                esp_log_level_set(tag, static_cast<esp_log_level_t>(to.logLevel));
+            }
+        }
+    }
+    for (unsigned index = 0; index < to.tagLogLevelCount; ++index) {
+        esp_log_level_set(to.tagLogLevels[index].tag, static_cast<esp_log_level_t>(to.tagLogLevels[index].level));
+    }
+}
+
+
+// Called with parkMux held.
+static bool isParked(app_stage_t stage) {
+    uint32_t bit = 1u << stage;
+    return !(joinedStages & bit) || (parkedStages & bit);
+}
+
+
+static bool waitForPark(app_stage_t stage) {
+    portENTER_CRITICAL(&parkMux);
+    requestedStages |= 1u << stage;
+    portEXIT_CRITICAL(&parkMux);
+
+    TickType_t startTicks = xTaskGetTickCount();
+    while (true) {
+        portENTER_CRITICAL(&parkMux);
+        bool isStageParked = isParked(stage);
+        portEXIT_CRITICAL(&parkMux);
+        if (isStageParked) {
+            return true;
+        }
+        if (xTaskGetTickCount() - startTicks >= PARK_TIMEOUT) {
+            ESP_LOGW(LOG_TAG, "waitForPark(): %s did not drain in time.", app_pipeline_get(stage)->taskName);
+            return false;
+        }
+        vTaskDelay(PARK_POLL_DELAY);
+    }
+}
+
+
+static void resumeAll() {
+    portENTER_CRITICAL(&parkMux);
+    uint32_t toResume = parkedStages;
+    requestedStages = 0;
+    parkedStages = 0;
+    portEXIT_CRITICAL(&parkMux);
+
+    for (unsigned stage = 0; stage < APP_STAGE_COUNT; ++stage) {
+        if (toResume & (1u << stage)) {
+            xSemaphoreGive(resumeSemaphores[stage]);
+        }
+    }
+}
+
+
+// Brings the pipeline to a quiescent point, rebuilds the queues and the SPI
+// transaction pool, and lets it go again, whatever happened.
+static bool rebuildPipeline(const app_runtime_config_t &config, char *error, size_t errorSize) {
+    if (!app_queues_close_gate(GATE_TIMEOUT)) {
+        return formatError(error, errorSize, "a producer held the queue gate too long");
+    }
+
+    esp_err_t err_code = ESP_ERR_TIMEOUT;
+    // The SPI task feeds the publisher, so it parks first.
+    if (waitForPark(APP_STAGE_SPI_LINK) && waitForPark(APP_STAGE_PUBLISHER)) {
+        app_heap_reinit_begin();
+        err_code = app_queues_resize(config.mqttRxQueueLength, config.spiRxQueueLength);
+        if (err_code == ESP_OK) {
+            err_code = app_spi_reconfigure(config.spiQueueSize, config.spiTransactionLength);
+            if (err_code != ESP_OK) {
+                // Keep the queues and the pool consistent with currentConfig.
+                app_queues_resize(currentConfig.mqttRxQueueLength, currentConfig.spiRxQueueLength);
+            }
+        }
+        app_heap_reinit_end();
+    }
+
+    resumeAll();
+    app_queues_open_gate();
+
+    if (err_code == ESP_ERR_TIMEOUT) {
+        return formatError(error, errorSize, "the pipeline did not drain in time");
+    }
+    if (err_code != ESP_OK) {
+        return formatError(error, errorSize, "rebuild failed, err_code=0x%x", err_code);
+    }
+    return true;
+}
+
+
+// Returns the result for the status message, or nullptr with error filled in.
+static const char *apply(const app_runtime_config_t &config, char *error, size_t errorSize) {
+    if (isSame(config, currentConfig)) {
+        return "unchanged";
+    }
+    if (!isSameStructure(config, currentConfig) && !rebuildPipeline(config, error, errorSize)) {
+        return nullptr;
+    }
+
+    app_runtime_config_t previous = currentConfig;
+    currentConfig.mqttRxQueueLength = config.mqttRxQueueLength;
+    currentConfig.spiRxQueueLength = config.spiRxQueueLength;
+    currentConfig.spiQueueSize = config.spiQueueSize;
+    currentConfig.spiTransactionLength = config.spiTransactionLength;
+    currentConfig.spiPollTicks = config.spiPollTicks;
+    currentConfig.publisherPollMs = config.publisherPollMs;
+    applyLogLevels(previous, config);
+    currentConfig.logLevel = config.logLevel;
+    currentConfig.tagLogLevelCount = config.tagLogLevelCount;
+    std::memcpy(currentConfig.tagLogLevels, config.tagLogLevels, sizeof(currentConfig.tagLogLevels));
+
+    save(currentConfig);
+    return "applied";
+}
+
+
+static void publishStatus(const char *result, const char *error) {
+    char msg[APP_SPI_MESSAGE_CAPACITY + 1];
+    if (result) {
+        std::snprintf(msg, sizeof(msg), "%s" CONFIG_STATUS_SUFFIX ",{\"ok\":true,\"result\":\"%s\"}",
+            configTopic, result);
+    } else {
+        std::snprintf(msg, sizeof(msg), "%s" CONFIG_STATUS_SUFFIX ",{\"ok\":false,\"error\":\"%s\"}",
+            configTopic, error);
+    }
+    app_queues_send_upstream(msg);
+}
+
+
+static void handlePayload(const ConfigPayload &payload) {
+    char error[CONFIG_ERROR_CAPACITY] = "";
+    const char *result = nullptr;
+    app_runtime_config_t config;
+
+    if (payload.isTooLong) {
+        formatError(error, sizeof(error), "payload longer than %u bytes", CONFIG_PAYLOAD_CAPACITY);
+    } else if (parsePayload(payload.data, payload.length, config, error, sizeof(error))) {
+        result = apply(config, error, sizeof(error));
+    }
+
+    if (result) {
+        ESP_LOGI(LOG_TAG, "Configuration %s: queues %u/%u, SPI %u x %u bytes, poll %u ticks/%u ms, log level %s.",
+            result, currentConfig.mqttRxQueueLength, currentConfig.spiRxQueueLength,
+            currentConfig.spiQueueSize, currentConfig.spiTransactionLength,
+            currentConfig.spiPollTicks, currentConfig.publisherPollMs, LOG_LEVEL_NAMES[currentConfig.logLevel]);
+    } else {
+        ESP_LOGE(LOG_TAG, "Configuration rejected: %s.", error);
+    }
+    publishStatus(result, error);
+}
+
+
+static void app_config_task_callback(void *parameters) {
+    while(1) {
+        if (xQueueReceive(payloadQueue, &pendingPayload, portMAX_DELAY) == pdTRUE) {
+            handlePayload(pendingPayload);
+        }
+    }
+}
+
+
+//-------------------------------------
+// C wrappers.
+//-------------------------------------
+void app_runtime_config_init(void) {
+    uint8_t mac[6] = {};
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    configTopicLength = std::snprintf(configTopic, sizeof(configTopic), "%s/%02x%02x%02x%02x%02x%02x",
+        CONFIG_APP_CONFIG_TOPIC_PREFIX, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+    load();
+    applyLogLevels(DEFAULT_CONFIG, currentConfig);
+
+    for (unsigned stage = 0; stage < APP_STAGE_COUNT; ++stage) {
+        resumeSemaphores[stage] = xSemaphoreCreateBinaryStatic(&resumeSemaphoreBuffers[stage]);
+        configASSERT(resumeSemaphores[stage]);
+    }
+    payloadQueue = xQueueCreateStatic(1, sizeof(ConfigPayload), payloadQueueStorage, &payloadQueueBuffer);
+    configASSERT(payloadQueue);
+
+    TaskHandle_t taskHandle = NULL;
+    BaseType_t result = xTaskCreatePinnedToCore(
+        app_config_task_callback,
+        CONFIG_TASK_NAME,
+        CONFIG_TASK_STACK_DEPTH,
+        NULL,                   //constpvParameters
+        CONFIG_TASK_PRIORITY,   //uxPriority
+        &taskHandle,            //constpvCreatedTask
+        tskNO_AFFINITY          //xCoreID
+    );
+    if (result == pdPASS) {
+        app_stack_register(taskHandle, CONFIG_TASK_NAME, CONFIG_TASK_STACK_DEPTH);
+    } else {
+        ESP_LOGE(LOG_TAG, "app_runtime_config_init(): xTaskCreatePinnedToCore(...) failed! Config messages are ignored.");
+    }
+
+    ESP_LOGI(LOG_TAG, "Config topic: %s", configTopic);
+}
+
+
+const char *app_runtime_config_topic(void) {
+    return configTopic;
+}
+
+
+bool app_runtime_config_is_topic(const char *topic, size_t topicLength) {
+    return configTopicLength > 0 && topicLength == configTopicLength
+        && std::memcmp(topic, configTopic, topicLength) == 0;
+}
+
+
+bool app_runtime_config_parse(const char *data, size_t dataLength, app_runtime_config_t *config,
+                              char *error, size_t errorSize) {
+    return parsePayload(data, dataLength, *config, error, errorSize);
+}
+
+
+esp_err_t app_runtime_config_receive(const char *data, size_t dataLength, size_t offset, size_t totalLength) {
+    if (offset == 0) {
+        receivedPayload.length = 0;
+        receivedPayload.isTooLong = totalLength > CONFIG_PAYLOAD_CAPACITY;
+    }
+    if (!receivedPayload.isTooLong) {
+        if (offset + dataLength > CONFIG_PAYLOAD_CAPACITY) {
+            receivedPayload.isTooLong = true;
+        } else {
+            std::memcpy(receivedPayload.data + offset, data, dataLength);
+            receivedPayload.length = static_cast<uint16_t>(offset + dataLength);
+        }
+    }
+    if (offset + dataLength < totalLength) {
+        return ESP_OK;
+    }
+
+    if (!payloadQueue) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xQueueOverwrite(payloadQueue, &receivedPayload);
+    return receivedPayload.isTooLong ? ESP_ERR_INVALID_SIZE : ESP_OK;
+}
+
+
+void app_runtime_config_join(app_stage_t stage) {
+    portENTER_CRITICAL(&parkMux);
+    joinedStages |= 1u << stage;
+    portEXIT_CRITICAL(&parkMux);
+}
+
+
+bool app_runtime_config_is_pause_requested(app_stage_t stage) {
+    return (requestedStages & (1u << stage)) != 0;
+}
+
+
+void app_runtime_config_park(app_stage_t stage) {
+    uint32_t bit = 1u << stage;
+
+    // The request may have been withdrawn since the caller checked.
+    portENTER_CRITICAL(&parkMux);
+    bool isParking = (requestedStages & bit) != 0;
+    if (isParking) {
+        parkedStages |= bit;
+    }
+    portEXIT_CRITICAL(&parkMux);
+
+    if (isParking) {
+        xSemaphoreTake(resumeSemaphores[stage], portMAX_DELAY);
+    }
+}
+
+#endif // CONFIG_APP_RUNTIME_CONFIG
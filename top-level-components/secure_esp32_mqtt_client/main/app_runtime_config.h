@@ -0,0 +1,116 @@
+/*  app_runtime_config.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+#ifndef _APP_RUNTIME_CONFIG_H_
+#define _APP_RUNTIME_CONFIG_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#include "app_pipeline.h"
+
+
+//------------------------------------------------------------------------------
+// Pipeline tuning that can change without reflashing.
+//
+// Each device subscribes to "<CONFIG_APP_CONFIG_TOPIC_PREFIX>/<mac>", normally
+// a retained message. The payload is JSON or the binary encoding below. Keys
+// that are left out take their defaults, so the same message always gives
+// the same configuration, and an empty payload goes back to the defaults.
+// A valid configuration is applied and saved to NVS, and is loaded again at
+// boot. The outcome is published to "<topic>/status".
+//
+// Poll delays and log levels apply straight away. Queue lengths and the SPI
+// transaction pool are rebuilt at a quiescent point: the producers are held
+// at the queue gate (app_queues_gate_enter()), then the SPI task and the
+// publisher drain their input and park. If that takes too long the change is
+// abandoned and reported.
+//
+// Binary encoding, little endian, also used for NVS:
+//   0  'R' 'C' APP_CONFIG_BINARY_VERSION logLevel
+//   4  mqttRxQueueLength spiRxQueueLength spiQueueSize spiTransactionLength  (uint16)
+//   12 spiPollTicks publisherPollMs                                          (uint16)
+//   16 tagLogLevelCount, then per tag: tag length, tag, level                (uint8)
+//
+// Enabled with CONFIG_APP_RUNTIME_CONFIG. When it is disabled the defaults
+// are used and nothing is subscribed.
+//------------------------------------------------------------------------------
+#define APP_CONFIG_BINARY_VERSION 1
+#define APP_CONFIG_MAX_TAG_LEVELS 4
+#define APP_CONFIG_TAG_CAPACITY   16  // Including the terminator.
+
+typedef struct {
+    char tag[APP_CONFIG_TAG_CAPACITY];
+    uint8_t level;                  // esp_log_level_t.
+} app_tag_log_level_t;
+
+typedef struct {
+    uint16_t mqttRxQueueLength;     // mqttReceivedQueue, 1 to APP_QUEUE_MAX_LENGTH.
+    uint16_t spiRxQueueLength;      // spiReceivedQueue, 1 to APP_QUEUE_MAX_LENGTH.
+    uint16_t spiQueueSize;          // Transactions in the SPI pool and driver queue.
+    uint16_t spiTransactionLength;  // In bytes, a multiple of 4. Must suit the peripheral.
+    uint16_t spiPollTicks;          // How long the SPI task waits on each of its sources.
+    uint16_t publisherPollMs;       // How long the publisher waits for upstream messages.
+    uint8_t logLevel;               // esp_log_level_t for "*".
+    uint8_t tagLogLevelCount;
+    app_tag_log_level_t tagLogLevels[APP_CONFIG_MAX_TAG_LEVELS];
+} app_runtime_config_t;
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// C wrappers.
+// The configuration in effect. Always valid, even before app_runtime_config_init().
+extern const app_runtime_config_t *app_runtime_config_get(void);
+
+#if CONFIG_APP_RUNTIME_CONFIG
+
+// Boot stage, after NVS: loads the saved configuration, applies its log
+// levels and builds the topic. Queues and SPI are sized from it afterwards.
+extern void app_runtime_config_init(void);
+// The device's config topic, to subscribe to.
+extern const char *app_runtime_config_topic(void);
+extern bool app_runtime_config_is_topic(const char *topic, size_t topicLength);
+// Parses and validates a payload as the config task would, without applying
+// it. On failure error holds the reason published to "<topic>/status".
+extern bool app_runtime_config_parse(const char *data, size_t dataLength, app_runtime_config_t *config,
+                                     char *error, size_t errorSize);
+// Called from the MQTT task with each part of a message on the config topic.
+extern esp_err_t app_runtime_config_receive(const char *data, size_t dataLength, size_t offset, size_t totalLength);
+
+// Quiescent points. The SPI task and the publisher join at start, and check
+// app_runtime_config_is_pause_requested() once per pass. When it is true
+// and their input is drained they call app_runtime_config_park(), which
+// returns once the change has been applied.
+extern void app_runtime_config_join(app_stage_t stage);
+extern bool app_runtime_config_is_pause_requested(app_stage_t stage);
+extern void app_runtime_config_park(app_stage_t stage);
+
+#else
+
+static inline void app_runtime_config_init(void) { }
+static inline void app_runtime_config_join(app_stage_t stage) { (void)stage; }
+static inline bool app_runtime_config_is_pause_requested(app_stage_t stage) { (void)stage; return false; }
+static inline void app_runtime_config_park(app_stage_t stage) { (void)stage; }
+
+#endif // CONFIG_APP_RUNTIME_CONFIG
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // _APP_RUNTIME_CONFIG_H_
@@ -9,15 +9,20 @@
     CONDITIONS OF ANY KIND, either express or implied.
 */
 
+#include <cstdio>
 #include <cstring>
-#include <string>
 #include "esp_system.h"
 #include "esp_log.h"
 //#include "soc/gpio_struct.h"
 #include "driver/gpio.h"
 #include "driver/spi_slave.h"
 
+#include "app_actuator_state.h"
+#include "app_deferred_log.h"
+#include "app_mqtt.h"
+#include "app_pipeline.h"
 #include "app_queues.h"
+#include "app_runtime_config.h"
 #include "app_spi.h"
 
 
@@ -34,12 +39,15 @@ static const gpio_num_t PIN_NUM_CS   = GPIO_NUM_32; // ** GPIO5 is STRAPPING **
 static const gpio_num_t PIN_NUM_HANDSHAKE = GPIO_NUM_33; // OUTPUT - Set to HIGH when requesting to send to the Master.
 #define GPIO_SEL_HANDSHAKE_PIN GPIO_SEL_33
 
-static const char       *APP_SPI_TASK_NAME = "App SPI";
-static const uint32_t    APP_SPI_STACK_DEPTH = 4000;
-static const UBaseType_t APP_SPI_DEFAULT_TASK_PRIORITY = 5;
-
 static AppSPI static_app_spi;
 
+// Messages from the peripheral that start with this are latest-value queries:
+//   "?topic" - the cached value of one topic.
+//   "?"      - every cached value.
+// Each cached value is sent as a normal "topic,data" message and the reply
+// always ends with "?,<number of values sent>".
+static const char CACHE_QUERY_PREFIX = '?';
+
 
 //-------------------------------------
 //
@@ -122,8 +130,6 @@ typedef struct {
 
 
 void AppSPI::connect() {
-    esp_err_t ret;
-
     //Configure handshake line as output
     gpio_config_t gpioConfig {
         GPIO_SEL_HANDSHAKE_PIN, //uint64_t pin_bit_mask
@@ -139,6 +145,13 @@ void AppSPI::connect() {
     gpio_set_pull_mode(PIN_NUM_CLK,  GPIO_PULLUP_ONLY);
     gpio_set_pull_mode(PIN_NUM_CS,   GPIO_PULLUP_ONLY);
 
+    initializeSlave();
+}
+
+
+void AppSPI::initializeSlave() {
+    esp_err_t ret;
+
     spi_bus_config_t busConfig = {
         PIN_NUM_MOSI, //mosi_io_num
         PIN_NUM_MISO, //miso_io_num
@@ -163,28 +176,79 @@ void AppSPI::connect() {
     //Initialize SPI slave interface
     ret = spi_slave_initialize(VSPI_HOST, &busConfig, &slaveConfig, 1);
     ESP_ERROR_CHECK(ret);
+    isSlaveInitialized = true;
+}
+
+
+esp_err_t AppSPI::reconfigure(unsigned queueSize, unsigned transactionLength) {
+    if (queueSize == transactionPool.poolSize && transactionLength == transactionPool.transactionLength) {
+        return ESP_OK;
+    }
+    if (txPendingCount != 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // The driver keeps queue_size, so it goes down and comes back up with the pool.
+    bool wasInitialized = isSlaveInitialized;
+    if (wasInitialized) {
+        ESP_ERROR_CHECK(spi_slave_free(VSPI_HOST));
+        isSlaveInitialized = false;
+    }
+    esp_err_t err_code = transactionPool.resize(queueSize, transactionLength);
+    if (wasInitialized) {
+        initializeSlave();
+    }
+
+    if (err_code != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "reconfigure(%u, %u) failed, err_code=0x%x. Kept %u x %u bytes.",
+            queueSize, transactionLength, err_code, transactionPool.poolSize, transactionPool.transactionLength);
+        return err_code;
+    }
+    ESP_LOGI(LOG_TAG, "reconfigure(): %u transactions of %u bytes.", queueSize, transactionLength);
+    return ESP_OK;
 }
 
 
 void AppSPI::taskStart() {
+    AppHeapScope heapScope(APP_HEAP_SPI);
+    // Before taskFirstTime(), which queues the first transactions.
+    txPendingCount = 0;
     taskFirstTime();
     task();
 }
 
 
 void AppSPI::taskFirstTime() {
+    // Put the actuators back the way they were before anything else goes over the link.
+    unsigned restoredCount = app_get_actuator_state_store().replay(restoreCallback, this);
+    ESP_LOGI(LOG_TAG, "taskFirstTime(): %u actuator value(s) sent to the peripheral.", restoredCount);
+
     AppMQTTQueueNode pingNode{ "ping", 4, "ready", 5 };
     processMqttNode(pingNode);
 }
 
 
+void AppSPI::restoreCallback(void *context, const char *topic, size_t topicSize, const char *data, size_t dataSize) {
+    AppSPI *appSPI = static_cast<AppSPI *>(context);
+    AppMQTTQueueNode node(topic, topicSize, data, dataSize);
+
+    // The pool may not hold every restored value at once, so wait for the master to collect some.
+    while (!appSPI->canQueueString(topicSize + 1 + dataSize)) {
+        appSPI->processCompletedSpiTransaction();
+    }
+    appSPI->processMqttNode(node);
+}
+
+
 void AppSPI::task() {
-    txPendingCount = 0;
+    app_runtime_config_join(APP_STAGE_SPI_LINK);
 
     while(1) {
-        ESP_LOGI(LOG_TAG, "AppSPI::task() - loop.");
+        APP_DLOG("AppSPI::task() - loop.");
         processIncomingMqttMessages();
+        processCacheQuery();
         processCompletedSpiTransaction();
+        parkIfRequested();
     }//while(1)
 
     // This should never be reached, but just incase...
@@ -195,8 +259,19 @@ void AppSPI::task() {
 }
 
 
+// Parks only once every transaction is back and nothing is left for the peripheral,
+// so the queues and the pool can be rebuilt under us.
+void AppSPI::parkIfRequested() {
+    if (app_runtime_config_is_pause_requested(APP_STAGE_SPI_LINK)
+        && txPendingCount == 0
+        && uxQueueMessagesWaiting(mqttReceivedQueue) == 0) {
+        app_runtime_config_park(APP_STAGE_SPI_LINK);
+    }
+}
+
+
 void AppSPI::processIncomingMqttMessages() {
-    TickType_t queueReceiveDelay = 1;
+    TickType_t queueReceiveDelay = app_runtime_config_get()->spiPollTicks;
 
     // TODO: uncomment the following if/when appropriate...
     //if (txPendingCount == 0) {
@@ -207,9 +282,22 @@ void AppSPI::processIncomingMqttMessages() {
 
     AppMQTTQueueNode node;
     esp_err_t err_code = node.queueReceive(mqttReceivedQueue, queueReceiveDelay);
-    if (err_code == ESP_OK) {
-        processMqttNode(node);
+    if (err_code != ESP_OK) {
+        return;
+    }
+
+    size_t strSize = node.getTopic().size() + 1 + node.getData().size();
+    if (strSize > getMaxMessageSize()) {
+        ESP_LOGE(LOG_TAG, "processIncomingMqttMessages(): %u byte message is larger than the transaction pool, dropped!\ntopic:%s",
+            static_cast<unsigned>(strSize), node.getTopic().c_str());
+        return;
+    }
+
+    // A long message needs several transactions, so wait for the master to collect enough of them.
+    while (!canQueueString(strSize)) {
+        processCompletedSpiTransaction();
     }
+    processMqttNode(node);
 }
 
 
@@ -246,24 +334,27 @@ void AppSPI::processIncomingMqttMessages() {
 
 
 void AppSPI::processMqttNode(const AppMQTTQueueNode &node) {
-    ESP_LOGD(LOG_TAG,
-        "AppSPI::processMqttNode()\ntopic:%s\ndata:%s",
-        node.getTopic().c_str(), node.getData().c_str()
-    );
+    APP_DLOG("AppSPI::processMqttNode(): topic %u bytes, data %u bytes", node.getTopic().size(), node.getData().size());
 
-    //std::stringstream sstr << node.getTopic() << ',' << node.getData();
-    std::string str;
-    str.reserve( node.getTopic().size() + node.getData().size() + 1 );
-    str = node.getTopic() + ',' + node.getData();
+    SpiMessageString str(node.getTopic());
+    str.append(',');
+    str.append(node.getData());
+
+#if CONFIG_APP_LATENCY_TRACE
+    txStamps = &node.getStamps();
+    queueString(str);
+    txStamps = nullptr;
+#else
     queueString(str);
+#endif
 }
 
 
-void AppSPI::queueString(const std::string &str) {
+void AppSPI::queueString(StringView str) {
     esp_err_t err_code;
     spi_slave_transaction_t *slaveTrans;
     TickType_t ticks_to_wait = 1;
-    const char *sendPtr = str.c_str();
+    const char *sendPtr = str.data();
     size_t sendLength = str.size() + 1; // Add 1 to force inclusion of the string null terminator.
 
     for (size_t sendIndex = 0;
@@ -274,8 +365,9 @@ void AppSPI::queueString(const std::string &str) {
         slaveTrans = transactionPool.getFromPool();
         configASSERT(slaveTrans);
 
-        slaveTrans->length = transactionPool.transactionLength;
-        slaveTrans->trans_len = transactionPool.transactionLength;
+        // The driver counts in bits.
+        slaveTrans->length = transactionPool.transactionLength * 8;
+        slaveTrans->trans_len = slaveTrans->length;
         std::memset((void*)slaveTrans->tx_buffer, 0, transactionPool.transactionLength);
         std::memset(slaveTrans->rx_buffer, 0, transactionPool.transactionLength);
         slaveTrans->user = (void *)this;
@@ -284,7 +376,18 @@ void AppSPI::queueString(const std::string &str) {
         if (copyNum > transactionPool.transactionLength) {
             copyNum = transactionPool.transactionLength;
         }
-        std::memcpy((void*)slaveTrans->tx_buffer, (sendPtr + sendIndex), copyNum);
+        // str need not be null terminated; the terminator comes from the memset above.
+        size_t strCopyNum = (sendIndex + copyNum > str.size()) ? str.size() - sendIndex : copyNum;
+        std::memcpy((void*)slaveTrans->tx_buffer, (sendPtr + sendIndex), strCopyNum);
+
+#if CONFIG_APP_LATENCY_TRACE
+        // The message is delivered when its last fragment is.
+        if (txStamps && sendIndex + copyNum == sendLength) {
+            LatencyStamps stamps = *txStamps;
+            APP_LATENCY_STAMP(stamps, spiQueuedUs);
+            transactionPool.setTrace(slaveTrans, stamps);
+        }
+#endif
 
         err_code = spi_slave_queue_trans(VSPI_HOST, slaveTrans, ticks_to_wait);
         if (err_code == ESP_OK) {
@@ -297,9 +400,72 @@ void AppSPI::queueString(const std::string &str) {
 }
 
 
+bool AppSPI::canQueueString(size_t strSize) const {
+    // Add 1 for the string null terminator.
+    unsigned transactionCount = (strSize + 1 + transactionPool.transactionLength - 1) / transactionPool.transactionLength;
+    return transactionPool.availableCount() >= transactionCount;
+}
+
+
+void AppSPI::startCacheQuery(StringView query) {
+    if (isCacheQueryPending) {
+        ESP_LOGW(LOG_TAG, "startCacheQuery(...): previous query still in progress, ignored: %.*s",
+            static_cast<int>(query.size()), query.data());
+        return;
+    }
+
+    isCacheQueryPending = true;
+    isCacheQueryAll = (query.size() == 1);
+    // A topic too long to fit can not be in the cache, so the reply is just the terminator.
+    cacheQueryTopic.assign(query.substr(1));
+    cacheQueryIndex = 0;
+    cacheQueryReplyCount = 0;
+}
+
+
+// Sends at most one reply per pass so that the query never starves the
+// transaction pool or the regular MQTT traffic.
+// The cache may change between passes, so a full dump is a best effort snapshot.
+void AppSPI::processCacheQuery() {
+    if (!isCacheQueryPending) {
+        return;
+    }
+
+    TopicValueCache &cache = app_mqtt_get_topic_cache();
+    AppMQTTQueueNode node;
+    bool isDone = true;
+
+    if (isCacheQueryAll) {
+        if (cache.getByIndex(cacheQueryIndex, node) == ESP_OK) {
+            isDone = false;
+        }
+    } else if (cacheQueryIndex == 0) {
+        if (!cacheQueryTopic.truncated() && cache.get(cacheQueryTopic, node) == ESP_OK) {
+            isDone = false;
+        }
+    }
+
+    if (!isDone) {
+        if (canQueueString(node.getTopic().size() + 1 + node.getData().size())) {
+            processMqttNode(node);
+            ++cacheQueryIndex;
+            ++cacheQueryReplyCount;
+        }
+        return;
+    }
+
+    FixedString<16> terminator;
+    terminator.appendFormat("%c,%u", CACHE_QUERY_PREFIX, cacheQueryReplyCount);
+    if (canQueueString(terminator.size())) {
+        queueString(terminator);
+        isCacheQueryPending = false;
+    }
+}
+
+
 void AppSPI::processCompletedSpiTransaction() {
     spi_slave_transaction_t *slaveTrans = nullptr;
-    TickType_t ticks_to_wait = 1;
+    TickType_t ticks_to_wait = app_runtime_config_get()->spiPollTicks;
     esp_err_t err_code = spi_slave_get_trans_result(VSPI_HOST, &slaveTrans, ticks_to_wait);
     //esp_err_t spi_slave_get_trans_result(spi_host_device_t host, spi_slave_transaction_t **trans_desc, TickType_t ticks_to_wait)
     //ESP_ERR_INVALID_ARG if parameter is invalid
@@ -309,7 +475,17 @@ void AppSPI::processCompletedSpiTransaction() {
 
         //Process slaveTrans->rx_buffer
         //i.e. re-assemble and queue up MQTT commands.
-        reassembleAndQueueRxMessage( static_cast<const char*>(slaveTrans->rx_buffer), slaveTrans->trans_len );
+        // trans_len is in bits; a short transaction ends part way through the buffer.
+        reassembleAndQueueRxMessage( static_cast<const char*>(slaveTrans->rx_buffer), slaveTrans->trans_len / 8 );
+
+#if CONFIG_APP_LATENCY_TRACE
+        // Stamped when this task collects the result, so it includes up to one pass of the loop.
+        LatencyStamps stamps;
+        if (transactionPool.takeTrace(slaveTrans, stamps)) {
+            APP_LATENCY_STAMP(stamps, spiDoneUs);
+            app_latency_record(stamps);
+        }
+#endif
 
         transactionPool.returnToPool(slaveTrans);
         atomicIncrementTxPendingCount(-1);
@@ -335,18 +511,22 @@ void AppSPI::reassembleAndQueueRxMessage(const char *rxBuffer, const size_t buff
     for (size_t index = 0; index < bufferLength; ++index) {
         ch = rxBuffer[index];
         if (ch) {
-            pendingRxBuffer += ch;
-        } else {
-            // When the null terminator is reached then queue the buffered string.
-            if (pendingRxBuffer.size() > 0) {
-                AppSPIQueueNode node(pendingRxBuffer.c_str());
-                esp_err_t err_code = node.queueSendToBack(spiReceivedQueue);
-                //if (err_code != ESP_OK) {
-                //}
-
-                pendingRxBuffer = ""; // clear the buffer but don't release its memory.
-            }
+            pendingRxBuffer.append(ch);
+            continue;
         }
+
+        // When the null terminator is reached then queue the buffered string.
+        if (pendingRxBuffer.truncated()) {
+            ESP_LOGE(LOG_TAG, "reassembleAndQueueRxMessage(...): message longer than %u bytes dropped!\n%.32s...",
+                APP_SPI_MESSAGE_CAPACITY, pendingRxBuffer.c_str());
+        } else if (pendingRxBuffer.size() > 0 && pendingRxBuffer[0] == CACHE_QUERY_PREFIX) {
+            // Answered locally, never published.
+            startCacheQuery(pendingRxBuffer);
+        } else if (pendingRxBuffer.size() > 0) {
+            AppSPIQueueNode node(pendingRxBuffer);
+            node.queueSendToBack(spiReceivedQueue);
+        }
+        pendingRxBuffer.clear();
     }
 }
 
@@ -377,42 +557,31 @@ static void app_spi_task_callback( void * parameters ) {
 
 esp_err_t app_spi_init(void) {
     TaskHandle_t taskHandle = NULL;
-    UBaseType_t priority = APP_SPI_DEFAULT_TASK_PRIORITY;
-    esp_err_t err_code = ESP_OK;
 
-    static_app_spi.connect();
-
-    /*
-    #if (configUSE_TRACE_FACILITY == 1)
-    // Get the priority of the task currently running
-    // so the this new task can have the same priority.
-    TaskHandle_t currTask = xTaskGetCurrentTaskHandle();
-    if (currTask) {
-        TaskStatus_t taskDetails;
-        vTaskGetInfo(currTask, &taskDetails, pdFALSE, eReady);
-        priority = taskDetails.uxCurrentPriority;
+    // static_app_spi was built with the defaults, before the saved configuration was loaded.
+    const app_runtime_config_t *config = app_runtime_config_get();
+    if (static_app_spi.reconfigure(config->spiQueueSize, config->spiTransactionLength) != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "app_spi_init(): keeping the default transaction pool.");
     }
-    #endif
-    */
-    ESP_LOGI(LOG_TAG, "app_spi_init(): App SPI task to run at priority %d!", static_cast<int>(priority));
-
-    BaseType_t result = xTaskCreatePinnedToCore(
-        app_spi_task_callback,
-        APP_SPI_TASK_NAME,
-        APP_SPI_STACK_DEPTH,
-        &static_app_spi, //constpvParameters
-        priority,        //uxPriority
-        &taskHandle,     //constpvCreatedTask
-        APP_CPU_NUM      //xCoreID
-    );
+    static_app_spi.connect();
 
-    if(result == pdPASS) {
+    esp_err_t err_code = app_pipeline_create_task(APP_STAGE_SPI_LINK, app_spi_task_callback, &static_app_spi, &taskHandle);
+    if (err_code == ESP_OK) {
         static_app_spi.setTaskHandle(taskHandle);
     } else {
-        err_code = ESP_ERR_NO_MEM;
-        ESP_LOGE(LOG_TAG, "app_spi_init(): xTaskCreatePinnedToCore(...) failed!");
+        ESP_LOGE(LOG_TAG, "app_spi_init(): the App SPI task could not be created!");
         ESP_ERROR_CHECK(err_code);
     }
 
     return err_code;
 }
+
+
+size_t app_spi_get_max_message_size(void) {
+    return static_app_spi.getMaxMessageSize();
+}
+
+
+esp_err_t app_spi_reconfigure(unsigned queueSize, unsigned transactionLength) {
+    return static_app_spi.reconfigure(queueSize, transactionLength);
+}
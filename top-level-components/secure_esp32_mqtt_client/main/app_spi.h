@@ -11,25 +11,34 @@
 #ifndef _APP_SPI_H_
 #define _APP_SPI_H_
 
+// Until app_runtime_config.h says otherwise.
+#define APP_SPI_DEFAULT_QUEUE_SIZE          6
+#define APP_SPI_DEFAULT_TRANSACTION_LENGTH  32
+
 
 //-------------------
 #ifdef __cplusplus
-#include <sstream>
 #include "esp_system.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+
+#include "app_fixed_string.h"
+#include "app_heap_stats.h"
+#include "app_latency_trace.h"
+#include "app_queues.h"
 //#include "soc/gpio_struct.h"
 //#include "driver/gpio.h"
-//#include "driver/spi_slave.h"
+#include "driver/spi_slave.h"
 
 
 //------------------------------------------------------------------------------
 // Very Light Weight memory pool.
 class SPISlaveTransactionPool {
 public:
-    const unsigned poolSize;
-    const unsigned transactionLength;
+    // Only change with resize().
+    unsigned poolSize;
+    unsigned transactionLength;
 
     // transactionLength MUST be divisible by 4!!!
     SPISlaveTransactionPool(unsigned poolSize, unsigned transactionLength) 
@@ -37,38 +46,35 @@ public:
         , transactionLength(transactionLength)
     {
         // TODO: assert that transactionLength is divisible by 4!
-
-        poolItems = static_cast<PoolItem *>( malloc(sizeof(PoolItem) * poolSize) );
+        poolItems = allocateItems(poolSize, transactionLength);
         configASSERT(poolItems);
-
-        for (unsigned poolIndex = 0; poolIndex < poolSize; ++poolIndex) {
-            spi_slave_transaction_t *spiSlaveTrans = static_cast<spi_slave_transaction_t *>( malloc(sizeof(spi_slave_transaction_t)) );
-            configASSERT(spiSlaveTrans);
-            spiSlaveTrans->length = transactionLength * 8; // in bits!
-            spiSlaveTrans->trans_len = spiSlaveTrans->length;
-            spiSlaveTrans->user = nullptr;
-
-            spiSlaveTrans->tx_buffer = heap_caps_malloc(transactionLength, MALLOC_CAP_32BIT | MALLOC_CAP_DMA);
-            configASSERT(spiSlaveTrans->tx_buffer);
-            spiSlaveTrans->rx_buffer = heap_caps_malloc(transactionLength, MALLOC_CAP_32BIT | MALLOC_CAP_DMA);
-            configASSERT(spiSlaveTrans->rx_buffer);
-
-            poolItems[poolIndex].spiSlaveTransaction = spiSlaveTrans;
-            poolItems[poolIndex].isInUse = false;
-        }
     }
 
     virtual ~SPISlaveTransactionPool() {
-        for (unsigned poolIndex = 0; poolIndex < poolSize; ++poolIndex) {
-            spi_slave_transaction_t *spiSlaveTrans = poolItems[poolIndex].spiSlaveTransaction;
-            free((void*)spiSlaveTrans->tx_buffer);
-            free(spiSlaveTrans->rx_buffer);
-            free(spiSlaveTrans);
-        }
-        free(poolItems);
+        freeItems(poolItems, poolSize);
         poolItems = nullptr;
     }
 
+    // NOT TREAD SAFE!!! Every transaction must be back in the pool.
+    // On failure the pool is left as it was.
+    esp_err_t resize(unsigned newPoolSize, unsigned newTransactionLength) {
+        if (newPoolSize == 0 || newTransactionLength == 0 || newTransactionLength % 4 != 0) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (availableCount() != poolSize) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        PoolItem *newItems = allocateItems(newPoolSize, newTransactionLength);
+        if (!newItems) {
+            return ESP_ERR_NO_MEM;
+        }
+        freeItems(poolItems, poolSize);
+        poolItems = newItems;
+        poolSize = newPoolSize;
+        transactionLength = newTransactionLength;
+        return ESP_OK;
+    }
+
     // NOT TREAD SAFE!!!
     spi_slave_transaction_t * getFromPool() {
         for (unsigned poolIndex = 0; poolIndex < poolSize; ++poolIndex) {
@@ -82,6 +88,17 @@ public:
         return nullptr;
     }
 
+    // NOT TREAD SAFE!!!
+    unsigned availableCount() const {
+        unsigned count = 0;
+        for (unsigned poolIndex = 0; poolIndex < poolSize; ++poolIndex) {
+            if (!poolItems[poolIndex].isInUse) {
+                ++count;
+            }
+        }
+        return count;
+    }
+
     // MIGHT BE TREAD SAFE???
     void returnToPool(spi_slave_transaction_t *spiSlaveTransaction) {
         if (!spiSlaveTransaction) {
@@ -92,18 +109,106 @@ public:
         for (unsigned poolIndex = 0; poolIndex < poolSize; ++poolIndex) {
             if (spiSlaveTransaction == poolItems[poolIndex].spiSlaveTransaction) {
                 poolItems[poolIndex].isInUse = false;
+#if CONFIG_APP_LATENCY_TRACE
+                poolItems[poolIndex].isTraced = false;
+#endif
                 return;
             }
         }
         // TODO: FAIL! Throw an exception!
     }
 
+#if CONFIG_APP_LATENCY_TRACE
+    // NOT TREAD SAFE!!!
+    // Attach the stamps of the message whose last fragment is spiSlaveTransaction.
+    void setTrace(spi_slave_transaction_t *spiSlaveTransaction, const LatencyStamps &stamps) {
+        PoolItem *poolItem = find(spiSlaveTransaction);
+        if (poolItem) {
+            poolItem->stamps = stamps;
+            poolItem->isTraced = true;
+        }
+    }
+
+    // NOT TREAD SAFE!!!
+    bool takeTrace(spi_slave_transaction_t *spiSlaveTransaction, LatencyStamps &stamps) {
+        PoolItem *poolItem = find(spiSlaveTransaction);
+        if (!poolItem || !poolItem->isTraced) {
+            return false;
+        }
+        stamps = poolItem->stamps;
+        poolItem->isTraced = false;
+        return true;
+    }
+#endif
+
 private:
     struct PoolItem {
         spi_slave_transaction_t *spiSlaveTransaction;
         bool isInUse;
+#if CONFIG_APP_LATENCY_TRACE
+        bool isTraced;
+        LatencyStamps stamps;
+#endif
     };
     struct PoolItem *poolItems;
+
+    // Returns nullptr, having freed what it got, if the heap runs out.
+    static PoolItem * allocateItems(unsigned itemCount, unsigned length) {
+        AppHeapScope heapScope(APP_HEAP_SPI);
+
+        PoolItem *items = static_cast<PoolItem *>( app_heap_malloc(sizeof(PoolItem) * itemCount, MALLOC_CAP_DEFAULT) );
+        if (!items) {
+            return nullptr;
+        }
+
+        for (unsigned poolIndex = 0; poolIndex < itemCount; ++poolIndex) {
+            spi_slave_transaction_t *spiSlaveTrans = static_cast<spi_slave_transaction_t *>( app_heap_malloc(sizeof(spi_slave_transaction_t), MALLOC_CAP_DEFAULT) );
+            if (spiSlaveTrans) {
+                spiSlaveTrans->length = length * 8; // in bits!
+                spiSlaveTrans->trans_len = spiSlaveTrans->length;
+                spiSlaveTrans->user = nullptr;
+                spiSlaveTrans->tx_buffer = app_heap_malloc(length, MALLOC_CAP_32BIT | MALLOC_CAP_DMA);
+                spiSlaveTrans->rx_buffer = app_heap_malloc(length, MALLOC_CAP_32BIT | MALLOC_CAP_DMA);
+            }
+
+            items[poolIndex].spiSlaveTransaction = spiSlaveTrans;
+            items[poolIndex].isInUse = false;
+#if CONFIG_APP_LATENCY_TRACE
+            items[poolIndex].isTraced = false;
+#endif
+            if (!spiSlaveTrans || !spiSlaveTrans->tx_buffer || !spiSlaveTrans->rx_buffer) {
+                freeItems(items, poolIndex + 1);
+                return nullptr;
+            }
+        }
+        return items;
+    }
+
+    static void freeItems(PoolItem *items, unsigned itemCount) {
+        if (!items) {
+            return;
+        }
+        for (unsigned poolIndex = 0; poolIndex < itemCount; ++poolIndex) {
+            spi_slave_transaction_t *spiSlaveTrans = items[poolIndex].spiSlaveTransaction;
+            if (spiSlaveTrans) {
+                app_heap_free((void*)spiSlaveTrans->tx_buffer);
+                app_heap_free(spiSlaveTrans->rx_buffer);
+                app_heap_free(spiSlaveTrans);
+            }
+        }
+        app_heap_free(items);
+    }
+
+#if CONFIG_APP_LATENCY_TRACE
+    PoolItem * find(spi_slave_transaction_t *spiSlaveTransaction) {
+        for (unsigned poolIndex = 0; poolIndex < poolSize; ++poolIndex) {
+            if (spiSlaveTransaction == poolItems[poolIndex].spiSlaveTransaction) {
+                return &poolItems[poolIndex];
+            }
+        }
+        return nullptr;
+    }
+#endif
 };
 
 
@@ -111,16 +216,25 @@ private:
 class AppSPI {
 public:
     // transactionLength MUST be divisible by 4!!!
-    AppSPI(const unsigned queueSize = 4, const unsigned transactionLength = 32);
+    AppSPI(const unsigned queueSize = APP_SPI_DEFAULT_QUEUE_SIZE,
+           const unsigned transactionLength = APP_SPI_DEFAULT_TRANSACTION_LENGTH);
     virtual ~AppSPI() { }
 
     void connect();
+    // Rebuilds the transaction pool and the driver for a new geometry.
+    // Only call while the SPI task is parked (see app_runtime_config.h).
+    esp_err_t reconfigure(unsigned queueSize, unsigned transactionLength);
     void taskStart();
 
     void setTaskHandle(TaskHandle_t taskHandle) {
         this->taskHandle = taskHandle;
     }
 
+    // The longest "topic,data" string the transaction pool can hold, without the terminator.
+    size_t getMaxMessageSize() const {
+        return transactionPool.poolSize * transactionPool.transactionLength - 1;
+    }
+
 private:
     //TODO: see 'void AppSPI::connect()'
     //      implement busConfig and slaveConfig here if AppSPI::connect() is failing.
@@ -128,15 +242,33 @@ private:
     //spi_slave_interface_config_t  slaveConfig;
     TaskHandle_t taskHandle = nullptr;
     SPISlaveTransactionPool transactionPool;
-    //std::stringstream rxStream;
-    std::string pendingRxBuffer;
+    bool isSlaveInitialized = false;
+    SpiMessageString pendingRxBuffer;
     volatile int txPendingCount = 0;
 
+    // A latest-value query from the peripheral, answered a few messages at a time.
+    bool isCacheQueryPending = false;
+    bool isCacheQueryAll = false;
+    MqttTopicString cacheQueryTopic;
+    unsigned cacheQueryIndex = 0;
+    unsigned cacheQueryReplyCount = 0;
+
+#if CONFIG_APP_LATENCY_TRACE
+    // Stamps of the message queueString() is sending, if it is traced.
+    const LatencyStamps *txStamps = nullptr;
+#endif
+
+    void initializeSlave();
     void task();
     void taskFirstTime();
+    void parkIfRequested();
+    static void restoreCallback(void *context, const char *topic, size_t topicSize, const char *data, size_t dataSize);
     void processIncomingMqttMessages();
     void processMqttNode(const AppMQTTQueueNode &node);
-    void queueString(const std::string &str);
+    void queueString(StringView str);
+    bool canQueueString(size_t strSize) const;
+    void startCacheQuery(StringView query);
+    void processCacheQuery();
     void processCompletedSpiTransaction();
     inline void atomicIncrementTxPendingCount(int incrementValue);
     void reassembleAndQueueRxMessage(const char *rxBuffer, const size_t bufferLength);
@@ -152,8 +284,11 @@ extern "C"
 {
 #endif
 
-// C wrapper.
+// C wrappers.
 extern esp_err_t app_spi_init(void);
+extern size_t app_spi_get_max_message_size(void);
+// See AppSPI::reconfigure().
+extern esp_err_t app_spi_reconfigure(unsigned queueSize, unsigned transactionLength);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,226 @@
+/*  app_stack_monitor.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include "app_stack_monitor.h"
+
+#if CONFIG_APP_STACK_REPORT
+#include <cstring>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include "app_queues.h"
+#include "app_spi.h"
+
+
+static const char *LOG_TAG = "APP_STACK";
+
+// Never recommend less headroom than this, whatever the measured use.
+static const uint32_t STACK_MARGIN_MIN_BYTES = 512;
+
+// Boot stages, long lived tasks and the ESP-MQTT task.
+#define MAX_WATCHED_TASKS 20
+
+struct WatchedTask {
+    TaskHandle_t task;      // NULL once the task has exited.
+    const char *name;
+    uint32_t stackDepth;
+    uint32_t minFreeBytes;  // Only kept up to date for exited tasks.
+};
+
+// Tasks register from both cores.
+static portMUX_TYPE watchedMux = portMUX_INITIALIZER_UNLOCKED;
+static WatchedTask watchedTasks[MAX_WATCHED_TASKS];
+static unsigned watchedCount = 0;
+
+
+static uint32_t recommendedDepth(uint32_t usedBytes) {
+    uint32_t margin = usedBytes / 4;
+    if (margin < STACK_MARGIN_MIN_BYTES) {
+        margin = STACK_MARGIN_MIN_BYTES;
+    }
+    return (usedBytes + margin + 255) & ~255u;
+}
+
+
+//-------------------------------------
+// C wrappers.
+//-------------------------------------
+void app_stack_register(TaskHandle_t task, const char *name, uint32_t stackDepth) {
+    if (!task) {
+        task = xTaskGetCurrentTaskHandle();
+    }
+
+    bool isFull = false;
+    portENTER_CRITICAL(&watchedMux);
+    bool isKnown = false;
+    for (unsigned index = 0; index < watchedCount; ++index) {
+        if (watchedTasks[index].task == task) {
+            isKnown = true;
+            break;
+        }
+    }
+    if (!isKnown) {
+        if (watchedCount < MAX_WATCHED_TASKS) {
+            WatchedTask &watched = watchedTasks[watchedCount++];
+            watched.task = task;
+            watched.name = name;
+            watched.stackDepth = stackDepth;
+            watched.minFreeBytes = stackDepth;
+        } else {
+            isFull = true;
+        }
+    }
+    portEXIT_CRITICAL(&watchedMux);
+
+    if (isFull) {
+        ESP_LOGW(LOG_TAG, "app_stack_register(%s): more than %d tasks, not watched.", name, MAX_WATCHED_TASKS);
+    }
+}
+
+
+void app_stack_task_exiting(void) {
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    uint32_t minFreeBytes = uxTaskGetStackHighWaterMark(NULL);
+
+    portENTER_CRITICAL(&watchedMux);
+    for (unsigned index = 0; index < watchedCount; ++index) {
+        if (watchedTasks[index].task == task) {
+            watchedTasks[index].task = NULL;
+            watchedTasks[index].minFreeBytes = minFreeBytes;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&watchedMux);
+}
+
+
+void app_stack_report(void) {
+    uint32_t totalDepth = 0;
+    uint32_t totalRecommended = 0;
+
+    ESP_LOGI(LOG_TAG, "Task stacks, in bytes:");
+    for (unsigned index = 0; ; ++index) {
+        // The mark is read under the lock so the task can not exit half way.
+        portENTER_CRITICAL(&watchedMux);
+        if (index >= watchedCount) {
+            portEXIT_CRITICAL(&watchedMux);
+            break;
+        }
+        WatchedTask watched = watchedTasks[index];
+        if (watched.task) {
+            watched.minFreeBytes = uxTaskGetStackHighWaterMark(watched.task);
+        }
+        portEXIT_CRITICAL(&watchedMux);
+
+        uint32_t usedBytes = (watched.stackDepth > watched.minFreeBytes) ? watched.stackDepth - watched.minFreeBytes : 0;
+        uint32_t recommended = recommendedDepth(usedBytes);
+        totalDepth += watched.stackDepth;
+        totalRecommended += recommended;
+
+        if (watched.minFreeBytes < STACK_MARGIN_MIN_BYTES) {
+            ESP_LOGW(LOG_TAG, "  %-16s size %5u  used %5u  free %5u  recommended %5u  <- LOW",
+                watched.name, watched.stackDepth, usedBytes, watched.minFreeBytes, recommended);
+        } else {
+            ESP_LOGI(LOG_TAG, "  %-16s size %5u  used %5u  free %5u  recommended %5u%s",
+                watched.name, watched.stackDepth, usedBytes, watched.minFreeBytes, recommended,
+                watched.task ? "" : "  (exited)");
+        }
+    }
+    ESP_LOGI(LOG_TAG, "  total size %u, recommended %u.", totalDepth, totalRecommended);
+}
+
+
+#if CONFIG_APP_STACK_STRESS
+//-------------------------------------
+// Stress run.
+//-------------------------------------
+static const char *STRESS_TOPIC_PREFIX = "stress/";
+static const unsigned STRESS_ROUNDS = 8;
+// Without a master the SPI task stops taking messages once its pool is full.
+static const TickType_t STRESS_SEND_TIMEOUT = 1000 / portTICK_PERIOD_MS;
+static const TickType_t STRESS_DRAIN_TIMEOUT = 5000 / portTICK_PERIOD_MS;
+
+
+// "stress/ttt...", exactly length bytes long.
+static void fillTopic(char *buffer, size_t length) {
+    size_t prefixLength = std::strlen(STRESS_TOPIC_PREFIX);
+    std::memset(buffer, 't', length);
+    std::memcpy(buffer, STRESS_TOPIC_PREFIX, (length < prefixLength) ? length : prefixLength);
+}
+
+
+static void queueDownstream(const char *topic, size_t topicSize, const char *data, size_t dataSize) {
+    AppMQTTQueueNode node(topic, topicSize, data, dataSize);
+    node.queueSendToBack(mqttReceivedQueue, STRESS_SEND_TIMEOUT);
+}
+
+
+static void queueUpstream(const char *msg, size_t length) {
+    AppSPIQueueNode node(StringView(msg, length));
+    node.queueSendToBack(spiReceivedQueue, STRESS_SEND_TIMEOUT);
+}
+
+
+void app_stack_stress_run(void) {
+    ESP_LOGW(LOG_TAG, "app_stack_stress_run(): driving the worst case paths, verbose logging on.");
+    esp_log_level_set("*", ESP_LOG_VERBOSE);
+
+    char topic[APP_MQTT_TOPIC_CAPACITY];
+    char data[APP_MQTT_DATA_CAPACITY];
+    char msg[APP_SPI_MESSAGE_CAPACITY];
+    fillTopic(topic, sizeof(topic));
+    std::memset(data, 'd', sizeof(data));
+
+    // The largest downstream message that fits the SPI transaction pool.
+    size_t maxMessageSize = app_spi_get_max_message_size();
+    size_t dataSize = (maxMessageSize > sizeof(topic) + 1) ? maxMessageSize - sizeof(topic) - 1 : 0;
+    if (dataSize > sizeof(data)) {
+        dataSize = sizeof(data);
+    }
+
+    for (unsigned round = 0; round < STRESS_ROUNDS; ++round) {
+        // Downstream: the largest message AppSPI takes, then one too large for it.
+        queueDownstream(topic, sizeof(topic), data, dataSize);
+        if (dataSize < sizeof(data)) {
+            queueDownstream(topic, sizeof(topic), data, sizeof(data));
+        }
+
+        // Upstream: a full message with the longest topic the publisher accepts.
+        fillTopic(msg, APP_MQTT_TOPIC_CAPACITY);
+        msg[APP_MQTT_TOPIC_CAPACITY] = ',';
+        std::memset(msg + APP_MQTT_TOPIC_CAPACITY + 1, 'd', sizeof(msg) - APP_MQTT_TOPIC_CAPACITY - 1);
+        queueUpstream(msg, sizeof(msg));
+
+        // Upstream error paths: a topic that is too long, then no separator at all.
+        fillTopic(msg, sizeof(msg));
+        msg[APP_MQTT_TOPIC_CAPACITY + 8] = ',';
+        queueUpstream(msg, sizeof(msg));
+        fillTopic(msg, sizeof(msg));
+        queueUpstream(msg, sizeof(msg));
+    }
+
+    TickType_t startTicks = xTaskGetTickCount();
+    while ((uxQueueMessagesWaiting(mqttReceivedQueue) > 0 || uxQueueMessagesWaiting(spiReceivedQueue) > 0)
+           && xTaskGetTickCount() - startTicks < STRESS_DRAIN_TIMEOUT) {
+        vTaskDelay(100 / portTICK_PERIOD_MS);
+    }
+    // Let the last message of each queue finish.
+    vTaskDelay(1000 / portTICK_PERIOD_MS);
+
+    esp_log_level_set("*", ESP_LOG_INFO);
+    ESP_LOGW(LOG_TAG, "app_stack_stress_run(): done.");
+    app_stack_report();
+}
+#endif // CONFIG_APP_STACK_STRESS
+
+#endif // CONFIG_APP_STACK_REPORT
@@ -0,0 +1,73 @@
+/*  app_stack_monitor.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+#ifndef _APP_STACK_MONITOR_H_
+#define _APP_STACK_MONITOR_H_
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+
+//------------------------------------------------------------------------------
+// Stack high-water marks of our tasks.
+//
+// Every task we create registers its handle and stack depth. app_stack_report()
+// logs how much of each stack has ever been used and recommends a size: the
+// bytes used plus a quarter, at least STACK_MARGIN_MIN_BYTES, rounded up to
+// 256 bytes. Short lived tasks call app_stack_task_exiting() before deleting
+// themselves so their final mark is kept.
+//
+// The marks only mean something once the worst case paths have run. With
+// CONFIG_APP_STACK_STRESS, app_stack_stress_run() drives them on purpose.
+//
+// Enabled with CONFIG_APP_STACK_REPORT. When it is disabled the functions
+// below do nothing.
+//------------------------------------------------------------------------------
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if CONFIG_APP_STACK_REPORT
+
+// C wrappers.
+// task may be NULL for the calling task. name must outlive the task.
+// Registering the same task again is ignored.
+extern void app_stack_register(TaskHandle_t task, const char *name, uint32_t stackDepth);
+// Records the calling task's final mark. Call just before vTaskDelete(NULL).
+extern void app_stack_task_exiting(void);
+// Logs the mark and recommended size of every registered task.
+extern void app_stack_report(void);
+
+#if CONFIG_APP_STACK_STRESS
+// Sends maximum size and malformed messages through the SPI and publisher
+// tasks with verbose logging on, waits for them to drain and reports.
+// Junk goes to the peripheral and, if connected, the broker, under "stress/".
+extern void app_stack_stress_run(void);
+#endif
+
+#else
+
+static inline void app_stack_register(TaskHandle_t task, const char *name, uint32_t stackDepth) {
+    (void)task; (void)name; (void)stackDepth;
+}
+static inline void app_stack_task_exiting(void) { }
+static inline void app_stack_report(void) { }
+
+#endif // CONFIG_APP_STACK_REPORT
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // _APP_STACK_MONITOR_H_
@@ -0,0 +1,214 @@
+/*  app_subscriptions.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <cstring>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+
+#include "app_hash.h"
+#include "app_subscriptions.h"
+
+
+static const char *LOG_TAG = "APP_SUBSCRIPTIONS";
+
+static const char *NVS_NAMESPACE = "app_subs";
+static const char *NVS_KEY_TABLE_HASH = "tableHash";
+
+
+SubscriptionTracker::SubscriptionTracker(const MqttSubscription *table, unsigned tableSize)
+    : table(table)
+    , tableSize(tableSize)
+{
+    configASSERT(tableSize <= MAX_SUBSCRIPTIONS);
+    disconnected();
+}
+
+
+esp_err_t SubscriptionTracker::subscribeAll(esp_mqtt_client_handle_t client, bool isSessionPresent) {
+    this->client = client;
+    connectedUs = esp_timer_get_time();
+
+    // Some filters are only filled in at boot, so hash the table here.
+    tableHash = hashTable();
+    if (isSessionPresent) {
+        loadTableHash();
+        if (storedTableHash == tableHash) {
+            portENTER_CRITICAL(&statesMux);
+            for (unsigned index = 0; index < tableSize; ++index) {
+                states[index].isAcked = true;
+            }
+            ackedCount = tableSize;
+            portEXIT_CRITICAL(&statesMux);
+            ESP_LOGI(LOG_TAG, "subscribeAll(...): session present, %u subscription(s) kept by the broker.", tableSize);
+            return ESP_OK;
+        }
+        ESP_LOGI(LOG_TAG, "subscribeAll(...): session present, but the subscription table has changed.");
+    }
+
+    unsigned sentCount = subscribeMissing();
+    ESP_LOGI(LOG_TAG, "subscribeAll(...): %u SUBSCRIBE request(s) sent.", sentCount);
+    return (sentCount == tableSize) ? ESP_OK : ESP_FAIL;
+}
+
+
+// Sends a SUBSCRIBE for every filter that has not been acknowledged.
+unsigned SubscriptionTracker::subscribeMissing() {
+    unsigned sentCount = 0;
+
+    for (unsigned index = 0; index < tableSize; ++index) {
+        portENTER_CRITICAL(&statesMux);
+        bool isAcked = states[index].isAcked;
+        portEXIT_CRITICAL(&statesMux);
+        if (isAcked) {
+            continue;
+        }
+
+        const MqttSubscription &subscription = table[index];
+        int msg_id = esp_mqtt_client_subscribe(client, subscription.topicFilter, subscription.qos);
+        if (msg_id < 0) {
+            ESP_LOGE(LOG_TAG, "subscribeMissing(): esp_mqtt_client_subscribe(%s) failed!", subscription.topicFilter);
+            continue;
+        }
+
+        portENTER_CRITICAL(&statesMux);
+        states[index].msg_id = msg_id;
+        portEXIT_CRITICAL(&statesMux);
+        ESP_LOGV(LOG_TAG, "subscribeMissing(): %s, qos=%d, msg_id=%d", subscription.topicFilter, subscription.qos, msg_id);
+        ++sentCount;
+    }
+
+    portENTER_CRITICAL(&statesMux);
+    retryAtUs = (ackedCount == tableSize) ? 0 : esp_timer_get_time() + SUBACK_TIMEOUT_US;
+    portEXIT_CRITICAL(&statesMux);
+    return sentCount;
+}
+
+
+void SubscriptionTracker::subscribed(int msg_id) {
+    bool isFound = false;
+    bool isAllAcked = false;
+
+    portENTER_CRITICAL(&statesMux);
+    for (unsigned index = 0; index < tableSize; ++index) {
+        SubscriptionState &state = states[index];
+        if (!state.isAcked && state.msg_id == msg_id) {
+            state.isAcked = true;
+            ++ackedCount;
+            isFound = true;
+            break;
+        }
+    }
+    isAllAcked = ackedCount == tableSize;
+    if (isFound && isAllAcked) {
+        retryAtUs = 0;
+    }
+    portEXIT_CRITICAL(&statesMux);
+
+    if (isFound && isAllAcked) {
+        ESP_LOGI(LOG_TAG, "subscribed(...): all %u subscription(s) acknowledged %lld ms after connect.",
+            tableSize, static_cast<long long>((esp_timer_get_time() - connectedUs) / 1000));
+        saveTableHash();
+    }
+}
+
+
+void SubscriptionTracker::disconnected() {
+    portENTER_CRITICAL(&statesMux);
+    for (unsigned index = 0; index < tableSize; ++index) {
+        states[index].msg_id = -1;
+        states[index].isAcked = false;
+    }
+    ackedCount = 0;
+    retryAtUs = 0;
+    portEXIT_CRITICAL(&statesMux);
+}
+
+
+void SubscriptionTracker::retryIfDue(int64_t nowUs) {
+    unsigned missingCount = 0;
+
+    portENTER_CRITICAL(&statesMux);
+    if (retryAtUs != 0 && nowUs >= retryAtUs) {
+        // Taken here, so a retry is never sent twice.
+        retryAtUs = 0;
+        missingCount = tableSize - ackedCount;
+    }
+    portEXIT_CRITICAL(&statesMux);
+
+    if (missingCount == 0) {
+        return;
+    }
+    ESP_LOGW(LOG_TAG, "retryIfDue(...): %u of %u subscription(s) not acknowledged, resubscribing.",
+        missingCount, tableSize);
+    subscribeMissing();
+}
+
+
+bool SubscriptionTracker::isComplete() const {
+    portENTER_CRITICAL(&statesMux);
+    bool isAllAcked = ackedCount == tableSize;
+    portEXIT_CRITICAL(&statesMux);
+    return isAllAcked;
+}
+
+
+//-------------------------------------
+// Table hash, in NVS.
+//-------------------------------------
+uint32_t SubscriptionTracker::hashTable() const {
+    uint32_t hash = FNV1A_OFFSET_BASIS;
+    for (unsigned index = 0; index < tableSize; ++index) {
+        const char *topicFilter = table[index].topicFilter;
+        // The terminator too, so "a" + "bc" differs from "ab" + "c".
+        hash = fnv1a(topicFilter, std::strlen(topicFilter) + 1, hash);
+        char qos = static_cast<char>(table[index].qos);
+        hash = fnv1a(&qos, 1, hash);
+    }
+    return hash;
+}
+
+
+void SubscriptionTracker::loadTableHash() {
+    if (isStoredTableHashLoaded) {
+        return;
+    }
+    nvs_handle nvsHandle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvsHandle) == ESP_OK) {
+        nvs_get_u32(nvsHandle, NVS_KEY_TABLE_HASH, &storedTableHash);
+        nvs_close(nvsHandle);
+    }
+    isStoredTableHashLoaded = true;
+}
+
+
+// Only written when the table changes, so once per firmware update.
+void SubscriptionTracker::saveTableHash() {
+    loadTableHash();
+    if (storedTableHash == tableHash) {
+        return;
+    }
+
+    nvs_handle nvsHandle;
+    esp_err_t err_code = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvsHandle);
+    if (err_code == ESP_OK) {
+        err_code = nvs_set_u32(nvsHandle, NVS_KEY_TABLE_HASH, tableHash);
+        if (err_code == ESP_OK) {
+            err_code = nvs_commit(nvsHandle);
+        }
+        nvs_close(nvsHandle);
+    }
+    if (err_code != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "saveTableHash(): failed, err_code=0x%x", err_code);
+        return;
+    }
+    storedTableHash = tableHash;
+}
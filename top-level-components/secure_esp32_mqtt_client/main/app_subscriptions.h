@@ -0,0 +1,90 @@
+/*  app_subscriptions.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+#ifndef _APP_SUBSCRIPTIONS_H_
+#define _APP_SUBSCRIPTIONS_H_
+
+
+//-------------------
+#ifdef __cplusplus
+#include "freertos/FreeRTOS.h"
+#include "mqtt_client.h"
+
+
+struct MqttSubscription {
+    const char *topicFilter;
+    int qos;
+};
+
+
+//------------------------------------------------------------------------------
+// Keeps the broker subscribed to every entry of a subscription table.
+//
+// On connect all SUBSCRIBE requests are sent back to back without waiting for
+// the SUBACKs, so becoming operational costs about one round-trip however many
+// topics there are. SUBACKs are matched by msg_id and only the filters that
+// were never acknowledged are sent again.
+//
+// A broker that kept our session also kept our subscriptions, but only those
+// of the firmware that made them. A hash of the table is kept in NVS once
+// every filter is acknowledged, and if the table has changed since, a kept
+// session is subscribed to again.
+class SubscriptionTracker {
+public:
+    static const unsigned MAX_SUBSCRIPTIONS = 16;
+    static const int64_t SUBACK_TIMEOUT_US = 5LL * 1000 * 1000;
+
+    SubscriptionTracker(const MqttSubscription *table, unsigned tableSize);
+    virtual ~SubscriptionTracker() { }
+
+    // Called on MQTT_EVENT_CONNECTED.
+    esp_err_t subscribeAll(esp_mqtt_client_handle_t client, bool isSessionPresent);
+    // Called on MQTT_EVENT_SUBSCRIBED.
+    void subscribed(int msg_id);
+    // Called on MQTT_EVENT_DISCONNECTED.
+    void disconnected();
+    // Resends the filters still missing SUBACK_TIMEOUT_US after they were sent.
+    // Called from the publisher task, which already makes the client's other
+    // requests, so no SUBSCRIBE goes out from the esp_timer task.
+    void retryIfDue(int64_t nowUs);
+
+    bool isComplete() const;
+
+private:
+    struct SubscriptionState {
+        int msg_id;
+        bool isAcked;
+    };
+
+    const MqttSubscription *table;
+    const unsigned tableSize;
+    SubscriptionState states[MAX_SUBSCRIPTIONS];
+    unsigned ackedCount = 0;
+
+    mutable portMUX_TYPE statesMux = portMUX_INITIALIZER_UNLOCKED;
+    esp_mqtt_client_handle_t client = nullptr;
+    int64_t connectedUs = 0;
+    int64_t retryAtUs = 0;      // 0 while no retry is pending.
+
+    uint32_t tableHash = 0;
+    uint32_t storedTableHash = 0;
+    bool isStoredTableHashLoaded = false;
+
+    unsigned subscribeMissing();
+    uint32_t hashTable() const;
+    void loadTableHash();
+    void saveTableHash();
+};
+
+#endif //__cplusplus
+//-------------------
+
+
+#endif // _APP_SUBSCRIPTIONS_H_
@@ -0,0 +1,156 @@
+/*  app_topic_cache.cpp
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <cstring>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "app_heap_stats.h"
+#include "app_topic_cache.h"
+
+
+static const char *LOG_TAG = "APP_TOPIC_CACHE";
+
+
+TopicValueCache::TopicValueCache(unsigned maxEntries, size_t maxBytes)
+    : maxEntries(maxEntries)
+    , maxBytes(maxBytes)
+{
+    AppHeapScope heapScope(APP_HEAP_MQTT);
+    entries = new CacheEntry[maxEntries];
+    arena = new char[maxBytes];
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    mutex = xSemaphoreCreateMutexStatic(&mutexBuffer);
+#else
+    mutex = xSemaphoreCreateMutex();
+#endif
+    configASSERT(mutex);
+}
+
+
+TopicValueCache::~TopicValueCache() {
+    delete [] entries;
+    entries = nullptr;
+    delete [] arena;
+    arena = nullptr;
+    vSemaphoreDelete(mutex);
+    mutex = nullptr;
+}
+
+
+int TopicValueCache::find(const char *topic, size_t topicSize) const {
+    for (unsigned index = 0; index < entryCount; ++index) {
+        const CacheEntry &entry = entries[index];
+        if (entry.topicSize == topicSize && std::memcmp(topicOf(entry), topic, topicSize) == 0) {
+            return static_cast<int>(index);
+        }
+    }
+    return -1;
+}
+
+
+// Closes the gap in the arena, so free space is always at the end.
+void TopicValueCache::removeAt(unsigned index) {
+    size_t offset = entries[index].offset;
+    size_t size = entries[index].topicSize + entries[index].dataSize;
+
+    std::memmove(arena + offset, arena + offset + size, byteCount - offset - size);
+    byteCount -= size;
+    for (unsigned other = 0; other < entryCount; ++other) {
+        if (entries[other].offset > offset) {
+            entries[other].offset -= size;
+        }
+    }
+
+    --entryCount;
+    if (index != entryCount) {
+        entries[index] = entries[entryCount];
+    }
+}
+
+
+void TopicValueCache::evictLeastRecent() {
+    unsigned oldestIndex = 0;
+    for (unsigned index = 1; index < entryCount; ++index) {
+        // Unsigned subtraction keeps this correct across counter wraparound.
+        if (updateCounter - entries[index].lastUpdate > updateCounter - entries[oldestIndex].lastUpdate) {
+            oldestIndex = index;
+        }
+    }
+    ESP_LOGV(LOG_TAG, "evictLeastRecent(): %.*s",
+        static_cast<int>(entries[oldestIndex].topicSize), topicOf(entries[oldestIndex]));
+    removeAt(oldestIndex);
+}
+
+
+void TopicValueCache::update(const char *topic, size_t topicSize, const char *data, size_t dataSize) {
+    size_t entryBytes = topicSize + dataSize;
+    if (!topic || topicSize == 0 || entryBytes > maxBytes) {
+        return;
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    int index = find(topic, topicSize);
+    if (index >= 0) {
+        removeAt(static_cast<unsigned>(index));
+    }
+    while (entryCount > 0 && (entryCount >= maxEntries || byteCount + entryBytes > maxBytes)) {
+        evictLeastRecent();
+    }
+
+    CacheEntry &entry = entries[entryCount++];
+    entry.offset = byteCount;
+    entry.topicSize = topicSize;
+    entry.dataSize = dataSize;
+    entry.lastUpdate = ++updateCounter;
+    std::memcpy(arena + byteCount, topic, topicSize);
+    std::memcpy(arena + byteCount + topicSize, data, dataSize);
+    byteCount += entryBytes;
+
+    xSemaphoreGive(mutex);
+}
+
+
+esp_err_t TopicValueCache::get(StringView topic, AppMQTTQueueNode &node) {
+    esp_err_t err_code = ESP_ERR_NOT_FOUND;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    int index = find(topic.data(), topic.size());
+    if (index >= 0) {
+        const CacheEntry &entry = entries[index];
+        node = AppMQTTQueueNode(topicOf(entry), entry.topicSize, dataOf(entry), entry.dataSize);
+        err_code = ESP_OK;
+    }
+    xSemaphoreGive(mutex);
+    return err_code;
+}
+
+
+esp_err_t TopicValueCache::getByIndex(unsigned index, AppMQTTQueueNode &node) {
+    esp_err_t err_code = ESP_ERR_NOT_FOUND;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    if (index < entryCount) {
+        const CacheEntry &entry = entries[index];
+        node = AppMQTTQueueNode(topicOf(entry), entry.topicSize, dataOf(entry), entry.dataSize);
+        err_code = ESP_OK;
+    }
+    xSemaphoreGive(mutex);
+    return err_code;
+}
+
+
+unsigned TopicValueCache::getCount() {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    unsigned count = entryCount;
+    xSemaphoreGive(mutex);
+    return count;
+}
@@ -0,0 +1,80 @@
+/*  app_topic_cache.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+#ifndef _APP_TOPIC_CACHE_H_
+#define _APP_TOPIC_CACHE_H_
+
+
+//-------------------
+#ifdef __cplusplus
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "app_fixed_string.h"
+#include "app_queues.h"
+
+
+//------------------------------------------------------------------------------
+// The latest value received for each topic, so the peripheral can ask for the
+// current state instead of waiting for the broker to send it again.
+//
+// Bounded by both the number of topics and the total bytes held.
+// The least recently updated topic is evicted first.
+// All the memory is allocated up front, an update never allocates.
+// Filled by the MQTT task and read by the SPI task.
+class TopicValueCache {
+public:
+    TopicValueCache(unsigned maxEntries = 32, size_t maxBytes = 4096);
+    virtual ~TopicValueCache();
+
+    void update(const char *topic, size_t topicSize, const char *data, size_t dataSize);
+
+    // Copy the cached value of one topic into node.
+    // Returns ESP_ERR_NOT_FOUND if the topic has no cached value.
+    esp_err_t get(StringView topic, AppMQTTQueueNode &node);
+    // Copy the value at index (0 .. getCount()-1) into node.
+    esp_err_t getByIndex(unsigned index, AppMQTTQueueNode &node);
+
+    unsigned getCount();
+
+private:
+    // The topic and then the data, packed into arena from offset.
+    struct CacheEntry {
+        size_t offset;
+        size_t topicSize;
+        size_t dataSize;
+        uint32_t lastUpdate;
+    };
+
+    const unsigned maxEntries;
+    const size_t maxBytes;
+    CacheEntry *entries;
+    char *arena;            // maxBytes long. Entries are kept packed from the start.
+    unsigned entryCount = 0;
+    size_t byteCount = 0;
+    uint32_t updateCounter = 0;
+    SemaphoreHandle_t mutex = nullptr;
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    StaticSemaphore_t mutexBuffer;
+#endif
+
+    const char * topicOf(const CacheEntry &entry) const { return arena + entry.offset; }
+    const char * dataOf(const CacheEntry &entry) const  { return arena + entry.offset + entry.topicSize; }
+
+    int find(const char *topic, size_t topicSize) const;
+    void evictLeastRecent();
+    void removeAt(unsigned index);
+};
+
+#endif //__cplusplus
+//-------------------
+
+
+#endif // _APP_TOPIC_CACHE_H_
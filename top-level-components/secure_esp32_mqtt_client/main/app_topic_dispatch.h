@@ -0,0 +1,173 @@
+/*  app_topic_dispatch.h
+    Created: 2026-10-19
+    Author: Warren Taylor
+
+    This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+    Unless required by applicable law or agreed to in writing, this
+    software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+    CONDITIONS OF ANY KIND, either express or implied.
+*/
+#ifndef _APP_TOPIC_DISPATCH_H_
+#define _APP_TOPIC_DISPATCH_H_
+
+
+//-------------------
+#ifdef __cplusplus
+#include <cstring>
+#include "app_hash.h"
+
+
+//------------------------------------------------------------------------------
+// What to do with a message received on a known topic.
+enum TopicHandlerId {
+    TOPIC_HANDLER_UNKNOWN = 0, // Not in the manifest.
+    TOPIC_HANDLER_FORWARD_TO_SPI,
+    TOPIC_HANDLER_AVR_OTA,      // Firmware for the peripheral, see app_avr_ota.h.
+};
+
+
+struct TopicManifestEntry {
+    const char *topic;
+    size_t topicLength;
+    TopicHandlerId handlerId;
+    // Actuator state: the last value is kept in NVS and replayed to the peripheral on boot.
+    bool isPersistent;
+};
+
+#define TOPIC_MANIFEST_ENTRY(topic, handlerId, isPersistent) { topic, sizeof(topic) - 1, handlerId, isPersistent }
+
+
+//------------------------------------------------------------------------------
+// Every topic known at build time.
+constexpr TopicManifestEntry TOPIC_MANIFEST[] = {
+    //                   topic                  handlerId                       isPersistent
+    TOPIC_MANIFEST_ENTRY("irrigation/zone/on",  TOPIC_HANDLER_FORWARD_TO_SPI,   true),
+#if CONFIG_APP_AVR_OTA
+    TOPIC_MANIFEST_ENTRY(CONFIG_APP_AVR_OTA_TOPIC, TOPIC_HANDLER_AVR_OTA,     false),
+#endif
+};
+
+constexpr size_t TOPIC_MANIFEST_SIZE = sizeof(TOPIC_MANIFEST) / sizeof(TOPIC_MANIFEST[0]);
+
+
+//------------------------------------------------------------------------------
+// Perfect hash over TOPIC_MANIFEST, built by the compiler.
+//
+// The table has at least twice as many slots as topics, and the compiler
+// searches for an FNV-1a seed that puts every topic in its own slot.
+// A lookup is one hash, one table read and one verifying compare.
+//
+// Everything below is C++11 constexpr, so loops are written as recursion.
+namespace topic_dispatch {
+
+constexpr size_t tableSizeFor(size_t count, size_t size = 1) {
+    return size >= 2 * count ? size : tableSizeFor(count, size * 2);
+}
+
+constexpr size_t TABLE_SIZE = tableSizeFor(TOPIC_MANIFEST_SIZE);
+constexpr uint32_t TABLE_MASK = static_cast<uint32_t>(TABLE_SIZE - 1);
+constexpr uint32_t MAX_SEED_TRIES = 128;
+
+// The low bits of an FNV-1a hash depend only on the low bits of the input,
+// so with a small table every seed could give two topics the same slot.
+// The high half is folded in.
+constexpr uint32_t slotForHash(uint32_t hash) {
+    return (hash ^ (hash >> 16)) & TABLE_MASK;
+}
+
+constexpr uint32_t slotOf(size_t index, uint32_t seed) {
+    return slotForHash(fnv1aConst(TOPIC_MANIFEST[index].topic, TOPIC_MANIFEST[index].topicLength, seed));
+}
+
+constexpr bool collidesWithLater(uint32_t seed, size_t index, size_t other) {
+    return other >= TOPIC_MANIFEST_SIZE
+        ? false
+        : (slotOf(index, seed) == slotOf(other, seed) || collidesWithLater(seed, index, other + 1));
+}
+
+constexpr bool isPerfect(uint32_t seed, size_t index = 0) {
+    return index >= TOPIC_MANIFEST_SIZE
+        ? true
+        : (!collidesWithLater(seed, index, index + 1) && isPerfect(seed, index + 1));
+}
+
+constexpr uint32_t findSeed(uint32_t seed, uint32_t triesLeft) {
+    return triesLeft == 0
+        ? 0
+        : (isPerfect(seed) ? seed : findSeed(seed + 1, triesLeft - 1));
+}
+
+constexpr uint32_t SEED = findSeed(FNV1A_OFFSET_BASIS, MAX_SEED_TRIES);
+static_assert(SEED != 0, "No perfect hash seed found for TOPIC_MANIFEST. Increase MAX_SEED_TRIES.");
+
+constexpr int manifestIndexForSlot(uint32_t slot, size_t index = 0) {
+    return index >= TOPIC_MANIFEST_SIZE
+        ? -1
+        : (slotOf(index, SEED) == slot ? static_cast<int>(index) : manifestIndexForSlot(slot, index + 1));
+}
+
+
+// Expands to one manifestIndexForSlot() call per table slot.
+template<size_t... Slots>
+struct IndexSequence {
+    typedef IndexSequence type;
+};
+
+template<size_t Count, size_t... Slots>
+struct MakeIndexSequence : MakeIndexSequence<Count - 1, Count - 1, Slots...> { };
+
+template<size_t... Slots>
+struct MakeIndexSequence<0, Slots...> : IndexSequence<Slots...> { };
+
+template<typename Sequence>
+struct SlotTable;
+
+template<size_t... Slots>
+struct SlotTable< IndexSequence<Slots...> > {
+    static constexpr int8_t manifestIndex[sizeof...(Slots)] = { manifestIndexForSlot(Slots)... };
+};
+
+template<size_t... Slots>
+constexpr int8_t SlotTable< IndexSequence<Slots...> >::manifestIndex[sizeof...(Slots)];
+
+typedef SlotTable< MakeIndexSequence<TABLE_SIZE>::type > Table;
+
+// Every topic must own its slot, or lookupTopicIndex() would miss it.
+constexpr bool isEveryTopicInItsSlot(size_t index = 0) {
+    return index >= TOPIC_MANIFEST_SIZE
+        ? true
+        : (manifestIndexForSlot(slotOf(index, SEED)) == static_cast<int>(index) && isEveryTopicInItsSlot(index + 1));
+}
+static_assert(isPerfect(SEED) && isEveryTopicInItsSlot(), "TOPIC_MANIFEST topics share a slot (is a topic listed twice?).");
+
+} // namespace topic_dispatch
+
+
+// Maps an incoming topic (not null terminated) to its TOPIC_MANIFEST index, or -1.
+inline int lookupTopicIndex(const char *topic, size_t topicLength) {
+    uint32_t slot = topic_dispatch::slotForHash(fnv1a(topic, topicLength, topic_dispatch::SEED));
+    int index = topic_dispatch::Table::manifestIndex[slot];
+    if (index < 0) {
+        return -1;
+    }
+
+    const TopicManifestEntry &entry = TOPIC_MANIFEST[index];
+    if (entry.topicLength != topicLength || std::memcmp(entry.topic, topic, topicLength) != 0) {
+        return -1;
+    }
+    return index;
+}
+
+
+// Maps an incoming topic (not null terminated) to its handler.
+inline TopicHandlerId lookupTopicHandler(const char *topic, size_t topicLength) {
+    int index = lookupTopicIndex(topic, topicLength);
+    return (index < 0) ? TOPIC_HANDLER_UNKNOWN : TOPIC_MANIFEST[index].handlerId;
+}
+
+#endif //__cplusplus
+//-------------------
+
+
+#endif // _APP_TOPIC_DISPATCH_H_
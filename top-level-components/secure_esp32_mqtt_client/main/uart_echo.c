@@ -22,73 +22,139 @@
 #include "driver/uart.h"
 #include "esp_log.h"
 
+#include "app_heap_stats.h"
+#include "app_pipeline.h"
+#include "app_queues.h"
 #include "uart_echo.h"
 
 static const char *LOG_TAG = "uart_echo";
 
 /**
- * This example shows how to use the UART driver to handle special UART events.
+ * UART ingest.
  *
- * It also reads data from UART0 directly, and echoes it to console.
+ * Lines received on UART2 ("topic,data\n") are handed to the publisher through
+ * spiReceivedQueue, exactly like messages from the SPI peripheral.
  *
- * - Port: UART0
+ * The driver's pattern detection marks every '\n', so nothing is read until a
+ * whole line is in the ring buffer and each line is read once, straight into
+ * lineBuffer, at its exact length.
+ *
+ * - Port: UART2
  * - Receive (Rx) buffer: on
  * - Transmit (Tx) buffer: off
  * - Flow control: off
  * - Event queue: on
- * - Pin assignment: TxD (default), RxD (default)
+ * - Pin assignment: TxD 17, RxD 16
  */
 
 #define EX_UART_NUM UART_NUM_2
 
-// Set the number of consecutive and identical characters received by
-// receiver which defines a UART pattern
-//#define PATTERN_CHR_NUM    (3)
+// A single '\n' ends a line.
+#define LINE_TERMINATOR    '\n'
+#define PATTERN_CHR_NUM    (1)
+#define PATTERN_QUEUE_SIZE (20)
 
 #define BUF_SIZE (1024)
-#define RD_BUF_SIZE (BUF_SIZE)
+// The longest line that is passed on, without the terminator.
+#define LINE_BUF_SIZE APP_SPI_MESSAGE_CAPACITY
+
 static QueueHandle_t uart0_queue;
 
+static char lineBuffer[LINE_BUF_SIZE + 1];
+static uint32_t linesReceived = 0;
+static uint32_t linesDropped = 0;
+
+
+// Drops everything buffered, including any pattern positions that refer to it.
+static void uart_discard_input(void)
+{
+    uart_flush_input(EX_UART_NUM);
+    uart_pattern_queue_reset(EX_UART_NUM, PATTERN_QUEUE_SIZE);
+    xQueueReset(uart0_queue);
+}
+
+
+// Reads the line that ends at pos and queues it for publishing.
+static void uart_ingest_line(int pos)
+{
+    uint8_t terminator;
+
+    if (pos > LINE_BUF_SIZE) {
+        // Too long to be a message. Skip it in LINE_BUF_SIZE chunks.
+        while (pos > 0) {
+            int chunk = (pos > LINE_BUF_SIZE) ? LINE_BUF_SIZE : pos;
+            uart_read_bytes(EX_UART_NUM, (uint8_t *)lineBuffer, chunk, 0);
+            pos -= chunk;
+        }
+        uart_read_bytes(EX_UART_NUM, &terminator, PATTERN_CHR_NUM, 0);
+        ++linesDropped;
+        ESP_LOGW(LOG_TAG, "line longer than %d bytes dropped (%u received, %u dropped)",
+            LINE_BUF_SIZE, linesReceived, linesDropped);
+        return;
+    }
+
+    int length = uart_read_bytes(EX_UART_NUM, (uint8_t *)lineBuffer, pos, 0);
+    uart_read_bytes(EX_UART_NUM, &terminator, PATTERN_CHR_NUM, 0);
+    if (length <= 0) {
+        return;
+    }
+
+    // Accept "\r\n" line endings too.
+    if (lineBuffer[length - 1] == '\r') {
+        --length;
+    }
+    if (length == 0) {
+        return;
+    }
+    lineBuffer[length] = '\0';
+
+    if (app_queues_send_upstream(lineBuffer) == ESP_OK) {
+        ++linesReceived;
+    } else {
+        ++linesDropped;
+    }
+}
+
 
 static void uart_event_task(void *pvParameters)
 {
     uart_event_t event;
-//    size_t buffered_size;
-    uint8_t* dtmp = (uint8_t*) malloc(RD_BUF_SIZE);
 
+    app_heap_enter(APP_HEAP_UART);
     for(;;) {
         //Waiting for UART event.
         if(xQueueReceive(uart0_queue, (void * )&event, (portTickType)portMAX_DELAY)) {
-            bzero(dtmp, RD_BUF_SIZE);
-            ESP_LOGI(LOG_TAG, "uart[%d] event:", EX_UART_NUM);
             switch(event.type) {
                 //Event of UART receving data
-                /*We'd better handler data event fast, there would be much more data events than
-                other types of events. If we take too much time on data event, the queue might
-                be full.*/
+                // Left in the ring buffer until the pattern detector finds the end of the line.
                 case UART_DATA:
-                    ESP_LOGI(LOG_TAG, "[UART DATA]: %d", event.size);
-                    uart_read_bytes(EX_UART_NUM, dtmp, event.size, portMAX_DELAY);
-                    ESP_LOGI(LOG_TAG, "[DATA EVT]: %s", (char*)dtmp);
-//                    uart_write_bytes(EX_UART_NUM, (const char*)dtmp, event.size);
                     break;
 
+                case UART_PATTERN_DET: {
+                    int pos = uart_pattern_pop_pos(EX_UART_NUM);
+                    if (pos == -1) {
+                        // The pattern position queue overflowed, so line boundaries are lost.
+                        ESP_LOGE(LOG_TAG, "pattern queue full, input flushed");
+                        uart_discard_input();
+                    } else {
+                        uart_ingest_line(pos);
+                    }
+                    break;
+                }
+
                 //Event of HW FIFO overflow detected
                 case UART_FIFO_OVF:
                     ESP_LOGE(LOG_TAG, "hw fifo overflow");
                     // If fifo overflow happened, you should consider adding flow control for your application.
                     // The ISR has already reset the rx FIFO,
                     // As an example, we directly flush the rx buffer here in order to read more data.
-                    uart_flush_input(EX_UART_NUM);
-                    xQueueReset(uart0_queue);
+                    uart_discard_input();
                     break;
                 //Event of UART ring buffer full
                 case UART_BUFFER_FULL:
                     ESP_LOGE(LOG_TAG, "ring buffer full");
-                    // If buffer full happened, you should consider encreasing your buffer size
-                    // As an example, we directly flush the rx buffer here in order to read more data.
-                    uart_flush_input(EX_UART_NUM);
-                    xQueueReset(uart0_queue);
+                    // No line terminator within BUF_SIZE * 2 bytes. Start again.
+                    uart_discard_input();
                     break;
                 //Event of UART RX break detected
                 case UART_BREAK:
@@ -102,26 +168,6 @@ static void uart_event_task(void *pvParameters)
                 case UART_FRAME_ERR:
                     ESP_LOGE(LOG_TAG, "uart frame error");
                     break;
-                /****
-                case UART_PATTERN_DET:
-                    uart_get_buffered_data_len(EX_UART_NUM, &buffered_size);
-                    int pos = uart_pattern_pop_pos(EX_UART_NUM);
-                    ESP_LOGI(LOG_TAG, "[UART PATTERN DETECTED] pos: %d, buffered size: %d", pos, buffered_size);
-                    if (pos == -1) {
-                        // There used to be a UART_PATTERN_DET event, but the pattern position queue is full so that it can not
-                        // record the position. We should set a larger queue size.
-                        // As an example, we directly flush the rx buffer here.
-                        uart_flush_input(EX_UART_NUM);
-                    } else {
-                        uart_read_bytes(EX_UART_NUM, dtmp, pos, 100 / portTICK_PERIOD_MS);
-                        uint8_t pat[PATTERN_CHR_NUM + 1];
-                        memset(pat, 0, sizeof(pat));
-                        uart_read_bytes(EX_UART_NUM, pat, PATTERN_CHR_NUM, 100 / portTICK_PERIOD_MS);
-                        ESP_LOGI(LOG_TAG, "read data: %s", dtmp);
-                        ESP_LOGI(LOG_TAG, "read pat : %s", pat);
-                    }
-                    break;
-                ****/
                 //Others
                 default:
                     ESP_LOGI(LOG_TAG, "uart event type: %d", event.type);
@@ -129,8 +175,6 @@ static void uart_event_task(void *pvParameters)
             }
         }
     }
-    free(dtmp);
-    dtmp = NULL;
     vTaskDelete(NULL);
 }
 
@@ -151,8 +195,6 @@ void uart_echo_init(void)
     };
     uart_param_config(EX_UART_NUM, &uart_config);
 
-    //esp_log_level_set(LOG_TAG, ESP_LOG_INFO);
-
     // Set UART default pins.
     uart_set_pin(EX_UART_NUM, 17, 16, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
     //esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num);
@@ -161,11 +203,12 @@ void uart_echo_init(void)
     uart_driver_install(EX_UART_NUM, BUF_SIZE * 2, 0, 20, &uart0_queue, 0);
     //esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size, int queue_size, QueueHandle_t* uart_queue, int intr_alloc_flags);
 
-//    //Set uart pattern detect function.
-//    uart_enable_pattern_det_intr(EX_UART_NUM, '+', PATTERN_CHR_NUM, 10000, 10, 10);
-//    //Reset the pattern queue length to record at most 20 pattern positions.
-//    uart_pattern_queue_reset(EX_UART_NUM, 20);
+    //Set uart pattern detect function.
+    // A line terminator is a single character, so no idle time is required around it.
+    uart_enable_pattern_det_intr(EX_UART_NUM, LINE_TERMINATOR, PATTERN_CHR_NUM, 10000, 0, 0);
+    //Reset the pattern queue length to record at most PATTERN_QUEUE_SIZE pattern positions.
+    uart_pattern_queue_reset(EX_UART_NUM, PATTERN_QUEUE_SIZE);
 
     //Create a task to handler UART event from ISR
-    xTaskCreate(uart_event_task, "uart_echo_task", 2048, NULL, 12, NULL);
+    app_pipeline_create_task(APP_STAGE_UART, uart_event_task, NULL, NULL);
 }
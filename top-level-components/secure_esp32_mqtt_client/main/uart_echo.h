@@ -5,8 +5,15 @@
 #ifndef _UART_ECHO_H_
 #define _UART_ECHO_H_
 
+#ifdef __cplusplus
+extern "C"
+{
+#endif
 
 extern void uart_echo_init(void);
 
+#ifdef __cplusplus
+}
+#endif
 
 #endif // _UART_ECHO_H_
@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+#  avr_ota_image.py
+#  Created: 2026-10-19
+#  Author: Warren Taylor
+#
+#  This example code is in the Public Domain (or CC0 licensed, at your option.)
+#
+#  Unless required by applicable law or agreed to in writing, this
+#  software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+#  CONDITIONS OF ANY KIND, either express or implied.
+#
+#  Wraps an AVR flash image in the header main/app_avr_ota.h expects.
+#
+#    (cd ../avr_spi_master && make image)
+#    tools/avr_ota_image.py ../avr_spi_master/spi_master.bin spi_master.ota
+#    mosquitto_pub -r -q 1 -t irrigation/ota/avr -f spi_master.ota
+
+import struct
+import sys
+import zlib
+
+MAGIC = b'AVR1'
+# ATmega168 flash, less the 2K boot section. APP_AVR_OTA_MAX_IMAGE_LENGTH.
+MAX_IMAGE_LENGTH = 16384 - 2048
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.stderr.write('usage: %s <image.bin> <output>\n' % sys.argv[0])
+        return 2
+
+    with open(sys.argv[1], 'rb') as source:
+        image = source.read()
+    if not image or len(image) > MAX_IMAGE_LENGTH:
+        sys.stderr.write('%s: %u bytes, must be 1 to %u\n' % (sys.argv[1], len(image), MAX_IMAGE_LENGTH))
+        return 1
+
+    crc = zlib.crc32(image) & 0xFFFFFFFF
+    with open(sys.argv[2], 'wb') as output:
+        output.write(MAGIC + struct.pack('<II', len(image), crc) + image)
+    sys.stdout.write('%s: %u bytes, CRC %08x\n' % (sys.argv[2], len(image), crc))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
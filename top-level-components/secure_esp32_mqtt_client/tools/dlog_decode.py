@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+#  dlog_decode.py
+#  Created: 2026-10-19
+#  Author: Warren Taylor
+#
+#  This example code is in the Public Domain (or CC0 licensed, at your option.)
+#
+#  Unless required by applicable law or agreed to in writing, this
+#  software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+#  CONDITIONS OF ANY KIND, either express or implied.
+#
+#  Turns the "#DL:" lines printed by APP_DLOG() (main/app_deferred_log.h) back
+#  into text. Every other line is passed through unchanged.
+#
+#    make monitor | tools/dlog_decode.py build/secure_esp32_mqtt_client.elf
+#    tools/dlog_decode.py build/secure_esp32_mqtt_client.elf < captured.log
+
+import re
+import struct
+import sys
+
+DLOG_PREFIX = '#DL:'
+HEADER_WORDS = 3
+
+FORMAT_SPEC = re.compile(r'%([-+ #0]*)(\d*)(?:\.(\d+))?(hh|h|ll|l|z|j|t)?([diouxXcsp%])')
+
+
+class ElfStrings(object):
+    """Reads null terminated strings from the loadable sections of a 32-bit little endian ELF file."""
+
+    SHT_PROGBITS = 1
+
+    def __init__(self, path):
+        with open(path, 'rb') as elf:
+            self.data = elf.read()
+        if self.data[:4] != b'\x7fELF' or self.data[4] != 1:
+            raise ValueError('%s is not a 32-bit ELF file' % path)
+
+        shoff, = struct.unpack_from('<I', self.data, 0x20)
+        shentsize, shnum = struct.unpack_from('<HH', self.data, 0x2E)
+        self.sections = []
+        for index in range(shnum):
+            _, sh_type, _, sh_addr, sh_offset, sh_size = struct.unpack_from(
+                '<IIIIII', self.data, shoff + index * shentsize)
+            if sh_type == self.SHT_PROGBITS and sh_addr != 0:
+                self.sections.append((sh_addr, sh_offset, sh_size))
+
+    def string_at(self, address):
+        for sh_addr, sh_offset, sh_size in self.sections:
+            if sh_addr <= address < sh_addr + sh_size:
+                start = sh_offset + (address - sh_addr)
+                end = self.data.find(b'\0', start, sh_offset + sh_size)
+                if end < 0:
+                    end = sh_offset + sh_size
+                return self.data[start:end].decode('utf-8', 'replace')
+        return None
+
+
+def format_record(strings, fmt, args):
+    args = list(args)
+
+    def convert(match):
+        flags, width, precision, _, conversion = match.groups()
+        if conversion == '%':
+            return '%'
+        if not args:
+            return '<missing>'
+        value = args.pop(0)
+        spec = '%' + flags + width + ('.' + precision if precision else '')
+        if conversion in 'di':
+            value = value - (1 << 32) if value & 0x80000000 else value
+            return (spec + 'd') % value
+        if conversion == 'p':
+            return '0x%08x' % value
+        if conversion == 'c':
+            return (spec + 'c') % chr(value & 0xFF)
+        if conversion == 's':
+            text = strings.string_at(value)
+            return (spec + 's') % (text if text is not None else '<0x%08x>' % value)
+        return (spec + conversion.replace('u', 'd')) % value
+
+    return FORMAT_SPEC.sub(convert, fmt)
+
+
+def decode_line(strings, line):
+    # "#DL:<core>:<8 hex digits per word>"
+    try:
+        core, payload = line[len(DLOG_PREFIX):].strip().split(':', 1)
+        words = [int(payload[index:index + 8], 16) for index in range(0, len(payload), 8)]
+    except ValueError:
+        return line
+    if len(words) < HEADER_WORDS:
+        return line
+
+    fmt_address, timestamp_us, arg_count = words[:HEADER_WORDS]
+    fmt = strings.string_at(fmt_address)
+    if fmt is None:
+        fmt = '<unknown format 0x%08x>' % fmt_address
+    text = format_record(strings, fmt, words[HEADER_WORDS:HEADER_WORDS + arg_count])
+    return 'D (%u.%06u) [core %s] %s\n' % (timestamp_us // 1000000, timestamp_us % 1000000, core, text)
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.stderr.write('usage: %s <elf file> < log\n' % sys.argv[0])
+        return 2
+
+    strings = ElfStrings(sys.argv[1])
+    for line in sys.stdin:
+        index = line.find(DLOG_PREFIX)
+        if index >= 0:
+            line = line[:index] + decode_line(strings, line[index:])
+        sys.stdout.write(line)
+        sys.stdout.flush()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())